@@ -31,6 +31,33 @@ if %ERRORLEVEL% EQU 0 (
         src/main.cpp ^
         src/core/application.cpp ^
         src/ui/main_window.cpp ^
+        src/core/selection.cpp ^
+        src/core/flood_fill.cpp ^
+        src/core/rasterizer.cpp ^
+        src/utils/file_utils.cpp ^
+        src/core/inflate.cpp ^
+        src/core/animation_decoder.cpp ^
+        src/core/gif_decoder.cpp ^
+        src/core/apng_decoder.cpp ^
+        src/core/animation_player.cpp ^
+        src/core/image_prefetcher.cpp ^
+        src/utils/mapped_file.cpp ^
+        src/core/jpeg_decoder.cpp ^
+        src/core/thumbnail_cache.cpp ^
+        src/core/thumbnail_generator.cpp ^
+        src/core/lz4.cpp ^
+        src/core/document.cpp ^
+        src/core/project_file.cpp ^
+        src/utils/scratch_file.cpp ^
+        src/core/tile_store.cpp ^
+        src/core/buffer_pool.cpp ^
+        src/core/frame_arena.cpp ^
+        src/core/parallel.cpp ^
+        src/core/canvas_renderer.cpp ^
+        src/core/render_thread.cpp ^
+        src/core/palette_quantizer.cpp ^
+        src/core/gif_encoder.cpp ^
+        src/core/background_task.cpp ^
         -o build/PixelForge_debug.exe ^
         -lopengl32 -lgdi32 -luser32 -lcomdlg32 -lgdiplus -lcomctl32
     set BUILD_RESULT=%ERRORLEVEL%
@@ -44,6 +71,33 @@ if %ERRORLEVEL% EQU 0 (
         src/main.cpp ^
         src/core/application.cpp ^
         src/ui/main_window.cpp ^
+        src/core/selection.cpp ^
+        src/core/flood_fill.cpp ^
+        src/core/rasterizer.cpp ^
+        src/utils/file_utils.cpp ^
+        src/core/inflate.cpp ^
+        src/core/animation_decoder.cpp ^
+        src/core/gif_decoder.cpp ^
+        src/core/apng_decoder.cpp ^
+        src/core/animation_player.cpp ^
+        src/core/image_prefetcher.cpp ^
+        src/utils/mapped_file.cpp ^
+        src/core/jpeg_decoder.cpp ^
+        src/core/thumbnail_cache.cpp ^
+        src/core/thumbnail_generator.cpp ^
+        src/core/lz4.cpp ^
+        src/core/document.cpp ^
+        src/core/project_file.cpp ^
+        src/utils/scratch_file.cpp ^
+        src/core/tile_store.cpp ^
+        src/core/buffer_pool.cpp ^
+        src/core/frame_arena.cpp ^
+        src/core/parallel.cpp ^
+        src/core/canvas_renderer.cpp ^
+        src/core/render_thread.cpp ^
+        src/core/palette_quantizer.cpp ^
+        src/core/gif_encoder.cpp ^
+        src/core/background_task.cpp ^
         /Fe:build\PixelForge_debug.exe ^
         /link opengl32.lib user32.lib gdi32.lib comdlg32.lib gdiplus.lib comctl32.lib ^
         /DEBUG
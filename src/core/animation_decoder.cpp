@@ -0,0 +1,22 @@
+#include "animation_decoder.h"
+#include "apng_decoder.h"
+#include "gif_decoder.h"
+
+namespace PixelForge {
+
+std::unique_ptr<AnimationDecoder> AnimationDecoder::Open(std::vector<uint8_t> data) {
+    if (GifDecoder::HasSignature(data)) {
+        auto decoder = std::make_unique<GifDecoder>(std::move(data));
+        if (decoder->Parse()) {
+            return decoder;
+        }
+    } else if (ApngDecoder::HasSignature(data)) {
+        auto decoder = std::make_unique<ApngDecoder>(std::move(data));
+        if (decoder->Parse()) {
+            return decoder;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace PixelForge
\ No newline at end of file
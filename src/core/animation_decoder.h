@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "geometry.h"
+#include "pixel_buffer.h"
+
+namespace PixelForge {
+
+// What happens to a frame's rectangle before the next frame is drawn
+enum class FrameDisposal {
+    None,           // Leave the pixels in place
+    Background,     // Clear the rectangle to transparent
+    Previous        // Restore what was there before this frame
+};
+
+enum class FrameBlend {
+    Source,         // Replace the rectangle (APNG APNG_BLEND_OP_SOURCE)
+    Over            // Alpha-composite onto the canvas
+};
+
+struct AnimationFrame {
+    IntRect rect;               // Canvas region the frame draws into
+    int delayMs = 100;
+    FrameDisposal disposal = FrameDisposal::None;
+    FrameBlend blend = FrameBlend::Over;
+    PixelBuffer pixels;         // rect-sized ARGB
+};
+
+// Frame source for animated images. Open() indexes the frames up front; pixel
+// data is only decoded when DecodeFrame is called, from whichever single
+// thread owns the decoder.
+class AnimationDecoder {
+public:
+    virtual ~AnimationDecoder() = default;
+
+    virtual int Width() const = 0;
+    virtual int Height() const = 0;
+    virtual int FrameCount() const = 0;
+    virtual int LoopCount() const = 0;     // Total plays; 0 = loop forever
+    virtual bool DecodeFrame(int index, AnimationFrame& frame) = 0;
+
+    // Picks a decoder from the file signature. Returns nullptr for formats
+    // without animation support or for files that fail to parse.
+    static std::unique_ptr<AnimationDecoder> Open(std::vector<uint8_t> data);
+};
+
+// Largest canvas or frame taken from a file, so a forged header cannot make
+// the player allocate gigabytes
+const int MAX_ANIMATION_SIDE = 16384;
+const int64_t MAX_ANIMATION_PIXELS = 32ll * 1024 * 1024;
+
+inline bool IsAnimationSizeAllowed(int64_t width, int64_t height) {
+    return width > 0 && height > 0 && width <= MAX_ANIMATION_SIDE && height <= MAX_ANIMATION_SIDE &&
+           width * height <= MAX_ANIMATION_PIXELS;
+}
+
+// Browsers play delays of 10 ms or less at 100 ms; so do we
+inline int NormalizeFrameDelay(int delayMs) {
+    return delayMs <= 10 ? 100 : delayMs;
+}
+
+} // namespace PixelForge
\ No newline at end of file
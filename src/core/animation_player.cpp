@@ -0,0 +1,220 @@
+#include "animation_player.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#ifdef DEBUG
+#include <stdio.h>
+#endif
+
+namespace PixelForge {
+
+namespace {
+
+void CopyRect(const PixelBuffer& src, int srcX, int srcY, PixelBuffer& dst, const IntRect& dstRect) {
+    for (int y = 0; y < dstRect.Height(); y++) {
+        std::memcpy(dst.Row(dstRect.top + y) + dstRect.left, src.Row(srcY + y) + srcX,
+                    dstRect.Width() * sizeof(uint32_t));
+    }
+}
+
+} // namespace
+
+AnimationPlayer::AnimationPlayer(std::unique_ptr<AnimationDecoder> decoder, int lookaheadFrames, size_t byteBudget)
+    : m_decoder(std::move(decoder))
+    , m_width(m_decoder ? m_decoder->Width() : 0)
+    , m_height(m_decoder ? m_decoder->Height() : 0)
+    , m_lookahead(std::max(lookaheadFrames, 1))
+    , m_byteBudget(byteBudget) {
+}
+
+AnimationPlayer::~AnimationPlayer() {
+    Stop();
+}
+
+void AnimationPlayer::Start() {
+    if (m_thread.joinable() || !m_decoder) {
+        return;
+    }
+    m_canvas.Resize(m_width, m_height, 0);
+    m_thread = std::thread(&AnimationPlayer::DecodeLoop, this);
+}
+
+void AnimationPlayer::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopRequested = true;
+    }
+    m_spaceAvailable.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+size_t AnimationPlayer::PatchBytes(const FramePatch& patch) const {
+    return static_cast<size_t>(patch.pixels.Width()) * patch.pixels.Height() * sizeof(uint32_t);
+}
+
+void AnimationPlayer::DecodeLoop() {
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            // Always allow one queued patch, however large, so playback never stalls
+            m_spaceAvailable.wait(lock, [this]() {
+                return m_stopRequested || m_queue.empty() ||
+                    (static_cast<int>(m_queue.size()) < m_lookahead && m_queuedBytes < m_byteBudget);
+            });
+            if (m_stopRequested) {
+                return;
+            }
+        }
+
+        FramePatch patch;
+        bool ok = ComposeNext(patch);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!ok) {
+            m_finished = true;
+            return;
+        }
+        m_queuedBytes += PatchBytes(patch);
+        m_queue.push_back(std::move(patch));
+    }
+}
+
+bool AnimationPlayer::ComposeNext(FramePatch& patch) {
+    // A frame that fails to decode is skipped, leaving the canvas as it
+    // was; playback only ends when none of them decode
+    const int frameCount = m_decoder->FrameCount();
+    for (int failures = 0;; failures++) {
+        if (failures >= frameCount) {
+            return false;
+        }
+        if (m_nextFrame >= frameCount) {
+            m_loopsPlayed++;
+            int loops = m_decoder->LoopCount();
+            if (loops > 0 && m_loopsPlayed >= loops) {
+                return false;
+            }
+            m_nextFrame = 0;
+            m_restartLoop = true;
+        }
+        if (m_decoder->DecodeFrame(m_nextFrame, m_frame)) {
+            break;
+        }
+        #ifdef DEBUG
+        printf("ERROR: AnimationPlayer could not decode frame %d\n", m_nextFrame);
+        #endif
+        m_nextFrame++;
+    }
+
+    const IntRect bounds = m_canvas.Bounds();
+    IntRect dirty;
+
+    if (m_restartLoop) {
+        // Every loop starts from a transparent canvas; only what earlier
+        // frames drew needs clearing
+        for (int y = m_painted.top; y < m_painted.bottom; y++) {
+            std::fill(m_canvas.Row(y) + m_painted.left, m_canvas.Row(y) + m_painted.right, 0u);
+        }
+        dirty = m_painted;
+        m_painted = IntRect();
+        m_pendingKind = FrameDisposal::None;
+        m_restartLoop = false;
+    } else if (m_pendingKind == FrameDisposal::Background) {
+        for (int y = m_pendingDisposal.top; y < m_pendingDisposal.bottom; y++) {
+            std::fill(m_canvas.Row(y) + m_pendingDisposal.left, m_canvas.Row(y) + m_pendingDisposal.right, 0u);
+        }
+        dirty = m_pendingDisposal;
+    } else if (m_pendingKind == FrameDisposal::Previous) {
+        CopyRect(m_saved, 0, 0, m_canvas, m_pendingDisposal);
+        dirty = m_pendingDisposal;
+    }
+
+    const IntRect& frameRect = m_frame.rect;
+    const IntRect drawn = frameRect.Intersect(bounds);
+    if (m_frame.disposal == FrameDisposal::Previous) {
+        m_saved.Resize(drawn.Width(), drawn.Height());
+        for (int y = 0; y < drawn.Height(); y++) {
+            std::memcpy(m_saved.Row(y), m_canvas.Row(drawn.top + y) + drawn.left,
+                        drawn.Width() * sizeof(uint32_t));
+        }
+    }
+
+    // Only the frame rectangle is recomposited
+    for (int y = drawn.top; y < drawn.bottom; y++) {
+        const uint32_t* src = m_frame.pixels.Row(y - frameRect.top) + (drawn.left - frameRect.left);
+        uint32_t* dst = m_canvas.Row(y) + drawn.left;
+        if (m_frame.blend == FrameBlend::Source) {
+            std::memcpy(dst, src, drawn.Width() * sizeof(uint32_t));
+            continue;
+        }
+        for (int x = 0; x < drawn.Width(); x++) {
+            dst[x] = BlendOver(dst[x], src[x], src[x] >> 24);
+        }
+    }
+
+    dirty = dirty.Union(drawn);
+    m_painted = m_painted.Union(drawn);
+    m_pendingDisposal = drawn;
+    m_pendingKind = m_frame.disposal;
+    m_nextFrame++;
+
+    patch.rect = dirty;
+    patch.delayMs = m_frame.delayMs;
+    patch.pixels.Resize(dirty.Width(), dirty.Height());
+    for (int y = 0; y < dirty.Height(); y++) {
+        std::memcpy(patch.pixels.Row(y), m_canvas.Row(dirty.top + y) + dirty.left,
+                    dirty.Width() * sizeof(uint32_t));
+    }
+    return true;
+}
+
+bool AnimationPlayer::Advance(Clock::time_point now, PixelBuffer& display, IntRect& dirty, int& nextDelayMs) {
+    dirty = IntRect();
+    bool finished;
+    bool queueEmpty;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        while (!m_queue.empty() && (!m_started || now >= m_nextDue)) {
+            FramePatch& patch = m_queue.front();
+            // Re-anchor after a stall instead of racing through missed frames
+            if (!m_started || now - m_nextDue > std::chrono::seconds(1)) {
+                m_nextDue = now;
+            }
+            m_nextDue += std::chrono::milliseconds(patch.delayMs);
+            m_started = true;
+            m_queuedBytes -= PatchBytes(patch);
+            m_due.push_back(std::move(patch));
+            m_queue.pop_front();
+        }
+        finished = m_finished;
+        queueEmpty = m_queue.empty();
+    }
+
+    if (!m_due.empty()) {
+        m_spaceAvailable.notify_one();
+    }
+
+    // Patches are applied in order; when the UI fell behind, intermediate
+    // frames are never shown but still keep the display consistent
+    if (display.Width() == m_width && display.Height() == m_height) {
+        for (const FramePatch& patch : m_due) {
+            CopyRect(patch.pixels, 0, 0, display, patch.rect);
+            dirty = dirty.Union(patch.rect);
+        }
+    }
+    // Keeps its capacity; the pixels go back to the pool for the decoder
+    m_due.clear();
+
+    if (finished && queueEmpty) {
+        nextDelayMs = 0;
+        return false;
+    }
+
+    // Sleep until the next frame is due; poll shortly if the decoder is behind
+    auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(m_nextDue - now).count();
+    nextDelayMs = (m_started && wait > 0) ? static_cast<int>(wait) : 5;
+    return true;
+}
+
+} // namespace PixelForge
\ No newline at end of file
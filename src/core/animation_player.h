@@ -0,0 +1,82 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "animation_decoder.h"
+#include "pixel_buffer.h"
+
+namespace PixelForge {
+
+// Plays an animation by decoding and compositing ahead on a background
+// thread. Each queued entry is a patch: the canvas rectangle that changed
+// since the previous frame (this frame's area plus the last frame's disposal)
+// and its composited pixels. The UI thread applies patches to its own display
+// buffer, so neither decoding nor full-frame copies happen on it.
+class AnimationPlayer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    AnimationPlayer(std::unique_ptr<AnimationDecoder> decoder,
+                    int lookaheadFrames = 4, size_t byteBudget = 64 * 1024 * 1024);
+    ~AnimationPlayer();
+
+    int Width() const { return m_width; }
+    int Height() const { return m_height; }
+
+    void Start();
+    void Stop();
+
+    // Applies every patch that is due to display (Width x Height) and reports
+    // the changed area and the wait until the next frame. Returns false once
+    // the animation has finished or failed and no patches remain.
+    bool Advance(Clock::time_point now, PixelBuffer& display, IntRect& dirty, int& nextDelayMs);
+
+private:
+    struct FramePatch {
+        IntRect rect;
+        PixelBuffer pixels;
+        int delayMs;
+    };
+
+    void DecodeLoop();
+    bool ComposeNext(FramePatch& patch);
+    size_t PatchBytes(const FramePatch& patch) const;
+
+    // Shared between threads
+    std::mutex m_mutex;
+    std::condition_variable m_spaceAvailable;
+    std::deque<FramePatch> m_queue;
+    size_t m_queuedBytes = 0;
+    bool m_stopRequested = false;
+    bool m_finished = false;
+    std::thread m_thread;
+
+    // Decoder thread only
+    std::unique_ptr<AnimationDecoder> m_decoder;
+    PixelBuffer m_canvas;
+    PixelBuffer m_saved;            // Pixels under a FrameDisposal::Previous frame
+    AnimationFrame m_frame;
+    IntRect m_pendingDisposal;
+    FrameDisposal m_pendingKind = FrameDisposal::None;
+    IntRect m_painted;              // Drawn since the canvas was last cleared
+    bool m_restartLoop = false;
+    int m_nextFrame = 0;
+    int m_loopsPlayed = 0;
+
+    // UI thread only
+    bool m_started = false;
+    Clock::time_point m_nextDue;
+    std::vector<FramePatch> m_due;  // Patches taken off the queue by Advance
+
+    const int m_width;
+    const int m_height;
+    const int m_lookahead;
+    const size_t m_byteBudget;
+};
+
+} // namespace PixelForge
\ No newline at end of file
@@ -0,0 +1,304 @@
+#include "apng_decoder.h"
+#include "inflate.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#ifdef DEBUG
+#include <stdio.h>
+#endif
+
+namespace PixelForge {
+
+namespace {
+
+const uint8_t PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+
+inline uint32_t ReadU32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+inline int ReadU16(const uint8_t* p) {
+    return (p[0] << 8) | p[1];
+}
+
+inline bool IsChunk(const uint8_t* type, const char* name) {
+    return std::memcmp(type, name, 4) == 0;
+}
+
+inline uint8_t Paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = std::abs(p - a);
+    int pb = std::abs(p - b);
+    int pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) return static_cast<uint8_t>(a);
+    if (pb <= pc) return static_cast<uint8_t>(b);
+    return static_cast<uint8_t>(c);
+}
+
+} // namespace
+
+ApngDecoder::ApngDecoder(std::vector<uint8_t> data)
+    : m_data(std::move(data)) {
+    for (int i = 0; i < 256; i++) {
+        m_palette[i] = 0xFF000000;
+    }
+}
+
+bool ApngDecoder::HasSignature(const std::vector<uint8_t>& data) {
+    return data.size() >= 8 && std::memcmp(data.data(), PNG_SIGNATURE, 8) == 0;
+}
+
+int ApngDecoder::Channels() const {
+    switch (m_colorType) {
+        case 2: return 3;
+        case 4: return 2;
+        case 6: return 4;
+        default: return 1;
+    }
+}
+
+bool ApngDecoder::Parse() {
+    if (!HasSignature(m_data)) {
+        return false;
+    }
+
+    const uint8_t* d = m_data.data();
+    const size_t size = m_data.size();
+    size_t pos = 8;
+    bool hasHeader = false;
+    bool hasAnimation = false;
+    bool seenFrameData = false;  // fdAT seen: later IDATs cannot belong to frame 0
+
+    while (pos + 12 <= size) {
+        uint32_t length = ReadU32(d + pos);
+        const uint8_t* type = d + pos + 4;
+        size_t body = pos + 8;
+        if (length > size - body - 4) break;
+
+        if (IsChunk(type, "IHDR") && length >= 13) {
+            uint32_t width = ReadU32(d + body);
+            uint32_t height = ReadU32(d + body + 4);
+            if (!IsAnimationSizeAllowed(width, height)) {
+                return false;
+            }
+            m_width = static_cast<int>(width);
+            m_height = static_cast<int>(height);
+            m_bitDepth = d[body + 8];
+            m_colorType = d[body + 9];
+            if (d[body + 12] != 0) {
+                #ifdef DEBUG
+                printf("ApngDecoder: interlaced PNGs are not supported\n");
+                #endif
+                return false;
+            }
+            hasHeader = true;
+        } else if (IsChunk(type, "PLTE")) {
+            for (uint32_t i = 0; i < length / 3 && i < 256; i++) {
+                const uint8_t* rgb = d + body + i * 3;
+                m_palette[i] = MakeColor(rgb[0], rgb[1], rgb[2]);
+            }
+        } else if (IsChunk(type, "tRNS")) {
+            if (m_colorType == 3) {
+                for (uint32_t i = 0; i < length && i < 256; i++) {
+                    m_palette[i] = (m_palette[i] & 0x00FFFFFF) | (static_cast<uint32_t>(d[body + i]) << 24);
+                }
+            } else if (m_colorType == 0 && length >= 2) {
+                m_hasColorKey = true;
+                m_colorKey[0] = static_cast<uint16_t>(ReadU16(d + body));
+            } else if (m_colorType == 2 && length >= 6) {
+                m_hasColorKey = true;
+                for (int i = 0; i < 3; i++) {
+                    m_colorKey[i] = static_cast<uint16_t>(ReadU16(d + body + i * 2));
+                }
+            }
+        } else if (IsChunk(type, "acTL") && length >= 8) {
+            hasAnimation = true;
+            m_loopCount = static_cast<int>((std::min)(ReadU32(d + body + 4), 0x7FFFFFFFu));
+        } else if (IsChunk(type, "fcTL") && length >= 26) {
+            FrameInfo info;
+            // Frames must lie inside the canvas, which IHDR has set
+            int64_t w = ReadU32(d + body + 4);
+            int64_t h = ReadU32(d + body + 8);
+            int64_t x = ReadU32(d + body + 12);
+            int64_t y = ReadU32(d + body + 16);
+            if (!hasHeader || !IsAnimationSizeAllowed(w, h) || x + w > m_width || y + h > m_height) {
+                return false;
+            }
+            info.rect = { static_cast<int>(x), static_cast<int>(y), static_cast<int>(x + w), static_cast<int>(y + h) };
+            int numerator = ReadU16(d + body + 20);
+            int denominator = ReadU16(d + body + 22);
+            info.delayMs = NormalizeFrameDelay(numerator * 1000 / (denominator ? denominator : 100));
+            int dispose = d[body + 24];
+            info.disposal = dispose == 1 ? FrameDisposal::Background
+                          : dispose == 2 ? FrameDisposal::Previous
+                          : FrameDisposal::None;
+            if (m_frames.empty() && info.disposal == FrameDisposal::Previous) {
+                info.disposal = FrameDisposal::Background;
+            }
+            info.blend = d[body + 25] == 1 ? FrameBlend::Over : FrameBlend::Source;
+            if (!info.rect.IsEmpty()) {
+                m_frames.push_back(info);
+            }
+        } else if (IsChunk(type, "IDAT")) {
+            // IDAT is frame 0 only when an fcTL came first; otherwise it is
+            // the hidden default image
+            if (m_frames.size() == 1 && !seenFrameData) {
+                m_frames[0].chunks.push_back({ body, length });
+            }
+        } else if (IsChunk(type, "fdAT") && length > 4) {
+            seenFrameData = true;
+            if (!m_frames.empty()) {
+                m_frames.back().chunks.push_back({ body + 4, length - 4 });
+            }
+        } else if (IsChunk(type, "IEND")) {
+            break;
+        }
+
+        pos = body + length + 4;
+    }
+
+    // Frames without data (truncated files) are dropped
+    m_frames.erase(std::remove_if(m_frames.begin(), m_frames.end(),
+        [](const FrameInfo& f) { return f.chunks.empty(); }), m_frames.end());
+
+    #ifdef DEBUG
+    printf("ApngDecoder: %dx%d, %d frames, loop count %d\n",
+           m_width, m_height, (int)m_frames.size(), m_loopCount);
+    #endif
+
+    bool supportedDepth = m_bitDepth == 8 || m_bitDepth == 16 ||
+        ((m_colorType == 0 || m_colorType == 3) && m_bitDepth < 8);
+    return hasHeader && hasAnimation && supportedDepth && !m_frames.empty() &&
+           m_width > 0 && m_height > 0;
+}
+
+bool ApngDecoder::Unfilter(uint8_t* data, int rowBytes, int height) const {
+    const int bpp = std::max(1, Channels() * m_bitDepth / 8);
+    const int stride = rowBytes + 1;
+    for (int y = 0; y < height; y++) {
+        uint8_t* row = data + static_cast<size_t>(y) * stride;
+        int filter = row[0];
+        row++;
+        const uint8_t* prior = y > 0 ? row - stride : nullptr;
+
+        switch (filter) {
+            case 0:
+                break;
+            case 1:
+                for (int i = bpp; i < rowBytes; i++) row[i] += row[i - bpp];
+                break;
+            case 2:
+                if (prior) for (int i = 0; i < rowBytes; i++) row[i] += prior[i];
+                break;
+            case 3:
+                for (int i = 0; i < rowBytes; i++) {
+                    int left = i >= bpp ? row[i - bpp] : 0;
+                    int up = prior ? prior[i] : 0;
+                    row[i] += static_cast<uint8_t>((left + up) >> 1);
+                }
+                break;
+            case 4:
+                for (int i = 0; i < rowBytes; i++) {
+                    int left = i >= bpp ? row[i - bpp] : 0;
+                    int up = prior ? prior[i] : 0;
+                    int upLeft = (prior && i >= bpp) ? prior[i - bpp] : 0;
+                    row[i] += Paeth(left, up, upLeft);
+                }
+                break;
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+void ApngDecoder::ConvertRow(const uint8_t* src, uint32_t* dst, int width) const {
+    if (m_bitDepth < 8) {
+        // Packed gray or palette samples, MSB first
+        const int depth = m_bitDepth;
+        const int mask = (1 << depth) - 1;
+        for (int x = 0; x < width; x++) {
+            int bit = x * depth;
+            int sample = (src[bit >> 3] >> (8 - depth - (bit & 7))) & mask;
+            if (m_colorType == 3) {
+                dst[x] = m_palette[sample];
+            } else {
+                uint8_t g = static_cast<uint8_t>(sample * 255 / mask);
+                uint8_t a = (m_hasColorKey && sample == m_colorKey[0]) ? 0 : 255;
+                dst[x] = MakeColor(g, g, g, a);
+            }
+        }
+        return;
+    }
+
+    const int bytes = m_bitDepth / 8;   // 1 or 2; 16-bit samples keep the high byte
+    auto sample = [&](int x, int channel) {
+        const uint8_t* p = src + (x * Channels() + channel) * bytes;
+        return bytes == 2 ? ReadU16(p) : p[0];
+    };
+
+    for (int x = 0; x < width; x++) {
+        const uint8_t* p = src + x * Channels() * bytes;
+        switch (m_colorType) {
+            case 0: {
+                uint8_t g = p[0];
+                uint8_t a = (m_hasColorKey && sample(x, 0) == m_colorKey[0]) ? 0 : 255;
+                dst[x] = MakeColor(g, g, g, a);
+                break;
+            }
+            case 2: {
+                bool keyed = m_hasColorKey && sample(x, 0) == m_colorKey[0] &&
+                             sample(x, 1) == m_colorKey[1] && sample(x, 2) == m_colorKey[2];
+                dst[x] = MakeColor(p[0], p[bytes], p[2 * bytes], keyed ? 0 : 255);
+                break;
+            }
+            case 3:
+                dst[x] = m_palette[p[0]];
+                break;
+            case 4:
+                dst[x] = MakeColor(p[0], p[0], p[0], p[bytes]);
+                break;
+            default:
+                dst[x] = MakeColor(p[0], p[bytes], p[2 * bytes], p[3 * bytes]);
+                break;
+        }
+    }
+}
+
+bool ApngDecoder::DecodeFrame(int index, AnimationFrame& frame) {
+    if (index < 0 || index >= FrameCount()) {
+        return false;
+    }
+
+    const FrameInfo& info = m_frames[index];
+    const int width = info.rect.Width();
+    const int height = info.rect.Height();
+    const int rowBytes = (width * Channels() * m_bitDepth + 7) / 8;
+    const size_t expected = static_cast<size_t>(rowBytes + 1) * height;
+
+    m_compressed.clear();
+    for (const auto& chunk : info.chunks) {
+        m_compressed.insert(m_compressed.end(), m_data.begin() + chunk.first,
+                            m_data.begin() + chunk.first + chunk.second);
+    }
+    m_inflated.clear();
+    if (!ZlibDecompress(m_compressed.data(), m_compressed.size(), m_inflated, expected) ||
+        m_inflated.size() < expected || !Unfilter(m_inflated.data(), rowBytes, height)) {
+        #ifdef DEBUG
+        printf("ERROR: APNG frame %d failed to decode\n", index);
+        #endif
+        return false;
+    }
+
+    frame.rect = info.rect;
+    frame.delayMs = info.delayMs;
+    frame.disposal = info.disposal;
+    frame.blend = info.blend;
+    frame.pixels.Resize(width, height);
+    for (int y = 0; y < height; y++) {
+        ConvertRow(m_inflated.data() + static_cast<size_t>(y) * (rowBytes + 1) + 1, frame.pixels.Row(y), width);
+    }
+    return true;
+}
+
+} // namespace PixelForge
\ No newline at end of file
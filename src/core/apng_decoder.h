@@ -0,0 +1,52 @@
+#pragma once
+
+#include <utility>
+#include "animation_decoder.h"
+
+namespace PixelForge {
+
+// Animated PNG. Only files with an acTL chunk are accepted; still PNGs and
+// Adam7-interlaced animations are left to the GDI+ path.
+class ApngDecoder : public AnimationDecoder {
+public:
+    explicit ApngDecoder(std::vector<uint8_t> data);
+
+    // Walks the chunk list and records every frame; no inflating
+    bool Parse();
+
+    int Width() const override { return m_width; }
+    int Height() const override { return m_height; }
+    int FrameCount() const override { return static_cast<int>(m_frames.size()); }
+    int LoopCount() const override { return m_loopCount; }
+    bool DecodeFrame(int index, AnimationFrame& frame) override;
+
+    static bool HasSignature(const std::vector<uint8_t>& data);
+
+private:
+    struct FrameInfo {
+        IntRect rect;
+        int delayMs;
+        FrameDisposal disposal;
+        FrameBlend blend;
+        std::vector<std::pair<size_t, size_t>> chunks;  // Offset and length of zlib data
+    };
+
+    int Channels() const;
+    bool Unfilter(uint8_t* data, int rowBytes, int height) const;
+    void ConvertRow(const uint8_t* src, uint32_t* dst, int width) const;
+
+    std::vector<uint8_t> m_data;
+    std::vector<FrameInfo> m_frames;
+    int m_width = 0;
+    int m_height = 0;
+    int m_bitDepth = 8;
+    int m_colorType = 6;
+    int m_loopCount = 0;
+    uint32_t m_palette[256];
+    bool m_hasColorKey = false;
+    uint16_t m_colorKey[3] = { 0, 0, 0 };
+    std::vector<uint8_t> m_compressed;  // Reused per frame
+    std::vector<uint8_t> m_inflated;
+};
+
+} // namespace PixelForge
\ No newline at end of file
@@ -95,6 +95,11 @@ int Application::Run() {
     // Main message loop
     MSG msg = {0};
     while (GetMessage(&msg, NULL, 0, 0)) {
+        // Image navigation keys work whichever control has focus
+        if (m_mainWindow->HandleNavigationKey(msg)) {
+            continue;
+        }
+        
         TranslateMessage(&msg);
         DispatchMessage(&msg);
     }
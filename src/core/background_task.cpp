@@ -0,0 +1,55 @@
+#include "background_task.h"
+
+namespace PixelForge {
+
+BackgroundTask::BackgroundTask(std::function<void(int percent)> onProgress, std::function<void()> onFinished)
+    : m_onProgress(std::move(onProgress))
+    , m_onFinished(std::move(onFinished))
+    , m_cancel(false)
+    , m_result(false) {
+}
+
+BackgroundTask::~BackgroundTask() {
+    Cancel();
+    Wait();
+}
+
+bool BackgroundTask::Start(Job job) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_thread.joinable()) {
+        return false;
+    }
+    m_cancel = false;
+    m_result = false;
+    m_thread = std::thread([this, job = std::move(job)]() {
+        TaskControl control;
+        control.cancel = &m_cancel;
+        control.progress = m_onProgress;
+        bool ok = job(control);
+        m_result = ok && !m_cancel;
+        if (m_onFinished) {
+            m_onFinished();
+        }
+    });
+    return true;
+}
+
+void BackgroundTask::Cancel() {
+    m_cancel = true;
+}
+
+bool BackgroundTask::IsBusy() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_thread.joinable();
+}
+
+bool BackgroundTask::Wait() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_thread.joinable()) {
+        return true;
+    }
+    m_thread.join();
+    return m_result;
+}
+
+} // namespace PixelForge
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace PixelForge {
+
+// Handed to long operations so another thread can follow and stop them
+struct TaskControl {
+    const std::atomic<bool>* cancel = nullptr;
+    std::function<void(int percent)> progress;
+
+    bool Cancelled() const { return cancel && *cancel; }
+    void Report(int percent) const {
+        if (progress) {
+            progress(percent);
+        }
+    }
+};
+
+// Runs one long job at a time, such as a save or an export, on its own
+// thread so the window keeps painting. The job polls control.Cancelled()
+// and reports progress from 0 to 100. onProgress and onFinished are called
+// on the worker thread and must not block; the owner collects the result
+// with Wait once told the job finished.
+class BackgroundTask {
+public:
+    using Job = std::function<bool(const TaskControl& control)>;
+
+    BackgroundTask(std::function<void(int percent)> onProgress, std::function<void()> onFinished);
+    ~BackgroundTask();
+
+    BackgroundTask(const BackgroundTask&) = delete;
+    BackgroundTask& operator=(const BackgroundTask&) = delete;
+
+    // False while an earlier job has not been collected by Wait
+    bool Start(Job job);
+    // Asks the running job to stop; Wait still has to collect it
+    void Cancel();
+    bool IsBusy() const;
+    bool IsCancelled() const { return m_cancel; }
+
+    // Blocks until the job is done and returns its result, false when it
+    // failed or was cancelled. True when there was no job.
+    bool Wait();
+
+private:
+    std::function<void(int)> m_onProgress;
+    std::function<void()> m_onFinished;
+    std::atomic<bool> m_cancel;
+    std::atomic<bool> m_result;
+    mutable std::mutex m_mutex;
+    std::thread m_thread;
+};
+
+} // namespace PixelForge
\ No newline at end of file
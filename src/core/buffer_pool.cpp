@@ -0,0 +1,215 @@
+#include "buffer_pool.h"
+#include <algorithm>
+#include <cstdlib>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+#ifdef DEBUG
+#include <stdio.h>
+#endif
+
+namespace PixelForge {
+
+namespace {
+
+const int MIN_CLASS_SHIFT = 8;                      // Smallest class: 256 bytes
+const int MAX_CLASS_SHIFT = 26;                     // Largest class: 64 MB
+const int CLASS_COUNT = (MAX_CLASS_SHIFT - MIN_CLASS_SHIFT) * 4 + 1;
+const size_t SHARED_CACHE_BYTES = 96 * 1024 * 1024;
+
+int HighestBit(size_t value) {
+    int bit = -1;
+    while (value) {
+        value >>= 1;
+        bit++;
+    }
+    return bit;
+}
+
+// Class 0 holds up to 2^MIN_CLASS_SHIFT bytes; after that each power of two
+// is split into four classes
+int ClassFor(size_t bytes) {
+    if (bytes <= (size_t(1) << MIN_CLASS_SHIFT)) {
+        return 0;
+    }
+    int shift = HighestBit(bytes - 1);
+    if (shift >= MAX_CLASS_SHIFT) {
+        return -1;
+    }
+    size_t step = size_t(1) << (shift - 2);
+    int quarter = static_cast<int>((bytes - 1 - (size_t(1) << shift)) / step);
+    return (shift - MIN_CLASS_SHIFT) * 4 + quarter + 1;
+}
+
+size_t ClassSize(int sizeClass) {
+    if (sizeClass == 0) {
+        return size_t(1) << MIN_CLASS_SHIFT;
+    }
+    int shift = MIN_CLASS_SHIFT + (sizeClass - 1) / 4;
+    int quarter = (sizeClass - 1) % 4;
+    return (size_t(1) << shift) + (quarter + 1) * (size_t(1) << (shift - 2));
+}
+
+uint8_t* AllocateAligned(size_t bytes) {
+#ifdef _WIN32
+    return static_cast<uint8_t*>(_aligned_malloc(bytes, BufferPool::ALIGNMENT));
+#else
+    void* data = nullptr;
+    if (posix_memalign(&data, BufferPool::ALIGNMENT, bytes) != 0) {
+        return nullptr;
+    }
+    return static_cast<uint8_t*>(data);
+#endif
+}
+
+void FreeAligned(uint8_t* data) {
+#ifdef _WIN32
+    _aligned_free(data);
+#else
+    free(data);
+#endif
+}
+
+} // namespace
+
+PooledBuffer::PooledBuffer(PooledBuffer&& other) noexcept
+    : m_pool(other.m_pool)
+    , m_data(other.m_data)
+    , m_size(other.m_size)
+    , m_sizeClass(other.m_sizeClass) {
+    other.m_pool = nullptr;
+    other.m_data = nullptr;
+    other.m_size = 0;
+}
+
+PooledBuffer& PooledBuffer::operator=(PooledBuffer&& other) noexcept {
+    if (this != &other) {
+        Reset();
+        m_pool = other.m_pool;
+        m_data = other.m_data;
+        m_size = other.m_size;
+        m_sizeClass = other.m_sizeClass;
+        other.m_pool = nullptr;
+        other.m_data = nullptr;
+        other.m_size = 0;
+    }
+    return *this;
+}
+
+void PooledBuffer::Reset() {
+    if (m_data) {
+        m_pool->Release(m_data, m_size, m_sizeClass);
+        m_pool = nullptr;
+        m_data = nullptr;
+        m_size = 0;
+    }
+}
+
+BufferPool& BufferPool::Shared() {
+    // Never destroyed, so buffers freed during shutdown still have a home
+    static BufferPool* pool = new BufferPool(SHARED_CACHE_BYTES);
+    return *pool;
+}
+
+BufferPool::BufferPool(size_t maxCachedBytes)
+    : m_maxCachedBytes(maxCachedBytes)
+    , m_free(CLASS_COUNT) {
+    // Room for the free lists up front keeps Release off the heap
+    for (auto& list : m_free) {
+        list.reserve(16);
+    }
+}
+
+BufferPool::~BufferPool() {
+    Trim();
+}
+
+size_t BufferPool::RoundUp(size_t bytes) {
+    int sizeClass = ClassFor(bytes);
+    if (sizeClass < 0) {
+        return (bytes + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+    return ClassSize(sizeClass);
+}
+
+PooledBuffer BufferPool::Acquire(size_t bytes) {
+    PooledBuffer buffer;
+    if (bytes == 0) {
+        return buffer;
+    }
+    const int sizeClass = ClassFor(bytes);
+    const size_t size = RoundUp(bytes);
+
+    uint8_t* data = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.acquires++;
+        if (sizeClass >= 0 && !m_free[sizeClass].empty()) {
+            data = m_free[sizeClass].back();
+            m_free[sizeClass].pop_back();
+            m_stats.reuses++;
+            m_stats.cachedBytes -= size;
+            m_stats.bytesInUse += size;
+            m_stats.peakBytesInUse = (std::max)(m_stats.peakBytesInUse, m_stats.bytesInUse);
+        }
+    }
+
+    if (!data) {
+        // The heap call happens outside the lock
+        data = AllocateAligned(size);
+        if (!data) {
+            #ifdef DEBUG
+            printf("BufferPool: could not allocate %zu bytes\n", size);
+            #endif
+            return buffer;
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.heapAllocations++;
+        m_stats.bytesInUse += size;
+        m_stats.peakBytesInUse = (std::max)(m_stats.peakBytesInUse, m_stats.bytesInUse);
+    }
+    buffer.m_pool = this;
+    buffer.m_data = data;
+    buffer.m_size = size;
+    buffer.m_sizeClass = sizeClass;
+    return buffer;
+}
+
+void BufferPool::Release(uint8_t* data, size_t size, int sizeClass) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.bytesInUse -= size;
+        if (sizeClass >= 0 && m_stats.cachedBytes + size <= m_maxCachedBytes) {
+            m_free[sizeClass].push_back(data);
+            m_stats.cachedBytes += size;
+            return;
+        }
+        m_stats.heapFrees++;
+    }
+    FreeAligned(data);
+}
+
+void BufferPool::Trim() {
+    std::vector<std::vector<uint8_t*>> cached(CLASS_COUNT);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (int i = 0; i < CLASS_COUNT; i++) {
+            cached[i].swap(m_free[i]);
+            m_free[i].reserve(16);
+            m_stats.heapFrees += cached[i].size();
+        }
+        m_stats.cachedBytes = 0;
+    }
+    for (const auto& list : cached) {
+        for (uint8_t* data : list) {
+            FreeAligned(data);
+        }
+    }
+}
+
+BufferPoolStats BufferPool::Stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+} // namespace PixelForge
\ No newline at end of file
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace PixelForge {
+
+struct BufferPoolStats {
+    uint64_t acquires = 0;
+    uint64_t reuses = 0;            // Acquires served from a free list
+    uint64_t heapAllocations = 0;
+    uint64_t heapFrees = 0;
+    uint64_t bytesInUse = 0;        // Handed out and not yet returned
+    uint64_t peakBytesInUse = 0;
+    uint64_t cachedBytes = 0;       // Free buffers kept for reuse
+};
+
+class BufferPool;
+
+// Owner of one buffer from a BufferPool, returned to it on destruction.
+// Move-only; Size is the capacity of the size class, at least what was asked.
+class PooledBuffer {
+public:
+    PooledBuffer() = default;
+    ~PooledBuffer() { Reset(); }
+
+    PooledBuffer(PooledBuffer&& other) noexcept;
+    PooledBuffer& operator=(PooledBuffer&& other) noexcept;
+    PooledBuffer(const PooledBuffer&) = delete;
+    PooledBuffer& operator=(const PooledBuffer&) = delete;
+
+    uint8_t* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+    bool IsEmpty() const { return m_data == nullptr; }
+
+    void Reset();
+
+private:
+    friend class BufferPool;
+
+    BufferPool* m_pool = nullptr;
+    uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    int m_sizeClass = -1;           // -1 when too large to pool
+};
+
+// Cache-line aligned buffers in size classes a quarter of a power of two
+// apart, so a buffer of similar size can be reused without going back to
+// the heap. Freed buffers are kept up to a cap and handed out again;
+// larger requests than the biggest class are allocated directly. All
+// methods are thread-safe.
+class BufferPool {
+public:
+    static const size_t ALIGNMENT = 64;
+
+    // Shared by pixel buffers and frame arenas
+    static BufferPool& Shared();
+
+    explicit BufferPool(size_t maxCachedBytes);
+    ~BufferPool();
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // Returns a buffer of at least bytes; empty only when bytes is 0 or
+    // the allocation failed
+    PooledBuffer Acquire(size_t bytes);
+
+    // Frees every cached buffer
+    void Trim();
+
+    BufferPoolStats Stats() const;
+
+    // Size of the class a request for bytes is served from
+    static size_t RoundUp(size_t bytes);
+
+private:
+    friend class PooledBuffer;
+
+    void Release(uint8_t* data, size_t size, int sizeClass);
+
+    const size_t m_maxCachedBytes;
+    mutable std::mutex m_mutex;
+    std::vector<std::vector<uint8_t*>> m_free;  // Per size class
+    BufferPoolStats m_stats;
+};
+
+} // namespace PixelForge
\ No newline at end of file
@@ -0,0 +1,208 @@
+#include "canvas_renderer.h"
+#include "frame_arena.h"
+#include "parallel.h"
+#include <cmath>
+
+namespace PixelForge {
+
+namespace {
+
+const uint32_t BACKGROUND_COLOR = 0xFFFFFFFF;
+const uint32_t CHECKER_LIGHT = 0xFFF0F0F0;
+const uint32_t CHECKER_DARK = 0xFFDCDCDC;
+const uint32_t BORDER_COLOR = 0xFF646464;
+const int CHECKER_SIZE = 10;
+const int ROWS_PER_TASK = 64;
+const int CANCEL_CHECK_ROWS = 16;
+
+// Source pixels and weights for each output pixel along one axis, with a
+// fixed stride of maxTaps
+struct Taps {
+    int* first;
+    int* count;
+    float* weights;
+    int maxTaps;
+};
+
+bool BuildTaps(int srcSize, int dstSize, FrameArena& arena, Taps& taps) {
+    const double scale = (double)srcSize / dstSize;
+    taps.maxTaps = scale > 1.0 ? static_cast<int>(std::ceil(scale)) + 1 : 2;
+    taps.first = arena.AllocateArray<int>(dstSize);
+    taps.count = arena.AllocateArray<int>(dstSize);
+    taps.weights = arena.AllocateArray<float>(static_cast<size_t>(dstSize) * taps.maxTaps);
+    if (!taps.first || !taps.count || !taps.weights) {
+        return false;
+    }
+
+    for (int i = 0; i < dstSize; i++) {
+        float* weights = taps.weights + static_cast<size_t>(i) * taps.maxTaps;
+        if (scale > 1.0) {
+            // Average the source pixels the output pixel covers, weighting
+            // the partly covered ones at either end
+            double start = i * scale;
+            double end = (std::min)((i + 1) * scale, (double)srcSize);
+            int first = static_cast<int>(start);
+            int last = (std::min)(static_cast<int>(std::ceil(end)), srcSize);
+            taps.first[i] = first;
+            taps.count[i] = last - first;
+            for (int s = first; s < last; s++) {
+                double covered = (std::min)(end, s + 1.0) - (std::max)(start, (double)s);
+                weights[s - first] = static_cast<float>(covered / scale);
+            }
+        } else {
+            double center = (i + 0.5) * scale - 0.5;
+            int first = static_cast<int>(std::floor(center));
+            float fraction = static_cast<float>(center - first);
+            if (first < 0) {
+                first = 0;
+                fraction = 0.0f;
+            }
+            if (first >= srcSize - 1) {
+                first = srcSize - 1;
+                fraction = 0.0f;
+            }
+            taps.first[i] = first;
+            taps.count[i] = fraction > 0.0f ? 2 : 1;
+            weights[0] = 1.0f - fraction;
+            weights[1] = fraction;
+        }
+    }
+    return true;
+}
+
+inline uint32_t CheckerColor(int x, int y, const IntRect& display) {
+    int cell = (x - display.left) / CHECKER_SIZE + (y - display.top) / CHECKER_SIZE;
+    return (cell & 1) ? CHECKER_DARK : CHECKER_LIGHT;
+}
+
+// Alpha-weighted average of the source footprint: straight colour and
+// total alpha (0-255)
+uint32_t SampleFootprint(const PixelBuffer& image, const Taps& columns, int column, const Taps& rows, int row, int& alpha) {
+    const int firstX = columns.first[column];
+    const int countX = columns.count[column];
+    const float* weightsX = columns.weights + static_cast<size_t>(column) * columns.maxTaps;
+    const float* weightsY = rows.weights + static_cast<size_t>(row) * rows.maxTaps;
+    float a = 0.0f, r = 0.0f, g = 0.0f, b = 0.0f;
+    for (int ky = 0; ky < rows.count[row]; ky++) {
+        const uint32_t* src = image.Row(rows.first[row] + ky) + firstX;
+        for (int kx = 0; kx < countX; kx++) {
+            uint32_t p = src[kx];
+            float weight = weightsX[kx] * weightsY[ky] * (p >> 24);
+            a += weight;
+            r += weight * ((p >> 16) & 0xFF);
+            g += weight * ((p >> 8) & 0xFF);
+            b += weight * (p & 0xFF);
+        }
+    }
+    alpha = (std::min)(static_cast<int>(a + 0.5f), 255);
+    if (a <= 0.0f) {
+        return 0;
+    }
+    return MakeColor(static_cast<uint8_t>(r / a + 0.5f), static_cast<uint8_t>(g / a + 0.5f),
+                     static_cast<uint8_t>(b / a + 0.5f));
+}
+
+// The source footprint composited over dst
+uint32_t SampleOver(const PixelBuffer& image, const Taps& columns, int column, const Taps& rows, int row, uint32_t dst) {
+    int alpha;
+    uint32_t color = SampleFootprint(image, columns, column, rows, row, alpha);
+    return BlendOver(dst, color, alpha);
+}
+
+} // namespace
+
+bool RenderCanvas(const CanvasScene& scene, PixelBuffer& target, const std::atomic<bool>* cancel) {
+    if (target.Width() != scene.width || target.Height() != scene.height) {
+        target.Resize(scene.width, scene.height);
+    }
+    const IntRect display = scene.display;
+    const IntRect visible = display.Intersect(target.Bounds());
+    const PixelBuffer* image = scene.image && !scene.image->IsEmpty() ? scene.image.get() : nullptr;
+
+    // Tap tables for the whole display area, shared by every row band
+    ArenaScope scope;
+    Taps columns = {};
+    Taps rows = {};
+    if (image && !visible.IsEmpty()) {
+        if (!BuildTaps(image->Width(), display.Width(), scope.Arena(), columns) ||
+            !BuildTaps(image->Height(), display.Height(), scope.Arena(), rows)) {
+            image = nullptr;
+        }
+    }
+
+    std::atomic<bool> cancelled(false);
+    ParallelFor(0, scene.height, ROWS_PER_TASK, [&](int firstRow, int lastRow) {
+        for (int y = firstRow; y < lastRow; y++) {
+            if (cancel && (y - firstRow) % CANCEL_CHECK_ROWS == 0 && cancel->load(std::memory_order_relaxed)) {
+                cancelled = true;
+                return;
+            }
+            uint32_t* out = target.Row(y);
+            if (y < visible.top || y >= visible.bottom) {
+                std::fill(out, out + scene.width, BACKGROUND_COLOR);
+                continue;
+            }
+            std::fill(out, out + visible.left, BACKGROUND_COLOR);
+            std::fill(out + visible.right, out + scene.width, BACKGROUND_COLOR);
+            for (int x = visible.left; x < visible.right; x++) {
+                uint32_t color = CheckerColor(x, y, display);
+                if (image) {
+                    color = SampleOver(*image, columns, x - display.left, rows, y - display.top, color);
+                }
+                out[x] = color;
+            }
+        }
+    });
+    if (cancelled) {
+        return false;
+    }
+
+    // Border along the display rectangle's inside edge
+    if (!visible.IsEmpty()) {
+        for (int x = visible.left; x < visible.right; x++) {
+            if (display.top == visible.top) {
+                target.SetPixel(x, display.top, BORDER_COLOR);
+            }
+            if (display.bottom == visible.bottom) {
+                target.SetPixel(x, display.bottom - 1, BORDER_COLOR);
+            }
+        }
+        for (int y = visible.top; y < visible.bottom; y++) {
+            if (display.left == visible.left) {
+                target.SetPixel(display.left, y, BORDER_COLOR);
+            }
+            if (display.right == visible.right) {
+                target.SetPixel(display.right - 1, y, BORDER_COLOR);
+            }
+        }
+    }
+    return true;
+}
+
+bool ResampleImage(const PixelBuffer& source, int width, int height, PixelBuffer& target) {
+    if (source.IsEmpty() || width <= 0 || height <= 0) {
+        return false;
+    }
+    ArenaScope scope;
+    Taps columns = {};
+    Taps rows = {};
+    if (!BuildTaps(source.Width(), width, scope.Arena(), columns) ||
+        !BuildTaps(source.Height(), height, scope.Arena(), rows)) {
+        return false;
+    }
+
+    target.Resize(width, height);
+    ParallelFor(0, height, ROWS_PER_TASK, [&](int firstRow, int lastRow) {
+        for (int y = firstRow; y < lastRow; y++) {
+            uint32_t* out = target.Row(y);
+            for (int x = 0; x < width; x++) {
+                int alpha;
+                uint32_t color = SampleFootprint(source, columns, x, rows, y, alpha);
+                out[x] = (color & 0x00FFFFFF) | (static_cast<uint32_t>(alpha) << 24);
+            }
+        }
+    });
+    return true;
+}
+
+} // namespace PixelForge
\ No newline at end of file
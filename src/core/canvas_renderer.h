@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include "geometry.h"
+#include "pixel_buffer.h"
+
+namespace PixelForge {
+
+// Everything a canvas frame depends on, captured by the UI thread so the
+// frame can be drawn anywhere else
+struct CanvasScene {
+    int width = 0;                  // Target size
+    int height = 0;
+    IntRect display;                // Image area in target pixels; empty without a canvas size
+    std::shared_ptr<const PixelBuffer> image;   // Stretched over display; may be null
+    uint64_t version = 0;           // Bumped by the owner when image changes in place
+};
+
+inline bool SameScene(const CanvasScene& a, const CanvasScene& b) {
+    return a.width == b.width && a.height == b.height &&
+           a.display.left == b.display.left && a.display.top == b.display.top &&
+           a.display.right == b.display.right && a.display.bottom == b.display.bottom &&
+           a.image == b.image && a.version == b.version;
+}
+
+// Draws scene into target, resized to width x height: a white background,
+// a checkerboard under the display area, the image resampled over it (area
+// averaged when shrinking, bilinear when enlarging) and a one-pixel border.
+// Returns false, with target partly drawn, once cancel becomes true.
+bool RenderCanvas(const CanvasScene& scene, PixelBuffer& target, const std::atomic<bool>* cancel = nullptr);
+
+// Stretches source to exactly width x height with the same filters,
+// keeping its alpha. False if either size is empty or scratch runs out.
+bool ResampleImage(const PixelBuffer& source, int width, int height, PixelBuffer& target);
+
+} // namespace PixelForge
\ No newline at end of file
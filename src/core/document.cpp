@@ -0,0 +1,623 @@
+#include "document.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cstring>
+#ifdef DEBUG
+#include <stdio.h>
+#endif
+
+namespace PixelForge {
+
+namespace {
+
+const int TILE_SHIFT = 8;   // log2(Document::TILE_SIZE)
+
+inline uint64_t TileBytes(const PixelBuffer& pixels) {
+    return static_cast<uint64_t>(pixels.Width()) * pixels.Height() * 4;
+}
+
+inline int ScaledSize(int size, int shift) {
+    return (size + (1 << shift) - 1) >> shift;
+}
+
+} // namespace
+
+void DownsampleBox(const PixelBuffer& src, const IntRect& rect, int shift, PixelBuffer& dst, int dstX, int dstY) {
+    const int width = ScaledSize(rect.Width(), shift);
+    const int height = ScaledSize(rect.Height(), shift);
+    if (shift == 0) {
+        for (int y = 0; y < height; y++) {
+            std::memcpy(dst.Row(dstY + y) + dstX, src.Row(rect.top + y) + rect.left, static_cast<size_t>(width) * 4);
+        }
+        return;
+    }
+
+    for (int y = 0; y < height; y++) {
+        int y0 = rect.top + (y << shift);
+        int y1 = (std::min)(y0 + (1 << shift), rect.bottom);
+        uint32_t* out = dst.Row(dstY + y) + dstX;
+        for (int x = 0; x < width; x++) {
+            int x0 = rect.left + (x << shift);
+            int x1 = (std::min)(x0 + (1 << shift), rect.right);
+            uint64_t a = 0, r = 0, g = 0, b = 0;
+            for (int sy = y0; sy < y1; sy++) {
+                const uint32_t* row = src.Row(sy);
+                for (int sx = x0; sx < x1; sx++) {
+                    uint32_t p = row[sx];
+                    uint32_t alpha = p >> 24;
+                    a += alpha;
+                    r += ((p >> 16) & 0xFF) * alpha;
+                    g += ((p >> 8) & 0xFF) * alpha;
+                    b += (p & 0xFF) * alpha;
+                }
+            }
+            uint64_t count = static_cast<uint64_t>(y1 - y0) * (x1 - x0);
+            out[x] = a == 0 ? 0 : MakeColor(static_cast<uint8_t>((r + a / 2) / a), static_cast<uint8_t>((g + a / 2) / a),
+                                            static_cast<uint8_t>((b + a / 2) / a), static_cast<uint8_t>((a + count / 2) / count));
+        }
+    }
+}
+
+Document::Document(int width, int height)
+    : m_width((std::max)(width, 1))
+    , m_height((std::max)(height, 1))
+    , m_tilesX((m_width + TILE_SIZE - 1) / TILE_SIZE)
+    , m_tilesY((m_height + TILE_SIZE - 1) / TILE_SIZE)
+    , m_previewStale(static_cast<size_t>(m_tilesX) * m_tilesY, 0) {
+
+    // Level 0 is built straight from tiles, so its scale must divide the
+    // tile size; the smaller levels halve the one before
+    int shift = 0;
+    while ((std::max)(ScaledSize(m_width, shift), ScaledSize(m_height, shift)) > PREVIEW_SIZE && shift < TILE_SHIFT) {
+        shift++;
+    }
+    for (;; shift++) {
+        PreviewLevel level;
+        level.shift = shift;
+        level.pixels.Resize(ScaledSize(m_width, shift), ScaledSize(m_height, shift));
+        level.chunksX = (level.pixels.Width() + TILE_SIZE - 1) / TILE_SIZE;
+        level.chunksY = (level.pixels.Height() + TILE_SIZE - 1) / TILE_SIZE;
+        level.chunkModified.assign(static_cast<size_t>(level.chunksX) * level.chunksY, 0);
+        m_preview.push_back(std::move(level));
+        if ((std::max)(ScaledSize(m_width, shift), ScaledSize(m_height, shift)) <= MIN_PREVIEW_SIZE) {
+            break;
+        }
+    }
+}
+
+IntRect Document::TileRect(int tx, int ty) const {
+    IntRect rect = {
+        tx * TILE_SIZE,
+        ty * TILE_SIZE,
+        (std::min)((tx + 1) * TILE_SIZE, m_width),
+        (std::min)((ty + 1) * TILE_SIZE, m_height)
+    };
+    return rect;
+}
+
+int Document::FindLayer(uint32_t id) const {
+    for (int i = 0; i < LayerCount(); i++) {
+        if (m_layers[i].m_id == id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int Document::AddLayer(const std::wstring& name, uint32_t id) {
+    if (id == 0 || FindLayer(id) >= 0) {
+        id = m_nextLayerId;
+    }
+    m_nextLayerId = (std::max)(m_nextLayerId, id + 1);
+    m_layers.emplace_back(id, name, TileCount());
+    m_modified = true;
+    return LayerCount() - 1;
+}
+
+void Document::RemoveLayer(int index) {
+    for (LayerTile& tile : m_layers[index].m_tiles) {
+        DropTile(tile);
+    }
+    m_layers.erase(m_layers.begin() + index);
+    m_modified = true;
+    InvalidatePreview();
+}
+
+void Document::SetLayerOpacity(int index, uint8_t opacity) {
+    if (m_layers[index].m_opacity != opacity) {
+        m_layers[index].m_opacity = opacity;
+        m_modified = true;
+        InvalidatePreview();
+    }
+}
+
+void Document::SetLayerVisible(int index, bool visible) {
+    if (m_layers[index].m_visible != visible) {
+        m_layers[index].m_visible = visible;
+        m_modified = true;
+        InvalidatePreview();
+    }
+}
+
+bool Document::ReadTile(int layer, int tx, int ty, const PixelBuffer*& pixels) {
+    pixels = nullptr;
+    LayerTile& tile = m_layers[layer].m_tiles[ty * m_tilesX + tx];
+    IntRect rect = TileRect(tx, ty);
+    if (tile.state == TileState::Stored) {
+        if (m_source && m_source->LoadTile(m_layers[layer].m_id, tx, ty, tile.pixels) &&
+            tile.pixels.Width() == rect.Width() && tile.pixels.Height() == rect.Height()) {
+            tile.state = TileState::Loaded;
+        } else {
+            #ifdef DEBUG
+            printf("Document: could not load tile %d,%d of layer %u\n", tx, ty, m_layers[layer].m_id);
+            #endif
+            tile.pixels = PixelBuffer();
+            return false;
+        }
+    } else if (tile.state == TileState::Solid) {
+        tile.pixels.Resize(rect.Width(), rect.Height(), tile.color);
+        tile.state = TileState::Loaded;
+    } else if (tile.state == TileState::Packed) {
+        if (m_store->Take(tile.handle, rect.Width(), rect.Height(), tile.pixels)) {
+            tile.state = TileState::Loaded;
+        } else {
+            #ifdef DEBUG
+            printf("Document: lost packed tile %d,%d of layer %u\n", tx, ty, m_layers[layer].m_id);
+            #endif
+            tile.state = TileState::Empty;
+            tile.pixels = PixelBuffer();
+            return false;
+        }
+    }
+    if (tile.state == TileState::Loaded) {
+        tile.lastUse = ++m_useClock;
+        pixels = &tile.pixels;
+    }
+    return true;
+}
+
+PixelBuffer& Document::WriteTile(int layer, int tx, int ty) {
+    LayerTile& tile = m_layers[layer].m_tiles[ty * m_tilesX + tx];
+    const PixelBuffer* pixels;
+    if (!ReadTile(layer, tx, ty, pixels) || !pixels) {
+        IntRect rect = TileRect(tx, ty);
+        tile.pixels.Resize(rect.Width(), rect.Height());
+        tile.state = TileState::Loaded;
+        tile.lastUse = ++m_useClock;
+    }
+    tile.modified = true;
+    m_modified = true;
+    MarkPreviewStale(tx, ty);
+    return tile.pixels;
+}
+
+void Document::SetPixels(int layer, const PixelBuffer& image) {
+    for (int ty = 0; ty < m_tilesY; ty++) {
+        for (int tx = 0; tx < m_tilesX; tx++) {
+            LayerTile& tile = m_layers[layer].m_tiles[ty * m_tilesX + tx];
+            IntRect rect = TileRect(tx, ty);
+            IntRect source = rect.Intersect(image.Bounds());
+            DropTile(tile);
+
+            // Tiles left fully transparent are not stored at all, and
+            // uniform ones only as their colour
+            bool empty = true;
+            bool uniform = source.Width() == rect.Width() && source.Height() == rect.Height();
+            const uint32_t first = source.IsEmpty() ? 0 : image.Row(source.top)[source.left];
+            for (int y = source.top; y < source.bottom && (empty || uniform); y++) {
+                const uint32_t* row = image.Row(y);
+                for (int x = source.left; x < source.right; x++) {
+                    uint32_t p = row[x];
+                    empty = empty && (p >> 24) == 0;
+                    uniform = uniform && p == first;
+                    if (!empty && !uniform) {
+                        break;
+                    }
+                }
+            }
+
+            if (empty) {
+                tile.state = TileState::Empty;
+            } else if (uniform) {
+                tile.state = TileState::Solid;
+                tile.color = first;
+            } else {
+                tile.pixels.Resize(rect.Width(), rect.Height());
+                for (int y = source.top; y < source.bottom; y++) {
+                    std::memcpy(tile.pixels.Row(y - rect.top) + (source.left - rect.left), image.Row(y) + source.left,
+                                static_cast<size_t>(source.Width()) * 4);
+                }
+                tile.state = TileState::Loaded;
+                tile.lastUse = ++m_useClock;
+            }
+            tile.modified = true;
+            MarkPreviewStale(tx, ty);
+        }
+    }
+    m_modified = true;
+}
+
+void Document::LoadTiles(const IntRect& rect) {
+    // Swapped out tiles start reading back while the first ones decompress
+    PrefetchTiles(rect);
+
+    int tx0 = rect.left / TILE_SIZE;
+    int ty0 = rect.top / TILE_SIZE;
+    int tx1 = (rect.right + TILE_SIZE - 1) / TILE_SIZE;
+    int ty1 = (rect.bottom + TILE_SIZE - 1) / TILE_SIZE;
+    for (int layer = 0; layer < LayerCount(); layer++) {
+        if (!m_layers[layer].m_visible || m_layers[layer].m_opacity == 0) {
+            continue;
+        }
+        for (int ty = ty0; ty < ty1; ty++) {
+            for (int tx = tx0; tx < tx1; tx++) {
+                // Solid tiles composite straight from their colour; one
+                // that cannot be read composites as transparent
+                const PixelBuffer* pixels;
+                if (m_layers[layer].m_tiles[ty * m_tilesX + tx].state != TileState::Solid) {
+                    ReadTile(layer, tx, ty, pixels);
+                }
+            }
+        }
+    }
+}
+
+void Document::PrefetchTiles(const IntRect& rect) {
+    if (!m_store) {
+        return;
+    }
+    int tx0 = rect.left / TILE_SIZE;
+    int ty0 = rect.top / TILE_SIZE;
+    int tx1 = (rect.right + TILE_SIZE - 1) / TILE_SIZE;
+    int ty1 = (rect.bottom + TILE_SIZE - 1) / TILE_SIZE;
+    std::vector<uint32_t> handles;
+    for (const Layer& layer : m_layers) {
+        if (!layer.m_visible || layer.m_opacity == 0) {
+            continue;
+        }
+        for (int ty = ty0; ty < ty1; ty++) {
+            for (int tx = tx0; tx < tx1; tx++) {
+                const LayerTile& tile = layer.m_tiles[ty * m_tilesX + tx];
+                if (tile.state == TileState::Packed) {
+                    handles.push_back(tile.handle);
+                }
+            }
+        }
+    }
+    if (!handles.empty()) {
+        m_store->Prefetch(handles);
+    }
+}
+
+void Document::CompositeLoaded(const IntRect& rect, PixelBuffer& out) const {
+    out.Resize(rect.Width(), rect.Height());
+    int tx0 = rect.left / TILE_SIZE;
+    int ty0 = rect.top / TILE_SIZE;
+    int tx1 = (rect.right + TILE_SIZE - 1) / TILE_SIZE;
+    int ty1 = (rect.bottom + TILE_SIZE - 1) / TILE_SIZE;
+
+    for (const Layer& layer : m_layers) {
+        const int opacity = layer.m_opacity;
+        if (!layer.m_visible || opacity == 0) {
+            continue;
+        }
+        for (int ty = ty0; ty < ty1; ty++) {
+            for (int tx = tx0; tx < tx1; tx++) {
+                const LayerTile& tile = layer.m_tiles[ty * m_tilesX + tx];
+                if (tile.state != TileState::Loaded && tile.state != TileState::Solid) {
+                    continue;
+                }
+                const bool solid = tile.state == TileState::Solid;
+                IntRect tileRect = TileRect(tx, ty);
+                IntRect area = tileRect.Intersect(rect);
+                for (int y = area.top; y < area.bottom; y++) {
+                    const uint32_t* src = solid ? nullptr : tile.pixels.Row(y - tileRect.top) + (area.left - tileRect.left);
+                    uint32_t* dst = out.Row(y - rect.top) + (area.left - rect.left);
+                    for (int x = 0; x < area.Width(); x++) {
+                        uint32_t p = src ? src[x] : tile.color;
+                        int alpha = p >> 24;
+                        if (opacity != 255) {
+                            alpha = (alpha * opacity + 127) / 255;
+                        }
+                        if (alpha != 0) {
+                            dst[x] = BlendOver(dst[x], p, alpha);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void Document::Composite(const IntRect& rect, PixelBuffer& out) {
+    IntRect area = rect.Intersect({ 0, 0, m_width, m_height });
+    TrimMemory();
+    LoadTiles(area);
+    CompositeLoaded(area, out);
+    TrimMemory();
+}
+
+bool Document::Render(int shift, PixelBuffer& out, const std::atomic<bool>* cancel) {
+    shift = (std::min)((std::max)(shift, 0), TILE_SHIFT);
+    out.Resize(ScaledSize(m_width, shift), ScaledSize(m_height, shift));
+    TrimMemory();
+
+    const int rows = BandRows();
+    for (int row = 0; row < m_tilesY; row += rows) {
+        if (cancel && *cancel) {
+            return false;
+        }
+        int rowEnd = (std::min)(row + rows, m_tilesY);
+        LoadTiles(BandRect(row, rowEnd));
+        if (rowEnd < m_tilesY) {
+            PrefetchTiles(BandRect(rowEnd, (std::min)(rowEnd + rows, m_tilesY)));
+        }
+
+        // Every tile lands in its own block of the output
+        ParallelFor(row * m_tilesX, rowEnd * m_tilesX, 4, [&](int begin, int end) {
+            PixelBuffer scratch;
+            for (int i = begin; i < end; i++) {
+                IntRect rect = TileRect(i % m_tilesX, i / m_tilesX);
+                CompositeLoaded(rect, scratch);
+                DownsampleBox(scratch, scratch.Bounds(), shift, out, rect.left >> shift, rect.top >> shift);
+            }
+        });
+        TrimMemory();
+    }
+    return true;
+}
+
+void Document::MarkPreviewStale(int tx, int ty) {
+    m_previewStale[ty * m_tilesX + tx] = 1;
+    m_previewDirty = true;
+}
+
+void Document::InvalidatePreview() {
+    std::fill(m_previewStale.begin(), m_previewStale.end(), 1);
+    m_previewDirty = true;
+}
+
+void Document::UpdatePreview() {
+    if (!m_previewDirty) {
+        return;
+    }
+    m_previewDirty = false;
+
+    std::vector<int> stale;
+    IntRect dirty;
+    PreviewLevel& base = m_preview[0];
+    for (int i = 0; i < TileCount(); i++) {
+        if (m_previewStale[i]) {
+            m_previewStale[i] = 0;
+            stale.push_back(i);
+            IntRect rect = TileRect(i % m_tilesX, i / m_tilesX);
+            IntRect scaled = { rect.left >> base.shift, rect.top >> base.shift,
+                               ScaledSize(rect.right, base.shift), ScaledSize(rect.bottom, base.shift) };
+            dirty = dirty.Union(scaled);
+        }
+    }
+
+    // Tiles load serially, a band at a time; compositing them is independent
+    TrimMemory();
+    const int band = BandRows() * m_tilesX;
+    const int staleCount = static_cast<int>(stale.size());
+    for (int start = 0; start < staleCount; start += band) {
+        int stop = (std::min)(start + band, staleCount);
+        for (int i = start; i < stop; i++) {
+            LoadTiles(TileRect(stale[i] % m_tilesX, stale[i] / m_tilesX));
+        }
+        for (int i = stop; i < (std::min)(stop + band, staleCount); i++) {
+            PrefetchTiles(TileRect(stale[i] % m_tilesX, stale[i] / m_tilesX));
+        }
+
+        ParallelFor(start, stop, 2, [&](int begin, int end) {
+            PixelBuffer scratch;
+            for (int i = begin; i < end; i++) {
+                IntRect rect = TileRect(stale[i] % m_tilesX, stale[i] / m_tilesX);
+                CompositeLoaded(rect, scratch);
+                DownsampleBox(scratch, scratch.Bounds(), base.shift, base.pixels, rect.left >> base.shift, rect.top >> base.shift);
+            }
+        });
+        TrimMemory();
+    }
+
+    // Carry the changed area down the pyramid
+    for (size_t level = 0; level < m_preview.size() && !dirty.IsEmpty(); level++) {
+        PreviewLevel& current = m_preview[level];
+        if (level > 0) {
+            const PreviewLevel& previous = m_preview[level - 1];
+            IntRect source = {
+                dirty.left & ~1, dirty.top & ~1,
+                (std::min)(dirty.right + (dirty.right & 1), previous.pixels.Width()),
+                (std::min)(dirty.bottom + (dirty.bottom & 1), previous.pixels.Height())
+            };
+            dirty = { source.left / 2, source.top / 2, ScaledSize(source.right, 1), ScaledSize(source.bottom, 1) };
+            DownsampleBox(previous.pixels, source, 1, current.pixels, dirty.left, dirty.top);
+        }
+        for (int cy = dirty.top / TILE_SIZE; cy <= (dirty.bottom - 1) / TILE_SIZE; cy++) {
+            for (int cx = dirty.left / TILE_SIZE; cx <= (dirty.right - 1) / TILE_SIZE; cx++) {
+                current.chunkModified[cy * current.chunksX + cx] = 1;
+            }
+        }
+    }
+}
+
+void Document::MarkPreviewCurrent() {
+    std::fill(m_previewStale.begin(), m_previewStale.end(), 0);
+    m_previewDirty = false;
+}
+
+int Document::PreviewLevelForSize(int width, int height) const {
+    for (int level = PreviewLevelCount() - 1; level > 0; level--) {
+        const PixelBuffer& pixels = m_preview[level].pixels;
+        if (pixels.Width() >= width && pixels.Height() >= height) {
+            return level;
+        }
+    }
+    return 0;
+}
+
+IntRect Document::PreviewChunkRect(int level, int cx, int cy) const {
+    const PixelBuffer& pixels = m_preview[level].pixels;
+    IntRect rect = {
+        cx * TILE_SIZE,
+        cy * TILE_SIZE,
+        (std::min)((cx + 1) * TILE_SIZE, pixels.Width()),
+        (std::min)((cy + 1) * TILE_SIZE, pixels.Height())
+    };
+    return rect;
+}
+
+void Document::SetTileStored(int layer, int tx, int ty) {
+    LayerTile& tile = m_layers[layer].m_tiles[ty * m_tilesX + tx];
+    DropTile(tile);
+    tile.state = TileState::Stored;
+    tile.modified = false;
+}
+
+bool Document::SetPreviewChunk(int level, int cx, int cy, const PixelBuffer& pixels) {
+    if (level < 0 || level >= PreviewLevelCount() || cx < 0 || cy < 0 ||
+        cx >= m_preview[level].chunksX || cy >= m_preview[level].chunksY) {
+        return false;
+    }
+    IntRect rect = PreviewChunkRect(level, cx, cy);
+    if (pixels.Width() != rect.Width() || pixels.Height() != rect.Height()) {
+        return false;
+    }
+    PixelBuffer& target = m_preview[level].pixels;
+    for (int y = 0; y < rect.Height(); y++) {
+        std::memcpy(target.Row(rect.top + y) + rect.left, pixels.Row(y), static_cast<size_t>(rect.Width()) * 4);
+    }
+    return true;
+}
+
+void Document::MarkSaved() {
+    for (Layer& layer : m_layers) {
+        for (LayerTile& tile : layer.m_tiles) {
+            tile.modified = false;
+        }
+    }
+    for (PreviewLevel& level : m_preview) {
+        std::fill(level.chunkModified.begin(), level.chunkModified.end(), 0);
+    }
+    m_modified = false;
+}
+
+void Document::SetMemoryBudget(uint64_t bytes, const std::wstring& swapPath) {
+    m_memoryBudget = bytes;
+    if (bytes > 0 && !m_store) {
+        m_store = std::make_unique<TileStore>(swapPath);
+    }
+    TrimMemory();
+}
+
+void Document::TrimMemory() {
+    if (m_memoryBudget == 0) {
+        return;
+    }
+    std::vector<LayerTile*> loaded;
+    uint64_t loadedBytes = 0;
+    for (Layer& layer : m_layers) {
+        for (LayerTile& tile : layer.m_tiles) {
+            if (tile.state == TileState::Loaded) {
+                loaded.push_back(&tile);
+                loadedBytes += TileBytes(tile.pixels);
+            }
+        }
+    }
+
+    // Pack the coldest tiles down to three quarters of the loaded share,
+    // so the edits that follow do not trim every time
+    const uint64_t loadedLimit = m_memoryBudget / 2;
+    if (loadedBytes > loadedLimit) {
+        std::sort(loaded.begin(), loaded.end(), [](const LayerTile* a, const LayerTile* b) {
+            return a->lastUse < b->lastUse;
+        });
+        const uint64_t target = loadedLimit - loadedLimit / 4;
+        int count = 0;
+        while (count < static_cast<int>(loaded.size()) && loadedBytes > target) {
+            loadedBytes -= TileBytes(loaded[count]->pixels);
+            count++;
+        }
+        ParallelFor(0, count, 4, [&](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                PackTile(*loaded[i]);
+            }
+        });
+
+        #ifdef DEBUG
+        printf("Document: packed %d tiles, %llu bytes left loaded\n", count, (unsigned long long)loadedBytes);
+        #endif
+    }
+
+    // Compressed tiles get whatever the loaded ones leave
+    m_store->Trim(m_memoryBudget > loadedBytes ? m_memoryBudget - loadedBytes : 0);
+}
+
+void Document::PackTile(LayerTile& tile) {
+    const uint32_t* data = tile.pixels.Data();
+    const uint32_t first = data[0];
+    if (std::all_of(data, data + TileBytes(tile.pixels) / 4, [first](uint32_t p) { return p == first; })) {
+        tile.state = (first >> 24) ? TileState::Solid : TileState::Empty;
+        tile.color = first;
+    } else if (!tile.modified && m_source) {
+        // Unchanged since it was loaded or saved, so the source has it
+        tile.state = TileState::Stored;
+    } else {
+        tile.handle = m_store->Put(tile.pixels);
+        tile.state = TileState::Packed;
+    }
+    tile.pixels = PixelBuffer();
+}
+
+void Document::DropTile(LayerTile& tile) {
+    if (tile.state == TileState::Packed) {
+        m_store->Release(tile.handle);
+    }
+    tile.state = TileState::Empty;
+    tile.pixels = PixelBuffer();
+}
+
+int Document::BandRows() const {
+    if (m_memoryBudget == 0) {
+        return m_tilesY;
+    }
+    uint64_t layers = 0;
+    for (const Layer& layer : m_layers) {
+        if (layer.m_visible && layer.m_opacity != 0) {
+            layers++;
+        }
+    }
+    const uint64_t tileBytes = static_cast<uint64_t>(TILE_SIZE) * TILE_SIZE * 4;
+    uint64_t rowBytes = (std::max<uint64_t>)(layers, 1) * m_tilesX * tileBytes;
+    uint64_t rows = (m_memoryBudget / 2) / rowBytes;
+    return static_cast<int>((std::min<uint64_t>)((std::max<uint64_t>)(rows, 1), m_tilesY));
+}
+
+IntRect Document::BandRect(int row, int rowEnd) const {
+    IntRect rect = { 0, row * TILE_SIZE, m_width, (std::min)(rowEnd * TILE_SIZE, m_height) };
+    return rect;
+}
+
+DocumentMemoryStats Document::MemoryStats() const {
+    DocumentMemoryStats stats;
+    stats.budget = m_memoryBudget;
+    for (const Layer& layer : m_layers) {
+        for (const LayerTile& tile : layer.m_tiles) {
+            if (tile.state == TileState::Loaded) {
+                stats.loadedTiles++;
+                stats.loadedBytes += TileBytes(tile.pixels);
+            } else if (tile.state == TileState::Solid) {
+                stats.solidTiles++;
+            } else if (tile.state == TileState::Stored) {
+                stats.storedTiles++;
+            }
+        }
+    }
+    if (m_store) {
+        stats.store = m_store->Stats();
+    }
+    return stats;
+}
+
+} // namespace PixelForge
\ No newline at end of file
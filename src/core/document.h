@@ -0,0 +1,193 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "geometry.h"
+#include "pixel_buffer.h"
+#include "tile_store.h"
+
+namespace PixelForge {
+
+// Supplies tiles that are stored but not in memory yet, e.g. a project
+// file. Tiles are named by layer id rather than index so reordering layers
+// does not invalidate them.
+class TileSource {
+public:
+    virtual ~TileSource() = default;
+    virtual bool LoadTile(uint32_t layerId, int tx, int ty, PixelBuffer& tile) = 0;
+};
+
+enum class TileState : uint8_t {
+    Empty,      // Fully transparent, nothing stored
+    Stored,     // Held by the tile source, not loaded yet
+    Loaded,
+    Solid,      // One colour, kept as that value
+    Packed      // Compressed in the tile store, in memory or swapped out
+};
+
+struct LayerTile {
+    TileState state = TileState::Empty;
+    bool modified = false;      // Changed since the last save
+    uint32_t color = 0;         // Solid tiles
+    uint32_t handle = 0;        // Packed tiles
+    uint64_t lastUse = 0;       // Loaded tiles, to pack the coldest first
+    PixelBuffer pixels;         // Loaded tiles only
+};
+
+class Layer {
+public:
+    Layer(uint32_t id, const std::wstring& name, int tileCount)
+        : m_id(id), m_name(name), m_tiles(tileCount) {}
+
+    uint32_t Id() const { return m_id; }
+    const std::wstring& Name() const { return m_name; }
+    uint8_t Opacity() const { return m_opacity; }
+    bool IsVisible() const { return m_visible; }
+    const LayerTile& Tile(int index) const { return m_tiles[index]; }
+
+private:
+    friend class Document;
+
+    uint32_t m_id;
+    std::wstring m_name;
+    uint8_t m_opacity = 255;
+    bool m_visible = true;
+    std::vector<LayerTile> m_tiles;
+};
+
+// One level of the flattened preview pyramid, split into TILE_SIZE chunks
+// so a save only rewrites the chunks that changed
+struct PreviewLevel {
+    int shift = 0;                          // Scale is 1 / 2^shift
+    PixelBuffer pixels;
+    std::vector<uint8_t> chunkModified;     // Per chunk, since the last save
+    int chunksX = 0;
+    int chunksY = 0;
+};
+
+struct DocumentMemoryStats {
+    uint64_t budget = 0;
+    int loadedTiles = 0;
+    uint64_t loadedBytes = 0;
+    int solidTiles = 0;
+    int storedTiles = 0;        // Left in the tile source
+    TileStoreStats store;       // Packed tiles
+};
+
+// Layered image split into TILE_SIZE tiles. Stored tiles are pulled from the
+// tile source on first use. A pyramid of flattened previews, the largest
+// fitting in PREVIEW_SIZE, is refreshed lazily from the tiles that changed
+// so a whole-document view never has to touch full-resolution pixels.
+//
+// With a memory budget, the least recently used tiles are packed once
+// loaded pixels pass half of it: uniform tiles shrink to their colour,
+// unchanged ones fall back to the tile source and the rest go to a
+// TileStore, which swaps out what does not fit in the remainder. Whole-
+// document passes work in bands of tile rows sized to the budget.
+class Document {
+public:
+    static constexpr int TILE_SIZE = 256;
+    static constexpr int PREVIEW_SIZE = 1024;
+    static constexpr int MIN_PREVIEW_SIZE = 64;
+
+    Document(int width, int height);
+
+    int Width() const { return m_width; }
+    int Height() const { return m_height; }
+    int TilesX() const { return m_tilesX; }
+    int TilesY() const { return m_tilesY; }
+    int TileCount() const { return m_tilesX * m_tilesY; }
+    IntRect TileRect(int tx, int ty) const;
+
+    int LayerCount() const { return static_cast<int>(m_layers.size()); }
+    const Layer& GetLayer(int index) const { return m_layers[index]; }
+    int FindLayer(uint32_t id) const;
+
+    // Adds a layer on top and returns its index. id 0 picks a new id.
+    int AddLayer(const std::wstring& name, uint32_t id = 0);
+    void RemoveLayer(int index);
+    void SetLayerOpacity(int index, uint8_t opacity);
+    void SetLayerVisible(int index, bool visible);
+
+    // Sets pixels to nullptr for empty tiles. Loads stored and packed tiles,
+    // and fails when their pixels cannot be read; a stored tile stays
+    // stored so a later read retries it. Pointers and references to tiles
+    // stay valid until the next Composite, Render, UpdatePreview or
+    // TrimMemory call.
+    bool ReadTile(int layer, int tx, int ty, const PixelBuffer*& pixels);
+    // Loads or creates the tile and marks it modified; write to it before
+    // the next preview update
+    PixelBuffer& WriteTile(int layer, int tx, int ty);
+    // Replaces a layer's pixels with image (placed at the origin)
+    void SetPixels(int layer, const PixelBuffer& image);
+
+    // Flattens the visible layers over transparency
+    void Composite(const IntRect& rect, PixelBuffer& out);
+    // Flattens the whole document at 1 / 2^shift. Returns false, with out
+    // partly drawn, once cancel becomes true.
+    bool Render(int shift, PixelBuffer& out, const std::atomic<bool>* cancel = nullptr);
+
+    // Preview pyramid. UpdatePreview re-renders what the changed tiles
+    // cover; call it before reading the levels.
+    void UpdatePreview();
+    int PreviewLevelCount() const { return static_cast<int>(m_preview.size()); }
+    const PreviewLevel& GetPreviewLevel(int level) const { return m_preview[level]; }
+    // Smallest level at least width x height, or 0 when none is
+    int PreviewLevelForSize(int width, int height) const;
+    IntRect PreviewChunkRect(int level, int cx, int cy) const;
+
+    // Tile source and save state
+    void SetTileSource(TileSource* source) { m_source = source; }
+    TileSource* GetTileSource() const { return m_source; }
+    void SetTileStored(int layer, int tx, int ty);
+    bool SetPreviewChunk(int level, int cx, int cy, const PixelBuffer& pixels);
+    void InvalidatePreview();
+    // For loaders: the preview chunks set so far already match the tiles
+    void MarkPreviewCurrent();
+    bool IsModified() const { return m_modified; }
+    void MarkSaved();
+
+    // Keeps loaded and compressed tiles within bytes (0 is unlimited),
+    // swapping the rest to a file at swapPath when it is not empty
+    void SetMemoryBudget(uint64_t bytes, const std::wstring& swapPath);
+    // Packs the least recently used tiles until within the budget
+    void TrimMemory();
+    DocumentMemoryStats MemoryStats() const;
+
+private:
+    void MarkPreviewStale(int tx, int ty);
+    void LoadTiles(const IntRect& rect);
+    void PrefetchTiles(const IntRect& rect);
+    void CompositeLoaded(const IntRect& rect, PixelBuffer& out) const;
+    void PackTile(LayerTile& tile);
+    void DropTile(LayerTile& tile);
+    int BandRows() const;
+    IntRect BandRect(int row, int rowEnd) const;
+
+    int m_width;
+    int m_height;
+    int m_tilesX;
+    int m_tilesY;
+    uint32_t m_nextLayerId = 1;
+    std::vector<Layer> m_layers;            // Bottom to top
+
+    std::vector<PreviewLevel> m_preview;
+    std::vector<uint8_t> m_previewStale;    // Per document tile
+    bool m_previewDirty = false;
+
+    TileSource* m_source = nullptr;         // Not owned; must outlive stored tiles
+    bool m_modified = false;
+
+    uint64_t m_memoryBudget = 0;
+    uint64_t m_useClock = 0;
+    std::unique_ptr<TileStore> m_store;     // Created with the first budget
+};
+
+// Box-filters rect of src down by 2^shift into dst at (dstX, dstY), with
+// colour weighted by alpha so transparent pixels do not darken edges
+void DownsampleBox(const PixelBuffer& src, const IntRect& rect, int shift, PixelBuffer& dst, int dstX, int dstY);
+
+} // namespace PixelForge
\ No newline at end of file
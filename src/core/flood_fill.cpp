@@ -0,0 +1,224 @@
+#include "flood_fill.h"
+#include "parallel.h"
+#include "simd.h"
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+#ifdef DEBUG
+#include <stdio.h>
+#endif
+
+namespace PixelForge {
+
+namespace {
+
+// Compares pixels against the seed color: a pixel matches when every channel
+// (including alpha) is within tolerance. Runs are scanned four pixels at a time.
+class ColorMatcher {
+public:
+    ColorMatcher(uint32_t seed, int tolerance)
+        : m_seed(seed)
+        , m_tolerance(std::min(std::max(tolerance, 0), 255)) {
+        #ifdef PIXELFORGE_SSE2
+        m_seedVec = _mm_set1_epi32(static_cast<int>(seed));
+        m_toleranceVec = _mm_set1_epi8(static_cast<char>(m_tolerance));
+        #endif
+    }
+
+    bool Matches(uint32_t pixel) const {
+        for (int shift = 0; shift < 32; shift += 8) {
+            int a = (pixel >> shift) & 0xFF;
+            int b = (m_seed >> shift) & 0xFF;
+            if (std::abs(a - b) > m_tolerance) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // First x in [x, end) that does not match, or end
+    int NextMismatch(const uint32_t* row, int x, int end) const {
+        #ifdef PIXELFORGE_SSE2
+        for (; x + 4 <= end; x += 4) {
+            int mask = Match4(row + x);
+            if (mask != 0xF) {
+                return x + LowestBit(~mask & 0xF);
+            }
+        }
+        #endif
+        while (x < end && Matches(row[x])) {
+            x++;
+        }
+        return x;
+    }
+
+    // First x in [x, end) that matches, or end
+    int NextMatch(const uint32_t* row, int x, int end) const {
+        #ifdef PIXELFORGE_SSE2
+        for (; x + 4 <= end; x += 4) {
+            int mask = Match4(row + x);
+            if (mask != 0) {
+                return x + LowestBit(mask);
+            }
+        }
+        #endif
+        while (x < end && !Matches(row[x])) {
+            x++;
+        }
+        return x;
+    }
+
+    // Start of the matching run containing x (row[x] must match)
+    int RunStart(const uint32_t* row, int x) const {
+        #ifdef PIXELFORGE_SSE2
+        while (x >= 4) {
+            int mask = Match4(row + x - 4);
+            if (mask != 0xF) {
+                return x - 4 + HighestBit(~mask & 0xF) + 1;
+            }
+            x -= 4;
+        }
+        #endif
+        while (x > 0 && Matches(row[x - 1])) {
+            x--;
+        }
+        return x;
+    }
+
+private:
+    #ifdef PIXELFORGE_SSE2
+    // Bit i set when pixel i of the four matches
+    int Match4(const uint32_t* pixels) const {
+        __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels));
+        __m128i diff = _mm_or_si128(_mm_subs_epu8(p, m_seedVec), _mm_subs_epu8(m_seedVec, p));
+        __m128i over = _mm_subs_epu8(diff, m_toleranceVec);
+        __m128i ok = _mm_cmpeq_epi32(over, _mm_setzero_si128());
+        return _mm_movemask_ps(_mm_castsi128_ps(ok));
+    }
+
+    static int LowestBit(int mask) {
+        int bit = 0;
+        while (!(mask & (1 << bit))) bit++;
+        return bit;
+    }
+
+    static int HighestBit(int mask) {
+        int bit = 3;
+        while (!(mask & (1 << bit))) bit--;
+        return bit;
+    }
+
+    __m128i m_seedVec;
+    __m128i m_toleranceVec;
+    #endif
+
+    uint32_t m_seed;
+    int m_tolerance;
+};
+
+void InsertSpan(std::vector<Span>& row, Span span) {
+    auto it = std::lower_bound(row.begin(), row.end(), span.x0,
+        [](const Span& s, int value) { return s.x0 < value; });
+    row.insert(it, span);
+}
+
+// Span-based scanline fill with an explicit stack. The output mask doubles as
+// the visited set: a matching run is either entirely filled or untouched, so
+// testing one pixel per run is enough.
+RunMask ContiguousFill(const PixelBuffer& image, int seedX, int seedY, const ColorMatcher& matcher) {
+    const int width = image.Width();
+    const int height = image.Height();
+    RunMask mask(width, height);
+
+    struct Seed { int x, y; };
+    std::vector<Seed> stack;
+    stack.push_back({ seedX, seedY });
+
+    while (!stack.empty()) {
+        Seed seed = stack.back();
+        stack.pop_back();
+        if (mask.Contains(seed.x, seed.y)) {
+            continue;
+        }
+
+        const uint32_t* line = image.Row(seed.y);
+        int x0 = matcher.RunStart(line, seed.x);
+        int x1 = matcher.NextMismatch(line, seed.x, width);
+        InsertSpan(mask.Row(seed.y), { x0, x1 });
+
+        for (int ny = seed.y - 1; ny <= seed.y + 1; ny += 2) {
+            if (ny < 0 || ny >= height) continue;
+            const uint32_t* adjacent = image.Row(ny);
+            int x = x0;
+            while (x < x1) {
+                x = matcher.NextMatch(adjacent, x, x1);
+                if (x >= x1) break;
+                if (!mask.Contains(x, ny)) {
+                    stack.push_back({ x, ny });
+                }
+                x = matcher.NextMismatch(adjacent, x, x1);
+            }
+        }
+    }
+    return mask;
+}
+
+// Non-contiguous wand: rows are independent, so bands run in parallel
+RunMask GlobalMatch(const PixelBuffer& image, const ColorMatcher& matcher) {
+    const int width = image.Width();
+    RunMask mask(width, image.Height());
+
+    ParallelFor(0, image.Height(), 64, [&](int y0, int y1) {
+        for (int y = y0; y < y1; y++) {
+            const uint32_t* line = image.Row(y);
+            std::vector<Span>& row = mask.Row(y);
+            int x = 0;
+            while (x < width) {
+                x = matcher.NextMatch(line, x, width);
+                if (x >= width) break;
+                int end = matcher.NextMismatch(line, x, width);
+                row.push_back({ x, end });
+                x = end;
+            }
+        }
+    });
+    return mask;
+}
+
+} // namespace
+
+Selection MagicWand(const PixelBuffer& image, int x, int y, const FillOptions& options) {
+    if (x < 0 || y < 0 || x >= image.Width() || y >= image.Height()) {
+        #ifdef DEBUG
+        printf("WARNING: MagicWand seed (%d, %d) outside image\n", x, y);
+        #endif
+        return Selection(image.Width(), image.Height());
+    }
+
+    ColorMatcher matcher(image.GetPixel(x, y), options.tolerance);
+    if (options.contiguous) {
+        return Selection::FromRuns(ContiguousFill(image, x, y, matcher));
+    }
+    return Selection::FromRuns(GlobalMatch(image, matcher));
+}
+
+bool BucketFill(PixelBuffer& image, int x, int y, uint32_t color,
+                const FillOptions& options, const Selection* constrain) {
+    if (x < 0 || y < 0 || x >= image.Width() || y >= image.Height()) {
+        return false;
+    }
+    // A selection for some other image size cannot say where to stop
+    if (constrain && (constrain->Width() != image.Width() || constrain->Height() != image.Height())) {
+        #ifdef DEBUG
+        printf("WARNING: BucketFill selection size mismatch\n");
+        #endif
+        return false;
+    }
+    Selection region = MagicWand(image, x, y, options);
+    if (constrain && !region.Intersect(*constrain)) {
+        return false;
+    }
+    return FillSelection(image, region, color);
+}
+
+} // namespace PixelForge
\ No newline at end of file
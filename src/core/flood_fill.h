@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include "pixel_buffer.h"
+#include "selection.h"
+
+namespace PixelForge {
+
+struct FillOptions {
+    int tolerance = 32;         // Max per-channel difference from the seed (0-255)
+    bool contiguous = true;     // false = global wand, every matching pixel
+};
+
+// Magic wand: selects pixels within tolerance of the color under (x, y).
+// The result is a hard-edged, run-length selection.
+Selection MagicWand(const PixelBuffer& image, int x, int y, const FillOptions& options);
+
+// Bucket fill: paints the magic wand region with color, limited to the
+// current selection when one is given. Fails without painting when the seed
+// is outside the image or the selection is a different size.
+bool BucketFill(PixelBuffer& image, int x, int y, uint32_t color,
+                const FillOptions& options, const Selection* constrain = nullptr);
+
+} // namespace PixelForge
\ No newline at end of file
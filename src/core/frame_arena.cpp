@@ -0,0 +1,107 @@
+#include "frame_arena.h"
+#include <algorithm>
+
+namespace PixelForge {
+
+namespace {
+
+const size_t MIN_BLOCK_BYTES = 64 * 1024;
+const size_t MAX_RETAINED_BYTES = 16 * 1024 * 1024;    // Larger frames give their blocks back
+
+} // namespace
+
+FrameArena& FrameArena::ForThread() {
+    thread_local FrameArena arena;
+    return arena;
+}
+
+void* FrameArena::Allocate(size_t bytes, size_t alignment) {
+    m_stats.allocations++;
+    if (m_blockCount > 0) {
+        size_t offset = (m_offset + alignment - 1) & ~(alignment - 1);
+        if (offset + bytes <= m_blocks[m_block].Size()) {
+            m_bytesInUse += offset + bytes - m_offset;
+            m_offset = offset + bytes;
+            m_stats.peakBytes = (std::max)(m_stats.peakBytes, m_bytesInUse);
+            return m_blocks[m_block].Data() + offset;
+        }
+    }
+
+    // Blocks start on a pool-aligned boundary
+    if (!NextBlock(bytes)) {
+        return nullptr;
+    }
+    m_offset = bytes;
+    m_bytesInUse += bytes;
+    m_stats.peakBytes = (std::max)(m_stats.peakBytes, m_bytesInUse);
+    return m_blocks[m_block].Data();
+}
+
+bool FrameArena::NextBlock(size_t bytes) {
+    // A later block left over from an earlier frame, if it is big enough
+    int first = m_blockCount == 0 ? 0 : m_block + 1;
+    for (int i = first; i < m_blockCount; i++) {
+        if (m_blocks[i].Size() >= bytes) {
+            m_block = i;
+            return true;
+        }
+    }
+    if (m_blockCount == MAX_BLOCKS) {
+        return false;
+    }
+
+    size_t size = (std::max)(bytes, MIN_BLOCK_BYTES);
+    if (m_blockCount > 0) {
+        size = (std::max)(size, m_blocks[m_blockCount - 1].Size() * 2);
+    }
+    PooledBuffer block = BufferPool::Shared().Acquire(size);
+    if (block.IsEmpty()) {
+        return false;
+    }
+    m_stats.blockAcquires++;
+    m_blocks[m_blockCount] = std::move(block);
+    m_block = m_blockCount++;
+    return true;
+}
+
+void FrameArena::Rewind(const Mark& mark) {
+    m_block = mark.block;
+    m_offset = mark.offset;
+    m_bytesInUse = mark.bytesInUse;
+}
+
+void FrameArena::Reset() {
+    m_stats.resets++;
+    m_block = 0;
+    m_offset = 0;
+    m_bytesInUse = 0;
+    if (m_blockCount == 0 || (m_blockCount == 1 && m_blocks[0].Size() <= MAX_RETAINED_BYTES)) {
+        return;
+    }
+
+    // Merge so the next frame of the same size fits in one block
+    size_t total = 0;
+    for (int i = 0; i < m_blockCount; i++) {
+        total += m_blocks[i].Size();
+        m_blocks[i].Reset();
+    }
+    m_blockCount = 0;
+    if (total <= MAX_RETAINED_BYTES) {
+        m_blocks[0] = BufferPool::Shared().Acquire(total);
+        if (!m_blocks[0].IsEmpty()) {
+            m_stats.blockAcquires++;
+            m_blockCount = 1;
+        }
+    }
+}
+
+FrameArenaStats FrameArena::Stats() const {
+    FrameArenaStats stats = m_stats;
+    stats.bytesInUse = m_bytesInUse;
+    for (int i = 0; i < m_blockCount; i++) {
+        stats.capacity += m_blocks[i].Size();
+    }
+    return stats;
+}
+
+} // namespace PixelForge
\ No newline at end of file
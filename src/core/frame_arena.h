@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "buffer_pool.h"
+
+namespace PixelForge {
+
+struct FrameArenaStats {
+    uint64_t allocations = 0;
+    uint64_t resets = 0;
+    uint64_t blockAcquires = 0;     // Blocks taken from the buffer pool
+    size_t bytesInUse = 0;
+    size_t peakBytes = 0;           // Most in use at once
+    size_t capacity = 0;
+};
+
+// Bump allocator for scratch memory that lives for one paint or one task.
+// Allocation is a pointer increment; nothing is freed individually, the
+// whole arena is rewound by ArenaScope instead. Blocks come from the shared
+// BufferPool, and when a frame spilled over several of them they are merged
+// into one on reset, so a repeating workload settles into a single block
+// and stops touching the pool or the heap. Each thread has its own arena;
+// only trivially destructible types belong in it.
+class FrameArena {
+public:
+    // The calling thread's arena
+    static FrameArena& ForThread();
+
+    FrameArena() = default;
+    ~FrameArena() = default;
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // Uninitialised memory; alignment is a power of two up to 64
+    void* Allocate(size_t bytes, size_t alignment = 16);
+
+    template <typename T>
+    T* AllocateArray(size_t count) {
+        return static_cast<T*>(Allocate(count * sizeof(T), alignof(T) > 16 ? alignof(T) : 16));
+    }
+
+    struct Mark {
+        int block;
+        size_t offset;
+        size_t bytesInUse;
+    };
+
+    Mark GetMark() const { return { m_block, m_offset, m_bytesInUse }; }
+    // Frees everything allocated since mark was taken
+    void Rewind(const Mark& mark);
+    // Frees everything
+    void Reset();
+
+    FrameArenaStats Stats() const;
+
+private:
+    static const int MAX_BLOCKS = 24;
+
+    bool NextBlock(size_t bytes);
+
+    PooledBuffer m_blocks[MAX_BLOCKS];
+    int m_blockCount = 0;
+    int m_block = 0;                // Block being bumped
+    size_t m_offset = 0;            // Next free byte in it
+    size_t m_bytesInUse = 0;
+    FrameArenaStats m_stats;
+};
+
+// Rewinds an arena to where it was when the scope began. The outermost
+// scope on a thread, such as the one around WM_PAINT or a worker task,
+// resets the arena completely.
+class ArenaScope {
+public:
+    explicit ArenaScope(FrameArena& arena = FrameArena::ForThread())
+        : m_arena(arena)
+        , m_mark(arena.GetMark()) {
+    }
+
+    ~ArenaScope() {
+        if (m_mark.block == 0 && m_mark.offset == 0) {
+            m_arena.Reset();
+        } else {
+            m_arena.Rewind(m_mark);
+        }
+    }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+    FrameArena& Arena() { return m_arena; }
+
+private:
+    FrameArena& m_arena;
+    FrameArena::Mark m_mark;
+};
+
+} // namespace PixelForge
\ No newline at end of file
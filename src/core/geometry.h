@@ -0,0 +1,53 @@
+#pragma once
+
+#include <algorithm>
+
+namespace PixelForge {
+
+// Platform-neutral integer rectangle (right/bottom exclusive, like RECT)
+struct IntRect {
+    int left = 0;
+    int top = 0;
+    int right = 0;
+    int bottom = 0;
+
+    int Width() const { return right - left; }
+    int Height() const { return bottom - top; }
+    bool IsEmpty() const { return right <= left || bottom <= top; }
+
+    bool Contains(int x, int y) const {
+        return x >= left && x < right && y >= top && y < bottom;
+    }
+
+    // (std::min)/(std::max) stay clear of the windows.h min/max macros
+    IntRect Intersect(const IntRect& other) const {
+        IntRect r = {
+            (std::max)(left, other.left),
+            (std::max)(top, other.top),
+            (std::min)(right, other.right),
+            (std::min)(bottom, other.bottom)
+        };
+        if (r.IsEmpty()) {
+            return IntRect();
+        }
+        return r;
+    }
+
+    IntRect Union(const IntRect& other) const {
+        if (IsEmpty()) return other;
+        if (other.IsEmpty()) return *this;
+        return {
+            (std::min)(left, other.left),
+            (std::min)(top, other.top),
+            (std::max)(right, other.right),
+            (std::max)(bottom, other.bottom)
+        };
+    }
+};
+
+struct PointF {
+    float x = 0.0f;
+    float y = 0.0f;
+};
+
+} // namespace PixelForge
\ No newline at end of file
@@ -0,0 +1,300 @@
+#include "gif_decoder.h"
+#include <algorithm>
+#include <cstring>
+#ifdef DEBUG
+#include <stdio.h>
+#endif
+
+namespace PixelForge {
+
+namespace {
+
+inline int ReadU16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+FrameDisposal ToDisposal(int method) {
+    switch (method) {
+        case 2:
+            return FrameDisposal::Background;
+        case 3:
+            return FrameDisposal::Previous;
+        default:
+            return FrameDisposal::None;
+    }
+}
+
+} // namespace
+
+GifDecoder::GifDecoder(std::vector<uint8_t> data)
+    : m_data(std::move(data)) {
+}
+
+bool GifDecoder::HasSignature(const std::vector<uint8_t>& data) {
+    return data.size() >= 6 &&
+        (std::memcmp(data.data(), "GIF87a", 6) == 0 || std::memcmp(data.data(), "GIF89a", 6) == 0);
+}
+
+bool GifDecoder::SkipSubBlocks(size_t& pos) const {
+    while (pos < m_data.size()) {
+        int length = m_data[pos++];
+        if (length == 0) {
+            return true;
+        }
+        pos += length;
+    }
+    return false;
+}
+
+bool GifDecoder::Parse() {
+    if (!HasSignature(m_data) || m_data.size() < 13) {
+        return false;
+    }
+
+    const uint8_t* d = m_data.data();
+    const size_t size = m_data.size();
+    m_width = ReadU16(d + 6);
+    m_height = ReadU16(d + 8);
+    int packed = d[10];
+    size_t pos = 13;
+    if (packed & 0x80) {
+        m_globalPaletteOffset = pos;
+        m_globalPaletteSize = 1 << ((packed & 7) + 1);
+        pos += 3 * m_globalPaletteSize;
+    }
+
+    // Graphic control extension applies to the next image only
+    int delayMs = 100;
+    FrameDisposal disposal = FrameDisposal::None;
+    int transparentIndex = -1;
+
+    while (pos < size) {
+        int block = d[pos++];
+        if (block == 0x21) {
+            if (pos >= size) break;
+            int label = d[pos++];
+            if (label == 0xF9 && pos + 5 <= size && d[pos] == 4) {
+                int flags = d[pos + 1];
+                disposal = ToDisposal((flags >> 2) & 7);
+                delayMs = NormalizeFrameDelay(ReadU16(d + pos + 2) * 10);
+                transparentIndex = (flags & 1) ? d[pos + 4] : -1;
+                pos += 5;
+            } else if (label == 0xFF && pos + 16 <= size && d[pos] == 11 &&
+                       std::memcmp(d + pos + 1, "NETSCAPE2.0", 11) == 0 &&
+                       d[pos + 12] >= 3 && d[pos + 13] == 1) {
+                // NETSCAPE counts repeats after the first play
+                int repeats = ReadU16(d + pos + 14);
+                m_loopCount = repeats == 0 ? 0 : repeats + 1;
+            }
+            if (!SkipSubBlocks(pos)) break;
+        } else if (block == 0x2C) {
+            if (pos + 10 > size) break;
+            FrameInfo info;
+            int left = ReadU16(d + pos);
+            int top = ReadU16(d + pos + 2);
+            int width = ReadU16(d + pos + 4);
+            int height = ReadU16(d + pos + 6);
+            if (!IsAnimationSizeAllowed(width, height)) break;
+            info.rect = { left, top, left + width, top + height };
+            int flags = d[pos + 8];
+            pos += 9;
+            info.interlaced = (flags & 0x40) != 0;
+            if (flags & 0x80) {
+                info.paletteOffset = pos;
+                info.paletteSize = 1 << ((flags & 7) + 1);
+                pos += 3 * info.paletteSize;
+            } else {
+                info.paletteOffset = m_globalPaletteOffset;
+                info.paletteSize = m_globalPaletteSize;
+            }
+            info.delayMs = delayMs;
+            info.disposal = disposal;
+            info.transparentIndex = transparentIndex;
+            info.dataOffset = pos;
+
+            if (pos >= size || info.rect.IsEmpty()) break;
+            m_frames.push_back(info);
+
+            delayMs = 100;
+            disposal = FrameDisposal::None;
+            transparentIndex = -1;
+
+            // A truncated final frame still decodes as far as it goes
+            pos++;
+            if (!SkipSubBlocks(pos)) break;
+        } else {
+            break;  // Trailer (0x3B) or junk
+        }
+    }
+
+    // Some encoders leave the logical screen at 0x0
+    if (m_width == 0 || m_height == 0) {
+        for (const auto& frame : m_frames) {
+            m_width = std::max(m_width, frame.rect.right);
+            m_height = std::max(m_height, frame.rect.bottom);
+        }
+    }
+
+    #ifdef DEBUG
+    printf("GifDecoder: %dx%d, %d frames, loop count %d\n",
+           m_width, m_height, (int)m_frames.size(), m_loopCount);
+    #endif
+
+    return !m_frames.empty() && IsAnimationSizeAllowed(m_width, m_height);
+}
+
+bool GifDecoder::DecodeLzw(const FrameInfo& info, std::vector<uint8_t>& indices) {
+    size_t pos = info.dataOffset;
+    int minCodeSize = m_data[pos++];
+    if (minCodeSize < 2 || minCodeSize > 11) {
+        return false;
+    }
+
+    // Join the data sub-blocks so the bit reader sees one stream
+    m_compressed.clear();
+    while (pos < m_data.size()) {
+        int length = m_data[pos++];
+        if (length == 0) break;
+        size_t end = std::min(pos + length, m_data.size());
+        m_compressed.insert(m_compressed.end(), m_data.begin() + pos, m_data.begin() + end);
+        pos = end;
+    }
+
+    static const int MAX_CODES = 4096;
+    uint16_t prefix[MAX_CODES];
+    uint8_t suffix[MAX_CODES];
+    uint8_t stack[MAX_CODES + 1];
+
+    const int clearCode = 1 << minCodeSize;
+    const int endCode = clearCode + 1;
+    for (int i = 0; i < clearCode; i++) {
+        prefix[i] = 0;
+        suffix[i] = static_cast<uint8_t>(i);
+    }
+
+    int codeSize = minCodeSize + 1;
+    int nextCode = clearCode + 2;
+    int oldCode = -1;
+    int firstByte = 0;
+
+    uint32_t bitBuffer = 0;
+    int bitCount = 0;
+    size_t in = 0;
+    size_t out = 0;
+    const size_t total = indices.size();
+
+    while (out < total) {
+        while (bitCount < codeSize && in < m_compressed.size()) {
+            bitBuffer |= static_cast<uint32_t>(m_compressed[in++]) << bitCount;
+            bitCount += 8;
+        }
+        if (bitCount < codeSize) break;
+        int code = bitBuffer & ((1 << codeSize) - 1);
+        bitBuffer >>= codeSize;
+        bitCount -= codeSize;
+
+        if (code == clearCode) {
+            codeSize = minCodeSize + 1;
+            nextCode = clearCode + 2;
+            oldCode = -1;
+            continue;
+        }
+        if (code == endCode) break;
+
+        if (oldCode < 0) {
+            if (code >= clearCode) break;
+            indices[out++] = static_cast<uint8_t>(code);
+            oldCode = code;
+            firstByte = code;
+            continue;
+        }
+
+        int inCode = code;
+        int top = 0;
+        if (code >= nextCode) {
+            if (code > nextCode) break;
+            stack[top++] = static_cast<uint8_t>(firstByte);
+            code = oldCode;
+        }
+        while (code >= clearCode) {
+            stack[top++] = suffix[code];
+            code = prefix[code];
+        }
+        firstByte = suffix[code];
+        stack[top++] = static_cast<uint8_t>(firstByte);
+
+        while (top > 0 && out < total) {
+            indices[out++] = stack[--top];
+        }
+
+        if (nextCode < MAX_CODES) {
+            prefix[nextCode] = static_cast<uint16_t>(oldCode);
+            suffix[nextCode] = static_cast<uint8_t>(firstByte);
+            nextCode++;
+            if (nextCode == (1 << codeSize) && codeSize < 12) {
+                codeSize++;
+            }
+        }
+        oldCode = inCode;
+    }
+
+    // Short streams are common in the wild; the rest stays at the fill index
+    return out > 0;
+}
+
+bool GifDecoder::DecodeFrame(int index, AnimationFrame& frame) {
+    if (index < 0 || index >= FrameCount()) {
+        return false;
+    }
+
+    const FrameInfo& info = m_frames[index];
+    const int width = info.rect.Width();
+    const int height = info.rect.Height();
+    const int fillIndex = info.transparentIndex >= 0 ? info.transparentIndex : 0;
+
+    std::vector<uint8_t> indices(static_cast<size_t>(width) * height, static_cast<uint8_t>(fillIndex));
+    if (!DecodeLzw(info, indices)) {
+        #ifdef DEBUG
+        printf("ERROR: GIF frame %d has no decodable LZW data\n", index);
+        #endif
+        return false;
+    }
+
+    uint32_t palette[256];
+    for (int i = 0; i < 256; i++) {
+        if (i < info.paletteSize && info.paletteOffset + 3 * i + 2 < m_data.size()) {
+            const uint8_t* rgb = m_data.data() + info.paletteOffset + 3 * i;
+            palette[i] = MakeColor(rgb[0], rgb[1], rgb[2]);
+        } else {
+            palette[i] = MakeColor(static_cast<uint8_t>(i), static_cast<uint8_t>(i), static_cast<uint8_t>(i));
+        }
+    }
+    if (info.transparentIndex >= 0) {
+        palette[info.transparentIndex] = 0;
+    }
+
+    frame.rect = info.rect;
+    frame.delayMs = info.delayMs;
+    frame.disposal = info.disposal;
+    frame.blend = FrameBlend::Over;
+    frame.pixels.Resize(width, height);
+
+    // Interlaced rows arrive in four passes
+    static const int PASS_START[4] = { 0, 4, 2, 1 };
+    static const int PASS_STEP[4] = { 8, 8, 4, 2 };
+    int sourceRow = 0;
+    for (int pass = 0; pass < (info.interlaced ? 4 : 1); pass++) {
+        int start = info.interlaced ? PASS_START[pass] : 0;
+        int step = info.interlaced ? PASS_STEP[pass] : 1;
+        for (int y = start; y < height; y += step, sourceRow++) {
+            const uint8_t* src = indices.data() + static_cast<size_t>(sourceRow) * width;
+            uint32_t* dst = frame.pixels.Row(y);
+            for (int x = 0; x < width; x++) {
+                dst[x] = palette[src[x]];
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace PixelForge
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "animation_decoder.h"
+
+namespace PixelForge {
+
+class GifDecoder : public AnimationDecoder {
+public:
+    explicit GifDecoder(std::vector<uint8_t> data);
+
+    // Walks the block structure and records every frame; no LZW decoding
+    bool Parse();
+
+    int Width() const override { return m_width; }
+    int Height() const override { return m_height; }
+    int FrameCount() const override { return static_cast<int>(m_frames.size()); }
+    int LoopCount() const override { return m_loopCount; }
+    bool DecodeFrame(int index, AnimationFrame& frame) override;
+
+    static bool HasSignature(const std::vector<uint8_t>& data);
+
+private:
+    struct FrameInfo {
+        IntRect rect;
+        int delayMs;
+        FrameDisposal disposal;
+        int transparentIndex;   // -1 when none
+        bool interlaced;
+        size_t paletteOffset;
+        int paletteSize;
+        size_t dataOffset;      // LZW minimum code size byte
+    };
+
+    bool SkipSubBlocks(size_t& pos) const;
+    bool DecodeLzw(const FrameInfo& info, std::vector<uint8_t>& indices);
+
+    std::vector<uint8_t> m_data;
+    std::vector<FrameInfo> m_frames;
+    int m_width = 0;
+    int m_height = 0;
+    int m_loopCount = 0;
+    size_t m_globalPaletteOffset = 0;
+    int m_globalPaletteSize = 0;
+    std::vector<uint8_t> m_compressed;  // Reused sub-block scratch
+};
+
+} // namespace PixelForge
\ No newline at end of file
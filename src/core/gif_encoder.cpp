@@ -0,0 +1,153 @@
+#include "gif_encoder.h"
+#include <algorithm>
+
+namespace PixelForge {
+
+namespace {
+
+const int MAX_CODES = 4096;
+const int HASH_SIZE = 8192;                 // Power of two above MAX_CODES
+const int MAX_SUB_BLOCK = 255;
+
+inline void WriteU16(std::vector<uint8_t>& out, int value) {
+    out.push_back(static_cast<uint8_t>(value & 0xFF));
+    out.push_back(static_cast<uint8_t>((value >> 8) & 0xFF));
+}
+
+// Packs variable-width codes least significant bit first
+class CodeWriter {
+public:
+    explicit CodeWriter(std::vector<uint8_t>& out) : m_out(out) {}
+
+    void Write(int code, int size) {
+        m_bits |= static_cast<uint32_t>(code) << m_count;
+        m_count += size;
+        while (m_count >= 8) {
+            m_out.push_back(static_cast<uint8_t>(m_bits & 0xFF));
+            m_bits >>= 8;
+            m_count -= 8;
+        }
+    }
+
+    void Flush() {
+        if (m_count > 0) {
+            m_out.push_back(static_cast<uint8_t>(m_bits & 0xFF));
+        }
+        m_bits = 0;
+        m_count = 0;
+    }
+
+private:
+    std::vector<uint8_t>& m_out;
+    uint32_t m_bits = 0;
+    int m_count = 0;
+};
+
+// Strings are found by (prefix code, next index) in an open-addressed table
+void CompressLzw(const std::vector<uint8_t>& indices, int minCodeSize, std::vector<uint8_t>& out) {
+    const int clearCode = 1 << minCodeSize;
+    const int endCode = clearCode + 1;
+    std::vector<int32_t> keys(HASH_SIZE);
+    std::vector<uint16_t> codes(HASH_SIZE);
+    CodeWriter writer(out);
+
+    int codeSize = minCodeSize + 1;
+    int nextCode = clearCode + 2;
+    std::fill(keys.begin(), keys.end(), -1);
+    writer.Write(clearCode, codeSize);
+
+    int prefix = indices[0];
+    for (size_t i = 1; i < indices.size(); i++) {
+        const int index = indices[i];
+        const int32_t key = (prefix << 8) | index;
+        int slot = static_cast<int>((static_cast<uint32_t>(key) * 2654435761u) >> 19);
+        while (keys[slot] != -1 && keys[slot] != key) {
+            slot = (slot + 1) & (HASH_SIZE - 1);
+        }
+        if (keys[slot] == key) {
+            prefix = codes[slot];
+            continue;
+        }
+
+        writer.Write(prefix, codeSize);
+        if (nextCode < MAX_CODES) {
+            keys[slot] = key;
+            codes[slot] = static_cast<uint16_t>(nextCode++);
+            // The decoder adds its entry one code later, so it widens then
+            if (nextCode == (1 << codeSize) + 1 && codeSize < 12) {
+                codeSize++;
+            }
+        } else {
+            writer.Write(clearCode, codeSize);
+            std::fill(keys.begin(), keys.end(), -1);
+            codeSize = minCodeSize + 1;
+            nextCode = clearCode + 2;
+        }
+        prefix = index;
+    }
+    writer.Write(prefix, codeSize);
+    writer.Write(endCode, codeSize);
+    writer.Flush();
+}
+
+} // namespace
+
+bool EncodeGif(const IndexedImage& image, std::vector<uint8_t>& out) {
+    out.clear();
+    const int colors = static_cast<int>(image.palette.size());
+    if (image.width <= 0 || image.height <= 0 || image.width > 0xFFFF || image.height > 0xFFFF ||
+        colors == 0 || colors > 256 || image.indices.size() != static_cast<size_t>(image.width) * image.height) {
+        return false;
+    }
+
+    // Colour tables hold a power of two entries, at least two
+    int tableBits = 1;
+    while ((1 << tableBits) < colors) {
+        tableBits++;
+    }
+
+    static const uint8_t SIGNATURE[] = { 'G', 'I', 'F', '8', '9', 'a' };
+    out.insert(out.end(), SIGNATURE, SIGNATURE + sizeof(SIGNATURE));
+    WriteU16(out, image.width);
+    WriteU16(out, image.height);
+    out.push_back(static_cast<uint8_t>(0x80 | 0x70 | (tableBits - 1)));    // Global table, 8-bit colour
+    out.push_back(0);       // Background index
+    out.push_back(0);       // Square pixels
+    for (int i = 0; i < (1 << tableBits); i++) {
+        uint32_t color = i < colors ? image.palette[i] : 0;
+        out.push_back(static_cast<uint8_t>((color >> 16) & 0xFF));
+        out.push_back(static_cast<uint8_t>((color >> 8) & 0xFF));
+        out.push_back(static_cast<uint8_t>(color & 0xFF));
+    }
+
+    if (image.transparentIndex >= 0 && image.transparentIndex < colors) {
+        const uint8_t control[] = { 0x21, 0xF9, 0x04, 0x01, 0x00, 0x00,
+                                    static_cast<uint8_t>(image.transparentIndex), 0x00 };
+        out.insert(out.end(), control, control + sizeof(control));
+    }
+
+    out.push_back(0x2C);
+    WriteU16(out, 0);
+    WriteU16(out, 0);
+    WriteU16(out, image.width);
+    WriteU16(out, image.height);
+    out.push_back(0);       // No local table, not interlaced
+
+    const int minCodeSize = (std::max)(tableBits, 2);
+    std::vector<uint8_t> compressed;
+    compressed.reserve(image.indices.size() / 2);
+    CompressLzw(image.indices, minCodeSize, compressed);
+
+    out.push_back(static_cast<uint8_t>(minCodeSize));
+    out.reserve(out.size() + compressed.size() + compressed.size() / MAX_SUB_BLOCK + 3);
+    for (size_t offset = 0; offset < compressed.size(); offset += MAX_SUB_BLOCK) {
+        size_t length = (std::min)(compressed.size() - offset, static_cast<size_t>(MAX_SUB_BLOCK));
+        out.push_back(static_cast<uint8_t>(length));
+        out.insert(out.end(), compressed.begin() + offset, compressed.begin() + offset + length);
+    }
+    out.push_back(0);       // Block terminator
+    out.push_back(0x3B);    // Trailer
+    return true;
+}
+
+} // namespace PixelForge
\ No newline at end of file
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "palette_quantizer.h"
+
+namespace PixelForge {
+
+// Writes image as a single-frame GIF89a with its palette as the global
+// colour table. Fails for images over 65535 pixels on a side or with
+// more than 256 palette entries.
+bool EncodeGif(const IndexedImage& image, std::vector<uint8_t>& out);
+
+} // namespace PixelForge
\ No newline at end of file
@@ -0,0 +1,259 @@
+#include "image_prefetcher.h"
+#include <algorithm>
+#include <cstdlib>
+#ifdef DEBUG
+#include <stdio.h>
+#endif
+
+namespace PixelForge {
+
+ImagePrefetcher::ImagePrefetcher(ImageLoader loader, int radius, size_t byteBudget, int workerCount)
+    : m_loader(std::move(loader))
+    , m_radius(std::max(radius, 1))
+    , m_byteBudget(byteBudget) {
+    for (int i = 0; i < std::max(workerCount, 1); i++) {
+        m_workers.emplace_back(&ImagePrefetcher::WorkerLoop, this);
+    }
+}
+
+ImagePrefetcher::~ImagePrefetcher() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopRequested = true;
+        m_pending.clear();
+        for (auto& job : m_active) {
+            *job.cancel = true;
+        }
+    }
+    m_workAvailable.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void ImagePrefetcher::SetReadyCallback(ReadyCallback onReady) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_onReady = std::move(onReady);
+}
+
+size_t ImagePrefetcher::ImageBytes(const PrefetchedImage& image) {
+    return static_cast<size_t>(image.pixels.Width()) * image.pixels.Height() * sizeof(uint32_t);
+}
+
+void ImagePrefetcher::SetFiles(std::vector<std::wstring> files) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_files = std::move(files);
+    m_indexOf.clear();
+    for (int i = 0; i < static_cast<int>(m_files.size()); i++) {
+        m_indexOf[m_files[i]] = i;
+    }
+    m_failed.clear();
+    m_current = -1;
+    m_direction = 1;
+    Reschedule();
+}
+
+void ImagePrefetcher::SetDisplaySize(int maxWidth, int maxHeight) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (maxWidth == m_maxWidth && maxHeight == m_maxHeight) {
+        return;
+    }
+    m_maxWidth = maxWidth;
+    m_maxHeight = maxHeight;
+    m_failed.clear();
+
+    // Keep images that already cover the new bounds (or are full size)
+    for (auto it = m_cache.begin(); it != m_cache.end();) {
+        const PrefetchedImage& image = *it->second;
+        double scale = std::min({ 1.0, (double)maxWidth / std::max(image.sourceWidth, 1),
+                                  (double)maxHeight / std::max(image.sourceHeight, 1) });
+        int needed = static_cast<int>(image.sourceWidth * scale);
+        if (image.pixels.Width() + 1 < needed) {
+            m_cacheBytes -= ImageBytes(image);
+            it = m_cache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // In-flight decodes target the old bounds
+    for (auto& job : m_active) {
+        *job.cancel = true;
+    }
+    Reschedule();
+}
+
+void ImagePrefetcher::SetCurrent(int index) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (index == m_current || index < 0 || index >= static_cast<int>(m_files.size())) {
+        return;
+    }
+    if (m_current >= 0) {
+        m_direction = index > m_current ? 1 : -1;
+    }
+    m_current = index;
+    Reschedule();
+}
+
+void ImagePrefetcher::Reschedule() {
+    m_wanted.clear();
+    m_pending.clear();
+
+    int count = static_cast<int>(m_files.size());
+    if (m_current >= 0 && m_current < count) {
+        m_wanted.push_back(m_files[m_current]);
+        for (int step = 1; step <= m_radius; step++) {
+            int ahead = m_current + step * m_direction;
+            if (ahead >= 0 && ahead < count) {
+                m_wanted.push_back(m_files[ahead]);
+            }
+        }
+        int behind = m_current - m_direction;
+        if (behind >= 0 && behind < count) {
+            m_wanted.push_back(m_files[behind]);
+        }
+    }
+
+    // Abandon decodes that fell out of the window, e.g. after a reversal
+    for (auto& job : m_active) {
+        if (!IsWanted(job.path) && !*job.cancel) {
+            *job.cancel = true;
+            m_stats.cancelled++;
+        }
+    }
+
+    // The current image goes first; the caller waits for it on a miss
+    for (const std::wstring& path : m_wanted) {
+        if (m_cache.find(path) == m_cache.end() && !IsActive(path) && m_failed.count(path) == 0) {
+            m_pending.push_back(path);
+        }
+    }
+
+    if (m_maxWidth > 0 && m_maxHeight > 0 && !m_pending.empty()) {
+        m_workAvailable.notify_all();
+    }
+}
+
+bool ImagePrefetcher::IsWanted(const std::wstring& path) const {
+    return std::find(m_wanted.begin(), m_wanted.end(), path) != m_wanted.end();
+}
+
+bool ImagePrefetcher::IsActive(const std::wstring& path) const {
+    for (const auto& job : m_active) {
+        if (job.path == path && !*job.cancel) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t ImagePrefetcher::Rank(const std::wstring& path) const {
+    // Wanted images rank by priority, everything else by distance beyond them
+    auto wanted = std::find(m_wanted.begin(), m_wanted.end(), path);
+    if (wanted != m_wanted.end()) {
+        return static_cast<size_t>(wanted - m_wanted.begin());
+    }
+    auto listed = m_indexOf.find(path);
+    if (listed == m_indexOf.end() || m_current < 0) {
+        return static_cast<size_t>(-1);
+    }
+    return m_wanted.size() + static_cast<size_t>(std::abs(listed->second - m_current));
+}
+
+void ImagePrefetcher::Insert(const std::wstring& path, std::shared_ptr<const PrefetchedImage> image) {
+    m_cacheBytes += ImageBytes(*image);
+    m_cache[path] = std::move(image);
+
+    while (m_cacheBytes > m_byteBudget && !m_cache.empty()) {
+        auto victim = m_cache.begin();
+        size_t victimRank = Rank(victim->first);
+        for (auto it = std::next(m_cache.begin()); it != m_cache.end(); ++it) {
+            size_t rank = Rank(it->first);
+            if (rank > victimRank) {
+                victim = it;
+                victimRank = rank;
+            }
+        }
+
+        #ifdef DEBUG
+        printf("ImagePrefetcher: evicting %ls\n", victim->first.c_str());
+        #endif
+
+        m_cacheBytes -= ImageBytes(*victim->second);
+        m_cache.erase(victim);
+    }
+}
+
+std::shared_ptr<const PrefetchedImage> ImagePrefetcher::Find(const std::wstring& path) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_cache.find(path);
+    if (it == m_cache.end()) {
+        m_stats.misses++;
+        return nullptr;
+    }
+    m_stats.hits++;
+    return it->second;
+}
+
+bool ImagePrefetcher::HasFailed(const std::wstring& path) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_failed.count(path) != 0;
+}
+
+PrefetchStats ImagePrefetcher::Stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    PrefetchStats stats = m_stats;
+    stats.cachedImages = static_cast<int>(m_cache.size());
+    stats.cacheBytes = m_cacheBytes;
+    return stats;
+}
+
+void ImagePrefetcher::WorkerLoop() {
+    for (;;) {
+        ActiveJob job;
+        int maxWidth, maxHeight;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_workAvailable.wait(lock, [this]() {
+                return m_stopRequested || (!m_pending.empty() && m_maxWidth > 0 && m_maxHeight > 0);
+            });
+            if (m_stopRequested) {
+                return;
+            }
+            job.path = m_pending.front();
+            job.cancel = std::make_shared<std::atomic<bool>>(false);
+            m_pending.pop_front();
+            m_active.push_back(job);
+            maxWidth = m_maxWidth;
+            maxHeight = m_maxHeight;
+        }
+
+        auto image = std::make_shared<PrefetchedImage>();
+        bool ok = m_loader(job.path, maxWidth, maxHeight, *job.cancel, *image);
+
+        ReadyCallback onReady;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_active.erase(std::find_if(m_active.begin(), m_active.end(),
+                [&job](const ActiveJob& active) { return active.cancel == job.cancel; }));
+            if (*job.cancel || !IsWanted(job.path)) {
+                continue;
+            }
+            if (ok) {
+                m_stats.decoded++;
+                Insert(job.path, std::move(image));
+            } else {
+                #ifdef DEBUG
+                printf("ImagePrefetcher: failed to decode %ls\n", job.path.c_str());
+                #endif
+                m_failed.insert(job.path);
+            }
+            onReady = m_onReady;
+        }
+        if (onReady) {
+            onReady(job.path);
+        }
+    }
+}
+
+} // namespace PixelForge
\ No newline at end of file
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "pixel_buffer.h"
+
+namespace PixelForge {
+
+// An image decoded at display resolution, with the size of the original file
+struct PrefetchedImage {
+    PixelBuffer pixels;
+    int sourceWidth = 0;
+    int sourceHeight = 0;
+};
+
+struct PrefetchStats {
+    int hits = 0;
+    int misses = 0;
+    int decoded = 0;
+    int cancelled = 0;
+    int cachedImages = 0;
+    size_t cacheBytes = 0;
+};
+
+// Decodes path to fit within maxWidth x maxHeight (never upscaling). Runs on a
+// worker thread and should give up early once cancel becomes true.
+using ImageLoader = std::function<bool(const std::wstring& path, int maxWidth, int maxHeight,
+                                       const std::atomic<bool>& cancel, PrefetchedImage& image)>;
+
+// Keeps the current image in a directory listing and its neighbours decoded
+// ahead of time. The current image is queued first, so a miss is decoded on
+// a worker rather than by the caller. Prefetching follows the direction of
+// travel: the radius images ahead are queued nearest first, then the nearest
+// one behind. When the current image moves, queued work is rebuilt and
+// in-flight decodes that are no longer wanted are cancelled. The cache is
+// bounded by byteBudget and evicts the entries furthest from the wanted
+// window first.
+class ImagePrefetcher {
+public:
+    // Runs on a worker thread once path has been cached or has failed
+    using ReadyCallback = std::function<void(const std::wstring& path)>;
+
+    ImagePrefetcher(ImageLoader loader, int radius = 3,
+                    size_t byteBudget = 256 * 1024 * 1024, int workerCount = 2);
+    ~ImagePrefetcher();
+
+    void SetReadyCallback(ReadyCallback onReady);
+
+    // Replaces the listing; cached images of files still listed are kept,
+    // earlier failures are forgotten
+    void SetFiles(std::vector<std::wstring> files);
+
+    // Decode bounds; cached images smaller than the new bounds are dropped
+    // and failed files are tried again
+    void SetDisplaySize(int maxWidth, int maxHeight);
+
+    // Moves the window to files[index] and reprioritises the queue
+    void SetCurrent(int index);
+
+    // Cached image for path, or nullptr. The returned image stays valid
+    // after eviction for as long as the caller holds it.
+    std::shared_ptr<const PrefetchedImage> Find(const std::wstring& path);
+
+    // True once the loader has given up on path; it is not queued again
+    bool HasFailed(const std::wstring& path) const;
+
+    PrefetchStats Stats() const;
+
+private:
+    struct ActiveJob {
+        std::wstring path;
+        std::shared_ptr<std::atomic<bool>> cancel;
+    };
+
+    void WorkerLoop();
+    void Reschedule();
+    void Insert(const std::wstring& path, std::shared_ptr<const PrefetchedImage> image);
+    size_t Rank(const std::wstring& path) const;
+    bool IsWanted(const std::wstring& path) const;
+    bool IsActive(const std::wstring& path) const;
+    static size_t ImageBytes(const PrefetchedImage& image);
+
+    ImageLoader m_loader;
+    const int m_radius;
+    const size_t m_byteBudget;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::vector<std::thread> m_workers;
+    bool m_stopRequested = false;
+
+    std::vector<std::wstring> m_files;
+    std::unordered_map<std::wstring, int> m_indexOf;
+    int m_current = -1;
+    int m_direction = 1;
+    int m_maxWidth = 0;
+    int m_maxHeight = 0;
+
+    std::vector<std::wstring> m_wanted;     // Priority order, current first
+    std::deque<std::wstring> m_pending;
+    std::vector<ActiveJob> m_active;
+    std::unordered_map<std::wstring, std::shared_ptr<const PrefetchedImage>> m_cache;
+    std::unordered_set<std::wstring> m_failed;
+    size_t m_cacheBytes = 0;
+    ReadyCallback m_onReady;
+    PrefetchStats m_stats;
+};
+
+} // namespace PixelForge
\ No newline at end of file
@@ -0,0 +1,359 @@
+#include "inflate.h"
+#include <cstring>
+
+namespace PixelForge {
+
+namespace {
+
+const int MAX_BITS = 15;
+const int FAST_BITS = 9;
+
+const uint16_t LENGTH_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+const uint8_t LENGTH_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+const uint16_t DIST_BASE[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+const uint8_t DIST_EXTRA[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+const uint8_t CODE_LENGTH_ORDER[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+// Canonical Huffman table with a direct lookup for short codes
+struct Huffman {
+    uint16_t count[MAX_BITS + 1];
+    uint16_t symbol[288];
+    uint16_t fast[1 << FAST_BITS];  // symbol << 4 | length, 0 = use the slow path
+
+    bool Build(const uint8_t* lengths, int n) {
+        std::memset(count, 0, sizeof(count));
+        std::memset(fast, 0, sizeof(fast));
+        for (int i = 0; i < n; i++) {
+            count[lengths[i]]++;
+        }
+        count[0] = 0;
+
+        // Reject over-subscribed sets; incomplete ones are legal
+        int left = 1;
+        for (int len = 1; len <= MAX_BITS; len++) {
+            left <<= 1;
+            left -= count[len];
+            if (left < 0) {
+                return false;
+            }
+        }
+
+        uint16_t offsets[MAX_BITS + 1];
+        offsets[1] = 0;
+        for (int len = 1; len < MAX_BITS; len++) {
+            offsets[len + 1] = offsets[len] + count[len];
+        }
+        for (int i = 0; i < n; i++) {
+            if (lengths[i]) {
+                symbol[offsets[lengths[i]]++] = static_cast<uint16_t>(i);
+            }
+        }
+
+        // Codes are assigned MSB-first but read LSB-first, so reverse them
+        int code = 0;
+        int index = 0;
+        for (int len = 1; len <= FAST_BITS; len++) {
+            for (int k = 0; k < count[len]; k++, index++, code++) {
+                int reversed = 0;
+                for (int b = 0; b < len; b++) {
+                    reversed |= ((code >> b) & 1) << (len - 1 - b);
+                }
+                for (int fill = reversed; fill < (1 << FAST_BITS); fill += 1 << len) {
+                    fast[fill] = static_cast<uint16_t>((symbol[index] << 4) | len);
+                }
+            }
+            code <<= 1;
+        }
+        return true;
+    }
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+    bool Need(int bits) {
+        while (m_count < bits) {
+            if (m_pos >= m_size) {
+                return false;
+            }
+            m_buffer |= static_cast<uint64_t>(m_data[m_pos++]) << m_count;
+            m_count += 8;
+        }
+        return true;
+    }
+
+    // Tops up the buffer as far as the input allows
+    void Refill() {
+        while (m_count <= 56 && m_pos < m_size) {
+            m_buffer |= static_cast<uint64_t>(m_data[m_pos++]) << m_count;
+            m_count += 8;
+        }
+    }
+
+    bool Bits(int n, int& value) {
+        if (!Need(n)) {
+            return false;
+        }
+        value = static_cast<int>(m_buffer & ((1ull << n) - 1));
+        Consume(n);
+        return true;
+    }
+
+    void Consume(int n) {
+        m_buffer >>= n;
+        m_count -= n;
+    }
+
+    void AlignToByte() {
+        Consume(m_count & 7);
+    }
+
+    uint64_t Peek() const { return m_buffer; }
+    int Available() const { return m_count; }
+
+    // Bytes for stored blocks, after AlignToByte
+    bool CopyBytes(size_t n, std::vector<uint8_t>& out, size_t limit) {
+        if (n > limit - out.size()) {
+            return false;
+        }
+        while (n > 0 && m_count >= 8) {
+            out.push_back(static_cast<uint8_t>(m_buffer & 0xFF));
+            Consume(8);
+            n--;
+        }
+        if (m_size - m_pos < n) {
+            return false;
+        }
+        out.insert(out.end(), m_data + m_pos, m_data + m_pos + n);
+        m_pos += n;
+        return true;
+    }
+
+private:
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_pos = 0;
+    uint64_t m_buffer = 0;
+    int m_count = 0;
+};
+
+int Decode(BitReader& in, const Huffman& h) {
+    in.Refill();
+    int available = in.Available();
+    if (available > 0) {
+        uint16_t entry = h.fast[in.Peek() & ((1 << FAST_BITS) - 1)];
+        int len = entry & 15;
+        if (entry && len <= available) {
+            in.Consume(len);
+            return entry >> 4;
+        }
+    }
+
+    // Long code: walk the canonical table one bit at a time
+    int code = 0, first = 0, index = 0;
+    for (int len = 1; len <= MAX_BITS; len++) {
+        int bit;
+        if (!in.Bits(1, bit)) {
+            return -1;
+        }
+        code |= bit;
+        int count = h.count[len];
+        if (code - count < first) {
+            return h.symbol[index + (code - first)];
+        }
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+bool InflateBlock(BitReader& in, std::vector<uint8_t>& out, size_t limit, const Huffman& lengths, const Huffman& distances) {
+    for (;;) {
+        int sym = Decode(in, lengths);
+        if (sym < 0) {
+            return false;
+        }
+        if (sym < 256) {
+            if (out.size() == limit) {
+                return false;
+            }
+            out.push_back(static_cast<uint8_t>(sym));
+            continue;
+        }
+        if (sym == 256) {
+            return true;
+        }
+
+        sym -= 257;
+        if (sym >= 29) {
+            return false;
+        }
+        int extra;
+        if (!in.Bits(LENGTH_EXTRA[sym], extra)) {
+            return false;
+        }
+        size_t length = LENGTH_BASE[sym] + extra;
+
+        int dsym = Decode(in, distances);
+        if (dsym < 0 || dsym >= 30 || !in.Bits(DIST_EXTRA[dsym], extra)) {
+            return false;
+        }
+        size_t distance = DIST_BASE[dsym] + extra;
+        if (distance > out.size() || length > limit - out.size()) {
+            return false;
+        }
+
+        size_t from = out.size() - distance;
+        out.resize(out.size() + length);
+        uint8_t* dst = out.data() + out.size() - length;
+        const uint8_t* src = out.data() + from;
+        for (size_t i = 0; i < length; i++) {
+            dst[i] = src[i];   // Overlapping copies repeat the pattern
+        }
+    }
+}
+
+bool BuildFixed(Huffman& lengths, Huffman& distances) {
+    uint8_t lens[288];
+    int i = 0;
+    for (; i < 144; i++) lens[i] = 8;
+    for (; i < 256; i++) lens[i] = 9;
+    for (; i < 280; i++) lens[i] = 7;
+    for (; i < 288; i++) lens[i] = 8;
+    uint8_t dists[30];
+    std::memset(dists, 5, sizeof(dists));
+    return lengths.Build(lens, 288) && distances.Build(dists, 30);
+}
+
+bool BuildDynamic(BitReader& in, Huffman& lengths, Huffman& distances) {
+    int hlit, hdist, hclen;
+    if (!in.Bits(5, hlit) || !in.Bits(5, hdist) || !in.Bits(4, hclen)) {
+        return false;
+    }
+    hlit += 257;
+    hdist += 1;
+    hclen += 4;
+    if (hlit > 286 || hdist > 30) {
+        return false;
+    }
+
+    uint8_t codeLengths[19] = { 0 };
+    for (int i = 0; i < hclen; i++) {
+        int value;
+        if (!in.Bits(3, value)) {
+            return false;
+        }
+        codeLengths[CODE_LENGTH_ORDER[i]] = static_cast<uint8_t>(value);
+    }
+    Huffman codeTable;
+    if (!codeTable.Build(codeLengths, 19)) {
+        return false;
+    }
+
+    uint8_t lens[286 + 30] = { 0 };
+    int index = 0;
+    while (index < hlit + hdist) {
+        int sym = Decode(in, codeTable);
+        if (sym < 0) {
+            return false;
+        }
+        if (sym < 16) {
+            lens[index++] = static_cast<uint8_t>(sym);
+            continue;
+        }
+
+        int repeat, value = 0;
+        if (sym == 16) {
+            if (index == 0 || !in.Bits(2, repeat)) return false;
+            value = lens[index - 1];
+            repeat += 3;
+        } else if (sym == 17) {
+            if (!in.Bits(3, repeat)) return false;
+            repeat += 3;
+        } else {
+            if (!in.Bits(7, repeat)) return false;
+            repeat += 11;
+        }
+        if (index + repeat > hlit + hdist) {
+            return false;
+        }
+        while (repeat--) {
+            lens[index++] = static_cast<uint8_t>(value);
+        }
+    }
+
+    return lens[256] != 0 && lengths.Build(lens, hlit) && distances.Build(lens + hlit, hdist);
+}
+
+} // namespace
+
+bool Inflate(const uint8_t* data, size_t size, std::vector<uint8_t>& out, size_t maxSize) {
+    size_t limit = SIZE_MAX;
+    if (maxSize) {
+        out.reserve(out.size() + maxSize);
+        limit = out.size() + maxSize;
+    }
+
+    BitReader in(data, size);
+    Huffman lengths, distances;
+    int last = 0;
+    while (!last) {
+        int type;
+        if (!in.Bits(1, last) || !in.Bits(2, type)) {
+            return false;
+        }
+
+        if (type == 0) {
+            in.AlignToByte();
+            int len, nlen;
+            if (!in.Bits(16, len) || !in.Bits(16, nlen) || len != (~nlen & 0xFFFF)) {
+                return false;
+            }
+            if (!in.CopyBytes(static_cast<size_t>(len), out, limit)) {
+                return false;
+            }
+        } else if (type == 1) {
+            if (!BuildFixed(lengths, distances) || !InflateBlock(in, out, limit, lengths, distances)) {
+                return false;
+            }
+        } else if (type == 2) {
+            if (!BuildDynamic(in, lengths, distances) || !InflateBlock(in, out, limit, lengths, distances)) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ZlibDecompress(const uint8_t* data, size_t size, std::vector<uint8_t>& out, size_t maxSize) {
+    if (size < 2) {
+        return false;
+    }
+    int cmf = data[0];
+    int flags = data[1];
+    if ((cmf & 0x0F) != 8 || ((cmf << 8) | flags) % 31 != 0 || (flags & 0x20)) {
+        return false;
+    }
+    return Inflate(data + 2, size - 2, out, maxSize);
+}
+
+} // namespace PixelForge
\ No newline at end of file
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace PixelForge {
+
+// Decompresses a raw DEFLATE stream (RFC 1951), appending to out. A
+// non-zero maxSize is reserved up front, and a stream that would append
+// more than that fails, so a small file cannot expand without bound.
+bool Inflate(const uint8_t* data, size_t size, std::vector<uint8_t>& out, size_t maxSize = 0);
+
+// Same for a zlib-wrapped stream (RFC 1950), as used by PNG. The Adler-32
+// trailer is not verified.
+bool ZlibDecompress(const uint8_t* data, size_t size, std::vector<uint8_t>& out, size_t maxSize = 0);
+
+} // namespace PixelForge
\ No newline at end of file
@@ -0,0 +1,934 @@
+#include "jpeg_decoder.h"
+#include "frame_arena.h"
+#include "parallel.h"
+#include "simd.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#ifdef DEBUG
+#include <stdio.h>
+#endif
+
+namespace PixelForge {
+
+namespace {
+
+// Natural (row-major) position of each zigzag index
+const uint8_t ZIGZAG[64] = {
+     0,  1,  8, 16,  9,  2,  3, 10,
+    17, 24, 32, 25, 18, 11,  4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34,
+    27, 20, 13,  6,  7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36,
+    29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46,
+    53, 60, 61, 54, 47, 55, 62, 63
+};
+
+inline int ReadU16(const uint8_t* p) {
+    return (p[0] << 8) | p[1];
+}
+
+inline uint64_t LoadBigEndian64(const uint8_t* p) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+// True when any byte of value is 0xFF
+inline bool HasFFByte(uint64_t value) {
+    uint64_t inverted = ~value;
+    return ((inverted - 0x0101010101010101ull) & ~inverted & 0x8080808080808080ull) != 0;
+}
+
+inline uint8_t ClampByte(int value) {
+    return static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+// Restart segments are only worth a thread in groups of this many MCUs
+const int PARALLEL_MIN_UNITS = 256;
+const int CONVERT_MIN_ROWS = 32;
+
+// Largest frame taken from a file, as for animations; the planes of a forged
+// 65535x65535 header would be 12 GB. Larger files go to the caller's fallback.
+const int64_t MAX_PIXELS = 32ll * 1024 * 1024;
+
+// YCbCr to RGB with 14 fractional bits, so the SSE2 path can use 16-bit
+// multiplies and still match the scalar one exactly
+const int CR_TO_R = 22970;      // 1.402
+const int CB_TO_G = -5638;      // -0.344136
+const int CR_TO_G = -11700;     // -0.714136
+const int CB_TO_B = 29032;      // 1.772
+const int COLOR_ROUND = 1 << 13;
+
+// ParallelFor split into at most threads chunks (0 for no limit)
+template <typename Fn>
+void ParallelForThreads(int begin, int end, int minChunk, int threads, Fn&& fn) {
+    if (threads > 0) {
+        minChunk = (std::max)(minChunk, (end - begin + threads - 1) / threads);
+    }
+    ParallelFor(begin, end, minChunk, fn);
+}
+
+// Plane row widened to the full sampling by repeating samples
+const uint8_t* UpsampleRow(const uint8_t* src, int h, int maxH, int width, uint8_t* scratch) {
+    if (h == maxH) {
+        return src;
+    }
+    if (h * 2 == maxH) {
+        for (int x = 0; x < width; x++) {
+            scratch[x] = src[x >> 1];
+        }
+    } else {
+        for (int x = 0; x < width; x++) {
+            scratch[x] = src[x * h / maxH];
+        }
+    }
+    return scratch;
+}
+
+inline uint32_t YCbCrToColor(int luma, int blue, int red) {
+    return MakeColor(ClampByte(luma + ((CR_TO_R * red + COLOR_ROUND) >> 14)),
+                     ClampByte(luma + ((CB_TO_G * blue + CR_TO_G * red + COLOR_ROUND) >> 14)),
+                     ClampByte(luma + ((CB_TO_B * blue + COLOR_ROUND) >> 14)));
+}
+
+#ifdef PIXELFORGE_SSE2
+// (a * factorA + b * factorB + COLOR_ROUND) >> 14 for eight 16-bit lanes
+inline __m128i ChromaTerm(__m128i a, __m128i b, int factorA, int factorB) {
+    const __m128i factors = _mm_set1_epi32(static_cast<int>((static_cast<uint32_t>(factorB) << 16) |
+                                                            (static_cast<uint32_t>(factorA) & 0xFFFF)));
+    const __m128i round = _mm_set1_epi32(COLOR_ROUND);
+    __m128i lo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(a, b), factors), round), 14);
+    __m128i hi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(a, b), factors), round), 14);
+    return _mm_packs_epi32(lo, hi);
+}
+
+// Eight YCbCr pixels to BGRA, identical to YCbCrToColor
+inline void ConvertEight(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint32_t* dst) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i center = _mm_set1_epi16(128);
+    __m128i luma = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(y)), zero);
+    __m128i blue = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(cb)), zero), center);
+    __m128i red = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(cr)), zero), center);
+
+    __m128i r = _mm_add_epi16(luma, ChromaTerm(red, zero, CR_TO_R, 0));
+    __m128i g = _mm_add_epi16(luma, ChromaTerm(blue, red, CB_TO_G, CR_TO_G));
+    __m128i b = _mm_add_epi16(luma, ChromaTerm(blue, zero, CB_TO_B, 0));
+
+    __m128i blueGreen = _mm_unpacklo_epi8(_mm_packus_epi16(b, b), _mm_packus_epi16(g, g));
+    __m128i redAlpha = _mm_unpacklo_epi8(_mm_packus_epi16(r, r), _mm_set1_epi8(static_cast<char>(0xFF)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_unpacklo_epi16(blueGreen, redAlpha));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4), _mm_unpackhi_epi16(blueGreen, redAlpha));
+}
+#endif
+
+// IDCT basis for an N-point output from the low N coefficients, keeping the
+// 8-point normalisation so each output sample is the average of the pixels
+// it replaces: table[x][u] = c(u) / 2 * cos((2x + 1) u pi / 2N)
+struct IdctTables {
+    float table[4][8][8];   // Indexed by log2(N)
+    alignas(16) float transposed[4][8][8];  // [u][x], for the SIMD row pass
+
+    IdctTables() {
+        const double pi = 3.14159265358979323846;
+        for (int level = 0; level < 4; level++) {
+            int n = 1 << level;
+            for (int x = 0; x < n; x++) {
+                for (int u = 0; u < n; u++) {
+                    double c = u == 0 ? std::sqrt(0.5) : 1.0;
+                    table[level][x][u] = static_cast<float>(c / 2.0 * std::cos((2 * x + 1) * u * pi / (2 * n)));
+                    transposed[level][u][x] = table[level][x][u];
+                }
+            }
+        }
+    }
+};
+
+const IdctTables& GetIdctTables() {
+    static const IdctTables tables;
+    return tables;
+}
+
+inline int Log2Scale(int n) {
+    return n == 8 ? 3 : n == 4 ? 2 : n == 2 ? 1 : 0;
+}
+
+} // namespace
+
+// Entropy-coded segment reader: removes 0xFF00 stuffing and stops at markers,
+// after which it returns zero bits
+struct JpegDecoder::BitReader {
+    const uint8_t* data;
+    size_t pos;
+    size_t size;
+    uint64_t buffer = 0;   // Left-aligned
+    int count = 0;
+    bool atMarker = false;
+
+    BitReader(const uint8_t* d, size_t start, size_t end)
+        : data(d), pos(start), size(end) {
+    }
+
+    // Keeps at least 25 bits buffered: enough for a code and its value
+    void Fill() {
+        if (count <= 24) {
+            Refill();
+        }
+    }
+
+    void Refill() {
+        // Whole bytes at once while none of them needs unstuffing
+        if (!atMarker && pos + 8 <= size) {
+            uint64_t word = LoadBigEndian64(data + pos);
+            if (!HasFFByte(word)) {
+                int bytes = (64 - count) >> 3;
+                if (bytes < 8) {
+                    word &= ~0ull << (64 - bytes * 8);
+                }
+                buffer |= word >> count;
+                pos += bytes;
+                count += bytes * 8;
+                return;
+            }
+        }
+        while (count <= 56) {
+            uint32_t byte = 0;
+            if (!atMarker && pos < size) {
+                byte = data[pos];
+                if (byte == 0xFF) {
+                    uint8_t next = pos + 1 < size ? data[pos + 1] : 0xD9;
+                    if (next == 0x00) {
+                        pos += 2;
+                    } else {
+                        atMarker = true;
+                        byte = 0;
+                    }
+                } else {
+                    pos++;
+                }
+            }
+            buffer |= static_cast<uint64_t>(byte) << (56 - count);
+            count += 8;
+        }
+    }
+
+    int Bits(int n) {
+        Fill();
+        int value = static_cast<int>(buffer >> (64 - n));
+        buffer <<= n;
+        count -= n;
+        return value;
+    }
+
+    // Signed coefficient of the given magnitude category
+    int Receive(int n) {
+        int value = Bits(n);
+        return value < (1 << (n - 1)) ? value - (1 << n) + 1 : value;
+    }
+
+    int Decode(const HuffmanTable& table) {
+        Fill();
+        uint32_t peek = static_cast<uint32_t>(buffer >> 55);
+        int length = table.fastLength[peek];
+        if (length) {
+            buffer <<= length;
+            count -= length;
+            return table.fastSymbol[peek];
+        }
+        uint32_t code16 = static_cast<uint32_t>(buffer >> 48);
+        for (length = 10; length <= 16; length++) {
+            int code = static_cast<int>(code16 >> (16 - length));
+            if (code <= table.maxCode[length]) {
+                buffer <<= length;
+                count -= length;
+                return table.values[table.valueOffset[length] + code];
+            }
+        }
+        return -1;
+    }
+
+    // Drops buffered bits and steps over the next RSTn marker
+    bool Restart() {
+        buffer = 0;
+        count = 0;
+        while (pos + 1 < size && !(data[pos] == 0xFF && data[pos + 1] >= 0xD0 && data[pos + 1] <= 0xD7)) {
+            pos++;
+        }
+        if (pos + 1 >= size) {
+            return false;
+        }
+        pos += 2;
+        atMarker = false;
+        return true;
+    }
+};
+
+JpegDecoder::JpegDecoder(const uint8_t* data, size_t size)
+    : m_data(data)
+    , m_size(size) {
+    std::memset(m_quant, 0, sizeof(m_quant));
+}
+
+bool JpegDecoder::HasSignature(const uint8_t* data, size_t size) {
+    return size >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF;
+}
+
+int JpegDecoder::ScaleForTarget(int width, int height, int targetWidth, int targetHeight) {
+    for (int denominator = 8; denominator > 1; denominator /= 2) {
+        if ((width + denominator - 1) / denominator >= targetWidth &&
+            (height + denominator - 1) / denominator >= targetHeight) {
+            return denominator;
+        }
+    }
+    return 1;
+}
+
+bool JpegDecoder::BuildHuffmanTable(HuffmanTable& table, const uint8_t* counts, const uint8_t* symbols, int total) {
+    std::memset(table.fastLength, 0, sizeof(table.fastLength));
+    std::memcpy(table.values, symbols, total);
+
+    int code = 0;
+    int index = 0;
+    for (int length = 1; length <= 16; length++) {
+        table.valueOffset[length] = index - code;
+        for (int i = 0; i < counts[length - 1]; i++) {
+            if (length <= 9) {
+                int first = code << (9 - length);
+                for (int j = 0; j < (1 << (9 - length)); j++) {
+                    table.fastLength[first + j] = static_cast<uint8_t>(length);
+                    table.fastSymbol[first + j] = symbols[index];
+                }
+            }
+            code++;
+            index++;
+        }
+        if (code > (1 << length)) {
+            return false;
+        }
+        table.maxCode[length] = counts[length - 1] ? code - 1 : -1;
+        code <<= 1;
+    }
+    table.maxCode[17] = 0x7FFFFFFF;
+    table.present = true;
+    return true;
+}
+
+void JpegDecoder::BuildFastAc(HuffmanTable& table) {
+    for (int peek = 0; peek < 512; peek++) {
+        table.fastAc[peek] = 0;
+        int length = table.fastLength[peek];
+        int symbol = table.fastSymbol[peek];
+        int size = symbol & 15;
+        if (length == 0 || size == 0 || length + size > 9) {
+            continue;
+        }
+        int bits = ((peek << length) & 511) >> (9 - size);
+        int value = bits < (1 << (size - 1)) ? bits - (1 << size) + 1 : bits;
+        table.fastAc[peek] = value * 256 + (symbol >> 4) * 16 + length + size;
+    }
+}
+
+bool JpegDecoder::ReadFrame(size_t pos, int length) {
+    const uint8_t* d = m_data + pos;
+    if (length < 6 || d[0] != 8) {
+        return false;
+    }
+    m_height = ReadU16(d + 1);
+    m_width = ReadU16(d + 3);
+    int count = d[5];
+    if (m_width <= 0 || m_height <= 0 || (count != 1 && count != 3) || length < 6 + count * 3) {
+        return false;
+    }
+    if (static_cast<int64_t>(m_width) * m_height > MAX_PIXELS) {
+        #ifdef DEBUG
+        printf("JpegDecoder: %dx%d is too large\n", m_width, m_height);
+        #endif
+        return false;
+    }
+
+    m_components.clear();
+    m_maxH = 1;
+    m_maxV = 1;
+    for (int i = 0; i < count; i++) {
+        Component component = {};
+        component.id = d[6 + i * 3];
+        component.h = d[7 + i * 3] >> 4;
+        component.v = d[7 + i * 3] & 15;
+        component.quantTable = d[8 + i * 3] & 3;
+        if (component.h < 1 || component.h > 4 || component.v < 1 || component.v > 4) {
+            return false;
+        }
+        m_maxH = std::max(m_maxH, component.h);
+        m_maxV = std::max(m_maxV, component.v);
+        m_components.push_back(component);
+    }
+
+    m_mcusWide = (m_width + 8 * m_maxH - 1) / (8 * m_maxH);
+    m_mcusHigh = (m_height + 8 * m_maxV - 1) / (8 * m_maxV);
+    for (auto& component : m_components) {
+        int width = (m_width * component.h + m_maxH - 1) / m_maxH;
+        int height = (m_height * component.v + m_maxV - 1) / m_maxV;
+        component.blocksWide = (width + 7) / 8;
+        component.blocksHigh = (height + 7) / 8;
+    }
+    return true;
+}
+
+bool JpegDecoder::ReadHuffmanTables(size_t pos, int length) {
+    size_t end = pos + length;
+    while (pos + 17 <= end) {
+        int tableClass = m_data[pos] >> 4;
+        int tableId = m_data[pos] & 15;
+        const uint8_t* counts = m_data + pos + 1;
+        int total = 0;
+        for (int i = 0; i < 16; i++) {
+            total += counts[i];
+        }
+        pos += 17;
+        if (tableClass > 1 || tableId > 3 || total > 256 || pos + total > end) {
+            return false;
+        }
+        HuffmanTable& table = tableClass == 0 ? m_dcTables[tableId] : m_acTables[tableId];
+        if (!BuildHuffmanTable(table, counts, m_data + pos, total)) {
+            return false;
+        }
+        if (tableClass == 1) {
+            BuildFastAc(table);
+        }
+        pos += total;
+    }
+    return true;
+}
+
+bool JpegDecoder::ReadQuantTables(size_t pos, int length) {
+    size_t end = pos + length;
+    while (pos < end) {
+        int precision = m_data[pos] >> 4;
+        int tableId = m_data[pos] & 15;
+        pos++;
+        size_t bytes = precision ? 128 : 64;
+        if (tableId > 3 || pos + bytes > end) {
+            return false;
+        }
+        for (int i = 0; i < 64; i++) {
+            m_quant[tableId][i] = static_cast<uint16_t>(precision ? ReadU16(m_data + pos + i * 2) : m_data[pos + i]);
+        }
+        pos += bytes;
+    }
+    return true;
+}
+
+bool JpegDecoder::ReadScanHeader(size_t pos, int length) {
+    const uint8_t* d = m_data + pos;
+    int count = length > 0 ? d[0] : 0;
+    if (count < 1 || count > static_cast<int>(m_components.size()) || length < 4 + count * 2) {
+        return false;
+    }
+
+    m_scanComponents.clear();
+    for (int i = 0; i < count; i++) {
+        int id = d[1 + i * 2];
+        int tables = d[2 + i * 2];
+        int index = -1;
+        for (int c = 0; c < static_cast<int>(m_components.size()); c++) {
+            if (m_components[c].id == id) {
+                index = c;
+            }
+        }
+        if (index < 0) {
+            return false;
+        }
+        Component& component = m_components[index];
+        component.dcTable = (tables >> 4) & 3;
+        component.acTable = tables & 3;
+        if (!m_dcTables[component.dcTable].present || !m_acTables[component.acTable].present) {
+            return false;
+        }
+        m_scanComponents.push_back(index);
+    }
+    return true;
+}
+
+bool JpegDecoder::ReadMarkers(bool stopAtScan) {
+    m_scanComponents.clear();
+    while (m_pos + 1 < m_size) {
+        if (m_data[m_pos] != 0xFF) {
+            m_pos++;
+            continue;
+        }
+        int marker = m_data[m_pos + 1];
+        if (marker == 0xFF || marker == 0x00) {
+            m_pos++;
+            continue;
+        }
+        m_pos += 2;
+        if (marker == 0xD8 || (marker >= 0xD0 && marker <= 0xD7) || marker == 0x01) {
+            continue;
+        }
+        if (marker == 0xD9) {
+            return true;
+        }
+        if (m_pos + 2 > m_size) {
+            return false;
+        }
+
+        int length = ReadU16(m_data + m_pos) - 2;
+        size_t body = m_pos + 2;
+        if (length < 0 || body + length > m_size) {
+            return false;
+        }
+        m_pos = body + length;
+
+        bool ok = true;
+        switch (marker) {
+            case 0xC0:
+            case 0xC1:
+                ok = ReadFrame(body, length);
+                break;
+            case 0xC4:
+                ok = ReadHuffmanTables(body, length);
+                break;
+            case 0xDB:
+                ok = ReadQuantTables(body, length);
+                break;
+            case 0xDD:
+                m_restartInterval = length >= 2 ? ReadU16(m_data + body) : 0;
+                break;
+            case 0xDA:
+                if (m_components.empty() || !ReadScanHeader(body, length)) {
+                    return false;
+                }
+                if (stopAtScan) {
+                    return true;
+                }
+                break;
+            default:
+                // Progressive, lossless, hierarchical and arithmetic-coded frames
+                if (marker >= 0xC2 && marker <= 0xCF && marker != 0xC8 && marker != 0xCC) {
+                    #ifdef DEBUG
+                    printf("JpegDecoder: unsupported frame type 0x%02X\n", marker);
+                    #endif
+                    return false;
+                }
+                break;
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool JpegDecoder::ReadHeader() {
+    m_pos = 0;
+    m_headerRead = false;
+    m_components.clear();
+    m_restartInterval = 0;
+    for (int i = 0; i < 4; i++) {
+        m_dcTables[i].present = false;
+        m_acTables[i].present = false;
+    }
+
+    if (!HasSignature(m_data, m_size) || !ReadMarkers(true) || m_scanComponents.empty()) {
+        return false;
+    }
+    m_headerRead = true;
+    return true;
+}
+
+bool JpegDecoder::DecodeBlock(BitReader& bits, const Component& component, int& dcPrediction, int scale,
+                              float* coefficients, int& acRows) const {
+    const uint16_t* quant = m_quant[component.quantTable];
+
+    int category = bits.Decode(m_dcTables[component.dcTable]);
+    if (category < 0 || category > 11) {
+        return false;
+    }
+    if (category) {
+        dcPrediction += bits.Receive(category);
+    }
+    coefficients[0] = static_cast<float>(dcPrediction * quant[0]);
+    acRows = 0;
+
+    const HuffmanTable& ac = m_acTables[component.acTable];
+    for (int k = 1; k < 64;) {
+        // Short codes with small values come out of one lookup
+        bits.Fill();
+        int fast = ac.fastAc[bits.buffer >> 55];
+        if (fast) {
+            int length = fast & 15;
+            bits.buffer <<= length;
+            bits.count -= length;
+            k += (fast >> 4) & 15;
+            if (k > 63) {
+                return false;
+            }
+            int position = ZIGZAG[k];
+            if ((position >> 3) < scale && (position & 7) < scale) {
+                coefficients[position] = static_cast<float>((fast >> 8) * quant[k]);
+                acRows |= 1 << (position >> 3);
+            }
+            k++;
+            continue;
+        }
+
+        int symbol = bits.Decode(ac);
+        if (symbol < 0) {
+            return false;
+        }
+        int run = symbol >> 4;
+        int size = symbol & 15;
+        if (size == 0) {
+            if (run != 15) {
+                break;  // End of block
+            }
+            k += 16;
+            continue;
+        }
+        k += run;
+        if (k > 63) {
+            return false;
+        }
+        int value = bits.Receive(size);
+        int position = ZIGZAG[k];
+        // Coefficients outside the kept corner are decoded but not stored
+        if ((position >> 3) < scale && (position & 7) < scale) {
+            coefficients[position] = static_cast<float>(value * quant[k]);
+            acRows |= 1 << (position >> 3);
+        }
+        k++;
+    }
+    return true;
+}
+
+void JpegDecoder::StoreBlock(Component& component, int blockX, int blockY, int scale,
+                             const float* coefficients, int acRows) {
+    const int stride = component.planeWidth;
+    uint8_t* out = component.plane.data() + static_cast<size_t>(blockY) * scale * stride + blockX * scale;
+
+    if (acRows == 0) {
+        uint8_t value = ClampByte(static_cast<int>(std::lrint(coefficients[0] / 8.0f)) + 128);
+        for (int y = 0; y < scale; y++) {
+            std::memset(out + static_cast<size_t>(y) * stride, value, scale);
+        }
+        return;
+    }
+
+    // Separable IDCT; coefficient rows that are all zero (most of the
+    // high-frequency ones) are skipped in both passes
+    const IdctTables& tables = GetIdctTables();
+    const int level = Log2Scale(scale);
+    const int rowsUsed = acRows | 1;    // Row 0 also holds the DC term
+
+#ifdef PIXELFORGE_SSE2
+    if (scale >= 4) {
+        // Row pass: each output row is a weighted sum of basis rows
+        const float (*basis)[8] = tables.transposed[level];
+        __m128 rowsLo[8];
+        __m128 rowsHi[8];
+        for (int v = 0; v < scale; v++) {
+            __m128 sumLo = _mm_setzero_ps();
+            __m128 sumHi = _mm_setzero_ps();
+            if (rowsUsed >> v & 1) {
+                for (int u = 0; u < scale; u++) {
+                    float coefficient = coefficients[v * 8 + u];
+                    if (coefficient != 0.0f) {
+                        __m128 weight = _mm_set1_ps(coefficient);
+                        sumLo = _mm_add_ps(sumLo, _mm_mul_ps(weight, _mm_load_ps(basis[u])));
+                        if (scale == 8) {
+                            sumHi = _mm_add_ps(sumHi, _mm_mul_ps(weight, _mm_load_ps(basis[u] + 4)));
+                        }
+                    }
+                }
+            }
+            rowsLo[v] = sumLo;
+            rowsHi[v] = sumHi;
+        }
+
+        // Column pass, then round, level shift and saturate to bytes
+        const __m128i offset = _mm_set1_epi16(128);
+        for (int y = 0; y < scale; y++) {
+            __m128 sumLo = _mm_setzero_ps();
+            __m128 sumHi = _mm_setzero_ps();
+            for (int v = 0; v < scale; v++) {
+                if (rowsUsed >> v & 1) {
+                    __m128 weight = _mm_set1_ps(tables.table[level][y][v]);
+                    sumLo = _mm_add_ps(sumLo, _mm_mul_ps(weight, rowsLo[v]));
+                    sumHi = _mm_add_ps(sumHi, _mm_mul_ps(weight, rowsHi[v]));
+                }
+            }
+            __m128i words = _mm_packs_epi32(_mm_cvtps_epi32(sumLo), _mm_cvtps_epi32(sumHi));
+            __m128i shifted = _mm_adds_epi16(words, offset);
+            __m128i bytes = _mm_packus_epi16(shifted, shifted);
+            uint8_t* dst = out + static_cast<size_t>(y) * stride;
+            if (scale == 8) {
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), bytes);
+            } else {
+                uint32_t four = static_cast<uint32_t>(_mm_cvtsi128_si32(bytes));
+                std::memcpy(dst, &four, 4);
+            }
+        }
+        return;
+    }
+#endif
+
+    const auto& table = tables.table[level];
+    float rows[8][8];
+    for (int v = 0; v < scale; v++) {
+        if (!(rowsUsed >> v & 1)) {
+            continue;
+        }
+        const float* row = coefficients + v * 8;
+        for (int x = 0; x < scale; x++) {
+            float sum = 0.0f;
+            for (int u = 0; u < scale; u++) {
+                sum += row[u] * table[x][u];
+            }
+            rows[v][x] = sum;
+        }
+    }
+    for (int y = 0; y < scale; y++) {
+        uint8_t* dst = out + static_cast<size_t>(y) * stride;
+        for (int x = 0; x < scale; x++) {
+            float sum = 0.0f;
+            for (int v = 0; v < scale; v++) {
+                if (rowsUsed >> v & 1) {
+                    sum += table[y][v] * rows[v][x];
+                }
+            }
+            dst[x] = ClampByte(static_cast<int>(std::lrint(sum)) + 128);
+        }
+    }
+}
+
+bool JpegDecoder::FindRestartSegments(std::vector<size_t>& starts, size_t& scanEnd) const {
+    starts.assign(1, m_pos);
+    size_t pos = m_pos;
+    for (;;) {
+        const void* hit = pos < m_size ? std::memchr(m_data + pos, 0xFF, m_size - pos) : nullptr;
+        if (!hit) {
+            return false;
+        }
+        pos = static_cast<const uint8_t*>(hit) - m_data;
+        if (pos + 1 >= m_size) {
+            return false;
+        }
+        uint8_t next = m_data[pos + 1];
+        if (next == 0x00) {
+            pos += 2;   // Stuffed 0xFF data byte
+        } else if (next == 0xFF) {
+            pos++;      // Fill byte before a marker
+        } else if (next >= 0xD0 && next <= 0xD7) {
+            pos += 2;
+            starts.push_back(pos);
+        } else {
+            scanEnd = pos;
+            return true;
+        }
+    }
+}
+
+bool JpegDecoder::DecodeUnits(size_t start, size_t end, int firstUnit, int lastUnit, int scale, size_t* stoppedAt) {
+    BitReader bits(m_data, start, end);
+    int dcPrediction[4] = {};   // Per component; reset at every restart
+    alignas(16) float coefficients[64] = {};
+
+    // A single-component scan is not interleaved: one block per MCU,
+    // covering only the component's own blocks
+    const bool interleaved = m_scanComponents.size() > 1;
+    const int unitsWide = interleaved ? m_mcusWide : m_components[m_scanComponents[0]].blocksWide;
+
+    auto decode = [&](int index, int blockX, int blockY) {
+        Component& component = m_components[index];
+        int acRows;
+        if (!DecodeBlock(bits, component, dcPrediction[index], scale, coefficients, acRows)) {
+            return false;
+        }
+        StoreBlock(component, blockX, blockY, scale, coefficients, acRows);
+        for (int v = 0; v < scale; v++) {
+            if (acRows >> v & 1) {
+                std::memset(coefficients + v * 8, 0, scale * sizeof(float));
+            }
+        }
+        return true;
+    };
+
+    for (int unit = firstUnit; unit < lastUnit; unit++) {
+        if (m_restartInterval && unit > firstUnit && unit % m_restartInterval == 0) {
+            if (!bits.Restart()) {
+                return false;
+            }
+            std::fill(dcPrediction, dcPrediction + 4, 0);
+        }
+
+        int unitX = unit % unitsWide;
+        int unitY = unit / unitsWide;
+        if (!interleaved) {
+            if (!decode(m_scanComponents[0], unitX, unitY)) {
+                return false;
+            }
+            continue;
+        }
+        for (int index : m_scanComponents) {
+            const Component& component = m_components[index];
+            for (int by = 0; by < component.v; by++) {
+                for (int bx = 0; bx < component.h; bx++) {
+                    if (!decode(index, unitX * component.h + bx, unitY * component.v + by)) {
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+
+    if (stoppedAt) {
+        *stoppedAt = bits.pos;
+    }
+    return true;
+}
+
+bool JpegDecoder::DecodeScan(int scale) {
+    const bool interleaved = m_scanComponents.size() > 1;
+    const Component& single = m_components[m_scanComponents[0]];
+    const int totalUnits = interleaved ? m_mcusWide * m_mcusHigh : single.blocksWide * single.blocksHigh;
+
+    // Restart markers split the scan into segments that decode on their
+    // own. Anything unexpected in them falls back to the serial path.
+    const int segments = m_restartInterval ? (totalUnits + m_restartInterval - 1) / m_restartInterval : 1;
+    std::vector<size_t> starts;
+    size_t scanEnd = 0;
+    if (segments > 1 && m_threadCount != 1 && FindRestartSegments(starts, scanEnd) &&
+        static_cast<int>(starts.size()) == segments) {
+        std::atomic<bool> failed(false);
+        const int minSegments = (std::max)(1, PARALLEL_MIN_UNITS / m_restartInterval);
+        ParallelForThreads(0, segments, minSegments, m_threadCount, [&](int first, int last) {
+            for (int i = first; i < last && !failed; i++) {
+                size_t end = i + 1 < segments ? starts[i + 1] - 2 : scanEnd;
+                int lastUnit = (std::min)((i + 1) * m_restartInterval, totalUnits);
+                if (!DecodeUnits(starts[i], end, i * m_restartInterval, lastUnit, scale, nullptr)) {
+                    failed = true;
+                }
+            }
+        });
+        m_pos = scanEnd;
+        return !failed;
+    }
+
+    return DecodeUnits(m_pos, m_size, 0, totalUnits, scale, &m_pos);
+}
+
+bool JpegDecoder::ConvertToPixels(int scale, PixelBuffer& image) const {
+    const int width = (m_width * scale + 7) / 8;
+    const int height = (m_height * scale + 7) / 8;
+    image.Resize(width, height);
+    std::atomic<bool> failed(false);
+    ParallelForThreads(0, height, CONVERT_MIN_ROWS, m_threadCount, [&](int first, int last) {
+        if (!ConvertRows(image, first, last)) {
+            failed = true;
+        }
+    });
+    return !failed;
+}
+
+bool JpegDecoder::ConvertRows(PixelBuffer& image, int firstRow, int lastRow) const {
+    const int width = image.Width();
+
+    if (m_components.size() == 1) {
+        const Component& gray = m_components[0];
+        for (int y = firstRow; y < lastRow; y++) {
+            const uint8_t* src = gray.plane.data() + static_cast<size_t>(y) * gray.planeWidth;
+            uint32_t* dst = image.Row(y);
+            int x = 0;
+#ifdef PIXELFORGE_SSE2
+            const __m128i opaque = _mm_set1_epi8(static_cast<char>(0xFF));
+            for (; x + 16 <= width; x += 16) {
+                __m128i luma = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x));
+                __m128i pairs = _mm_unpacklo_epi8(luma, luma);
+                __m128i alpha = _mm_unpacklo_epi8(luma, opaque);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm_unpacklo_epi16(pairs, alpha));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x + 4), _mm_unpackhi_epi16(pairs, alpha));
+                pairs = _mm_unpackhi_epi8(luma, luma);
+                alpha = _mm_unpackhi_epi8(luma, opaque);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x + 8), _mm_unpacklo_epi16(pairs, alpha));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x + 12), _mm_unpackhi_epi16(pairs, alpha));
+            }
+#endif
+            for (; x < width; x++) {
+                dst[x] = MakeColor(src[x], src[x], src[x]);
+            }
+        }
+        return true;
+    }
+
+    // Chroma planes are upsampled by replication
+    const Component& cy = m_components[0];
+    const Component& cb = m_components[1];
+    const Component& cr = m_components[2];
+    ArenaScope scope;
+    uint8_t* scratch = scope.Arena().AllocateArray<uint8_t>(static_cast<size_t>(width) * 3);
+    if (!scratch) {
+        return false;
+    }
+    for (int y = firstRow; y < lastRow; y++) {
+        const uint8_t* rowY = UpsampleRow(cy.plane.data() + static_cast<size_t>(y * cy.v / m_maxV) * cy.planeWidth,
+                                          cy.h, m_maxH, width, scratch);
+        const uint8_t* rowCb = UpsampleRow(cb.plane.data() + static_cast<size_t>(y * cb.v / m_maxV) * cb.planeWidth,
+                                           cb.h, m_maxH, width, scratch + width);
+        const uint8_t* rowCr = UpsampleRow(cr.plane.data() + static_cast<size_t>(y * cr.v / m_maxV) * cr.planeWidth,
+                                           cr.h, m_maxH, width, scratch + width * 2);
+        uint32_t* dst = image.Row(y);
+        int x = 0;
+#ifdef PIXELFORGE_SSE2
+        for (; x + 8 <= width; x += 8) {
+            ConvertEight(rowY + x, rowCb + x, rowCr + x, dst + x);
+        }
+#endif
+        for (; x < width; x++) {
+            dst[x] = YCbCrToColor(rowY[x], rowCb[x] - 128, rowCr[x] - 128);
+        }
+    }
+    return true;
+}
+
+bool JpegDecoder::Decode(int scaleDenominator, PixelBuffer& image) {
+    if (scaleDenominator != 1 && scaleDenominator != 2 && scaleDenominator != 4 && scaleDenominator != 8) {
+        return false;
+    }
+    if (!ReadHeader()) {
+        return false;
+    }
+
+    const int scale = 8 / scaleDenominator;
+    for (auto& component : m_components) {
+        component.planeWidth = m_mcusWide * component.h * scale;
+        component.planeHeight = m_mcusHigh * component.v * scale;
+        component.plane.assign(static_cast<size_t>(component.planeWidth) * component.planeHeight, 128);
+    }
+
+    // Baseline files may split components over several scans
+    while (!m_scanComponents.empty()) {
+        if (!DecodeScan(scale)) {
+            #ifdef DEBUG
+            printf("JpegDecoder: corrupt scan data\n");
+            #endif
+            return false;
+        }
+        if (!ReadMarkers(true)) {
+            return false;
+        }
+    }
+
+    if (!ConvertToPixels(scale, image)) {
+        #ifdef DEBUG
+        printf("JpegDecoder: out of scratch memory for colour conversion\n");
+        #endif
+        return false;
+    }
+    return true;
+}
+
+} // namespace PixelForge
\ No newline at end of file
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "pixel_buffer.h"
+
+namespace PixelForge {
+
+// Baseline (sequential Huffman, 8-bit) JPEG decoder for grayscale and YCbCr
+// files. Decoding can be scaled by 1/2, 1/4 or 1/8 in the DCT domain: only
+// the low-frequency corner of each block is kept and transformed with a
+// smaller IDCT, which is much cheaper than decoding in full and resizing.
+// When the file has restart markers, the segments between them are entropy
+// decoded in parallel; colour conversion is always split across threads.
+// Progressive, arithmetic-coded and CMYK files are rejected by ReadHeader,
+// as are frames over 32 megapixels.
+class JpegDecoder {
+public:
+    JpegDecoder(const uint8_t* data, size_t size);
+
+    // 0 uses one thread per core; callers that already decode several
+    // files at once should pass 1
+    void SetThreadCount(int count) { m_threadCount = count; }
+
+    // Parses the markers up to the first scan
+    bool ReadHeader();
+
+    int Width() const { return m_width; }
+    int Height() const { return m_height; }
+
+    // Decodes into image at ceil(Width / scaleDenominator) x
+    // ceil(Height / scaleDenominator); scaleDenominator is 1, 2, 4 or 8
+    bool Decode(int scaleDenominator, PixelBuffer& image);
+
+    // Largest scale denominator whose output still covers targetWidth x targetHeight
+    static int ScaleForTarget(int width, int height, int targetWidth, int targetHeight);
+
+    static bool HasSignature(const uint8_t* data, size_t size);
+
+private:
+    struct HuffmanTable {
+        bool present = false;
+        uint8_t fastLength[512];    // 9-bit lookup, 0 when the code is longer
+        uint8_t fastSymbol[512];
+        int32_t fastAc[512];        // AC code and value together: value << 8 | run << 4 | length
+        int maxCode[18];
+        int valueOffset[17];
+        uint8_t values[256];
+    };
+
+    struct Component {
+        int id;
+        int h, v;                   // Sampling factors
+        int quantTable;
+        int dcTable, acTable;
+        int blocksWide, blocksHigh; // Blocks covering the component's own size
+        int planeWidth;             // Scaled pixels; padded to whole MCUs
+        int planeHeight;
+        std::vector<uint8_t> plane;
+    };
+
+    struct BitReader;
+
+    bool ReadMarkers(bool stopAtScan);
+    bool ReadFrame(size_t pos, int length);
+    bool ReadHuffmanTables(size_t pos, int length);
+    bool ReadQuantTables(size_t pos, int length);
+    bool ReadScanHeader(size_t pos, int length);
+    bool DecodeScan(int scale);
+    bool FindRestartSegments(std::vector<size_t>& starts, size_t& scanEnd) const;
+    bool DecodeUnits(size_t start, size_t end, int firstUnit, int lastUnit, int scale, size_t* stoppedAt);
+    bool DecodeBlock(BitReader& bits, const Component& component, int& dcPrediction, int scale,
+                     float* coefficients, int& acRows) const;
+    void StoreBlock(Component& component, int blockX, int blockY, int scale, const float* coefficients, int acRows);
+    bool ConvertToPixels(int scale, PixelBuffer& image) const;
+    bool ConvertRows(PixelBuffer& image, int firstRow, int lastRow) const;
+    static bool BuildHuffmanTable(HuffmanTable& table, const uint8_t* counts, const uint8_t* symbols, int total);
+    static void BuildFastAc(HuffmanTable& table);
+
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_pos = 0;
+
+    int m_width = 0;
+    int m_height = 0;
+    int m_maxH = 1;
+    int m_maxV = 1;
+    int m_mcusWide = 0;
+    int m_mcusHigh = 0;
+    int m_restartInterval = 0;
+    bool m_headerRead = false;
+    int m_threadCount = 0;
+
+    std::vector<Component> m_components;
+    uint16_t m_quant[4][64];        // Zigzag order, as stored in the file
+    HuffmanTable m_dcTables[4];
+    HuffmanTable m_acTables[4];
+
+    std::vector<int> m_scanComponents;  // Indices into m_components
+};
+
+} // namespace PixelForge
\ No newline at end of file
@@ -0,0 +1,208 @@
+#include "lz4.h"
+#include <cstring>
+
+namespace PixelForge {
+
+namespace {
+
+const int MIN_MATCH = 4;
+const int LAST_LITERALS = 5;        // The block always ends with this many literals
+const int MATCH_FIND_LIMIT = 12;    // No match may start closer than this to the end
+const int MAX_OFFSET = 65535;
+const int HASH_BITS = 12;
+const int SKIP_SHIFT = 6;           // Probe step grows by one every 64 misses
+
+inline uint32_t Read32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint64_t Read64(const uint8_t* p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint32_t Hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+inline int TrailingZeroBytes(uint64_t value) {
+    int count = 0;
+    while ((value & 0xFF) == 0) {
+        value >>= 8;
+        count++;
+    }
+    return count;
+}
+
+inline uint8_t* WriteLength(uint8_t* op, size_t length) {
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = static_cast<uint8_t>(length);
+    return op;
+}
+
+inline bool ReadLength(const uint8_t*& ip, const uint8_t* end, size_t& length) {
+    uint8_t byte;
+    do {
+        if (ip >= end) {
+            return false;
+        }
+        byte = *ip++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+uint8_t* WriteSequence(uint8_t* op, const uint8_t* literals, size_t literalCount, size_t offset, size_t matchLength) {
+    uint8_t* token = op++;
+    size_t extra = matchLength - MIN_MATCH;
+    *token = static_cast<uint8_t>(((literalCount < 15 ? literalCount : 15) << 4) | (extra < 15 ? extra : 15));
+    if (literalCount >= 15) {
+        op = WriteLength(op, literalCount - 15);
+    }
+    std::memcpy(op, literals, literalCount);
+    op += literalCount;
+    *op++ = static_cast<uint8_t>(offset);
+    *op++ = static_cast<uint8_t>(offset >> 8);
+    if (extra >= 15) {
+        op = WriteLength(op, extra - 15);
+    }
+    return op;
+}
+
+} // namespace
+
+void Lz4Compress(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+    out.resize(Lz4CompressBound(size));
+    uint8_t* op = out.data();
+    const uint8_t* anchor = data;
+    const uint8_t* end = data + size;
+
+    if (size > MATCH_FIND_LIMIT) {
+        const uint8_t* matchLimit = end - LAST_LITERALS;
+        const uint8_t* findLimit = end - MATCH_FIND_LIMIT;
+        uint32_t table[1 << HASH_BITS];
+        std::memset(table, 0, sizeof(table));
+
+        const uint8_t* ip = data + 1;
+        int misses = 0;
+        while (ip < findLimit) {
+            uint32_t sequence = Read32(ip);
+            uint32_t h = Hash(sequence);
+            const uint8_t* ref = data + table[h];
+            table[h] = static_cast<uint32_t>(ip - data);
+            if (ref >= ip || ip - ref > MAX_OFFSET || Read32(ref) != sequence) {
+                ip += 1 + (misses++ >> SKIP_SHIFT);
+                continue;
+            }
+            misses = 0;
+
+            // Extend backwards into the pending literals, then forwards a
+            // word at a time
+            while (ip > anchor && ref > data && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+            const uint8_t* mp = ip + MIN_MATCH;
+            const uint8_t* rp = ref + MIN_MATCH;
+            bool mismatched = false;
+            while (mp + 8 <= matchLimit) {
+                uint64_t diff = Read64(mp) ^ Read64(rp);
+                if (diff != 0) {
+                    mp += TrailingZeroBytes(diff);
+                    mismatched = true;
+                    break;
+                }
+                mp += 8;
+                rp += 8;
+            }
+            while (!mismatched && mp < matchLimit && *mp == *rp) {
+                mp++;
+                rp++;
+            }
+
+            op = WriteSequence(op, anchor, ip - anchor, ip - ref, mp - ip);
+            ip = mp;
+            anchor = ip;
+            if (ip < findLimit) {
+                table[Hash(Read32(ip - 2))] = static_cast<uint32_t>(ip - 2 - data);
+            }
+        }
+    }
+
+    // Final literal-only sequence
+    size_t literalCount = end - anchor;
+    *op++ = static_cast<uint8_t>((literalCount < 15 ? literalCount : 15) << 4);
+    if (literalCount >= 15) {
+        op = WriteLength(op, literalCount - 15);
+    }
+    if (literalCount > 0) {
+        std::memcpy(op, anchor, literalCount);
+        op += literalCount;
+    }
+    out.resize(op - out.data());
+}
+
+bool Lz4Decompress(const uint8_t* data, size_t size, uint8_t* out, size_t outSize) {
+    const uint8_t* ip = data;
+    const uint8_t* end = data + size;
+    uint8_t* op = out;
+    uint8_t* outEnd = out + outSize;
+
+    while (ip < end) {
+        uint8_t token = *ip++;
+        size_t literalCount = token >> 4;
+        if (literalCount == 15 && !ReadLength(ip, end, literalCount)) {
+            return false;
+        }
+        if (literalCount > static_cast<size_t>(end - ip) || literalCount > static_cast<size_t>(outEnd - op)) {
+            return false;
+        }
+        std::memcpy(op, ip, literalCount);
+        ip += literalCount;
+        op += literalCount;
+        if (ip == end) {
+            break;
+        }
+
+        if (end - ip < 2) {
+            return false;
+        }
+        size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        size_t length = token & 15;
+        if (length == 15 && !ReadLength(ip, end, length)) {
+            return false;
+        }
+        length += MIN_MATCH;
+        if (offset == 0 || offset > static_cast<size_t>(op - out) || length > static_cast<size_t>(outEnd - op)) {
+            return false;
+        }
+
+        // Overlapping copies repeat the last offset bytes, so only copy
+        // whole words when they cannot overlap
+        const uint8_t* match = op - offset;
+        if (offset >= 8) {
+            size_t i = 0;
+            for (; i + 8 <= length; i += 8) {
+                std::memcpy(op + i, match + i, 8);
+            }
+            for (; i < length; i++) {
+                op[i] = match[i];
+            }
+        } else {
+            for (size_t i = 0; i < length; i++) {
+                op[i] = match[i];
+            }
+        }
+        op += length;
+    }
+    return op == outEnd;
+}
+
+} // namespace PixelForge
\ No newline at end of file
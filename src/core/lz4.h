@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace PixelForge {
+
+// Largest possible Lz4Compress output for size input bytes
+inline size_t Lz4CompressBound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+// Compresses into the LZ4 block format (no frame header or checksum),
+// replacing the contents of out. Greedy single-probe matching: fast, and it
+// skips ahead quickly through data that does not compress.
+void Lz4Compress(const uint8_t* data, size_t size, std::vector<uint8_t>& out);
+
+// Decompresses an LZ4 block that must expand to exactly outSize bytes.
+// Every length and offset is checked, so damaged input fails cleanly.
+bool Lz4Decompress(const uint8_t* data, size_t size, uint8_t* out, size_t outSize);
+
+} // namespace PixelForge
\ No newline at end of file
@@ -0,0 +1,589 @@
+#include "palette_quantizer.h"
+#include "frame_arena.h"
+#include "parallel.h"
+#include "simd.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#ifdef DEBUG
+#include <chrono>
+#include <stdio.h>
+#endif
+
+namespace PixelForge {
+
+namespace {
+
+const int HISTOGRAM_BITS = 5;
+const int HISTOGRAM_SIZE = 1 << (3 * HISTOGRAM_BITS);
+const int CACHE_BITS = 6;
+const int CACHE_SIZE = 1 << (3 * CACHE_BITS);
+const uint16_t CACHE_EMPTY = 0xFFFF;
+const int ALPHA_THRESHOLD = 128;
+const int ROWS_PER_TASK = 32;
+const int BINS_PER_TASK = 1024;
+const int CELLS_PER_TASK = 4096;
+const float MIN_CENTER_MOVE = 0.5f;         // k-means stops once no centre moves further
+
+// Ordered dither thresholds, 0-63
+const uint8_t BAYER_8X8[8][8] = {
+    {  0, 32,  8, 40,  2, 34, 10, 42 },
+    { 48, 16, 56, 24, 50, 18, 58, 26 },
+    { 12, 44,  4, 36, 14, 46,  6, 38 },
+    { 60, 28, 52, 20, 62, 30, 54, 22 },
+    {  3, 35, 11, 43,  1, 33,  9, 41 },
+    { 51, 19, 59, 27, 49, 17, 57, 25 },
+    { 15, 47,  7, 39, 13, 45,  5, 37 },
+    { 63, 31, 55, 23, 61, 29, 53, 21 }
+};
+
+struct HistogramBin {
+    uint32_t count;
+    uint64_t r, g, b;
+};
+
+// A histogram bin's mean colour, weighted by how many samples fell in it
+struct ColorPoint {
+    float r, g, b;
+    float weight;
+};
+
+struct Center {
+    float r, g, b;
+};
+
+struct Box {
+    int begin;
+    int end;
+    int axis;                       // Channel with the widest spread
+    double error;                   // Weighted squared distance from the mean
+};
+
+inline int Clamp255(int value) {
+    return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+inline float Channel(const ColorPoint& point, int axis) {
+    return axis == 0 ? point.r : (axis == 1 ? point.g : point.b);
+}
+
+inline float Distance(const Center& c, float r, float g, float b) {
+    float dr = c.r - r;
+    float dg = c.g - g;
+    float db = c.b - b;
+    return dr * dr + dg * dg + db * db;
+}
+
+int NearestCenter(const std::vector<Center>& centers, float r, float g, float b) {
+    int best = 0;
+    float bestDistance = Distance(centers[0], r, g, b);
+    for (int i = 1; i < static_cast<int>(centers.size()); i++) {
+        float distance = Distance(centers[i], r, g, b);
+        if (distance < bestDistance) {
+            bestDistance = distance;
+            best = i;
+        }
+    }
+    return best;
+}
+
+// Samples a grid of pixels into a 15-bit histogram, one partial histogram
+// per task, and checks every pixel for transparency on the way
+void BuildHistogram(const PixelBuffer& image, int sampleCount, std::vector<HistogramBin>& histogram, bool& transparent) {
+    const double pixels = static_cast<double>(image.Width()) * image.Height();
+    const int step = (std::max)(1, static_cast<int>(std::sqrt(pixels / (std::max)(sampleCount, 1))));
+    const int shift = 8 - HISTOGRAM_BITS;
+
+    histogram.assign(HISTOGRAM_SIZE, HistogramBin());
+    std::atomic<bool> anyTransparent(false);
+    std::mutex mutex;
+    ParallelFor(0, image.Height(), ROWS_PER_TASK, [&](int firstRow, int lastRow) {
+        std::vector<HistogramBin> local(HISTOGRAM_SIZE, HistogramBin());
+        bool foundTransparent = false;
+        for (int y = firstRow; y < lastRow; y++) {
+            const uint32_t* row = image.Row(y);
+            if (!foundTransparent) {
+                for (int x = 0; x < image.Width(); x++) {
+                    if ((row[x] >> 24) < ALPHA_THRESHOLD) {
+                        foundTransparent = true;
+                        break;
+                    }
+                }
+            }
+            if (y % step != 0) {
+                continue;
+            }
+            for (int x = 0; x < image.Width(); x += step) {
+                uint32_t p = row[x];
+                if ((p >> 24) < ALPHA_THRESHOLD) {
+                    continue;
+                }
+                int r = (p >> 16) & 0xFF;
+                int g = (p >> 8) & 0xFF;
+                int b = p & 0xFF;
+                HistogramBin& bin = local[((r >> shift) << (2 * HISTOGRAM_BITS)) | ((g >> shift) << HISTOGRAM_BITS) | (b >> shift)];
+                bin.count++;
+                bin.r += r;
+                bin.g += g;
+                bin.b += b;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int i = 0; i < HISTOGRAM_SIZE; i++) {
+            histogram[i].count += local[i].count;
+            histogram[i].r += local[i].r;
+            histogram[i].g += local[i].g;
+            histogram[i].b += local[i].b;
+        }
+        if (foundTransparent) {
+            anyTransparent = true;
+        }
+    });
+    transparent = anyTransparent;
+}
+
+void MeasureBox(const std::vector<ColorPoint>& points, Box& box) {
+    double weight = 0.0;
+    double sum[3] = {};
+    double squares[3] = {};
+    for (int i = box.begin; i < box.end; i++) {
+        const ColorPoint& point = points[i];
+        for (int axis = 0; axis < 3; axis++) {
+            double value = Channel(point, axis);
+            sum[axis] += point.weight * value;
+            squares[axis] += point.weight * value * value;
+        }
+        weight += point.weight;
+    }
+
+    box.axis = 0;
+    box.error = 0.0;
+    double widest = -1.0;
+    for (int axis = 0; axis < 3; axis++) {
+        double spread = weight > 0.0 ? squares[axis] - sum[axis] * sum[axis] / weight : 0.0;
+        box.error += spread;
+        if (spread > widest) {
+            widest = spread;
+            box.axis = axis;
+        }
+    }
+    if (box.end - box.begin < 2) {
+        box.error = 0.0;
+    }
+}
+
+// Splits the box with the largest error at its weighted median until there
+// are count boxes, then returns their means
+std::vector<Center> MedianCut(std::vector<ColorPoint>& points, int count) {
+    std::vector<Box> boxes;
+    Box all = { 0, static_cast<int>(points.size()), 0, 0.0 };
+    MeasureBox(points, all);
+    boxes.push_back(all);
+
+    while (static_cast<int>(boxes.size()) < count) {
+        auto widest = std::max_element(boxes.begin(), boxes.end(),
+                                       [](const Box& a, const Box& b) { return a.error < b.error; });
+        if (widest->error <= 0.0) {
+            break;
+        }
+        Box box = *widest;
+        const int axis = box.axis;
+        std::sort(points.begin() + box.begin, points.begin() + box.end, [axis](const ColorPoint& a, const ColorPoint& b) {
+            return Channel(a, axis) < Channel(b, axis);
+        });
+
+        double total = 0.0;
+        for (int i = box.begin; i < box.end; i++) {
+            total += points[i].weight;
+        }
+        double running = 0.0;
+        int split = box.begin + 1;
+        for (int i = box.begin; i < box.end - 1; i++) {
+            running += points[i].weight;
+            split = i + 1;
+            if (running >= total / 2) {
+                break;
+            }
+        }
+
+        Box low = { box.begin, split, 0, 0.0 };
+        Box high = { split, box.end, 0, 0.0 };
+        MeasureBox(points, low);
+        MeasureBox(points, high);
+        *widest = low;
+        boxes.push_back(high);
+    }
+
+    std::vector<Center> centers;
+    centers.reserve(boxes.size());
+    for (const Box& box : boxes) {
+        double weight = 0.0, r = 0.0, g = 0.0, b = 0.0;
+        for (int i = box.begin; i < box.end; i++) {
+            weight += points[i].weight;
+            r += points[i].weight * points[i].r;
+            g += points[i].weight * points[i].g;
+            b += points[i].weight * points[i].b;
+        }
+        if (weight > 0.0) {
+            centers.push_back({ static_cast<float>(r / weight), static_cast<float>(g / weight), static_cast<float>(b / weight) });
+        }
+    }
+    return centers;
+}
+
+// Moves each centre to the mean of the points nearest it, assigning the
+// points in parallel
+void RefineCenters(const std::vector<ColorPoint>& points, std::vector<Center>& centers, int passes) {
+    const int count = static_cast<int>(centers.size());
+    for (int pass = 0; pass < passes; pass++) {
+        std::vector<double> sums(static_cast<size_t>(count) * 4, 0.0);
+        std::mutex mutex;
+        ParallelFor(0, static_cast<int>(points.size()), BINS_PER_TASK, [&](int begin, int end) {
+            std::vector<double> local(static_cast<size_t>(count) * 4, 0.0);
+            for (int i = begin; i < end; i++) {
+                const ColorPoint& point = points[i];
+                double* sum = &local[static_cast<size_t>(NearestCenter(centers, point.r, point.g, point.b)) * 4];
+                sum[0] += point.weight * point.r;
+                sum[1] += point.weight * point.g;
+                sum[2] += point.weight * point.b;
+                sum[3] += point.weight;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            for (size_t i = 0; i < sums.size(); i++) {
+                sums[i] += local[i];
+            }
+        });
+
+        // A centre nothing maps to keeps its place
+        float moved = 0.0f;
+        for (int i = 0; i < count; i++) {
+            const double* sum = &sums[static_cast<size_t>(i) * 4];
+            if (sum[3] <= 0.0) {
+                continue;
+            }
+            Center updated = { static_cast<float>(sum[0] / sum[3]), static_cast<float>(sum[1] / sum[3]),
+                               static_cast<float>(sum[2] / sum[3]) };
+            moved = (std::max)(moved, Distance(centers[i], updated.r, updated.g, updated.b));
+            centers[i] = updated;
+        }
+        if (moved < MIN_CENTER_MOVE * MIN_CENTER_MOVE) {
+            break;
+        }
+    }
+}
+
+// Nearest opaque palette entry for each 18-bit colour, searched the first
+// time a colour of that cell is seen. Threads may race to fill a cell, but
+// they all store the same answer.
+class NearestColorCache {
+public:
+    NearestColorCache(const std::vector<uint32_t>& palette, int count)
+        : m_count(count)
+        , m_cells(new std::atomic<uint16_t>[CACHE_SIZE]) {
+        for (int i = 0; i < count; i++) {
+            m_r[i] = (palette[i] >> 16) & 0xFF;
+            m_g[i] = (palette[i] >> 8) & 0xFF;
+            m_b[i] = palette[i] & 0xFF;
+        }
+        for (int i = 0; i < CACHE_SIZE; i++) {
+            m_cells[i].store(CACHE_EMPTY, std::memory_order_relaxed);
+        }
+    }
+
+    uint8_t Lookup(int r, int g, int b) {
+        const int shift = 8 - CACHE_BITS;
+        int key = ((r >> shift) << (2 * CACHE_BITS)) | ((g >> shift) << CACHE_BITS) | (b >> shift);
+        uint16_t index = m_cells[key].load(std::memory_order_relaxed);
+        if (index == CACHE_EMPTY) {
+            index = Search(key);
+            m_cells[key].store(index, std::memory_order_relaxed);
+        }
+        return static_cast<uint8_t>(index);
+    }
+
+    // Searches every cell up front, split across threads
+    void Fill() {
+        ParallelFor(0, CACHE_SIZE, CELLS_PER_TASK, [this](int begin, int end) {
+            for (int key = begin; key < end; key++) {
+                m_cells[key].store(Search(key), std::memory_order_relaxed);
+            }
+        });
+    }
+
+private:
+    // Searches from the middle of the cell
+    uint16_t Search(int key) const {
+        const int shift = 8 - CACHE_BITS;
+        const int half = 1 << (shift - 1);
+        const int mask = (1 << CACHE_BITS) - 1;
+        return static_cast<uint16_t>(Nearest((((key >> (2 * CACHE_BITS)) & mask) << shift) + half,
+                                             (((key >> CACHE_BITS) & mask) << shift) + half,
+                                             ((key & mask) << shift) + half));
+    }
+
+    int Nearest(int r, int g, int b) const {
+        int best = 0;
+        int bestDistance = INT32_MAX;
+        for (int i = 0; i < m_count; i++) {
+            int dr = m_r[i] - r;
+            int dg = m_g[i] - g;
+            int db = m_b[i] - b;
+            int distance = dr * dr + dg * dg + db * db;
+            if (distance < bestDistance) {
+                bestDistance = distance;
+                best = i;
+            }
+        }
+        return best;
+    }
+
+    int m_count;
+    int m_r[256];
+    int m_g[256];
+    int m_b[256];
+    std::unique_ptr<std::atomic<uint16_t>[]> m_cells;
+};
+
+inline uint8_t MapPixel(uint32_t p, NearestColorCache& cache, int transparentIndex) {
+    if (transparentIndex >= 0 && (p >> 24) < ALPHA_THRESHOLD) {
+        return static_cast<uint8_t>(transparentIndex);
+    }
+    return cache.Lookup((p >> 16) & 0xFF, (p >> 8) & 0xFF, p & 0xFF);
+}
+
+void MapPlain(const PixelBuffer& image, NearestColorCache& cache, int transparentIndex, IndexedImage& out) {
+    const int width = image.Width();
+    ParallelFor(0, image.Height(), ROWS_PER_TASK, [&](int firstRow, int lastRow) {
+        for (int y = firstRow; y < lastRow; y++) {
+            const uint32_t* src = image.Row(y);
+            uint8_t* dst = out.indices.data() + static_cast<size_t>(y) * width;
+            for (int x = 0; x < width; x++) {
+                dst[x] = MapPixel(src[x], cache, transparentIndex);
+            }
+        }
+    });
+}
+
+// Adds a Bayer threshold to each colour channel before the lookup. The
+// offsets span about one palette step, estimated from the colour count.
+void MapOrdered(const PixelBuffer& image, NearestColorCache& cache, int colors, int transparentIndex, IndexedImage& out) {
+    const int width = image.Width();
+    const int spread = static_cast<int>(256.0 / std::cbrt(static_cast<double>((std::max)(colors, 2))));
+    int offsets[8][8];
+    for (int y = 0; y < 8; y++) {
+        for (int x = 0; x < 8; x++) {
+            offsets[y][x] = ((2 * BAYER_8X8[y][x] + 1) - 64) * spread / 128;
+        }
+    }
+
+    ParallelFor(0, image.Height(), ROWS_PER_TASK, [&](int firstRow, int lastRow) {
+        ArenaScope scope;
+        uint32_t* dithered = scope.Arena().AllocateArray<uint32_t>(width);
+        for (int y = firstRow; y < lastRow; y++) {
+            const uint32_t* src = image.Row(y);
+            const int* rowOffsets = offsets[y & 7];
+            uint8_t* dst = out.indices.data() + static_cast<size_t>(y) * width;
+            if (!dithered) {
+                for (int x = 0; x < width; x++) {
+                    dst[x] = MapPixel(src[x], cache, transparentIndex);
+                }
+                continue;
+            }
+
+            int x = 0;
+            #ifdef PIXELFORGE_SSE2
+            // Offsets for eight pixels as two vectors each of the parts
+            // to add and subtract, so saturating byte arithmetic clamps
+            // every channel; alpha is left alone
+            alignas(16) uint8_t up[32];
+            alignas(16) uint8_t down[32];
+            for (int i = 0; i < 8; i++) {
+                int offset = rowOffsets[i];
+                for (int c = 0; c < 3; c++) {
+                    up[i * 4 + c] = static_cast<uint8_t>((std::max)(offset, 0));
+                    down[i * 4 + c] = static_cast<uint8_t>((std::max)(-offset, 0));
+                }
+                up[i * 4 + 3] = 0;
+                down[i * 4 + 3] = 0;
+            }
+            const __m128i add[2] = { _mm_load_si128(reinterpret_cast<const __m128i*>(up)),
+                                     _mm_load_si128(reinterpret_cast<const __m128i*>(up + 16)) };
+            const __m128i subtract[2] = { _mm_load_si128(reinterpret_cast<const __m128i*>(down)),
+                                          _mm_load_si128(reinterpret_cast<const __m128i*>(down + 16)) };
+            for (; x + 4 <= width; x += 4) {
+                const int half = (x >> 2) & 1;
+                __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x));
+                pixels = _mm_subs_epu8(_mm_adds_epu8(pixels, add[half]), subtract[half]);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dithered + x), pixels);
+            }
+            #endif
+            for (; x < width; x++) {
+                uint32_t p = src[x];
+                int offset = rowOffsets[x & 7];
+                dithered[x] = (p & 0xFF000000) |
+                              (static_cast<uint32_t>(Clamp255(static_cast<int>((p >> 16) & 0xFF) + offset)) << 16) |
+                              (static_cast<uint32_t>(Clamp255(static_cast<int>((p >> 8) & 0xFF) + offset)) << 8) |
+                              static_cast<uint32_t>(Clamp255(static_cast<int>(p & 0xFF) + offset));
+            }
+
+            for (x = 0; x < width; x++) {
+                dst[x] = MapPixel(dithered[x], cache, transparentIndex);
+            }
+        }
+    });
+}
+
+// Floyd-Steinberg with the scan direction alternating per row. Each row
+// needs every error from the row above, so the diffusion itself runs on
+// one thread. The colours it looks up include the diffused error, so they
+// cannot be known ahead; for images with more pixels than cache cells the
+// whole cache is searched up front in parallel instead, and the diffusion
+// never has to search.
+bool MapFloydSteinberg(const PixelBuffer& image, NearestColorCache& cache, const std::vector<uint32_t>& palette,
+                       int transparentIndex, const std::atomic<bool>* cancel, IndexedImage& out) {
+    const int width = image.Width();
+    const int height = image.Height();
+    const int stride = (width + 2) * 3;     // One pixel of padding at either end
+
+    ArenaScope scope;
+    int* current = scope.Arena().AllocateArray<int>(static_cast<size_t>(stride) * 2);
+    if (!current) {
+        return false;
+    }
+    int* next = current + stride;
+    std::fill(current, current + stride, 0);
+
+    if (static_cast<int64_t>(width) * height >= CACHE_SIZE) {
+        cache.Fill();
+    }
+
+    bool cancelled = false;
+    for (int y = 0; y < height; y++) {
+        if (cancel && *cancel) {
+            cancelled = true;
+            break;
+        }
+        const uint32_t* src = image.Row(y);
+        uint8_t* dst = out.indices.data() + static_cast<size_t>(y) * width;
+        const int step = (y & 1) ? -1 : 1;
+        const int ahead = step * 3;
+        std::fill(next, next + stride, 0);
+
+        for (int i = 0, x = step > 0 ? 0 : width - 1; i < width; i++, x += step) {
+            uint32_t p = src[x];
+            if (transparentIndex >= 0 && (p >> 24) < ALPHA_THRESHOLD) {
+                dst[x] = static_cast<uint8_t>(transparentIndex);
+                continue;
+            }
+
+            // Errors are kept in sixteenths
+            int* error = current + (x + 1) * 3;
+            int r = Clamp255(static_cast<int>((p >> 16) & 0xFF) + ((error[0] + 8) >> 4));
+            int g = Clamp255(static_cast<int>((p >> 8) & 0xFF) + ((error[1] + 8) >> 4));
+            int b = Clamp255(static_cast<int>(p & 0xFF) + ((error[2] + 8) >> 4));
+            uint8_t index = cache.Lookup(r, g, b);
+            dst[x] = index;
+
+            uint32_t chosen = palette[index];
+            const int diff[3] = { r - static_cast<int>((chosen >> 16) & 0xFF), g - static_cast<int>((chosen >> 8) & 0xFF),
+                                  b - static_cast<int>(chosen & 0xFF) };
+            int* below = next + (x + 1) * 3;
+            for (int c = 0; c < 3; c++) {
+                error[ahead + c] += diff[c] * 7;
+                below[c - ahead] += diff[c] * 3;
+                below[c] += diff[c] * 5;
+                below[c + ahead] += diff[c];
+            }
+        }
+        std::swap(current, next);
+    }
+
+    return !cancelled;
+}
+
+} // namespace
+
+bool QuantizeImage(const PixelBuffer& image, const QuantizeOptions& options, IndexedImage& out) {
+    if (image.IsEmpty()) {
+        return false;
+    }
+    #ifdef DEBUG
+    auto start = std::chrono::steady_clock::now();
+    #endif
+
+    auto cancelled = [&options]() { return options.cancel && *options.cancel; };
+    std::vector<HistogramBin> histogram;
+    bool transparent = false;
+    BuildHistogram(image, options.sampleCount, histogram, transparent);
+    if (cancelled()) {
+        return false;
+    }
+
+    std::vector<ColorPoint> points;
+    for (const HistogramBin& bin : histogram) {
+        if (bin.count > 0) {
+            float weight = static_cast<float>(bin.count);
+            points.push_back({ bin.r / weight, bin.g / weight, bin.b / weight, weight });
+        }
+    }
+    histogram.clear();
+    histogram.shrink_to_fit();
+
+    // The transparent entry goes last and takes one of the colours
+    const int maxColors = (std::min)((std::max)(options.maxColors, 2), 256);
+    const int opaqueColors = transparent ? maxColors - 1 : maxColors;
+    std::vector<Center> centers;
+    if (!points.empty()) {
+        centers = MedianCut(points, opaqueColors);
+        RefineCenters(points, centers, options.refinePasses);
+    }
+    if (centers.empty()) {
+        centers.push_back({ 0.0f, 0.0f, 0.0f });
+    }
+    if (cancelled()) {
+        return false;
+    }
+
+    out.width = image.Width();
+    out.height = image.Height();
+    out.palette.clear();
+    for (const Center& center : centers) {
+        out.palette.push_back(MakeColor(static_cast<uint8_t>(Clamp255(static_cast<int>(center.r + 0.5f))),
+                                        static_cast<uint8_t>(Clamp255(static_cast<int>(center.g + 0.5f))),
+                                        static_cast<uint8_t>(Clamp255(static_cast<int>(center.b + 0.5f)))));
+    }
+    const int opaqueCount = static_cast<int>(out.palette.size());
+    out.transparentIndex = -1;
+    if (transparent) {
+        out.transparentIndex = opaqueCount;
+        out.palette.push_back(0);
+    }
+    out.indices.resize(static_cast<size_t>(out.width) * out.height);
+
+    NearestColorCache cache(out.palette, opaqueCount);
+    bool ok = true;
+    switch (options.dither) {
+        case DitherMode::None:
+            MapPlain(image, cache, out.transparentIndex, out);
+            break;
+        case DitherMode::Ordered:
+            MapOrdered(image, cache, opaqueCount, out.transparentIndex, out);
+            break;
+        case DitherMode::FloydSteinberg:
+            ok = MapFloydSteinberg(image, cache, out.palette, out.transparentIndex, options.cancel, out);
+            break;
+    }
+    ok = ok && !cancelled();
+
+    #ifdef DEBUG
+    double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    printf("QuantizeImage: %dx%d to %d colours from %d histogram bins in %.1f ms\n",
+           out.width, out.height, static_cast<int>(out.palette.size()), static_cast<int>(points.size()), elapsed);
+    #endif
+    return ok;
+}
+
+} // namespace PixelForge
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "pixel_buffer.h"
+
+namespace PixelForge {
+
+enum class DitherMode {
+    None,
+    Ordered,            // 8x8 Bayer thresholds; rows are independent
+    FloydSteinberg      // Serpentine error diffusion
+};
+
+struct QuantizeOptions {
+    int maxColors = 256;            // 2-256, including the transparent entry
+    DitherMode dither = DitherMode::FloydSteinberg;
+    int sampleCount = 1 << 20;      // Pixels looked at when choosing the palette
+    int refinePasses = 4;           // k-means passes after the median cut
+    const std::atomic<bool>* cancel = nullptr;  // Makes QuantizeImage fail early once set
+};
+
+struct IndexedImage {
+    int width = 0;
+    int height = 0;
+    std::vector<uint32_t> palette;  // 0xAARRGGBB; opaque except the transparent entry
+    std::vector<uint8_t> indices;   // width * height, top row first
+    int transparentIndex = -1;      // Entry for pixels under half alpha, or -1
+};
+
+// Reduces image to at most maxColors colours. The palette comes from a
+// median cut of a sampled colour histogram refined by k-means; pixels are
+// then mapped through a cache of nearest palette entries, optionally
+// dithered. Pixels under half alpha share one transparent entry.
+bool QuantizeImage(const PixelBuffer& image, const QuantizeOptions& options, IndexedImage& out);
+
+} // namespace PixelForge
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "parallel.h"
+
+namespace PixelForge {
+
+WorkerPool& WorkerPool::Shared() {
+    // Never destroyed, so threads still splitting work during shutdown
+    // have a pool to use
+    static WorkerPool* pool = new WorkerPool(WorkerCount() - 1);
+    return *pool;
+}
+
+WorkerPool::WorkerPool(int threadCount) {
+    for (int i = 0; i < threadCount; i++) {
+        m_threads.emplace_back(&WorkerPool::WorkerLoop, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopRequested = true;
+    }
+    m_workAvailable.notify_all();
+    for (auto& thread : m_threads) {
+        thread.join();
+    }
+}
+
+void WorkerPool::RunTasks(Job& job) {
+    for (int index = job.next++; index < job.count; index = job.next++) {
+        try {
+            (*job.task)(index);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!job.error) {
+                job.error = std::current_exception();
+            }
+        }
+    }
+}
+
+void WorkerPool::Run(int count, const std::function<void(int)>& task) {
+    Job job;
+    job.task = &task;
+    job.count = count;
+    if (!m_threads.empty() && count > 1) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_jobs.push_back(&job);
+        }
+        m_workAvailable.notify_all();
+    }
+
+    RunTasks(job);
+
+    // Every chunk is claimed; wait for the workers still running theirs
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto queued = std::find(m_jobs.begin(), m_jobs.end(), &job);
+    if (queued != m_jobs.end()) {
+        m_jobs.erase(queued);
+    }
+    m_jobReleased.wait(lock, [&job]() { return job.users == 0; });
+    if (job.error) {
+        std::rethrow_exception(job.error);
+    }
+}
+
+void WorkerPool::WorkerLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_workAvailable.wait(lock, [this]() { return m_stopRequested || !m_jobs.empty(); });
+        if (m_stopRequested) {
+            return;
+        }
+        Job* job = m_jobs.front();
+        job->users++;
+        lock.unlock();
+        RunTasks(*job);
+        lock.lock();
+
+        // Nothing is left to claim, so stop offering the job
+        auto queued = std::find(m_jobs.begin(), m_jobs.end(), job);
+        if (queued != m_jobs.end()) {
+            m_jobs.erase(queued);
+        }
+        if (--job->users == 0) {
+            m_jobReleased.notify_all();
+        }
+    }
+}
+
+} // namespace PixelForge
\ No newline at end of file
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace PixelForge {
+
+inline int WorkerCount() {
+    unsigned int count = std::thread::hardware_concurrency();
+    return count == 0 ? 1 : static_cast<int>(count);
+}
+
+// Threads that outlive a single ParallelFor, so splitting work does not
+// start and join a thread per chunk. A caller takes part in its own job
+// and picks up any chunks no worker has claimed yet, so nested calls and
+// several callers at once cannot deadlock; they only get less help.
+class WorkerPool {
+public:
+    // WorkerCount() - 1 threads; the caller is the last worker
+    static WorkerPool& Shared();
+
+    explicit WorkerPool(int threadCount);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Calls task(0) .. task(count - 1) across the pool and returns when all
+    // have finished. The first exception a task throws is rethrown here.
+    void Run(int count, const std::function<void(int)>& task);
+
+    int ThreadCount() const { return static_cast<int>(m_threads.size()); }
+
+private:
+    struct Job {
+        const std::function<void(int)>* task;
+        int count;
+        std::atomic<int> next{ 0 };
+        int users = 0;              // Workers inside RunTasks; guarded by m_mutex
+        std::exception_ptr error;   // Guarded by m_mutex
+    };
+
+    void WorkerLoop();
+    void RunTasks(Job& job);
+
+    std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_jobReleased;
+    std::deque<Job*> m_jobs;
+    std::vector<std::thread> m_threads;
+    bool m_stopRequested = false;
+};
+
+// Splits [begin, end) into contiguous chunks and calls fn(chunkBegin, chunkEnd)
+// on each, spread over the shared worker pool. Runs inline when the range is
+// too small to split.
+template <typename Fn>
+void ParallelFor(int begin, int end, int minChunk, Fn&& fn) {
+    int count = end - begin;
+    if (count <= 0) {
+        return;
+    }
+    int chunks = std::min(WorkerCount(), (count + minChunk - 1) / std::max(minChunk, 1));
+    if (chunks <= 1) {
+        fn(begin, end);
+        return;
+    }
+
+    int step = (count + chunks - 1) / chunks;
+    chunks = (count + step - 1) / step;
+    WorkerPool::Shared().Run(chunks, [&fn, begin, end, step](int chunk) {
+        int start = begin + chunk * step;
+        fn(start, std::min(start + step, end));
+    });
+}
+
+} // namespace PixelForge
\ No newline at end of file
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <new>
+#include "buffer_pool.h"
+#include "geometry.h"
+
+namespace PixelForge {
+
+// 32-bit pixels stored as 0xAARRGGBB (B, G, R, A in memory), the same layout
+// as a 32bpp DIB section and GDI+ PixelFormat32bppARGB. Alpha is straight.
+// Storage comes from the shared BufferPool, 64-byte aligned, so buffers of
+// similar size are recycled between operations instead of hitting the heap.
+class PixelBuffer {
+public:
+    PixelBuffer() = default;
+    PixelBuffer(int width, int height, uint32_t color = 0) {
+        Resize(width, height, color);
+    }
+
+    PixelBuffer(const PixelBuffer& other) {
+        *this = other;
+    }
+
+    PixelBuffer(PixelBuffer&& other) noexcept
+        : m_width(other.m_width)
+        , m_height(other.m_height)
+        , m_storage(std::move(other.m_storage)) {
+        other.m_width = 0;
+        other.m_height = 0;
+    }
+
+    PixelBuffer& operator=(const PixelBuffer& other) {
+        if (this != &other) {
+            Allocate(other.m_width, other.m_height);
+            if (!IsEmpty()) {
+                std::memcpy(Data(), other.Data(), PixelCount() * sizeof(uint32_t));
+            }
+        }
+        return *this;
+    }
+
+    PixelBuffer& operator=(PixelBuffer&& other) noexcept {
+        if (this != &other) {
+            m_width = other.m_width;
+            m_height = other.m_height;
+            m_storage = std::move(other.m_storage);
+            other.m_width = 0;
+            other.m_height = 0;
+        }
+        return *this;
+    }
+
+    void Resize(int width, int height, uint32_t color = 0) {
+        Allocate(width, height);
+        Clear(color);
+    }
+
+    void Clear(uint32_t color) {
+        std::fill(Data(), Data() + PixelCount(), color);
+    }
+
+    int Width() const { return m_width; }
+    int Height() const { return m_height; }
+    bool IsEmpty() const { return m_storage.IsEmpty(); }
+    IntRect Bounds() const { return { 0, 0, m_width, m_height }; }
+
+    // Row pitch in pixels
+    int Stride() const { return m_width; }
+
+    uint32_t* Data() { return reinterpret_cast<uint32_t*>(m_storage.Data()); }
+    const uint32_t* Data() const { return reinterpret_cast<const uint32_t*>(m_storage.Data()); }
+
+    uint32_t* Row(int y) { return Data() + static_cast<size_t>(y) * m_width; }
+    const uint32_t* Row(int y) const { return Data() + static_cast<size_t>(y) * m_width; }
+
+    uint32_t GetPixel(int x, int y) const { return Row(y)[x]; }
+    void SetPixel(int x, int y, uint32_t color) { Row(y)[x] = color; }
+
+private:
+    size_t PixelCount() const { return static_cast<size_t>(m_width) * m_height; }
+
+    // Keeps the current storage when the new size falls in the same class.
+    // Throws std::bad_alloc, leaving the buffer empty, when the pool cannot
+    // supply the storage, as the std::vector it replaced did.
+    void Allocate(int width, int height) {
+        m_width = (std::max)(width, 0);
+        m_height = (std::max)(height, 0);
+        size_t bytes = PixelCount() * sizeof(uint32_t);
+        if (bytes == 0) {
+            m_storage.Reset();
+        } else if (BufferPool::RoundUp(bytes) != m_storage.Size()) {
+            m_storage.Reset();
+            m_storage = BufferPool::Shared().Acquire(bytes);
+        }
+        if (m_storage.IsEmpty()) {
+            m_width = 0;
+            m_height = 0;
+            if (bytes != 0) {
+                throw std::bad_alloc();
+            }
+        }
+    }
+
+    int m_width = 0;
+    int m_height = 0;
+    PooledBuffer m_storage;
+};
+
+inline uint32_t MakeColor(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255) {
+    return (static_cast<uint32_t>(a) << 24) | (static_cast<uint32_t>(r) << 16) |
+           (static_cast<uint32_t>(g) << 8) | b;
+}
+
+// Straight-alpha source-over of color at the given alpha (0-255). The alpha
+// byte of color itself is ignored: full alpha gives an opaque pixel, zero
+// leaves dst untouched.
+inline uint32_t BlendOver(uint32_t dst, uint32_t color, int alpha) {
+    if (alpha >= 255) {
+        return color | 0xFF000000;
+    }
+    if (alpha <= 0) {
+        return dst;
+    }
+    int dstAlpha = dst >> 24;
+    int inv = 255 - alpha;
+    if (dstAlpha == 255) {
+        uint32_t result = 0xFF000000;
+        for (int shift = 0; shift < 24; shift += 8) {
+            int d = (dst >> shift) & 0xFF;
+            int s = (color >> shift) & 0xFF;
+            result |= static_cast<uint32_t>((s * alpha + d * inv + 127) / 255) << shift;
+        }
+        return result;
+    }
+
+    // Straight alpha source-over onto a translucent destination
+    int dstWeight = (dstAlpha * inv + 127) / 255;
+    int outAlpha = alpha + dstWeight;
+    if (outAlpha == 0) {
+        return 0;
+    }
+    uint32_t result = static_cast<uint32_t>(outAlpha) << 24;
+    for (int shift = 0; shift < 24; shift += 8) {
+        int d = (dst >> shift) & 0xFF;
+        int s = (color >> shift) & 0xFF;
+        result |= static_cast<uint32_t>((s * alpha + d * dstWeight + outAlpha / 2) / outAlpha) << shift;
+    }
+    return result;
+}
+
+} // namespace PixelForge
\ No newline at end of file
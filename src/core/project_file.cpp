@@ -0,0 +1,557 @@
+#include "project_file.h"
+#include "lz4.h"
+#include "parallel.h"
+#include "../utils/file_utils.h"
+#include <algorithm>
+#include <cstring>
+#ifdef DEBUG
+#include <stdio.h>
+#endif
+
+namespace PixelForge {
+
+namespace {
+
+const uint32_t PROJECT_MAGIC = 0x4A504650;     // "PFPJ"
+const uint32_t PROJECT_VERSION = 1;
+const int ENCODE_BATCH = 64;                    // Chunks compressed together before appending
+const uint64_t MIN_REWRITE_BYTES = 4 * 1024 * 1024;
+
+enum ChunkKind : uint8_t {
+    CHUNK_LAYER = 1,
+    CHUNK_TILE = 2,
+    CHUNK_PREVIEW = 3
+};
+
+enum ChunkCodec : uint8_t {
+    CODEC_RAW = 0,
+    CODEC_LZ4 = 1,
+    CODEC_SOLID = 2     // One pixel value repeated
+};
+
+inline uint64_t ChunkKey(uint8_t kind, uint32_t owner, int x, int y) {
+    return (static_cast<uint64_t>(kind) << 56) | (static_cast<uint64_t>(owner & 0xFFFFFF) << 32) |
+           (static_cast<uint64_t>(y & 0xFFFF) << 16) | static_cast<uint64_t>(x & 0xFFFF);
+}
+
+uint32_t Checksum(const uint8_t* data, size_t size) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        h = (h ^ data[i]) * 16777619u;
+    }
+    return h;
+}
+
+// Stores whichever is smallest of a single colour, LZ4 and raw pixels
+void EncodePixels(const PixelBuffer& pixels, std::vector<uint8_t>& out, uint8_t& codec) {
+    const uint32_t* data = pixels.Data();
+    const size_t count = static_cast<size_t>(pixels.Width()) * pixels.Height();
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    if (std::all_of(data, data + count, [first = data[0]](uint32_t p) { return p == first; })) {
+        out.assign(bytes, bytes + 4);
+        codec = CODEC_SOLID;
+        return;
+    }
+    Lz4Compress(bytes, count * 4, out);
+    if (out.size() >= count * 4) {
+        out.assign(bytes, bytes + count * 4);
+        codec = CODEC_RAW;
+    } else {
+        codec = CODEC_LZ4;
+    }
+}
+
+// Layer chunk: id, opacity, visibility, then the name as UTF-16
+void EncodeLayer(const Layer& layer, std::vector<uint8_t>& out) {
+    uint32_t id = layer.Id();
+    uint16_t length = static_cast<uint16_t>((std::min)(layer.Name().size(), static_cast<size_t>(0xFFFF)));
+    out.resize(8 + length * 2);
+    std::memcpy(out.data(), &id, 4);
+    out[4] = layer.Opacity();
+    out[5] = layer.IsVisible() ? 1 : 0;
+    std::memcpy(out.data() + 6, &length, 2);
+    for (uint16_t i = 0; i < length; i++) {
+        uint16_t c = static_cast<uint16_t>(layer.Name()[i]);
+        std::memcpy(out.data() + 8 + i * 2, &c, 2);
+    }
+}
+
+bool DecodeLayer(const uint8_t* data, size_t size, std::wstring& name, uint8_t& opacity, bool& visible) {
+    if (size < 8) {
+        return false;
+    }
+    uint16_t length;
+    std::memcpy(&length, data + 6, 2);
+    if (size != 8 + static_cast<size_t>(length) * 2) {
+        return false;
+    }
+    opacity = data[4];
+    visible = data[5] != 0;
+    name.resize(length);
+    for (uint16_t i = 0; i < length; i++) {
+        uint16_t c;
+        std::memcpy(&c, data + 8 + i * 2, 2);
+        name[i] = static_cast<wchar_t>(c);
+    }
+    return true;
+}
+
+// Writes at end, growing the file by half again when it runs out
+bool Append(MappedFile& file, uint64_t& end, const void* data, size_t bytes) {
+    if (bytes == 0) {
+        return true;
+    }
+    if (end + bytes > file.Size()) {
+        uint64_t size = (std::max)(end + bytes, static_cast<uint64_t>(file.Size()) + file.Size() / 2);
+        if (!file.Resize(static_cast<size_t>(size))) {
+            return false;
+        }
+    }
+    std::memcpy(file.Data() + end, data, bytes);
+    end += bytes;
+    return true;
+}
+
+} // namespace
+
+struct ProjectFile::PendingChunk {
+    ChunkEntry entry = {};
+    const ChunkEntry* existing = nullptr;   // Unchanged chunk in the open file
+    const PixelBuffer* pixels = nullptr;    // Pixels still to encode
+    int layer = -1;                         // Layer tile, read when its batch is encoded
+    PixelBuffer extracted;                  // Preview chunks are copied out of their level
+    std::vector<uint8_t> data;              // Encoded chunk
+};
+
+ProjectFile::~ProjectFile() {
+    Close();
+}
+
+void ProjectFile::Close() {
+    m_file.Flush();
+    m_file.Close();
+    m_path.clear();
+    m_entries.clear();
+    m_index.clear();
+}
+
+bool ProjectFile::MapFile(const std::wstring& path) {
+    m_entries.clear();
+    m_index.clear();
+    if (!m_file.Open(path, 0)) {
+        return false;
+    }
+
+    const uint64_t fileSize = m_file.Size();
+    FileHeader header;
+    if (fileSize < sizeof(header)) {
+        m_file.Close();
+        return false;
+    }
+    std::memcpy(&header, m_file.Data(), sizeof(header));
+    const uint64_t tableBytes = static_cast<uint64_t>(header.chunkCount) * sizeof(ChunkEntry);
+    if (header.magic != PROJECT_MAGIC || header.version != PROJECT_VERSION ||
+        header.tileSize != static_cast<uint32_t>(Document::TILE_SIZE) || header.width == 0 || header.height == 0 ||
+        header.width > 0xFFFF * static_cast<uint32_t>(Document::TILE_SIZE) ||
+        header.height > 0xFFFF * static_cast<uint32_t>(Document::TILE_SIZE) ||
+        header.tableOffset < sizeof(header) || header.tableOffset > fileSize || tableBytes > fileSize - header.tableOffset ||
+        Checksum(m_file.Data() + header.tableOffset, static_cast<size_t>(tableBytes)) != header.tableChecksum) {
+        #ifdef DEBUG
+        printf("ProjectFile: %ls is not a valid project\n", path.c_str());
+        #endif
+        m_file.Close();
+        return false;
+    }
+
+    m_entries.resize(header.chunkCount);
+    if (header.chunkCount > 0) {
+        std::memcpy(m_entries.data(), m_file.Data() + header.tableOffset, static_cast<size_t>(tableBytes));
+    }
+    for (size_t i = 0; i < m_entries.size(); i++) {
+        const ChunkEntry& entry = m_entries[i];
+        if (entry.offset < sizeof(header) || entry.offset > fileSize || entry.storedBytes > fileSize - entry.offset) {
+            m_file.Close();
+            m_entries.clear();
+            m_index.clear();
+            return false;
+        }
+        m_index[ChunkKey(entry.kind, entry.owner, entry.x, entry.y)] = i;
+    }
+
+    m_width = static_cast<int>(header.width);
+    m_height = static_cast<int>(header.height);
+    return true;
+}
+
+const ProjectFile::ChunkEntry* ProjectFile::FindChunk(uint8_t kind, uint32_t owner, int x, int y) const {
+    auto it = m_index.find(ChunkKey(kind, owner, x, y));
+    return it == m_index.end() ? nullptr : &m_entries[it->second];
+}
+
+bool ProjectFile::DecodePixels(const ChunkEntry& entry, int width, int height, PixelBuffer& pixels) const {
+    const size_t rawBytes = static_cast<size_t>(width) * height * 4;
+    const uint8_t* data = m_file.Data() + entry.offset;
+    if (entry.rawBytes != rawBytes) {
+        return false;
+    }
+
+    switch (entry.codec) {
+        case CODEC_SOLID: {
+            uint32_t color;
+            if (entry.storedBytes != 4) {
+                return false;
+            }
+            std::memcpy(&color, data, 4);
+            pixels.Resize(width, height, color);
+            return true;
+        }
+        case CODEC_RAW:
+            if (entry.storedBytes != rawBytes) {
+                return false;
+            }
+            pixels.Resize(width, height);
+            std::memcpy(pixels.Data(), data, rawBytes);
+            return true;
+        case CODEC_LZ4:
+            pixels.Resize(width, height);
+            return Lz4Decompress(data, entry.storedBytes, reinterpret_cast<uint8_t*>(pixels.Data()), rawBytes);
+        default:
+            return false;
+    }
+}
+
+bool ProjectFile::Open(const std::wstring& path, std::unique_ptr<Document>& document) {
+    Close();
+    if (!MapFile(path)) {
+        return false;
+    }
+    m_path = path;
+
+    // Only the layer settings and the preview are read here; the table
+    // lists layers before their tiles
+    auto opened = std::make_unique<Document>(m_width, m_height);
+    int previewChunks = 0;
+    bool previewValid = true;
+    for (const ChunkEntry& entry : m_entries) {
+        const uint8_t* data = m_file.Data() + entry.offset;
+        if (entry.kind == CHUNK_LAYER) {
+            std::wstring name;
+            uint8_t opacity;
+            bool visible;
+            if (!DecodeLayer(data, entry.storedBytes, name, opacity, visible)) {
+                continue;
+            }
+            int index = opened->AddLayer(name, entry.owner);
+            opened->SetLayerOpacity(index, opacity);
+            opened->SetLayerVisible(index, visible);
+        } else if (entry.kind == CHUNK_TILE) {
+            int layer = opened->FindLayer(entry.owner);
+            if (layer >= 0 && entry.x < opened->TilesX() && entry.y < opened->TilesY()) {
+                opened->SetTileStored(layer, entry.x, entry.y);
+            }
+        } else if (entry.kind == CHUNK_PREVIEW) {
+            int level = static_cast<int>(entry.owner);
+            PixelBuffer pixels;
+            if (level >= opened->PreviewLevelCount() || entry.x >= opened->GetPreviewLevel(level).chunksX ||
+                entry.y >= opened->GetPreviewLevel(level).chunksY) {
+                previewValid = false;
+                continue;
+            }
+            IntRect rect = opened->PreviewChunkRect(level, entry.x, entry.y);
+            if (DecodePixels(entry, rect.Width(), rect.Height(), pixels) &&
+                opened->SetPreviewChunk(level, entry.x, entry.y, pixels)) {
+                previewChunks++;
+            } else {
+                previewValid = false;
+            }
+        }
+    }
+
+    // A missing or damaged preview is rebuilt from the tiles when needed
+    int expectedChunks = 0;
+    for (int level = 0; level < opened->PreviewLevelCount(); level++) {
+        expectedChunks += opened->GetPreviewLevel(level).chunksX * opened->GetPreviewLevel(level).chunksY;
+    }
+    if (previewValid && previewChunks == expectedChunks) {
+        opened->MarkPreviewCurrent();
+    } else {
+        opened->InvalidatePreview();
+    }
+
+    opened->SetTileSource(this);
+    opened->MarkSaved();
+    document = std::move(opened);
+
+    #ifdef DEBUG
+    printf("ProjectFile: opened %ls, %dx%d, %zu chunks\n", path.c_str(), m_width, m_height, m_entries.size());
+    #endif
+    return true;
+}
+
+bool ProjectFile::LoadTile(uint32_t layerId, int tx, int ty, PixelBuffer& tile) {
+    const ChunkEntry* entry = FindChunk(CHUNK_TILE, layerId, tx, ty);
+    if (!entry) {
+        return false;
+    }
+    int width = (std::min)(Document::TILE_SIZE, m_width - tx * Document::TILE_SIZE);
+    int height = (std::min)(Document::TILE_SIZE, m_height - ty * Document::TILE_SIZE);
+    return DecodePixels(*entry, width, height, tile);
+}
+
+bool ProjectFile::WriteFile(Document& document, MappedFile& target, bool inPlace, std::vector<ChunkEntry>& entries,
+                            const TaskControl* control) {
+    // Unchanged chunks can only come from this file if it is where the
+    // document's stored tiles live
+    const bool ownsDocument = m_file.IsOpen() && document.GetTileSource() == this &&
+                              m_width == document.Width() && m_height == document.Height();
+    document.UpdatePreview();
+
+    // Preview first, so opening reads the front of a fresh file
+    std::vector<PendingChunk> pending;
+    for (int level = 0; level < document.PreviewLevelCount(); level++) {
+        const PreviewLevel& preview = document.GetPreviewLevel(level);
+        for (int cy = 0; cy < preview.chunksY; cy++) {
+            for (int cx = 0; cx < preview.chunksX; cx++) {
+                PendingChunk chunk;
+                chunk.entry.kind = CHUNK_PREVIEW;
+                chunk.entry.owner = static_cast<uint32_t>(level);
+                chunk.entry.x = static_cast<uint16_t>(cx);
+                chunk.entry.y = static_cast<uint16_t>(cy);
+                if (ownsDocument && !preview.chunkModified[cy * preview.chunksX + cx]) {
+                    chunk.existing = FindChunk(CHUNK_PREVIEW, level, cx, cy);
+                }
+                if (!chunk.existing) {
+                    IntRect rect = document.PreviewChunkRect(level, cx, cy);
+                    chunk.extracted.Resize(rect.Width(), rect.Height());
+                    for (int y = 0; y < rect.Height(); y++) {
+                        std::memcpy(chunk.extracted.Row(y), preview.pixels.Row(rect.top + y) + rect.left,
+                                    static_cast<size_t>(rect.Width()) * 4);
+                    }
+                }
+                pending.push_back(std::move(chunk));
+            }
+        }
+    }
+
+    // Each layer's settings, then its non-empty tiles
+    for (int layer = 0; layer < document.LayerCount(); layer++) {
+        const Layer& info = document.GetLayer(layer);
+        PendingChunk header;
+        header.entry.kind = CHUNK_LAYER;
+        header.entry.owner = info.Id();
+        header.entry.codec = CODEC_RAW;
+        EncodeLayer(info, header.data);
+        header.entry.rawBytes = static_cast<uint32_t>(header.data.size());
+        const ChunkEntry* old = ownsDocument ? FindChunk(CHUNK_LAYER, info.Id(), 0, 0) : nullptr;
+        if (old && old->storedBytes == header.data.size() &&
+            std::memcmp(m_file.Data() + old->offset, header.data.data(), header.data.size()) == 0) {
+            header.existing = old;
+            header.data.clear();
+        }
+        pending.push_back(std::move(header));
+
+        for (int ty = 0; ty < document.TilesY(); ty++) {
+            for (int tx = 0; tx < document.TilesX(); tx++) {
+                const LayerTile& tile = info.Tile(ty * document.TilesX() + tx);
+                if (tile.state == TileState::Empty) {
+                    continue;
+                }
+                PendingChunk chunk;
+                chunk.entry.kind = CHUNK_TILE;
+                chunk.entry.owner = info.Id();
+                chunk.entry.x = static_cast<uint16_t>(tx);
+                chunk.entry.y = static_cast<uint16_t>(ty);
+                if (ownsDocument && !tile.modified) {
+                    chunk.existing = FindChunk(CHUNK_TILE, info.Id(), tx, ty);
+                }
+                if (!chunk.existing) {
+                    chunk.layer = layer;
+                }
+                pending.push_back(std::move(chunk));
+            }
+        }
+    }
+    for (PendingChunk& chunk : pending) {
+        if (!chunk.existing && !chunk.extracted.IsEmpty()) {
+            chunk.pixels = &chunk.extracted;
+        }
+    }
+
+    // Compress a batch in parallel, then append it in table order
+    uint64_t end = inPlace ? target.Size() : sizeof(FileHeader);
+    for (size_t start = 0; start < pending.size(); start += ENCODE_BATCH) {
+        size_t stop = (std::min)(start + ENCODE_BATCH, pending.size());
+        if (control) {
+            if (control->Cancelled()) {
+                return false;
+            }
+            control->Report(static_cast<int>(start * 100 / pending.size()));
+        }
+
+        // Layer tiles load a batch at a time, so a document with a memory
+        // budget only ever holds one batch for the save
+        for (size_t i = start; i < stop; i++) {
+            PendingChunk& chunk = pending[i];
+            // A tile that cannot be read fails the save rather than being
+            // dropped from the file; the old header stays current
+            if (chunk.layer >= 0 && !document.ReadTile(chunk.layer, chunk.entry.x, chunk.entry.y, chunk.pixels)) {
+                return false;
+            }
+        }
+        ParallelFor(static_cast<int>(start), static_cast<int>(stop), 1, [&pending](int first, int last) {
+            for (int i = first; i < last; i++) {
+                PendingChunk& chunk = pending[i];
+                if (chunk.pixels) {
+                    EncodePixels(*chunk.pixels, chunk.data, chunk.entry.codec);
+                    chunk.entry.rawBytes = static_cast<uint32_t>(chunk.pixels->Width()) * chunk.pixels->Height() * 4;
+                }
+            }
+        });
+
+        for (size_t i = start; i < stop; i++) {
+            PendingChunk& chunk = pending[i];
+            if (chunk.existing && inPlace) {
+                entries.push_back(*chunk.existing);
+                m_lastSave.chunksReused++;
+                continue;
+            }
+
+            const uint8_t* bytes = chunk.data.data();
+            size_t size = chunk.data.size();
+            if (chunk.existing) {
+                // Copied across as stored, without decoding
+                chunk.entry = *chunk.existing;
+                bytes = m_file.Data() + chunk.existing->offset;
+                size = chunk.existing->storedBytes;
+                m_lastSave.chunksReused++;
+            } else {
+                m_lastSave.chunksWritten++;
+            }
+            chunk.entry.offset = end;
+            chunk.entry.storedBytes = static_cast<uint32_t>(size);
+            if (!Append(target, end, bytes, size)) {
+                return false;
+            }
+            m_lastSave.bytesWritten += size;
+            entries.push_back(chunk.entry);
+            chunk.data = std::vector<uint8_t>();
+            chunk.extracted = PixelBuffer();
+        }
+        document.TrimMemory();
+    }
+
+    // The header is written last: until then the old table stays current
+    uint64_t tableOffset = end;
+    if (!Append(target, end, entries.data(), entries.size() * sizeof(ChunkEntry))) {
+        return false;
+    }
+    target.Flush();
+
+    FileHeader header = {};
+    header.magic = PROJECT_MAGIC;
+    header.version = PROJECT_VERSION;
+    header.width = static_cast<uint32_t>(document.Width());
+    header.height = static_cast<uint32_t>(document.Height());
+    header.tileSize = Document::TILE_SIZE;
+    header.chunkCount = static_cast<uint32_t>(entries.size());
+    header.tableOffset = tableOffset;
+    header.liveBytes = entries.size() * sizeof(ChunkEntry);
+    for (const ChunkEntry& entry : entries) {
+        header.liveBytes += entry.storedBytes;
+    }
+    header.tableChecksum = Checksum(target.Data() + tableOffset, entries.size() * sizeof(ChunkEntry));
+    std::memcpy(target.Data(), &header, sizeof(header));
+    target.Flush();
+
+    // Drop the growth slack
+    target.Resize(static_cast<size_t>(end));
+    return true;
+}
+
+bool ProjectFile::Save(Document& document, const TaskControl* control) {
+    if (!m_file.IsOpen() || document.GetTileSource() != this) {
+        return !m_path.empty() && SaveAs(document, m_path, control);
+    }
+
+    m_lastSave = ProjectSaveStats();
+    std::vector<ChunkEntry> entries;
+    if (!WriteFile(document, m_file, true, entries, control)) {
+        #ifdef DEBUG
+        printf("ProjectFile: save to %ls failed\n", m_path.c_str());
+        #endif
+        return false;
+    }
+    m_entries = std::move(entries);
+    m_index.clear();
+    for (size_t i = 0; i < m_entries.size(); i++) {
+        const ChunkEntry& entry = m_entries[i];
+        m_index[ChunkKey(entry.kind, entry.owner, entry.x, entry.y)] = i;
+    }
+    document.MarkSaved();
+
+    #ifdef DEBUG
+    printf("ProjectFile: saved %d chunks (%llu bytes), kept %d\n", m_lastSave.chunksWritten,
+           (unsigned long long)m_lastSave.bytesWritten, m_lastSave.chunksReused);
+    #endif
+
+    // Rewrite once superseded chunks outweigh the live ones. The save has
+    // already succeeded, so the rewrite is not offered to control.
+    FileHeader header;
+    std::memcpy(&header, m_file.Data(), sizeof(header));
+    uint64_t garbage = m_file.Size() - sizeof(header) - header.liveBytes;
+    if (m_file.Size() > MIN_REWRITE_BYTES && garbage > header.liveBytes) {
+        ProjectSaveStats incremental = m_lastSave;
+        if (SaveAs(document, m_path)) {
+            m_lastSave.chunksWritten += incremental.chunksWritten;
+        } else {
+            m_lastSave = incremental;
+        }
+    }
+    return true;
+}
+
+bool ProjectFile::SaveAs(Document& document, const std::wstring& path, const TaskControl* control) {
+    m_lastSave = ProjectSaveStats();
+    m_lastSave.rewritten = true;
+
+    // Build the new file beside the target, so a failed save leaves both
+    // the old file and the old mapping alone
+    std::wstring temporary = path + L".tmp";
+    MappedFile target;
+    std::vector<ChunkEntry> entries;
+    if (!target.Open(temporary, sizeof(FileHeader)) || !WriteFile(document, target, false, entries, control)) {
+        #ifdef DEBUG
+        printf("ProjectFile: could not write %ls\n", temporary.c_str());
+        #endif
+        target.Close();
+        DeleteFileAt(temporary);
+        return false;
+    }
+    target.Close();
+
+    // The mapping has to go before the file can be replaced
+    std::wstring previous = m_path;
+    m_file.Close();
+    if (!RenameFile(temporary, path)) {
+        DeleteFileAt(temporary);
+        if (!previous.empty()) {
+            MapFile(previous);
+        }
+        return false;
+    }
+    if (!MapFile(path)) {
+        m_path.clear();
+        return false;
+    }
+    m_path = path;
+    document.SetTileSource(this);
+    document.MarkSaved();
+
+    #ifdef DEBUG
+    printf("ProjectFile: wrote %ls, %d chunks encoded, %d copied\n", path.c_str(),
+           m_lastSave.chunksWritten, m_lastSave.chunksReused);
+    #endif
+    return true;
+}
+
+} // namespace PixelForge
\ No newline at end of file
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "background_task.h"
+#include "document.h"
+#include "../utils/mapped_file.h"
+
+namespace PixelForge {
+
+struct ProjectSaveStats {
+    int chunksWritten = 0;
+    int chunksReused = 0;       // Left in place (Save) or copied without re-encoding (SaveAs)
+    uint64_t bytesWritten = 0;
+    bool rewritten = false;     // Whole file written, e.g. to reclaim space
+};
+
+// PixelForge project (.pfp). A header points at a chunk table listing every
+// chunk: one per layer (name and settings), one per non-empty layer tile,
+// and one per preview pyramid tile. Pixel chunks are LZ4-compressed, or a
+// single colour when uniform. The file stays memory-mapped, so opening only
+// reads the table and the preview, and layer tiles decompress straight out
+// of the mapping when the document first needs them.
+//
+// Save appends the chunks that changed plus a new table, and repoints the
+// header last, so an interrupted save leaves the previous version intact.
+// Once superseded chunks make up more than half the file it is rewritten.
+class ProjectFile : public TileSource {
+public:
+    ProjectFile() = default;
+    ~ProjectFile() override;
+
+    ProjectFile(const ProjectFile&) = delete;
+    ProjectFile& operator=(const ProjectFile&) = delete;
+
+    // Creates a document from the file at path. Its tiles load from this
+    // object, which must outlive it.
+    bool Open(const std::wstring& path, std::unique_ptr<Document>& document);
+    // Writes the document's changes into the open file. control, when
+    // given, receives progress and can stop the save, which then fails
+    // leaving the previous version current.
+    bool Save(Document& document, const TaskControl* control = nullptr);
+    // Writes a complete file at path and continues from it
+    bool SaveAs(Document& document, const std::wstring& path, const TaskControl* control = nullptr);
+    void Close();
+
+    bool IsOpen() const { return m_file.IsOpen(); }
+    const std::wstring& Path() const { return m_path; }
+    const ProjectSaveStats& LastSaveStats() const { return m_lastSave; }
+
+    bool LoadTile(uint32_t layerId, int tx, int ty, PixelBuffer& tile) override;
+
+private:
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t width;
+        uint32_t height;
+        uint32_t tileSize;
+        uint32_t chunkCount;
+        uint64_t tableOffset;
+        uint64_t liveBytes;     // Chunks and table the header references
+        uint32_t tableChecksum;
+        uint32_t reserved[5];
+    };
+
+    struct ChunkEntry {
+        uint8_t kind;
+        uint8_t codec;
+        uint16_t reserved;
+        uint32_t owner;         // Layer id, or preview level
+        uint16_t x;             // Tile or preview chunk position
+        uint16_t y;
+        uint32_t storedBytes;
+        uint64_t offset;
+        uint32_t rawBytes;
+        uint32_t reserved2;
+    };
+
+    struct PendingChunk;
+
+    bool MapFile(const std::wstring& path);
+    const ChunkEntry* FindChunk(uint8_t kind, uint32_t owner, int x, int y) const;
+    bool DecodePixels(const ChunkEntry& entry, int width, int height, PixelBuffer& pixels) const;
+    bool WriteFile(Document& document, MappedFile& target, bool inPlace, std::vector<ChunkEntry>& entries,
+                   const TaskControl* control);
+
+    MappedFile m_file;
+    std::wstring m_path;
+    int m_width = 0;
+    int m_height = 0;
+    std::vector<ChunkEntry> m_entries;
+    std::unordered_map<uint64_t, size_t> m_index;   // Chunk key to m_entries
+    ProjectSaveStats m_lastSave;
+};
+
+} // namespace PixelForge
\ No newline at end of file
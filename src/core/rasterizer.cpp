@@ -0,0 +1,490 @@
+#include "rasterizer.h"
+#include "simd.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace PixelForge {
+
+namespace {
+
+const float PI = 3.14159265358979f;
+
+PointF Add(PointF a, PointF b) { return { a.x + b.x, a.y + b.y }; }
+PointF Sub(PointF a, PointF b) { return { a.x - b.x, a.y - b.y }; }
+PointF Scale(PointF a, float s) { return { a.x * s, a.y * s }; }
+float Dot(PointF a, PointF b) { return a.x * b.x + a.y * b.y; }
+float Cross(PointF a, PointF b) { return a.x * b.y - a.y * b.x; }
+PointF Perp(PointF a) { return { -a.y, a.x }; }
+
+PointF Normalize(PointF a) {
+    float length = std::sqrt(a.x * a.x + a.y * a.y);
+    return length > 0.0f ? Scale(a, 1.0f / length) : PointF();
+}
+
+const float FLATTEN_TOLERANCE = 0.1f;
+
+// Angle step keeping the chord within FLATTEN_TOLERANCE of the arc
+float ArcStep(float radius) {
+    if (radius <= FLATTEN_TOLERANCE) {
+        return PI / 4.0f;
+    }
+    return 2.0f * std::acos(1.0f - FLATTEN_TOLERANCE / radius);
+}
+
+int ArcSegments(float radius) {
+    return std::min(std::max(static_cast<int>(std::ceil(2.0f * PI / ArcStep(radius))), 8), 1024);
+}
+
+std::vector<PointF> EllipsePoints(float cx, float cy, float rx, float ry) {
+    int segments = ArcSegments(std::max(rx, ry));
+    std::vector<PointF> points(segments);
+    for (int i = 0; i < segments; i++) {
+        float angle = 2.0f * PI * i / segments;
+        points[i] = { cx + rx * std::cos(angle), cy + ry * std::sin(angle) };
+    }
+    return points;
+}
+
+// Adds a closed polygon wound so its signed area is positive. Stroke pieces
+// all share one orientation, so NonZero filling unions them without seams.
+void AddOriented(Path& out, std::vector<PointF> points) {
+    float area = 0.0f;
+    for (size_t i = 0; i < points.size(); i++) {
+        area += Cross(points[i], points[(i + 1) % points.size()]);
+    }
+    if (area < 0.0f) {
+        std::reverse(points.begin(), points.end());
+    }
+    out.AddPolyline(points, true);
+}
+
+} // namespace
+
+// Path
+
+void Path::MoveTo(float x, float y) {
+    m_contours.emplace_back();
+    m_contours.back().points.push_back({ x, y });
+}
+
+void Path::LineTo(float x, float y) {
+    if (m_contours.empty() || m_contours.back().closed) {
+        m_contours.emplace_back();
+    }
+    m_contours.back().points.push_back({ x, y });
+}
+
+void Path::Close() {
+    if (!m_contours.empty()) {
+        m_contours.back().closed = true;
+    }
+}
+
+void Path::AddRectangle(float x, float y, float width, float height) {
+    AddPolyline({ { x, y }, { x + width, y }, { x + width, y + height }, { x, y + height } }, true);
+}
+
+void Path::AddEllipse(float cx, float cy, float rx, float ry) {
+    AddPolyline(EllipsePoints(cx, cy, rx, ry), true);
+}
+
+void Path::AddPolyline(const std::vector<PointF>& points, bool closed) {
+    if (points.empty()) {
+        return;
+    }
+    Contour contour;
+    contour.points = points;
+    contour.closed = closed;
+    m_contours.push_back(std::move(contour));
+}
+
+Path Path::Stroke(const StrokeStyle& style) const {
+    Path out;
+    const float hw = style.width * 0.5f;
+    if (hw <= 0.0f) {
+        return out;
+    }
+
+    for (const Contour& contour : m_contours) {
+        // Drop repeated points; they have no direction
+        std::vector<PointF> pts;
+        for (const PointF& p : contour.points) {
+            if (pts.empty() || p.x != pts.back().x || p.y != pts.back().y) {
+                pts.push_back(p);
+            }
+        }
+        if (contour.closed && pts.size() > 1 &&
+            pts.front().x == pts.back().x && pts.front().y == pts.back().y) {
+            pts.pop_back();
+        }
+
+        const size_t n = pts.size();
+        if (n == 0) {
+            continue;
+        }
+        if (n == 1) {
+            if (style.cap == LineCap::Round) {
+                AddOriented(out, EllipsePoints(pts[0].x, pts[0].y, hw, hw));
+            } else if (style.cap == LineCap::Square) {
+                out.AddRectangle(pts[0].x - hw, pts[0].y - hw, hw * 2.0f, hw * 2.0f);
+            }
+            continue;
+        }
+
+        const bool closed = contour.closed && n > 2;
+        const size_t segments = closed ? n : n - 1;
+
+        for (size_t i = 0; i < segments; i++) {
+            PointF a = pts[i];
+            PointF b = pts[(i + 1) % n];
+            PointF normal = Scale(Perp(Normalize(Sub(b, a))), hw);
+            AddOriented(out, { Add(a, normal), Add(b, normal), Sub(b, normal), Sub(a, normal) });
+        }
+
+        // Joins fill the wedge on the outside of each turn
+        size_t firstJoin = closed ? 0 : 1;
+        size_t lastJoin = closed ? n : n - 1;
+        for (size_t i = firstJoin; i < lastJoin; i++) {
+            PointF v = pts[i];
+            PointF d0 = Normalize(Sub(v, pts[(i + n - 1) % n]));
+            PointF d1 = Normalize(Sub(pts[(i + 1) % n], v));
+            float cross = Cross(d0, d1);
+            if (std::fabs(cross) < 1e-6f && Dot(d0, d1) > 0.0f) {
+                continue;
+            }
+
+            float side = cross > 0.0f ? -1.0f : 1.0f;
+            PointF n0 = Scale(Perp(d0), hw * side);
+            PointF n1 = Scale(Perp(d1), hw * side);
+            PointF o0 = Add(v, n0);
+            PointF o1 = Add(v, n1);
+
+            // Shallow turns (flattened curves) differ from a bevel by less
+            // than the flattening tolerance whatever the join style
+            float turn = std::atan2(std::fabs(cross), Dot(d0, d1));
+            if (hw * (1.0f - std::cos(turn * 0.5f)) < FLATTEN_TOLERANCE) {
+                AddOriented(out, { v, o0, o1 });
+                continue;
+            }
+
+            switch (style.join) {
+                case LineJoin::Round: {
+                    // Fan from the vertex along the outer arc
+                    std::vector<PointF> fan = { v, o0 };
+                    int steps = static_cast<int>(std::ceil(turn / ArcStep(hw)));
+                    float start = std::atan2(n0.y, n0.x);
+                    float sweep = cross > 0.0f ? turn : -turn;
+                    for (int k = 1; k < steps; k++) {
+                        float angle = start + sweep * k / steps;
+                        fan.push_back({ v.x + hw * std::cos(angle), v.y + hw * std::sin(angle) });
+                    }
+                    fan.push_back(o1);
+                    AddOriented(out, fan);
+                    break;
+                }
+                case LineJoin::Miter: {
+                    PointF bisector = Normalize(Add(n0, n1));
+                    float cosHalf = Dot(bisector, n0) / hw;
+                    if (cosHalf > 1e-6f && 1.0f / cosHalf <= style.miterLimit) {
+                        PointF tip = Add(v, Scale(bisector, hw / cosHalf));
+                        AddOriented(out, { v, o0, tip, o1 });
+                        break;
+                    }
+                    AddOriented(out, { v, o0, o1 });
+                    break;
+                }
+                default:
+                    AddOriented(out, { v, o0, o1 });
+                    break;
+            }
+        }
+
+        if (closed || style.cap == LineCap::Butt) {
+            continue;
+        }
+
+        PointF ends[2] = { pts[0], pts[n - 1] };
+        PointF outward[2] = {
+            Normalize(Sub(pts[0], pts[1])),
+            Normalize(Sub(pts[n - 1], pts[n - 2]))
+        };
+        for (int e = 0; e < 2; e++) {
+            if (style.cap == LineCap::Round) {
+                AddOriented(out, EllipsePoints(ends[e].x, ends[e].y, hw, hw));
+            } else {
+                PointF normal = Scale(Perp(outward[e]), hw);
+                PointF extent = Scale(outward[e], hw);
+                AddOriented(out, {
+                    Add(ends[e], normal), Add(Add(ends[e], normal), extent),
+                    Add(Sub(ends[e], normal), extent), Sub(ends[e], normal)
+                });
+            }
+        }
+    }
+    return out;
+}
+
+// Rasterizer
+
+void Rasterizer::Fill(PixelBuffer& target, const Path& path, uint32_t color, FillRule rule) {
+    if (path.IsEmpty() || target.IsEmpty() || (color >> 24) == 0) {
+        return;
+    }
+
+    float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f;
+    for (const auto& contour : path.Contours()) {
+        for (const PointF& p : contour.points) {
+            minX = std::min(minX, p.x);
+            minY = std::min(minY, p.y);
+            maxX = std::max(maxX, p.x);
+            maxY = std::max(maxY, p.y);
+        }
+    }
+    IntRect shapeBounds = {
+        static_cast<int>(std::floor(std::max(minX, -1e6f))),
+        static_cast<int>(std::floor(std::max(minY, -1e6f))),
+        static_cast<int>(std::ceil(std::min(maxX, 1e6f))),
+        static_cast<int>(std::ceil(std::min(maxY, 1e6f)))
+    };
+    m_bounds = shapeBounds.Intersect(target.Bounds());
+    if (m_bounds.IsEmpty()) {
+        return;
+    }
+
+    // Zeroed after every composite, so only growth needs clearing
+    m_pitch = m_bounds.Width() + 2;
+    size_t needed = static_cast<size_t>(m_pitch) * m_bounds.Height();
+    if (m_accumulation.size() < needed) {
+        m_accumulation.resize(needed, 0.0f);
+    }
+
+    for (const auto& contour : path.Contours()) {
+        const auto& pts = contour.points;
+        for (size_t i = 0; i < pts.size(); i++) {
+            AddLine(pts[i], pts[(i + 1) % pts.size()]);
+        }
+    }
+
+    Composite(target, color, rule);
+}
+
+void Rasterizer::Stroke(PixelBuffer& target, const Path& path, uint32_t color, const StrokeStyle& style) {
+    Fill(target, path.Stroke(style), color, FillRule::NonZero);
+}
+
+void Rasterizer::DrawRectangle(PixelBuffer& target, const IntRect& rect, uint32_t color, const StrokeStyle& style) {
+    // Keep the stroke inside the rectangle, as GDI does with an inside frame
+    float hw = style.width * 0.5f;
+    Path path;
+    path.AddRectangle(rect.left + hw, rect.top + hw, rect.Width() - style.width, rect.Height() - style.width);
+    Stroke(target, path, color, style);
+}
+
+void Rasterizer::DrawEllipse(PixelBuffer& target, const IntRect& rect, uint32_t color, const StrokeStyle& style) {
+    float hw = style.width * 0.5f;
+    Path path;
+    path.AddEllipse((rect.left + rect.right) * 0.5f, (rect.top + rect.bottom) * 0.5f,
+                    rect.Width() * 0.5f - hw, rect.Height() * 0.5f - hw);
+    Stroke(target, path, color, style);
+}
+
+void Rasterizer::DrawArrow(PixelBuffer& target, PointF from, PointF to, uint32_t color, const StrokeStyle& style) {
+    PointF delta = Sub(to, from);
+    float length = std::sqrt(Dot(delta, delta));
+    if (length <= 0.0f) {
+        return;
+    }
+
+    PointF dir = Scale(delta, 1.0f / length);
+    float headLength = std::min(length, std::max(style.width * 4.0f, 10.0f));
+    PointF base = Sub(to, Scale(dir, headLength));
+
+    if (length > headLength) {
+        // Run the shaft slightly into the head so the two overlap
+        Path shaft;
+        shaft.MoveTo(from.x, from.y);
+        PointF end = Add(base, Scale(dir, std::min(headLength * 0.5f, style.width)));
+        shaft.LineTo(end.x, end.y);
+        Stroke(target, shaft, color, style);
+    }
+
+    PointF normal = Scale(Perp(dir), headLength * 0.5f);
+    Path head;
+    head.AddPolyline({ to, Add(base, normal), Sub(base, normal) }, true);
+    Fill(target, head, color, FillRule::NonZero);
+}
+
+void Rasterizer::AddLine(PointF p0, PointF p1) {
+    // Work in buffer coordinates and split at the left/right buffer edges;
+    // the parts outside are clamped onto the edge so winding stays correct
+    const float width = static_cast<float>(m_bounds.Width());
+    p0 = { p0.x - m_bounds.left, p0.y - m_bounds.top };
+    p1 = { p1.x - m_bounds.left, p1.y - m_bounds.top };
+
+    float splits[4] = { 0.0f, 1.0f, 1.0f, 1.0f };
+    int count = 1;
+    float dx = p1.x - p0.x;
+    if (dx != 0.0f) {
+        for (float edge : { 0.0f, width }) {
+            float t = (edge - p0.x) / dx;
+            if (t > 0.0f && t < 1.0f) {
+                splits[count++] = t;
+            }
+        }
+    }
+    if (count == 3 && splits[1] > splits[2]) {
+        std::swap(splits[1], splits[2]);
+    }
+    splits[count++] = 1.0f;
+
+    for (int i = 0; i + 1 < count; i++) {
+        PointF a = { p0.x + dx * splits[i], p0.y + (p1.y - p0.y) * splits[i] };
+        PointF b = { p0.x + dx * splits[i + 1], p0.y + (p1.y - p0.y) * splits[i + 1] };
+        a.x = std::min(std::max(a.x, 0.0f), width);
+        b.x = std::min(std::max(b.x, 0.0f), width);
+        AccumulateLine(a, b);
+    }
+}
+
+void Rasterizer::AccumulateLine(PointF p0, PointF p1) {
+    if (p0.y == p1.y) {
+        return;
+    }
+    float dir = 1.0f;
+    if (p0.y > p1.y) {
+        dir = -1.0f;
+        std::swap(p0, p1);
+    }
+
+    const float width = static_cast<float>(m_bounds.Width());
+    const float height = static_cast<float>(m_bounds.Height());
+    const float dxdy = (p1.x - p0.x) / (p1.y - p0.y);
+    float x = p0.x;
+    float y0 = p0.y;
+    float y1 = std::min(p1.y, height);
+    if (y0 < 0.0f) {
+        x -= y0 * dxdy;
+        y0 = 0.0f;
+    }
+    if (y0 >= y1) {
+        return;
+    }
+
+    // Each row receives the signed area the edge sweeps through its cells
+    const int yEnd = static_cast<int>(std::ceil(y1));
+    for (int y = static_cast<int>(y0); y < yEnd; y++) {
+        float* row = m_accumulation.data() + static_cast<size_t>(y) * m_pitch;
+        float dy = std::min(static_cast<float>(y + 1), y1) - std::max(static_cast<float>(y), y0);
+        float xNext = std::min(std::max(x + dxdy * dy, 0.0f), width);
+        float d = dy * dir;
+        float xa = std::min(x, xNext);
+        float xb = std::max(x, xNext);
+        float xaFloor = std::floor(xa);
+        int xai = static_cast<int>(xaFloor);
+        float xbCeil = std::ceil(xb);
+        int xbi = static_cast<int>(xbCeil);
+
+        if (xbi <= xai + 1) {
+            float xmf = 0.5f * (x + xNext) - xaFloor;
+            row[xai] += d - d * xmf;
+            row[xai + 1] += d * xmf;
+        } else {
+            float s = 1.0f / (xb - xa);
+            float xaf = xa - xaFloor;
+            float a0 = 0.5f * s * (1.0f - xaf) * (1.0f - xaf);
+            float xbf = xb - xbCeil + 1.0f;
+            float am = 0.5f * s * xbf * xbf;
+            row[xai] += d * a0;
+            if (xbi == xai + 2) {
+                row[xai + 1] += d * (1.0f - a0 - am);
+            } else {
+                float a1 = s * (1.5f - xaf);
+                row[xai + 1] += d * (a1 - a0);
+                for (int xi = xai + 2; xi < xbi - 1; xi++) {
+                    row[xi] += d * s;
+                }
+                float a2 = a1 + (xbi - xai - 3) * s;
+                row[xbi - 1] += d * (1.0f - a2 - am);
+            }
+            row[xbi] += d * am;
+        }
+        x = xNext;
+    }
+}
+
+void Rasterizer::Composite(PixelBuffer& target, uint32_t color, FillRule rule) {
+    const int width = m_bounds.Width();
+    const int colorAlpha = color >> 24;
+    m_coverage.resize(width);
+
+    for (int y = 0; y < m_bounds.Height(); y++) {
+        float* row = m_accumulation.data() + static_cast<size_t>(y) * m_pitch;
+        uint8_t* coverage = m_coverage.data();
+
+        // Prefix sum turns deposited area into the winding value per pixel
+        int x = 0;
+        float sum = 0.0f;
+        #ifdef PIXELFORGE_SSE2
+        __m128 offset = _mm_setzero_ps();
+        for (; x + 4 <= width; x += 4) {
+            __m128 v = _mm_loadu_ps(row + x);
+            v = _mm_add_ps(v, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 4)));
+            v = _mm_add_ps(v, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 8)));
+            v = _mm_add_ps(v, offset);
+            offset = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3));
+            _mm_storeu_ps(row + x, v);
+        }
+        sum = _mm_cvtss_f32(offset);
+        #endif
+        for (; x < width; x++) {
+            sum += row[x];
+            row[x] = sum;
+        }
+
+        x = 0;
+        if (rule == FillRule::NonZero) {
+            #ifdef PIXELFORGE_SSE2
+            const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+            const __m128 one = _mm_set1_ps(1.0f);
+            const __m128 scale = _mm_set1_ps(255.0f);
+            const __m128 half = _mm_set1_ps(0.5f);
+            for (; x + 4 <= width; x += 4) {
+                __m128 v = _mm_and_ps(_mm_loadu_ps(row + x), absMask);
+                v = _mm_add_ps(_mm_mul_ps(_mm_min_ps(v, one), scale), half);
+                __m128i i32 = _mm_cvttps_epi32(v);
+                __m128i i16 = _mm_packs_epi32(i32, i32);
+                __m128i i8 = _mm_packus_epi16(i16, i16);
+                int packed = _mm_cvtsi128_si32(i8);
+                std::memcpy(coverage + x, &packed, 4);
+            }
+            #endif
+            for (; x < width; x++) {
+                float v = std::min(std::fabs(row[x]), 1.0f);
+                coverage[x] = static_cast<uint8_t>(v * 255.0f + 0.5f);
+            }
+        } else {
+            for (; x < width; x++) {
+                float v = std::fabs(row[x]);
+                v -= 2.0f * std::floor(v * 0.5f);
+                if (v > 1.0f) {
+                    v = 2.0f - v;
+                }
+                coverage[x] = static_cast<uint8_t>(v * 255.0f + 0.5f);
+            }
+        }
+        std::memset(row, 0, m_pitch * sizeof(float));
+
+        uint32_t* out = target.Row(m_bounds.top + y) + m_bounds.left;
+        for (x = 0; x < width; x++) {
+            int c = coverage[x];
+            if (c == 0) continue;
+            int alpha = c == 255 ? colorAlpha : (colorAlpha * c + 127) / 255;
+            if (alpha != 0) {
+                out[x] = BlendOver(out[x], color, alpha);
+            }
+        }
+    }
+}
+
+} // namespace PixelForge
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "geometry.h"
+#include "pixel_buffer.h"
+
+namespace PixelForge {
+
+enum class FillRule {
+    NonZero,
+    EvenOdd
+};
+
+enum class LineJoin {
+    Miter,
+    Round,
+    Bevel
+};
+
+enum class LineCap {
+    Butt,
+    Round,
+    Square
+};
+
+struct StrokeStyle {
+    float width = 1.0f;
+    LineJoin join = LineJoin::Miter;
+    LineCap cap = LineCap::Butt;
+    float miterLimit = 4.0f;
+};
+
+// Polylines and polygons in pixel coordinates. Curved shapes are flattened
+// when they are added, so the rasterizer only ever sees line segments.
+class Path {
+public:
+    struct Contour {
+        std::vector<PointF> points;
+        bool closed = false;
+    };
+
+    void MoveTo(float x, float y);
+    void LineTo(float x, float y);
+    void Close();
+
+    void AddRectangle(float x, float y, float width, float height);
+    void AddEllipse(float cx, float cy, float rx, float ry);
+    void AddPolyline(const std::vector<PointF>& points, bool closed);
+
+    bool IsEmpty() const { return m_contours.empty(); }
+    const std::vector<Contour>& Contours() const { return m_contours; }
+
+    // Outline of the stroke as positively wound polygons; fill it NonZero
+    Path Stroke(const StrokeStyle& style) const;
+
+private:
+    std::vector<Contour> m_contours;
+};
+
+// Scanline coverage rasterizer. Edges deposit signed area into a float
+// accumulation buffer covering the shape bounds; a prefix sum along each row
+// turns that into exact anti-aliased coverage, folded by the fill rule. The
+// scratch buffers are kept between calls, so drawing many small shapes does
+// not allocate.
+class Rasterizer {
+public:
+    void Fill(PixelBuffer& target, const Path& path, uint32_t color,
+              FillRule rule = FillRule::NonZero);
+    void Stroke(PixelBuffer& target, const Path& path, uint32_t color,
+                const StrokeStyle& style);
+
+    // Annotation helpers
+    void DrawRectangle(PixelBuffer& target, const IntRect& rect, uint32_t color,
+                       const StrokeStyle& style);
+    void DrawEllipse(PixelBuffer& target, const IntRect& rect, uint32_t color,
+                     const StrokeStyle& style);
+    void DrawArrow(PixelBuffer& target, PointF from, PointF to, uint32_t color,
+                   const StrokeStyle& style);
+
+private:
+    void AddLine(PointF p0, PointF p1);
+    void AccumulateLine(PointF p0, PointF p1);
+    void Composite(PixelBuffer& target, uint32_t color, FillRule rule);
+
+    IntRect m_bounds;           // Target pixels covered by the accumulation buffer
+    int m_pitch = 0;            // Accumulation row length (bounds width + 2)
+    std::vector<float> m_accumulation;
+    std::vector<uint8_t> m_coverage;
+};
+
+} // namespace PixelForge
\ No newline at end of file
@@ -0,0 +1,144 @@
+#include "render_thread.h"
+#include "frame_arena.h"
+#include <chrono>
+#ifdef DEBUG
+#include <stdio.h>
+#endif
+
+namespace PixelForge {
+
+RenderThread::RenderThread(std::function<void()> onFrameReady)
+    : m_onFrameReady(std::move(onFrameReady))
+    , m_jobSuperseded(false)
+    , m_superseded(false) {
+    m_thread = std::thread(&RenderThread::RenderLoop, this);
+}
+
+RenderThread::~RenderThread() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopRequested = true;
+    }
+    m_superseded = true;
+    m_jobSuperseded = true;
+    m_changed.notify_all();
+    m_thread.join();
+}
+
+uint64_t RenderThread::Request(CanvasScene scene) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.requests++;
+    if (m_hasPending) {
+        m_stats.coalesced++;
+    }
+    m_pending = std::move(scene);
+    m_hasPending = true;
+    m_pendingSerial = ++m_lastSerial;
+    if (m_rendering) {
+        m_superseded = true;
+    }
+    m_changed.notify_all();
+    return m_pendingSerial;
+}
+
+void RenderThread::Post(std::function<void(const std::atomic<bool>& superseded)> job) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_job) {
+        m_stats.jobsSuperseded++;
+    }
+    if (m_jobRunning && !m_jobSuperseded) {
+        m_jobSuperseded = true;
+        m_stats.jobsSuperseded++;
+    }
+    m_job = std::move(job);
+    m_changed.notify_all();
+}
+
+bool RenderThread::WaitForFrame(uint64_t serial, int timeoutMs) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_changed.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                              [this, serial]() { return m_frameSerial >= serial || m_stopRequested; }) &&
+           m_frameSerial >= serial;
+}
+
+bool RenderThread::IsUsing(const PixelBuffer* image) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return (m_hasPending && m_pending.image.get() == image) || (m_rendering && m_renderingImage == image);
+}
+
+RenderStats RenderThread::Stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void RenderThread::RenderLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_changed.wait(lock, [this]() { return m_stopRequested || m_hasPending || m_job; });
+        if (m_stopRequested) {
+            return;
+        }
+        if (!m_hasPending) {
+            std::function<void(const std::atomic<bool>&)> job = std::move(m_job);
+            m_job = nullptr;
+            m_jobRunning = true;
+            m_jobSuperseded = false;
+            lock.unlock();
+            job(m_jobSuperseded);
+            job = nullptr;
+            lock.lock();
+            m_jobRunning = false;
+            m_stats.jobsRun++;
+            continue;
+        }
+
+        CanvasScene scene = std::move(m_pending);
+        m_pending = CanvasScene();
+        m_hasPending = false;
+        uint64_t serial = m_pendingSerial;
+        m_rendering = true;
+        m_renderingImage = scene.image.get();
+        m_superseded = false;
+        const int back = 1 - m_front;
+        lock.unlock();
+
+        // The back buffer is only ever touched by this thread
+        auto start = std::chrono::steady_clock::now();
+        bool finished;
+        {
+            ArenaScope frame;
+            finished = RenderCanvas(scene, m_buffers[back], &m_superseded);
+        }
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        // Drop the scene's image reference before publishing
+        scene = CanvasScene();
+
+        lock.lock();
+        m_rendering = false;
+        m_renderingImage = nullptr;
+        if (!finished) {
+            m_stats.abandoned++;
+            m_changed.notify_all();
+            continue;
+        }
+        m_front = back;
+        m_frameSerial = serial;
+        m_stats.framesRendered++;
+        m_stats.lastRenderMs = elapsed;
+        m_changed.notify_all();
+
+        #ifdef DEBUG
+        if (elapsed > 50.0) {
+            printf("RenderThread: frame %llu took %.1f ms\n", (unsigned long long)serial, elapsed);
+        }
+        #endif
+
+        lock.unlock();
+        if (m_onFrameReady) {
+            m_onFrameReady();
+        }
+        lock.lock();
+    }
+}
+
+} // namespace PixelForge
\ No newline at end of file
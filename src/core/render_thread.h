@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "canvas_renderer.h"
+#include "pixel_buffer.h"
+
+namespace PixelForge {
+
+struct RenderStats {
+    uint64_t requests = 0;
+    uint64_t framesRendered = 0;
+    uint64_t coalesced = 0;         // Requests replaced before they started
+    uint64_t abandoned = 0;         // Renders cut short by a newer request
+    uint64_t jobsRun = 0;
+    uint64_t jobsSuperseded = 0;    // Jobs replaced before starting or told to stop
+    double lastRenderMs = 0.0;
+};
+
+// Draws canvas frames on its own thread into two back buffers: one holds
+// the latest finished frame for presenting, the other is drawn into. Only
+// the newest request matters, so a request replaces any that has not
+// started and cuts short a render in progress. onFrameReady is called on
+// the render thread after each finished frame; it must not block. Nothing
+// here touches a window, so it runs just as well headless.
+//
+// Other work that feeds the canvas, such as rendering a document view, can
+// be posted to run on the same thread between frames. Jobs are superseded
+// the same way frames are, and a waiting frame always goes first.
+class RenderThread {
+public:
+    explicit RenderThread(std::function<void()> onFrameReady);
+    ~RenderThread();
+
+    RenderThread(const RenderThread&) = delete;
+    RenderThread& operator=(const RenderThread&) = delete;
+
+    // Queues scene and returns its serial number, counting from 1
+    uint64_t Request(CanvasScene scene);
+
+    // Runs job on the render thread once no frame is waiting. Posting
+    // replaces a job that has not started and sets the superseded flag of
+    // one that is running, which should then give up. A job still queued
+    // when the thread stops is dropped.
+    void Post(std::function<void(const std::atomic<bool>& superseded)> job);
+
+    // Calls draw(frame, serial) with the latest finished frame, which
+    // stays untouched until draw returns. False before the first frame.
+    template <typename Fn>
+    bool Present(Fn&& draw) const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_frameSerial == 0) {
+            return false;
+        }
+        draw(static_cast<const PixelBuffer&>(m_buffers[m_front]), m_frameSerial);
+        return true;
+    }
+
+    // Waits until the frame for serial, or a later one, is finished
+    bool WaitForFrame(uint64_t serial, int timeoutMs);
+
+    // True while a queued or running render reads image, so its owner must
+    // not write to it yet. A render of a superseded scene is cut short, so
+    // image is soon free again unless it is in the latest request.
+    bool IsUsing(const PixelBuffer* image) const;
+
+    RenderStats Stats() const;
+
+private:
+    void RenderLoop();
+
+    std::function<void()> m_onFrameReady;
+    PixelBuffer m_buffers[2];
+    int m_front = 0;                // Presented; the other is the render target
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_changed;
+    CanvasScene m_pending;
+    bool m_hasPending = false;
+    std::function<void(const std::atomic<bool>&)> m_job;
+    bool m_jobRunning = false;
+    std::atomic<bool> m_jobSuperseded;
+    uint64_t m_pendingSerial = 0;
+    uint64_t m_lastSerial = 0;
+    uint64_t m_frameSerial = 0;     // Serial of the front buffer's frame
+    bool m_rendering = false;
+    const PixelBuffer* m_renderingImage = nullptr;
+    std::atomic<bool> m_superseded;
+    bool m_stopRequested = false;
+    RenderStats m_stats;
+    std::thread m_thread;
+};
+
+} // namespace PixelForge
\ No newline at end of file
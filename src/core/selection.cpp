@@ -0,0 +1,893 @@
+#include "selection.h"
+#include "frame_arena.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#ifdef DEBUG
+#include <stdio.h>
+#endif
+
+namespace PixelForge {
+
+namespace {
+
+void UnionSpans(const std::vector<Span>& a, const std::vector<Span>& b, std::vector<Span>& out) {
+    out.clear();
+    size_t i = 0, j = 0;
+    while (i < a.size() || j < b.size()) {
+        Span s;
+        if (j >= b.size() || (i < a.size() && a[i].x0 <= b[j].x0)) {
+            s = a[i++];
+        } else {
+            s = b[j++];
+        }
+        if (!out.empty() && s.x0 <= out.back().x1) {
+            out.back().x1 = std::max(out.back().x1, s.x1);
+        } else {
+            out.push_back(s);
+        }
+    }
+}
+
+void IntersectSpans(const std::vector<Span>& a, const std::vector<Span>& b, std::vector<Span>& out) {
+    out.clear();
+    size_t i = 0, j = 0;
+    while (i < a.size() && j < b.size()) {
+        int lo = std::max(a[i].x0, b[j].x0);
+        int hi = std::min(a[i].x1, b[j].x1);
+        if (lo < hi) {
+            out.push_back({ lo, hi });
+        }
+        if (a[i].x1 < b[j].x1) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+}
+
+void SubtractSpans(const std::vector<Span>& a, const std::vector<Span>& b, std::vector<Span>& out) {
+    out.clear();
+    size_t j = 0;
+    for (const Span& s : a) {
+        while (j < b.size() && b[j].x1 <= s.x0) {
+            j++;
+        }
+        int cur = s.x0;
+        for (size_t k = j; k < b.size() && b[k].x0 < s.x1; k++) {
+            if (b[k].x0 > cur) {
+                out.push_back({ cur, b[k].x0 });
+            }
+            cur = std::max(cur, b[k].x1);
+        }
+        if (cur < s.x1) {
+            out.push_back({ cur, s.x1 });
+        }
+    }
+}
+
+// Adds span [x0, x1) clamped to the row width, keeping the row sorted
+void AddClampedSpan(std::vector<Span>& row, int x0, int x1, int width) {
+    x0 = std::max(x0, 0);
+    x1 = std::min(x1, width);
+    if (x0 < x1) {
+        row.push_back({ x0, x1 });
+    }
+}
+
+inline uint32_t LerpPixel(uint32_t dst, uint32_t src, uint32_t coverage) {
+    uint32_t result = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        int d = (dst >> shift) & 0xFF;
+        int s = (src >> shift) & 0xFF;
+        int v = d + ((s - d) * static_cast<int>(coverage) + (s > d ? 127 : -127)) / 255;
+        result |= static_cast<uint32_t>(v) << shift;
+    }
+    return result;
+}
+
+} // namespace
+
+// RunMask
+
+RunMask::RunMask(int width, int height)
+    : m_width(std::max(width, 0))
+    , m_height(std::max(height, 0))
+    , m_rows(static_cast<size_t>(std::max(height, 0))) {
+}
+
+bool RunMask::Contains(int x, int y) const {
+    if (y < 0 || y >= m_height) {
+        return false;
+    }
+    const auto& row = m_rows[y];
+    auto it = std::upper_bound(row.begin(), row.end(), x,
+        [](int value, const Span& s) { return value < s.x1; });
+    return it != row.end() && it->x0 <= x;
+}
+
+bool RunMask::IsEmpty() const {
+    for (const auto& row : m_rows) {
+        if (!row.empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+IntRect RunMask::Bounds() const {
+    IntRect bounds;
+    for (int y = 0; y < m_height; y++) {
+        const auto& row = m_rows[y];
+        if (!row.empty()) {
+            bounds = bounds.Union({ row.front().x0, y, row.back().x1, y + 1 });
+        }
+    }
+    return bounds;
+}
+
+size_t RunMask::MemoryUsage() const {
+    size_t bytes = m_rows.capacity() * sizeof(std::vector<Span>);
+    for (const auto& row : m_rows) {
+        bytes += row.capacity() * sizeof(Span);
+    }
+    return bytes;
+}
+
+bool RunMask::Union(const RunMask& other) {
+    if (other.m_width != m_width || other.m_height != m_height) {
+        return false;
+    }
+    std::vector<Span> scratch;
+    for (int y = 0; y < m_height; y++) {
+        if (other.m_rows[y].empty()) continue;
+        UnionSpans(m_rows[y], other.m_rows[y], scratch);
+        m_rows[y].swap(scratch);
+    }
+    return true;
+}
+
+bool RunMask::Intersect(const RunMask& other) {
+    if (other.m_width != m_width || other.m_height != m_height) {
+        return false;
+    }
+    std::vector<Span> scratch;
+    for (int y = 0; y < m_height; y++) {
+        if (m_rows[y].empty()) continue;
+        IntersectSpans(m_rows[y], other.m_rows[y], scratch);
+        m_rows[y].swap(scratch);
+    }
+    return true;
+}
+
+bool RunMask::Subtract(const RunMask& other) {
+    if (other.m_width != m_width || other.m_height != m_height) {
+        return false;
+    }
+    std::vector<Span> scratch;
+    for (int y = 0; y < m_height; y++) {
+        if (m_rows[y].empty() || other.m_rows[y].empty()) continue;
+        SubtractSpans(m_rows[y], other.m_rows[y], scratch);
+        m_rows[y].swap(scratch);
+    }
+    return true;
+}
+
+void RunMask::Invert() {
+    std::vector<Span> scratch;
+    for (auto& row : m_rows) {
+        scratch.clear();
+        int cur = 0;
+        for (const Span& s : row) {
+            if (s.x0 > cur) {
+                scratch.push_back({ cur, s.x0 });
+            }
+            cur = s.x1;
+        }
+        if (cur < m_width) {
+            scratch.push_back({ cur, m_width });
+        }
+        row.swap(scratch);
+    }
+}
+
+// Selection
+
+Selection::Selection(int width, int height)
+    : m_width(std::max(width, 0))
+    , m_height(std::max(height, 0))
+    , m_isRuns(true)
+    , m_runs(width, height) {
+}
+
+Selection Selection::All(int width, int height) {
+    return Rectangle(width, height, { 0, 0, width, height });
+}
+
+Selection Selection::Rectangle(int width, int height, const IntRect& rect) {
+    Selection selection(width, height);
+    IntRect clipped = rect.Intersect({ 0, 0, width, height });
+    for (int y = clipped.top; y < clipped.bottom; y++) {
+        selection.m_runs.Row(y).push_back({ clipped.left, clipped.right });
+    }
+    return selection;
+}
+
+Selection Selection::Ellipse(int width, int height, const IntRect& rect, bool antiAlias) {
+    Selection selection(width, height);
+    if (rect.IsEmpty()) {
+        return selection;
+    }
+
+    const double cx = (rect.left + rect.right) * 0.5;
+    const double cy = (rect.top + rect.bottom) * 0.5;
+    const double rx = rect.Width() * 0.5;
+    const double ry = rect.Height() * 0.5;
+    IntRect clipped = rect.Intersect({ 0, 0, width, height });
+
+    if (!antiAlias) {
+        // Sample at pixel centers, one span per row
+        for (int y = clipped.top; y < clipped.bottom; y++) {
+            double dy = (y + 0.5 - cy) / ry;
+            if (dy * dy >= 1.0) continue;
+            double halfWidth = rx * std::sqrt(1.0 - dy * dy);
+            int x0 = static_cast<int>(std::ceil(cx - halfWidth - 0.5));
+            int x1 = static_cast<int>(std::ceil(cx + halfWidth - 0.5));
+            AddClampedSpan(selection.m_runs.Row(y), x0, x1, width);
+        }
+        return selection;
+    }
+
+    auto inside = [&](double x, double y) {
+        double nx = (x - cx) / rx;
+        double ny = (y - cy) / ry;
+        return nx * nx + ny * ny <= 1.0;
+    };
+
+    selection.InitTiles(TileKind::Empty);
+    const int T = TILE_SIZE;
+    for (int ty = clipped.top / T; ty * T < clipped.bottom; ty++) {
+        for (int tx = clipped.left / T; tx * T < clipped.right; tx++) {
+            IntRect tr = selection.TileRect(tx, ty);
+            Tile& tile = selection.TileAt(tx, ty);
+
+            // The ellipse is convex: all four corners inside means the tile is
+            if (inside(tr.left, tr.top) && inside(tr.right, tr.top) &&
+                inside(tr.left, tr.bottom) && inside(tr.right, tr.bottom)) {
+                tile.kind = TileKind::Full;
+                continue;
+            }
+
+            // Nearest tile point to the center outside the ellipse: no overlap
+            double nearX = std::min<double>(std::max<double>(cx, tr.left), tr.right);
+            double nearY = std::min<double>(std::max<double>(cy, tr.top), tr.bottom);
+            if (!inside(nearX, nearY)) {
+                continue;
+            }
+
+            // Boundary tile: 4x4 supersampling
+            auto coverage = std::make_shared<std::vector<uint8_t>>(T * T, 0);
+            for (int y = tr.top; y < tr.bottom; y++) {
+                uint8_t* out = coverage->data() + (y - tr.top) * T;
+                for (int x = tr.left; x < tr.right; x++) {
+                    int hits = 0;
+                    for (int sy = 0; sy < 4; sy++) {
+                        for (int sx = 0; sx < 4; sx++) {
+                            hits += inside(x + (sx + 0.5) / 4.0, y + (sy + 0.5) / 4.0);
+                        }
+                    }
+                    out[x - tr.left] = static_cast<uint8_t>((hits * 255 + 8) / 16);
+                }
+            }
+            tile.kind = TileKind::Partial;
+            tile.coverage = coverage;
+            selection.NormalizeTile(tile, tr);
+        }
+    }
+    return selection;
+}
+
+Selection Selection::Polygon(int width, int height, const std::vector<PointF>& points) {
+    Selection selection(width, height);
+    if (points.size() < 3) {
+        return selection;
+    }
+
+    float minY = points[0].y, maxY = points[0].y;
+    for (const auto& p : points) {
+        minY = std::min(minY, p.y);
+        maxY = std::max(maxY, p.y);
+    }
+    int y0 = std::max(0, static_cast<int>(std::floor(minY)));
+    int y1 = std::min(height, static_cast<int>(std::ceil(maxY)) + 1);
+
+    // Even-odd scanline fill sampled at pixel centers
+    std::vector<float> crossings;
+    for (int y = y0; y < y1; y++) {
+        float py = y + 0.5f;
+        crossings.clear();
+        for (size_t i = 0; i < points.size(); i++) {
+            const PointF& a = points[i];
+            const PointF& b = points[(i + 1) % points.size()];
+            if ((a.y <= py && b.y > py) || (b.y <= py && a.y > py)) {
+                crossings.push_back(a.x + (py - a.y) / (b.y - a.y) * (b.x - a.x));
+            }
+        }
+        std::sort(crossings.begin(), crossings.end());
+
+        std::vector<Span>& row = selection.m_runs.Row(y);
+        for (size_t i = 0; i + 1 < crossings.size(); i += 2) {
+            int x0 = static_cast<int>(std::ceil(crossings[i] - 0.5f));
+            int x1 = static_cast<int>(std::ceil(crossings[i + 1] - 0.5f));
+            x0 = std::max(x0, 0);
+            x1 = std::min(x1, width);
+            if (x0 >= x1) continue;
+            if (!row.empty() && x0 <= row.back().x1) {
+                row.back().x1 = std::max(row.back().x1, x1);
+            } else {
+                row.push_back({ x0, x1 });
+            }
+        }
+    }
+    return selection;
+}
+
+Selection Selection::FromRuns(RunMask runs) {
+    Selection selection;
+    selection.m_width = runs.Width();
+    selection.m_height = runs.Height();
+    selection.m_isRuns = true;
+    selection.m_runs = std::move(runs);
+    return selection;
+}
+
+void Selection::InitTiles(TileKind kind) {
+    m_isRuns = false;
+    m_runs = RunMask();
+    m_tiles.assign(static_cast<size_t>(TilesX()) * TilesY(), Tile());
+    for (auto& tile : m_tiles) {
+        tile.kind = kind;
+    }
+}
+
+IntRect Selection::TileRect(int tx, int ty) const {
+    int x = tx * TILE_SIZE;
+    int y = ty * TILE_SIZE;
+    return { x, y, std::min(x + TILE_SIZE, m_width), std::min(y + TILE_SIZE, m_height) };
+}
+
+SelectionTileView Selection::GetTileView(int tx, int ty) const {
+    const Tile& tile = TileAt(tx, ty);
+    SelectionTileView view;
+    view.rect = TileRect(tx, ty);
+    view.kind = tile.kind;
+    view.coverage = tile.kind == TileKind::Partial ? tile.coverage->data() : nullptr;
+    view.pitch = TILE_SIZE;
+    return view;
+}
+
+bool Selection::IsEmpty() const {
+    if (m_isRuns) {
+        return m_runs.IsEmpty();
+    }
+    for (const auto& tile : m_tiles) {
+        if (tile.kind != TileKind::Empty) {
+            return false;
+        }
+    }
+    return true;
+}
+
+IntRect Selection::Bounds() const {
+    if (m_isRuns) {
+        return m_runs.Bounds();
+    }
+    // Tile granular for soft selections
+    IntRect bounds;
+    for (int ty = 0; ty < TilesY(); ty++) {
+        for (int tx = 0; tx < TilesX(); tx++) {
+            if (TileAt(tx, ty).kind != TileKind::Empty) {
+                bounds = bounds.Union(TileRect(tx, ty));
+            }
+        }
+    }
+    return bounds;
+}
+
+uint8_t Selection::CoverageAt(int x, int y) const {
+    if (x < 0 || y < 0 || x >= m_width || y >= m_height) {
+        return 0;
+    }
+    if (m_isRuns) {
+        return m_runs.Contains(x, y) ? 255 : 0;
+    }
+    const Tile& tile = TileAt(x / TILE_SIZE, y / TILE_SIZE);
+    switch (tile.kind) {
+        case TileKind::Empty:
+            return 0;
+        case TileKind::Full:
+            return 255;
+        default:
+            return (*tile.coverage)[(y % TILE_SIZE) * TILE_SIZE + (x % TILE_SIZE)];
+    }
+}
+
+size_t Selection::MemoryUsage() const {
+    if (m_isRuns) {
+        return m_runs.MemoryUsage();
+    }
+    size_t bytes = m_tiles.capacity() * sizeof(Tile);
+    for (const auto& tile : m_tiles) {
+        if (tile.kind == TileKind::Partial) {
+            bytes += tile.coverage->size();
+        }
+    }
+    return bytes;
+}
+
+void Selection::ConvertToTiles() {
+    if (!m_isRuns) {
+        return;
+    }
+
+    RunMask runs = std::move(m_runs);
+    InitTiles(TileKind::Empty);
+
+    const int T = TILE_SIZE;
+    const int tilesX = TilesX();
+    std::vector<int> counts(tilesX);
+
+    for (int ty = 0; ty < TilesY(); ty++) {
+        int y0 = ty * T;
+        int y1 = std::min(y0 + T, m_height);
+
+        // First pass counts covered pixels so full tiles never allocate
+        CountRunTiles(runs, ty, counts);
+
+        for (int tx = 0; tx < tilesX; tx++) {
+            IntRect tr = TileRect(tx, ty);
+            Tile& tile = TileAt(tx, ty);
+            if (counts[tx] == 0) {
+                tile.kind = TileKind::Empty;
+            } else if (counts[tx] == tr.Width() * tr.Height()) {
+                tile.kind = TileKind::Full;
+            } else {
+                tile.kind = TileKind::Partial;
+                tile.coverage = std::make_shared<std::vector<uint8_t>>(T * T, 0);
+            }
+        }
+
+        for (int y = y0; y < y1; y++) {
+            for (const Span& s : runs.Row(y)) {
+                for (int x = s.x0; x < s.x1;) {
+                    int tx = x / T;
+                    int end = std::min((tx + 1) * T, s.x1);
+                    Tile& tile = TileAt(tx, ty);
+                    if (tile.kind == TileKind::Partial) {
+                        std::memset(tile.coverage->data() + (y - y0) * T + (x - tx * T), 255, end - x);
+                    }
+                    x = end;
+                }
+            }
+        }
+    }
+}
+
+void Selection::CountRunTiles(const RunMask& runs, int ty, std::vector<int>& counts) const {
+    const int T = TILE_SIZE;
+    int y0 = ty * T;
+    int y1 = std::min(y0 + T, m_height);
+    std::fill(counts.begin(), counts.end(), 0);
+    for (int y = y0; y < y1; y++) {
+        for (const Span& s : runs.Row(y)) {
+            for (int x = s.x0; x < s.x1;) {
+                int tx = x / T;
+                int end = std::min((tx + 1) * T, s.x1);
+                counts[tx] += end - x;
+                x = end;
+            }
+        }
+    }
+}
+
+SelectionTileView Selection::GetRunTileView(int tx, int ty, int covered, uint8_t* scratch) const {
+    SelectionTileView view;
+    view.rect = TileRect(tx, ty);
+    view.coverage = nullptr;
+    view.pitch = TILE_SIZE;
+    if (covered == 0) {
+        view.kind = TileKind::Empty;
+        return view;
+    }
+    if (covered == view.rect.Width() * view.rect.Height()) {
+        view.kind = TileKind::Full;
+        return view;
+    }
+
+    view.kind = TileKind::Partial;
+    view.coverage = scratch;
+    std::memset(scratch, 0, TILE_SIZE * TILE_SIZE);
+    const IntRect& r = view.rect;
+    for (int y = r.top; y < r.bottom; y++) {
+        const std::vector<Span>& row = m_runs.Row(y);
+        // Spans are sorted, so skip straight to the first one reaching the tile
+        auto it = std::lower_bound(row.begin(), row.end(), r.left,
+                                   [](const Span& s, int x) { return s.x1 <= x; });
+        uint8_t* out = scratch + (y - r.top) * TILE_SIZE;
+        for (; it != row.end() && it->x0 < r.right; ++it) {
+            int x0 = std::max(it->x0, r.left);
+            int x1 = std::min(it->x1, r.right);
+            std::memset(out + (x0 - r.left), 255, x1 - x0);
+        }
+    }
+    return view;
+}
+
+void Selection::NormalizeTile(Tile& tile, const IntRect& rect) const {
+    if (tile.kind != TileKind::Partial) {
+        return;
+    }
+    bool allZero = true;
+    bool allFull = true;
+    for (int y = 0; y < rect.Height() && (allZero || allFull); y++) {
+        const uint8_t* row = tile.coverage->data() + y * TILE_SIZE;
+        for (int x = 0; x < rect.Width(); x++) {
+            allZero &= row[x] == 0;
+            allFull &= row[x] == 255;
+        }
+    }
+    if (allZero || allFull) {
+        tile.kind = allZero ? TileKind::Empty : TileKind::Full;
+        tile.coverage.reset();
+    }
+}
+
+void Selection::ReadRow(int y, int x0, int x1, uint8_t* out) const {
+    const int ty = y / TILE_SIZE;
+    for (int x = x0; x < x1;) {
+        int tx = x / TILE_SIZE;
+        int end = std::min((tx + 1) * TILE_SIZE, x1);
+        const Tile& tile = TileAt(tx, ty);
+        switch (tile.kind) {
+            case TileKind::Empty:
+                std::memset(out, 0, end - x);
+                break;
+            case TileKind::Full:
+                std::memset(out, 255, end - x);
+                break;
+            default:
+                std::memcpy(out, tile.coverage->data() + (y % TILE_SIZE) * TILE_SIZE + (x % TILE_SIZE), end - x);
+                break;
+        }
+        out += end - x;
+        x = end;
+    }
+}
+
+template <typename Op>
+void Selection::CombineTiles(const Selection& other, Op op) {
+    ConvertToTiles();
+    Selection tiledOther;
+    const Selection* src = &other;
+    if (other.m_isRuns) {
+        tiledOther = other;
+        tiledOther.ConvertToTiles();
+        src = &tiledOther;
+    }
+
+    auto uniformValue = [](TileKind kind) { return kind == TileKind::Full ? 255 : 0; };
+    auto kindOf = [](int value) { return value ? TileKind::Full : TileKind::Empty; };
+
+    for (int ty = 0; ty < TilesY(); ty++) {
+        for (int tx = 0; tx < TilesX(); tx++) {
+            Tile& a = TileAt(tx, ty);
+            const Tile& b = src->TileAt(tx, ty);
+            bool aUniform = a.kind != TileKind::Partial;
+            bool bUniform = b.kind != TileKind::Partial;
+
+            if (aUniform && bUniform) {
+                a.kind = kindOf(op(uniformValue(a.kind), uniformValue(b.kind)));
+                continue;
+            }
+
+            // One uniform operand often decides the tile without touching pixels
+            if (aUniform) {
+                int va = uniformValue(a.kind);
+                if (op(va, 0) == op(va, 255)) {
+                    a.kind = kindOf(op(va, 0));
+                    continue;
+                }
+                if (op(va, 0) == 0 && op(va, 128) == 128 && op(va, 255) == 255) {
+                    a = b;
+                    continue;
+                }
+            }
+            if (bUniform) {
+                int vb = uniformValue(b.kind);
+                if (op(0, vb) == op(255, vb)) {
+                    a.kind = kindOf(op(0, vb));
+                    a.coverage.reset();
+                    continue;
+                }
+                if (op(0, vb) == 0 && op(128, vb) == 128 && op(255, vb) == 255) {
+                    continue;
+                }
+            }
+
+            auto result = std::make_shared<std::vector<uint8_t>>(TILE_SIZE * TILE_SIZE, 0);
+            int va = aUniform ? uniformValue(a.kind) : -1;
+            int vb = bUniform ? uniformValue(b.kind) : -1;
+            const uint8_t* pa = aUniform ? nullptr : a.coverage->data();
+            const uint8_t* pb = bUniform ? nullptr : b.coverage->data();
+            uint8_t* out = result->data();
+            for (int i = 0; i < TILE_SIZE * TILE_SIZE; i++) {
+                out[i] = static_cast<uint8_t>(op(pa ? pa[i] : va, pb ? pb[i] : vb));
+            }
+            a.kind = TileKind::Partial;
+            a.coverage = result;
+            NormalizeTile(a, TileRect(tx, ty));
+        }
+    }
+}
+
+bool Selection::Combine(const Selection& other, SelectionOp op) {
+    switch (op) {
+        case SelectionOp::Replace:
+            *this = other;
+            return true;
+        case SelectionOp::Add:
+            return Union(other);
+        case SelectionOp::Subtract:
+            return Subtract(other);
+        case SelectionOp::Intersect:
+            return Intersect(other);
+    }
+    return false;
+}
+
+bool Selection::Union(const Selection& other) {
+    if (other.m_width != m_width || other.m_height != m_height) {
+        #ifdef DEBUG
+        printf("WARNING: Selection::Union size mismatch\n");
+        #endif
+        return false;
+    }
+    if (m_isRuns && other.m_isRuns) {
+        return m_runs.Union(other.m_runs);
+    }
+    CombineTiles(other, [](int a, int b) { return std::max(a, b); });
+    return true;
+}
+
+bool Selection::Intersect(const Selection& other) {
+    if (other.m_width != m_width || other.m_height != m_height) {
+        #ifdef DEBUG
+        printf("WARNING: Selection::Intersect size mismatch\n");
+        #endif
+        return false;
+    }
+    if (m_isRuns && other.m_isRuns) {
+        return m_runs.Intersect(other.m_runs);
+    }
+    CombineTiles(other, [](int a, int b) { return std::min(a, b); });
+    return true;
+}
+
+bool Selection::Subtract(const Selection& other) {
+    if (other.m_width != m_width || other.m_height != m_height) {
+        #ifdef DEBUG
+        printf("WARNING: Selection::Subtract size mismatch\n");
+        #endif
+        return false;
+    }
+    if (m_isRuns && other.m_isRuns) {
+        return m_runs.Subtract(other.m_runs);
+    }
+    CombineTiles(other, [](int a, int b) { return std::min(a, 255 - b); });
+    return true;
+}
+
+void Selection::Invert() {
+    if (m_isRuns) {
+        m_runs.Invert();
+        return;
+    }
+    for (auto& tile : m_tiles) {
+        switch (tile.kind) {
+            case TileKind::Empty:
+                tile.kind = TileKind::Full;
+                break;
+            case TileKind::Full:
+                tile.kind = TileKind::Empty;
+                break;
+            default: {
+                auto inverted = std::make_shared<std::vector<uint8_t>>(*tile.coverage);
+                for (auto& value : *inverted) {
+                    value = static_cast<uint8_t>(255 - value);
+                }
+                tile.coverage = inverted;
+                break;
+            }
+        }
+    }
+}
+
+bool Selection::Feather(int radius) {
+    if (radius <= 0 || m_width == 0 || m_height == 0) {
+        return true;
+    }
+
+    // Scratch for the largest tile plus apron, reused for every tile. Taken
+    // before the selection is touched, so running out leaves it as it was.
+    const int T = TILE_SIZE;
+    ArenaScope scope;
+    const size_t apron = static_cast<size_t>(T) + 2 * radius;
+    uint8_t* source = scope.Arena().AllocateArray<uint8_t>(apron * apron);
+    uint8_t* horizontal = scope.Arena().AllocateArray<uint8_t>(apron * T);
+    if (!source || !horizontal) {
+        return false;
+    }
+
+    ConvertToTiles();
+    const int tilesX = TilesX();
+    const int tilesY = TilesY();
+    const int reach = (radius + T - 1) / T;
+    const int window = 2 * radius + 1;
+
+    std::vector<Tile> feathered(m_tiles.size());
+
+    for (int ty = 0; ty < tilesY; ty++) {
+        for (int tx = 0; tx < tilesX; tx++) {
+            const Tile& tile = TileAt(tx, ty);
+            Tile& out = feathered[static_cast<size_t>(ty) * tilesX + tx];
+
+            // Uniform tiles whose neighbourhood shares their kind are unaffected
+            bool unaffected = tile.kind != TileKind::Partial;
+            for (int ny = ty - reach; ny <= ty + reach && unaffected; ny++) {
+                for (int nx = tx - reach; nx <= tx + reach && unaffected; nx++) {
+                    int cx = std::min(std::max(nx, 0), tilesX - 1);
+                    int cy = std::min(std::max(ny, 0), tilesY - 1);
+                    unaffected = TileAt(cx, cy).kind == tile.kind;
+                }
+            }
+            if (unaffected) {
+                out = tile;
+                continue;
+            }
+
+            // Gather the tile plus a radius-wide apron, clamping at the image edge
+            IntRect tr = TileRect(tx, ty);
+            const int srcW = tr.Width() + 2 * radius;
+            const int srcH = tr.Height() + 2 * radius;
+            const int rx0 = tr.left - radius;
+            const int readX0 = std::max(rx0, 0);
+            const int readX1 = std::min(tr.right + radius, m_width);
+            for (int row = 0; row < srcH; row++) {
+                int y = std::min(std::max(tr.top - radius + row, 0), m_height - 1);
+                uint8_t* dst = source + static_cast<size_t>(row) * srcW;
+                ReadRow(y, readX0, readX1, dst + (readX0 - rx0));
+                std::memset(dst, dst[readX0 - rx0], readX0 - rx0);
+                int tail = srcW - (readX1 - rx0);
+                std::memset(dst + (readX1 - rx0), dst[readX1 - rx0 - 1], tail);
+            }
+
+            // Separable box blur: horizontal into the apron rows, then vertical
+            for (int row = 0; row < srcH; row++) {
+                const uint8_t* in = source + static_cast<size_t>(row) * srcW;
+                uint8_t* dst = horizontal + static_cast<size_t>(row) * tr.Width();
+                int sum = 0;
+                for (int i = 0; i < window; i++) {
+                    sum += in[i];
+                }
+                for (int x = 0; x < tr.Width(); x++) {
+                    dst[x] = static_cast<uint8_t>((sum + window / 2) / window);
+                    if (x + 1 < tr.Width()) {
+                        sum += in[x + window] - in[x];
+                    }
+                }
+            }
+
+            auto coverage = std::make_shared<std::vector<uint8_t>>(T * T, 0);
+            for (int x = 0; x < tr.Width(); x++) {
+                int sum = 0;
+                for (int i = 0; i < window; i++) {
+                    sum += horizontal[static_cast<size_t>(i) * tr.Width() + x];
+                }
+                for (int y = 0; y < tr.Height(); y++) {
+                    (*coverage)[y * T + x] = static_cast<uint8_t>((sum + window / 2) / window);
+                    if (y + 1 < tr.Height()) {
+                        sum += horizontal[static_cast<size_t>(y + window) * tr.Width() + x] -
+                               horizontal[static_cast<size_t>(y) * tr.Width() + x];
+                    }
+                }
+            }
+            out.kind = TileKind::Partial;
+            out.coverage = coverage;
+            NormalizeTile(out, tr);
+        }
+    }
+
+    m_tiles.swap(feathered);
+    return true;
+}
+
+bool ApplySelection(PixelBuffer& dst, const PixelBuffer& src, const Selection& selection) {
+    if (dst.Width() != src.Width() || dst.Height() != src.Height() ||
+        dst.Width() != selection.Width() || dst.Height() != selection.Height()) {
+        #ifdef DEBUG
+        printf("ERROR: ApplySelection size mismatch\n");
+        #endif
+        return false;
+    }
+
+    selection.ForEachTile([&](const SelectionTileView& tile) {
+        const IntRect& r = tile.rect;
+        if (tile.kind == TileKind::Empty) {
+            return;
+        }
+        for (int y = r.top; y < r.bottom; y++) {
+            uint32_t* out = dst.Row(y) + r.left;
+            const uint32_t* in = src.Row(y) + r.left;
+            if (tile.kind == TileKind::Full) {
+                std::memcpy(out, in, r.Width() * sizeof(uint32_t));
+                continue;
+            }
+            const uint8_t* coverage = tile.coverage + (y - r.top) * tile.pitch;
+            for (int x = 0; x < r.Width(); x++) {
+                uint8_t c = coverage[x];
+                if (c == 255) {
+                    out[x] = in[x];
+                } else if (c != 0) {
+                    out[x] = LerpPixel(out[x], in[x], c);
+                }
+            }
+        }
+    });
+    return true;
+}
+
+bool FillSelection(PixelBuffer& dst, const Selection& selection, uint32_t color) {
+    if (dst.Width() != selection.Width() || dst.Height() != selection.Height()) {
+        #ifdef DEBUG
+        printf("ERROR: FillSelection size mismatch\n");
+        #endif
+        return false;
+    }
+
+    if (selection.IsHardEdged()) {
+        const RunMask& runs = selection.Runs();
+        for (int y = 0; y < runs.Height(); y++) {
+            uint32_t* out = dst.Row(y);
+            for (const Span& s : runs.Row(y)) {
+                std::fill(out + s.x0, out + s.x1, color);
+            }
+        }
+        return true;
+    }
+
+    selection.ForEachTile([&](const SelectionTileView& tile) {
+        const IntRect& r = tile.rect;
+        if (tile.kind == TileKind::Empty) {
+            return;
+        }
+        for (int y = r.top; y < r.bottom; y++) {
+            uint32_t* out = dst.Row(y) + r.left;
+            if (tile.kind == TileKind::Full) {
+                std::fill(out, out + r.Width(), color);
+                continue;
+            }
+            const uint8_t* coverage = tile.coverage + (y - r.top) * tile.pitch;
+            for (int x = 0; x < r.Width(); x++) {
+                uint8_t c = coverage[x];
+                if (c == 255) {
+                    out[x] = color;
+                } else if (c != 0) {
+                    out[x] = LerpPixel(out[x], color, c);
+                }
+            }
+        }
+    });
+    return true;
+}
+
+} // namespace PixelForge
\ No newline at end of file
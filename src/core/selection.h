@@ -0,0 +1,171 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "geometry.h"
+#include "pixel_buffer.h"
+
+namespace PixelForge {
+
+// Half-open horizontal run [x0, x1) of fully selected pixels
+struct Span {
+    int x0;
+    int x1;
+};
+
+// Hard-edged mask stored as sorted, non-overlapping runs per row
+class RunMask {
+public:
+    RunMask() = default;
+    RunMask(int width, int height);
+
+    int Width() const { return m_width; }
+    int Height() const { return m_height; }
+
+    std::vector<Span>& Row(int y) { return m_rows[y]; }
+    const std::vector<Span>& Row(int y) const { return m_rows[y]; }
+
+    bool Contains(int x, int y) const;
+    bool IsEmpty() const;
+    IntRect Bounds() const;
+    size_t MemoryUsage() const;
+
+    // Combining masks of different sizes fails and leaves this one unchanged
+    bool Union(const RunMask& other);
+    bool Intersect(const RunMask& other);
+    bool Subtract(const RunMask& other);
+    void Invert();
+
+private:
+    int m_width = 0;
+    int m_height = 0;
+    std::vector<std::vector<Span>> m_rows;
+};
+
+enum class TileKind : uint8_t {
+    Empty,      // No pixel selected - kernels skip the tile
+    Full,       // Every pixel selected - kernels take the unmasked path
+    Partial     // 8-bit coverage per pixel
+};
+
+enum class SelectionOp {
+    Replace,
+    Add,
+    Subtract,
+    Intersect
+};
+
+// Read-only view of one selection tile handed to kernels
+struct SelectionTileView {
+    IntRect rect;               // Document pixels covered by the tile
+    TileKind kind;
+    const uint8_t* coverage;    // Only set for Partial tiles
+    int pitch;                  // Bytes between coverage rows
+};
+
+// Selection mask for a document. Hard-edged shapes (rectangles, non
+// anti-aliased ellipses, lassos) are kept as run-length rows and combined
+// exactly; anything soft (anti-aliased, feathered) lives in a sparse grid of
+// empty / full / 8-bit coverage tiles. Neither form is ever expanded into a
+// full-resolution bitmap.
+class Selection {
+public:
+    static constexpr int TILE_SIZE = 64;
+
+    Selection() = default;
+    Selection(int width, int height);   // Nothing selected
+
+    static Selection All(int width, int height);
+    static Selection Rectangle(int width, int height, const IntRect& rect);
+    static Selection Ellipse(int width, int height, const IntRect& rect, bool antiAlias);
+    static Selection Polygon(int width, int height, const std::vector<PointF>& points);
+    static Selection FromRuns(RunMask runs);
+
+    int Width() const { return m_width; }
+    int Height() const { return m_height; }
+    int TilesX() const { return (m_width + TILE_SIZE - 1) / TILE_SIZE; }
+    int TilesY() const { return (m_height + TILE_SIZE - 1) / TILE_SIZE; }
+
+    bool IsHardEdged() const { return m_isRuns; }
+    const RunMask& Runs() const { return m_runs; }   // Valid while hard-edged
+    bool IsEmpty() const;
+    IntRect Bounds() const;
+    uint8_t CoverageAt(int x, int y) const;
+    size_t MemoryUsage() const;
+
+    // These fail without changing the selection when the sizes differ or
+    // scratch memory runs out
+    bool Combine(const Selection& other, SelectionOp op);
+    bool Union(const Selection& other);
+    bool Intersect(const Selection& other);
+    bool Subtract(const Selection& other);
+    void Invert();
+    bool Feather(int radius);
+
+    // Converts run rows into tiles; no-op for tiled selections
+    void ConvertToTiles();
+
+    // Visits every tile in row-major order, including empty ones, so callers
+    // can branch on the tile kind. Run-based selections are read straight
+    // from the runs; a partial tile's coverage is only valid during its call.
+    template <typename Fn>
+    void ForEachTile(Fn&& fn) const {
+        if (m_isRuns) {
+            std::vector<int> counts(TilesX());
+            std::vector<uint8_t> scratch(TILE_SIZE * TILE_SIZE);
+            for (int ty = 0; ty < TilesY(); ty++) {
+                CountRunTiles(m_runs, ty, counts);
+                for (int tx = 0; tx < TilesX(); tx++) {
+                    fn(GetRunTileView(tx, ty, counts[tx], scratch.data()));
+                }
+            }
+            return;
+        }
+        for (int ty = 0; ty < TilesY(); ty++) {
+            for (int tx = 0; tx < TilesX(); tx++) {
+                fn(GetTileView(tx, ty));
+            }
+        }
+    }
+
+    SelectionTileView GetTileView(int tx, int ty) const;
+
+private:
+    struct Tile {
+        TileKind kind = TileKind::Empty;
+        std::shared_ptr<std::vector<uint8_t>> coverage;  // Shared until written
+    };
+
+    IntRect TileRect(int tx, int ty) const;
+    Tile& TileAt(int tx, int ty) { return m_tiles[static_cast<size_t>(ty) * TilesX() + tx]; }
+    const Tile& TileAt(int tx, int ty) const { return m_tiles[static_cast<size_t>(ty) * TilesX() + tx]; }
+    void ReadRow(int y, int x0, int x1, uint8_t* out) const;
+    void NormalizeTile(Tile& tile, const IntRect& rect) const;
+
+    // Covered pixels of every tile in tile row ty of a run mask
+    void CountRunTiles(const RunMask& runs, int ty, std::vector<int>& counts) const;
+    // Classifies a run tile; partial coverage is written to scratch
+    SelectionTileView GetRunTileView(int tx, int ty, int covered, uint8_t* scratch) const;
+
+    void InitTiles(TileKind kind);
+
+    template <typename Op>
+    void CombineTiles(const Selection& other, Op op);
+
+    int m_width = 0;
+    int m_height = 0;
+    bool m_isRuns = true;
+    RunMask m_runs;
+    std::vector<Tile> m_tiles;
+};
+
+// Writes src into dst through the selection: unselected tiles are skipped,
+// fully selected tiles are copied, partial tiles are blended by coverage.
+// Fails when the sizes differ.
+bool ApplySelection(PixelBuffer& dst, const PixelBuffer& src, const Selection& selection);
+
+// Paints a solid color through the selection with the same tile fast paths
+bool FillSelection(PixelBuffer& dst, const Selection& selection, uint32_t color);
+
+} // namespace PixelForge
\ No newline at end of file
@@ -0,0 +1,8 @@
+#pragma once
+
+// SSE2 is baseline on every x64 target and on x86 builds that opt in
+// (-msse2, /arch:SSE2). Kernels keep a scalar path for everything else.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PIXELFORGE_SSE2 1
+#include <emmintrin.h>
+#endif
\ No newline at end of file
@@ -0,0 +1,355 @@
+#include "thumbnail_cache.h"
+#include <algorithm>
+#include <cstring>
+#include <cwctype>
+#include <vector>
+#ifdef DEBUG
+#include <stdio.h>
+#endif
+
+namespace PixelForge {
+
+namespace {
+
+const uint32_t PACK_MAGIC = 0x43544650;    // "PFTC"
+const uint32_t PACK_VERSION = 1;
+const uint32_t SLOT_COUNT = 16384;          // Power of two
+const uint64_t INITIAL_DATA_BYTES = 4 * 1024 * 1024;
+const uint64_t COMPACT_STEP_BYTES = 1024 * 1024;   // Data moved per lock while compacting
+
+inline uint64_t MixHash(uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBull;
+    h ^= h >> 31;
+    return h;
+}
+
+} // namespace
+
+ThumbnailCache::ThumbnailCache(size_t maxBytes)
+    : m_maxBytes(maxBytes) {
+}
+
+ThumbnailCache::~ThumbnailCache() {
+    Close();
+}
+
+uint64_t ThumbnailCache::MakeKey(const std::wstring& path, uint64_t size, uint64_t modifiedTime) {
+    size_t slash = path.find_last_of(L"\\/");
+    size_t start = slash == std::wstring::npos ? 0 : slash + 1;
+
+    // FNV-1a over the case-folded name, then the size and time
+    uint64_t h = 0xCBF29CE484222325ull;
+    for (size_t i = start; i < path.size(); i++) {
+        h = (h ^ static_cast<uint64_t>(std::towlower(path[i]))) * 0x100000001B3ull;
+    }
+    h = MixHash(h ^ size);
+    h = MixHash(h ^ modifiedTime);
+    return h ? h : 1;
+}
+
+ThumbnailCache::PackHeader* ThumbnailCache::Header() {
+    return reinterpret_cast<PackHeader*>(m_file.Data());
+}
+
+ThumbnailCache::PackSlot* ThumbnailCache::Slots() {
+    return reinterpret_cast<PackSlot*>(m_file.Data() + sizeof(PackHeader));
+}
+
+bool ThumbnailCache::Open(const std::wstring& path) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_file.Close();
+    m_compactCursor = 0;
+
+    const uint64_t dataStart = sizeof(PackHeader) + static_cast<uint64_t>(SLOT_COUNT) * sizeof(PackSlot);
+    if (!m_file.Open(path, static_cast<size_t>(dataStart + std::min<uint64_t>(INITIAL_DATA_BYTES, m_maxBytes)))) {
+        #ifdef DEBUG
+        printf("ThumbnailCache: pack unavailable, caching in memory\n");
+        #endif
+        return false;
+    }
+
+    if (!Validate()) {
+        #ifdef DEBUG
+        printf("ThumbnailCache: pack missing or damaged, starting empty\n");
+        #endif
+        Reset();
+    }
+    return true;
+}
+
+void ThumbnailCache::Close() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_file.Flush();
+    m_file.Close();
+    m_compactCursor = 0;
+}
+
+bool ThumbnailCache::Validate() {
+    const PackHeader* header = Header();
+    const uint64_t dataStart = sizeof(PackHeader) + static_cast<uint64_t>(SLOT_COUNT) * sizeof(PackSlot);
+    if (header->magic != PACK_MAGIC || header->version != PACK_VERSION || header->slotCount != SLOT_COUNT ||
+        header->dataStart != dataStart || header->dataEnd < dataStart || header->dataEnd > m_file.Size()) {
+        return false;
+    }
+
+    uint32_t entries = 0;
+    uint64_t live = 0;
+    const PackSlot* slots = Slots();
+    for (uint32_t i = 0; i < SLOT_COUNT; i++) {
+        const PackSlot& slot = slots[i];
+        if (slot.key == 0) {
+            continue;
+        }
+        if (slot.offset < dataStart || slot.offset > header->dataEnd || slot.bytes > header->dataEnd - slot.offset ||
+            slot.width == 0 || slot.height == 0 || slot.bytes != static_cast<uint64_t>(slot.width) * slot.height * 4) {
+            return false;
+        }
+        entries++;
+        live += slot.bytes;
+    }
+    return entries == header->entryCount && live == header->liveBytes;
+}
+
+void ThumbnailCache::Reset() {
+    const uint64_t dataStart = sizeof(PackHeader) + static_cast<uint64_t>(SLOT_COUNT) * sizeof(PackSlot);
+    std::memset(m_file.Data(), 0, static_cast<size_t>(dataStart));
+    PackHeader* header = Header();
+    header->magic = PACK_MAGIC;
+    header->version = PACK_VERSION;
+    header->slotCount = SLOT_COUNT;
+    header->dataStart = dataStart;
+    header->dataEnd = dataStart;
+}
+
+ThumbnailCache::PackSlot* ThumbnailCache::FindSlot(uint64_t key) {
+    PackSlot* slots = Slots();
+    for (uint32_t i = static_cast<uint32_t>(key) & (SLOT_COUNT - 1);; i = (i + 1) & (SLOT_COUNT - 1)) {
+        if (slots[i].key == key) {
+            return &slots[i];
+        }
+        if (slots[i].key == 0) {
+            return nullptr;
+        }
+    }
+}
+
+ThumbnailCache::PackSlot* ThumbnailCache::FreeSlot(uint64_t key) {
+    // The index is kept at most three quarters full, so this terminates
+    PackSlot* slots = Slots();
+    for (uint32_t i = static_cast<uint32_t>(key) & (SLOT_COUNT - 1);; i = (i + 1) & (SLOT_COUNT - 1)) {
+        if (slots[i].key == 0) {
+            return &slots[i];
+        }
+    }
+}
+
+void ThumbnailCache::EraseSlot(uint32_t index) {
+    // Backward-shift deletion keeps every probe chain unbroken
+    PackSlot* slots = Slots();
+    const uint32_t mask = SLOT_COUNT - 1;
+    slots[index].key = 0;
+    for (uint32_t next = (index + 1) & mask; slots[next].key != 0; next = (next + 1) & mask) {
+        uint32_t home = static_cast<uint32_t>(slots[next].key) & mask;
+        bool stays = index <= next ? (home > index && home <= next) : (home > index || home <= next);
+        if (!stays) {
+            slots[index] = slots[next];
+            slots[next].key = 0;
+            index = next;
+        }
+    }
+}
+
+bool ThumbnailCache::Contains(uint64_t key) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file.IsOpen()) {
+        return m_memory.count(key) != 0;
+    }
+    return FindSlot(key) != nullptr;
+}
+
+bool ThumbnailCache::Lookup(uint64_t key, PixelBuffer& thumbnail) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file.IsOpen()) {
+        auto it = m_memory.find(key);
+        if (it == m_memory.end()) {
+            m_stats.misses++;
+            return false;
+        }
+        thumbnail = it->second;
+        m_stats.hits++;
+        return true;
+    }
+
+    PackSlot* slot = FindSlot(key);
+    if (!slot) {
+        m_stats.misses++;
+        return false;
+    }
+    thumbnail.Resize(slot->width, slot->height);
+    std::memcpy(thumbnail.Data(), m_file.Data() + slot->offset, slot->bytes);
+    slot->lastUse = ++Header()->useClock;
+    m_stats.hits++;
+    return true;
+}
+
+bool ThumbnailCache::Reserve(uint64_t bytes) {
+    if (bytes <= m_file.Size()) {
+        return true;
+    }
+    // Grow geometrically, but never past what maxBytes can need
+    const uint64_t limit = Header()->dataStart + m_maxBytes;
+    uint64_t size = std::max<uint64_t>(bytes, std::min<uint64_t>(m_file.Size() * 2, limit));
+    return m_file.Resize(static_cast<size_t>(size));
+}
+
+void ThumbnailCache::Evict(uint64_t incomingBytes) {
+    PackHeader* header = Header();
+    PackSlot* slots = Slots();
+
+    std::vector<PackSlot> live;
+    for (uint32_t i = 0; i < SLOT_COUNT; i++) {
+        if (slots[i].key != 0) {
+            live.push_back(slots[i]);
+        }
+    }
+
+    // Drop least recently used entries down to three quarters of the budget
+    std::sort(live.begin(), live.end(), [](const PackSlot& a, const PackSlot& b) {
+        return a.lastUse < b.lastUse;
+    });
+    const uint64_t targetBytes = m_maxBytes / 4 * 3;
+    size_t first = 0;
+    while (first < live.size() &&
+           (header->liveBytes + incomingBytes > targetBytes || live.size() - first > SLOT_COUNT / 2)) {
+        header->liveBytes -= live[first].bytes;
+        header->entryCount--;
+        EraseSlot(static_cast<uint32_t>(FindSlot(live[first].key) - slots));
+        first++;
+    }
+    m_stats.evictions += static_cast<int>(first);
+
+    // The freed space is reclaimed by CompactStep
+    m_compactCursor = header->dataStart;
+
+    #ifdef DEBUG
+    printf("ThumbnailCache: evicted %d, %u entries remain\n", (int)first, header->entryCount);
+    #endif
+}
+
+void ThumbnailCache::CompactStep() {
+    PackHeader* header = Header();
+    PackSlot* slots = Slots();
+
+    // Everything below the cursor is already packed; slide the entries
+    // above it down in file order
+    std::vector<PackSlot*> pending;
+    for (uint32_t i = 0; i < SLOT_COUNT; i++) {
+        if (slots[i].key != 0 && slots[i].offset >= m_compactCursor) {
+            pending.push_back(&slots[i]);
+        }
+    }
+    std::sort(pending.begin(), pending.end(), [](const PackSlot* a, const PackSlot* b) {
+        return a->offset < b->offset;
+    });
+
+    uint64_t moved = 0;
+    for (PackSlot* slot : pending) {
+        if (moved >= COMPACT_STEP_BYTES) {
+            return;
+        }
+        if (slot->offset != m_compactCursor) {
+            std::memmove(m_file.Data() + m_compactCursor, m_file.Data() + slot->offset, slot->bytes);
+            slot->offset = m_compactCursor;
+            moved += slot->bytes;
+        }
+        m_compactCursor += slot->bytes;
+    }
+    header->dataEnd = m_compactCursor;
+    m_compactCursor = 0;
+}
+
+bool ThumbnailCache::Insert(uint64_t key, const PixelBuffer& thumbnail) {
+    const uint64_t bytes = static_cast<uint64_t>(thumbnail.Width()) * thumbnail.Height() * 4;
+    if (key == 0 || bytes == 0 || thumbnail.Width() > 0xFFFF || thumbnail.Height() > 0xFFFF ||
+        bytes > m_maxBytes / 4) {
+        return false;
+    }
+
+    // The lock is released between compaction steps so lookups can run
+    for (;;) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_file.IsOpen()) {
+            if (m_memoryBytes + bytes > m_maxBytes) {
+                m_stats.evictions += static_cast<int>(m_memory.size());
+                m_memory.clear();
+                m_memoryBytes = 0;
+            }
+            auto it = m_memory.find(key);
+            if (it != m_memory.end()) {
+                m_memoryBytes -= static_cast<size_t>(it->second.Width()) * it->second.Height() * 4;
+            }
+            m_memory[key] = thumbnail;
+            m_memoryBytes += static_cast<size_t>(bytes);
+            return true;
+        }
+
+        // A replaced entry's old pixels become garbage until the next compaction
+        if (PackSlot* existing = FindSlot(key)) {
+            Header()->liveBytes -= existing->bytes;
+            Header()->entryCount--;
+            EraseSlot(static_cast<uint32_t>(existing - Slots()));
+        }
+
+        if (m_compactCursor != 0) {
+            CompactStep();
+            continue;
+        }
+        PackHeader* header = Header();
+        if (header->dataEnd + bytes > header->dataStart + m_maxBytes || header->entryCount + 1 > SLOT_COUNT / 4 * 3) {
+            Evict(bytes);
+            continue;
+        }
+        if (!Reserve(header->dataEnd + bytes)) {
+            return false;
+        }
+
+        // Pixels and the append position go first, so an interrupted insert
+        // only leaves unreferenced bytes behind
+        header = Header();
+        uint64_t offset = header->dataEnd;
+        std::memcpy(m_file.Data() + offset, thumbnail.Data(), static_cast<size_t>(bytes));
+        header->dataEnd = offset + bytes;
+
+        PackSlot slot = {};
+        slot.offset = offset;
+        slot.bytes = static_cast<uint32_t>(bytes);
+        slot.width = static_cast<uint16_t>(thumbnail.Width());
+        slot.height = static_cast<uint16_t>(thumbnail.Height());
+        slot.lastUse = ++header->useClock;
+        slot.key = key;
+        *FreeSlot(key) = slot;
+        header->entryCount++;
+        header->liveBytes += bytes;
+        return true;
+    }
+}
+
+ThumbnailCacheStats ThumbnailCache::Stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ThumbnailCacheStats stats = m_stats;
+    if (m_file.IsOpen()) {
+        const PackHeader* header = reinterpret_cast<const PackHeader*>(m_file.Data());
+        stats.entries = static_cast<int>(header->entryCount);
+        stats.dataBytes = static_cast<size_t>(header->liveBytes);
+        stats.fileBytes = m_file.Size();
+    } else {
+        stats.entries = static_cast<int>(m_memory.size());
+        stats.dataBytes = m_memoryBytes;
+    }
+    return stats;
+}
+
+} // namespace PixelForge
\ No newline at end of file
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "pixel_buffer.h"
+#include "../utils/mapped_file.h"
+
+namespace PixelForge {
+
+struct ThumbnailCacheStats {
+    int entries = 0;
+    size_t dataBytes = 0;       // Live thumbnail pixels
+    size_t fileBytes = 0;
+    int hits = 0;
+    int misses = 0;
+    int evictions = 0;
+};
+
+// Persistent thumbnail store in a single memory-mapped pack file: a header,
+// a fixed open-addressed index of 64-bit keys, then the thumbnails' pixels
+// appended one after another. Lookups probe the index in place and copy the
+// pixels out of the mapping, so no file is opened per thumbnail. When the
+// data would exceed maxBytes (or the index gets crowded) the least recently
+// used entries are dropped and the survivors compacted. Compaction moves a
+// bounded amount of data per lock, so lookups wait for one step rather than
+// the whole pack. If the pack cannot be opened, e.g. when another instance
+// holds it, thumbnails are kept in memory for the session instead.
+class ThumbnailCache {
+public:
+    explicit ThumbnailCache(size_t maxBytes = 256 * 1024 * 1024);
+    ~ThumbnailCache();
+
+    bool Open(const std::wstring& path);
+    void Close();
+
+    bool Contains(uint64_t key);
+    bool Lookup(uint64_t key, PixelBuffer& thumbnail);
+    bool Insert(uint64_t key, const PixelBuffer& thumbnail);
+
+    ThumbnailCacheStats Stats() const;
+
+    // Key for a file from what a directory listing already provides: the
+    // name (without folder, so moved folders still hit), size and write time.
+    // The content is not read, so an edit that keeps both the size and the
+    // write time still finds the old thumbnail.
+    static uint64_t MakeKey(const std::wstring& path, uint64_t size, uint64_t modifiedTime);
+
+private:
+    struct PackHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t slotCount;
+        uint32_t entryCount;
+        uint64_t dataStart;
+        uint64_t dataEnd;       // Append position
+        uint64_t liveBytes;
+        uint32_t useClock;
+        uint32_t reserved[5];
+    };
+
+    struct PackSlot {
+        uint64_t key;           // 0 when empty
+        uint64_t offset;
+        uint32_t bytes;
+        uint16_t width;
+        uint16_t height;
+        uint32_t lastUse;
+        uint32_t reserved;
+    };
+
+    PackHeader* Header();
+    PackSlot* Slots();
+    PackSlot* FindSlot(uint64_t key);
+    PackSlot* FreeSlot(uint64_t key);
+    void EraseSlot(uint32_t index);
+    bool Validate();
+    void Reset();
+    bool Reserve(uint64_t bytes);
+    void Evict(uint64_t incomingBytes);
+    void CompactStep();
+
+    const size_t m_maxBytes;
+    mutable std::mutex m_mutex;
+    MappedFile m_file;
+    uint64_t m_compactCursor = 0;       // End of the compacted data, 0 when not compacting
+    std::unordered_map<uint64_t, PixelBuffer> m_memory;     // Used when the pack is unavailable
+    size_t m_memoryBytes = 0;
+    ThumbnailCacheStats m_stats;
+};
+
+} // namespace PixelForge
\ No newline at end of file
@@ -0,0 +1,179 @@
+#include "thumbnail_generator.h"
+#include "jpeg_decoder.h"
+#include "parallel.h"
+#include "../utils/file_utils.h"
+#include <algorithm>
+#include <cmath>
+#ifdef DEBUG
+#include <stdio.h>
+#endif
+
+namespace PixelForge {
+
+namespace {
+
+// Box filter down to fit maxSize x maxSize. Colour is weighted by alpha so
+// transparent pixels do not darken edges.
+void ShrinkToFit(const PixelBuffer& src, int maxSize, PixelBuffer& dst) {
+    const int srcWidth = src.Width();
+    const int srcHeight = src.Height();
+    double scale = std::min({ 1.0, (double)maxSize / srcWidth, (double)maxSize / srcHeight });
+    const int width = std::max(1, static_cast<int>(std::lround(srcWidth * scale)));
+    const int height = std::max(1, static_cast<int>(std::lround(srcHeight * scale)));
+    if (width == srcWidth && height == srcHeight) {
+        dst = src;
+        return;
+    }
+
+    dst.Resize(width, height);
+    for (int y = 0; y < height; y++) {
+        int y0 = y * srcHeight / height;
+        int y1 = std::max(y0 + 1, (y + 1) * srcHeight / height);
+        uint32_t* out = dst.Row(y);
+        for (int x = 0; x < width; x++) {
+            int x0 = x * srcWidth / width;
+            int x1 = std::max(x0 + 1, (x + 1) * srcWidth / width);
+            uint64_t a = 0, r = 0, g = 0, b = 0;
+            for (int sy = y0; sy < y1; sy++) {
+                const uint32_t* row = src.Row(sy);
+                for (int sx = x0; sx < x1; sx++) {
+                    uint32_t p = row[sx];
+                    uint32_t alpha = p >> 24;
+                    a += alpha;
+                    r += ((p >> 16) & 0xFF) * alpha;
+                    g += ((p >> 8) & 0xFF) * alpha;
+                    b += (p & 0xFF) * alpha;
+                }
+            }
+            uint64_t count = static_cast<uint64_t>(y1 - y0) * (x1 - x0);
+            out[x] = a == 0 ? 0 : MakeColor(static_cast<uint8_t>((r + a / 2) / a), static_cast<uint8_t>((g + a / 2) / a),
+                                            static_cast<uint8_t>((b + a / 2) / a), static_cast<uint8_t>((a + count / 2) / count));
+        }
+    }
+}
+
+} // namespace
+
+ThumbnailGenerator::ThumbnailGenerator(ThumbnailCache& cache, ImageLoader fallback, int thumbnailSize, int workerCount)
+    : m_cache(cache)
+    , m_fallback(std::move(fallback))
+    , m_thumbnailSize(thumbnailSize) {
+    int count = workerCount > 0 ? workerCount : WorkerCount();
+    for (int i = 0; i < count; i++) {
+        m_workers.emplace_back(&ThumbnailGenerator::WorkerLoop, this);
+    }
+}
+
+ThumbnailGenerator::~ThumbnailGenerator() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopRequested = true;
+        if (m_batch) {
+            m_batch->cancelled = true;
+        }
+        m_queue.clear();
+    }
+    m_workAvailable.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+bool ThumbnailGenerator::CreateThumbnail(const std::wstring& path, int size, const ImageLoader& fallback,
+                                         const std::atomic<bool>& cancel, PixelBuffer& thumbnail) {
+    std::vector<uint8_t> data;
+    if (!ReadFileBytes(path, data) || cancel) {
+        return false;
+    }
+
+    PixelBuffer decoded;
+    bool ok = false;
+    if (JpegDecoder::HasSignature(data.data(), data.size())) {
+        JpegDecoder decoder(data.data(), data.size());
+        // The workers already keep every core busy
+        decoder.SetThreadCount(1);
+        if (decoder.ReadHeader()) {
+            // Smallest DCT scale that still covers the thumbnail
+            int width = decoder.Width();
+            int height = decoder.Height();
+            double scale = std::min({ 1.0, (double)size / width, (double)size / height });
+            int denominator = JpegDecoder::ScaleForTarget(width, height,
+                static_cast<int>(std::ceil(width * scale)), static_cast<int>(std::ceil(height * scale)));
+            ok = decoder.Decode(denominator, decoded);
+        }
+    }
+
+    // Other formats, and JPEGs the decoder does not handle (e.g. progressive)
+    if (!ok && fallback) {
+        PrefetchedImage image;
+        ok = fallback(path, size, size, cancel, image);
+        decoded = std::move(image.pixels);
+    }
+    if (!ok || cancel || decoded.IsEmpty()) {
+        return false;
+    }
+
+    ShrinkToFit(decoded, size, thumbnail);
+    return true;
+}
+
+void ThumbnailGenerator::Generate(const std::vector<ThumbnailSource>& sources, ReadyCallback onReady) {
+    auto batch = std::make_shared<Batch>();
+    batch->onReady = std::move(onReady);
+
+    std::vector<Job> jobs;
+    for (int i = 0; i < static_cast<int>(sources.size()); i++) {
+        if (!m_cache.Contains(sources[i].key)) {
+            jobs.push_back({ i, sources[i], batch });
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_batch) {
+            m_batch->cancelled = true;
+        }
+        m_batch = batch;
+        m_queue.assign(jobs.begin(), jobs.end());
+    }
+    m_workAvailable.notify_all();
+}
+
+void ThumbnailGenerator::Cancel() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_batch) {
+        m_batch->cancelled = true;
+        m_batch.reset();
+    }
+    m_queue.clear();
+}
+
+void ThumbnailGenerator::WorkerLoop() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_workAvailable.wait(lock, [this]() { return m_stopRequested || !m_queue.empty(); });
+            if (m_stopRequested) {
+                return;
+            }
+            job = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+
+        PixelBuffer thumbnail;
+        if (!CreateThumbnail(job.source.path, m_thumbnailSize, m_fallback, job.batch->cancelled, thumbnail)) {
+            #ifdef DEBUG
+            if (!job.batch->cancelled) {
+                printf("ThumbnailGenerator: could not read %ls\n", job.source.path.c_str());
+            }
+            #endif
+            continue;
+        }
+        if (m_cache.Insert(job.source.key, thumbnail) && !job.batch->cancelled && job.batch->onReady) {
+            job.batch->onReady(job.index);
+        }
+    }
+}
+
+} // namespace PixelForge
\ No newline at end of file
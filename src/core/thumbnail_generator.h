@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "image_prefetcher.h"
+#include "thumbnail_cache.h"
+
+namespace PixelForge {
+
+struct ThumbnailSource {
+    std::wstring path;
+    uint64_t key;
+};
+
+// Fills a ThumbnailCache on worker threads. JPEGs are decoded with DCT
+// scaling at the smallest size that still covers the thumbnail; other
+// formats go through the fallback loader.
+class ThumbnailGenerator {
+public:
+    using ReadyCallback = std::function<void(int index)>;
+
+    // workerCount 0 uses one worker per core
+    ThumbnailGenerator(ThumbnailCache& cache, ImageLoader fallback, int thumbnailSize = 160, int workerCount = 0);
+    ~ThumbnailGenerator();
+
+    // Queues the sources missing from the cache, in order, replacing any
+    // earlier request. onReady(index) runs on a worker thread once
+    // sources[index] has been added to the cache.
+    void Generate(const std::vector<ThumbnailSource>& sources, ReadyCallback onReady);
+    void Cancel();
+
+    int ThumbnailSize() const { return m_thumbnailSize; }
+
+    // Decodes path and shrinks it to fit within size x size
+    static bool CreateThumbnail(const std::wstring& path, int size, const ImageLoader& fallback,
+                                const std::atomic<bool>& cancel, PixelBuffer& thumbnail);
+
+private:
+    struct Batch {
+        std::atomic<bool> cancelled{ false };
+        ReadyCallback onReady;
+    };
+
+    struct Job {
+        int index;
+        ThumbnailSource source;
+        std::shared_ptr<Batch> batch;
+    };
+
+    void WorkerLoop();
+
+    ThumbnailCache& m_cache;
+    ImageLoader m_fallback;
+    const int m_thumbnailSize;
+
+    std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::deque<Job> m_queue;
+    std::shared_ptr<Batch> m_batch;
+    std::vector<std::thread> m_workers;
+    bool m_stopRequested = false;
+};
+
+} // namespace PixelForge
\ No newline at end of file
@@ -0,0 +1,380 @@
+#include "tile_store.h"
+#include "lz4.h"
+#include <cstring>
+#include <iterator>
+#ifdef DEBUG
+#include <stdio.h>
+#endif
+
+namespace PixelForge {
+
+namespace {
+
+const uint64_t SWAP_ALIGNMENT = 4096;
+const uint64_t MAX_QUEUED_WRITE_BYTES = 32 * 1024 * 1024;   // Trim waits beyond this
+const size_t AGE_SLACK = 1024;                               // Stale age entries tolerated
+
+inline uint64_t SwapLength(uint32_t size) {
+    return (static_cast<uint64_t>(size) + SWAP_ALIGNMENT - 1) & ~(SWAP_ALIGNMENT - 1);
+}
+
+} // namespace
+
+TileStore::TileStore(const std::wstring& swapPath)
+    : m_swapPath(swapPath) {
+}
+
+TileStore::~TileStore() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopRequested = true;
+        m_reads.clear();
+        m_writes.clear();
+    }
+    m_changed.notify_all();
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+}
+
+uint32_t TileStore::Put(const PixelBuffer& tile) {
+    // Compress outside the lock so several threads can pack at once
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(tile.Data());
+    const size_t rawBytes = static_cast<size_t>(tile.Width()) * tile.Height() * 4;
+    auto data = std::make_shared<std::vector<uint8_t>>();
+    Lz4Compress(bytes, rawBytes, *data);
+    const bool compressed = data->size() < rawBytes;
+    if (compressed) {
+        data->shrink_to_fit();
+    } else {
+        data->assign(bytes, bytes + rawBytes);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint32_t handle;
+    if (!m_freeHandles.empty()) {
+        handle = m_freeHandles.back();
+        m_freeHandles.pop_back();
+    } else {
+        handle = static_cast<uint32_t>(m_entries.size());
+        m_entries.emplace_back();
+    }
+    Entry& entry = m_entries[handle];
+    entry.live = true;
+    entry.compressed = compressed;
+    entry.rawBytes = static_cast<uint32_t>(rawBytes);
+    entry.storedBytes = static_cast<uint32_t>(data->size());
+    entry.data = std::move(data);
+
+    m_stats.tiles++;
+    m_stats.rawBytes += entry.rawBytes;
+    m_stats.memoryBytes += entry.storedBytes;
+
+    // Handles taken back before Trim reaches them leave stale age entries
+    if (m_age.size() > m_entries.size() + AGE_SLACK) {
+        std::deque<Job> current;
+        for (const Job& job : m_age) {
+            const Entry& aged = m_entries[job.handle];
+            if (aged.live && aged.generation == job.generation) {
+                current.push_back(job);
+            }
+        }
+        m_age.swap(current);
+    }
+    m_age.push_back({ handle, entry.generation });
+    return handle;
+}
+
+bool TileStore::Take(uint32_t handle, int width, int height, PixelBuffer& tile) {
+    std::shared_ptr<const std::vector<uint8_t>> data;
+    uint32_t rawBytes;
+    bool compressed;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (handle >= m_entries.size() || !m_entries[handle].live) {
+            return false;
+        }
+        m_changed.wait(lock, [this, handle]() { return !m_entries[handle].reading; });
+
+        Entry& entry = m_entries[handle];
+        if (entry.data) {
+            data = entry.data;
+            if (entry.prefetched) {
+                m_stats.readAheadHits++;
+            }
+        } else {
+            // Not read ahead, so read it here; the flag keeps the worker off it
+            entry.reading = true;
+            uint64_t offset = entry.swapOffset;
+            uint32_t size = entry.storedBytes;
+            lock.unlock();
+            auto buffer = std::make_shared<std::vector<uint8_t>>(size);
+            bool ok = m_swap.Read(offset, buffer->data(), size);
+            lock.lock();
+            m_entries[handle].reading = false;
+            m_changed.notify_all();
+            if (!ok) {
+                #ifdef DEBUG
+                printf("TileStore: could not read tile %u from the swap file\n", handle);
+                #endif
+                FreeEntry(handle);
+                return false;
+            }
+            m_stats.swapReads++;
+            data = std::move(buffer);
+        }
+        rawBytes = m_entries[handle].rawBytes;
+        compressed = m_entries[handle].compressed;
+        FreeEntry(handle);
+    }
+
+    if (static_cast<size_t>(width) * height * 4 != rawBytes) {
+        return false;
+    }
+    tile.Resize(width, height);
+    uint8_t* out = reinterpret_cast<uint8_t*>(tile.Data());
+    if (!compressed) {
+        std::memcpy(out, data->data(), rawBytes);
+        return true;
+    }
+    return Lz4Decompress(data->data(), data->size(), out, rawBytes);
+}
+
+void TileStore::Release(uint32_t handle) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (handle < m_entries.size() && m_entries[handle].live) {
+        FreeEntry(handle);
+    }
+}
+
+void TileStore::FreeEntry(uint32_t handle) {
+    Entry& entry = m_entries[handle];
+    if (entry.data) {
+        m_stats.memoryBytes -= entry.storedBytes;
+    } else if (entry.swapped) {
+        m_stats.swappedTiles--;
+    }
+    // A write in progress finds the generation changed and frees its space
+    if (entry.writing) {
+        m_queuedWriteBytes -= entry.storedBytes;
+    }
+    if (entry.swapped) {
+        FreeSwap(entry.swapOffset, entry.storedBytes);
+    }
+    m_stats.tiles--;
+    m_stats.rawBytes -= entry.rawBytes;
+
+    uint32_t generation = entry.generation + 1;
+    entry = Entry();
+    entry.generation = generation;
+    m_freeHandles.push_back(handle);
+}
+
+void TileStore::Prefetch(const std::vector<uint32_t>& handles) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_swap.IsOpen()) {
+        return;
+    }
+    size_t queued = m_reads.size();
+    for (uint32_t handle : handles) {
+        if (handle < m_entries.size()) {
+            const Entry& entry = m_entries[handle];
+            if (entry.live && entry.swapped && !entry.data && !entry.reading) {
+                m_reads.push_back({ handle, entry.generation });
+            }
+        }
+    }
+    if (m_reads.size() != queued) {
+        m_changed.notify_all();
+    }
+}
+
+void TileStore::Trim(uint64_t memoryLimit) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_stats.memoryBytes <= m_queuedWriteBytes + memoryLimit || !StartSwap()) {
+        return;
+    }
+
+    bool queued = false;
+    while (m_stats.memoryBytes > m_queuedWriteBytes + memoryLimit && !m_age.empty()) {
+        Job job = m_age.front();
+        m_age.pop_front();
+        Entry& entry = m_entries[job.handle];
+        if (!entry.live || entry.generation != job.generation || !entry.data || entry.writing) {
+            continue;
+        }
+        if (entry.swapped) {
+            // Read back earlier and still on disk, so just let go of it
+            entry.data.reset();
+            entry.prefetched = false;
+            m_stats.memoryBytes -= entry.storedBytes;
+            m_stats.swappedTiles++;
+            continue;
+        }
+        entry.writing = true;
+        m_queuedWriteBytes += entry.storedBytes;
+        m_writes.push_back(job);
+        queued = true;
+    }
+    if (queued) {
+        m_changed.notify_all();
+    }
+
+    m_changed.wait(lock, [this]() {
+        return m_queuedWriteBytes <= MAX_QUEUED_WRITE_BYTES || m_stopRequested || m_swapFailed;
+    });
+}
+
+bool TileStore::StartSwap() {
+    if (m_swap.IsOpen()) {
+        return true;
+    }
+    if (m_swapFailed || m_swapPath.empty()) {
+        return false;
+    }
+    if (!m_swap.Create(m_swapPath)) {
+        #ifdef DEBUG
+        printf("TileStore: no swap file, tiles stay compressed in memory\n");
+        #endif
+        m_swapFailed = true;
+        return false;
+    }
+    m_worker = std::thread(&TileStore::WorkerLoop, this);
+    return true;
+}
+
+void TileStore::WorkerLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_changed.wait(lock, [this]() { return m_stopRequested || !m_reads.empty() || !m_writes.empty(); });
+        if (m_stopRequested) {
+            return;
+        }
+
+        // Reads first: someone is about to need them
+        if (!m_reads.empty()) {
+            Job job = m_reads.front();
+            m_reads.pop_front();
+            Entry& entry = m_entries[job.handle];
+            if (!entry.live || entry.generation != job.generation || entry.data || entry.reading || !entry.swapped) {
+                continue;
+            }
+            entry.reading = true;
+            uint64_t offset = entry.swapOffset;
+            uint32_t size = entry.storedBytes;
+            lock.unlock();
+            auto data = std::make_shared<std::vector<uint8_t>>(size);
+            bool ok = m_swap.Read(offset, data->data(), size);
+            lock.lock();
+
+            // Released meanwhile: the data is no longer wanted
+            Entry& current = m_entries[job.handle];
+            if (current.live && current.generation == job.generation) {
+                current.reading = false;
+                if (ok) {
+                    current.data = std::move(data);
+                    current.prefetched = true;
+                    m_stats.memoryBytes += size;
+                    m_stats.swappedTiles--;
+                    m_stats.swapReads++;
+                    m_age.push_back(job);
+                }
+            }
+            m_changed.notify_all();
+            continue;
+        }
+
+        Job job = m_writes.front();
+        m_writes.pop_front();
+        Entry& entry = m_entries[job.handle];
+        if (!entry.live || entry.generation != job.generation || !entry.writing) {
+            continue;
+        }
+        std::shared_ptr<const std::vector<uint8_t>> data = entry.data;
+        uint32_t size = entry.storedBytes;
+        uint64_t offset = AllocateSwap(size);
+        lock.unlock();
+        bool ok = m_swap.Write(offset, data->data(), size);
+        lock.lock();
+
+        Entry& current = m_entries[job.handle];
+        if (!current.live || current.generation != job.generation) {
+            FreeSwap(offset, size);
+        } else {
+            current.writing = false;
+            m_queuedWriteBytes -= size;
+            if (ok) {
+                current.swapped = true;
+                current.swapOffset = offset;
+                current.data.reset();
+                m_stats.memoryBytes -= size;
+                m_stats.swappedTiles++;
+                m_stats.swapWrites++;
+            } else {
+                #ifdef DEBUG
+                printf("TileStore: swap write failed, keeping tiles in memory\n");
+                #endif
+                FreeSwap(offset, size);
+                m_swapFailed = true;
+            }
+        }
+        m_changed.notify_all();
+    }
+}
+
+uint64_t TileStore::AllocateSwap(uint32_t size) {
+    const uint64_t length = SwapLength(size);
+    for (auto it = m_freeSwap.begin(); it != m_freeSwap.end(); ++it) {
+        if (it->second >= length) {
+            uint64_t offset = it->first;
+            uint64_t remaining = it->second - length;
+            m_freeSwap.erase(it);
+            if (remaining > 0) {
+                m_freeSwap[offset + length] = remaining;
+            }
+            return offset;
+        }
+    }
+    uint64_t offset = m_swapEnd;
+    m_swapEnd += length;
+    m_stats.swapFileBytes = m_swapEnd;
+    return offset;
+}
+
+void TileStore::FreeSwap(uint64_t offset, uint32_t size) {
+    uint64_t length = SwapLength(size);
+
+    // Merge with the free neighbours on either side
+    auto next = m_freeSwap.lower_bound(offset);
+    if (next != m_freeSwap.end() && offset + length == next->first) {
+        length += next->second;
+        next = m_freeSwap.erase(next);
+    }
+    if (next != m_freeSwap.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset) {
+            offset = previous->first;
+            length += previous->second;
+            m_freeSwap.erase(previous);
+        }
+    }
+
+    if (offset + length == m_swapEnd) {
+        m_swapEnd = offset;
+        m_stats.swapFileBytes = m_swapEnd;
+    } else {
+        m_freeSwap[offset] = length;
+    }
+}
+
+uint64_t TileStore::MemoryBytes() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats.memoryBytes;
+}
+
+TileStoreStats TileStore::Stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+} // namespace PixelForge
\ No newline at end of file
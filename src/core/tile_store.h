@@ -0,0 +1,104 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "pixel_buffer.h"
+#include "../utils/scratch_file.h"
+
+namespace PixelForge {
+
+struct TileStoreStats {
+    int tiles = 0;                  // Held, in memory or swapped out
+    int swappedTiles = 0;           // Only in the swap file
+    uint64_t rawBytes = 0;          // Uncompressed size of the held tiles
+    uint64_t memoryBytes = 0;       // Compressed data held in memory
+    uint64_t swapFileBytes = 0;
+    uint64_t swapWrites = 0;
+    uint64_t swapReads = 0;         // Including read-ahead
+    uint64_t readAheadHits = 0;     // Takes served by an earlier Prefetch
+};
+
+// Home for tiles that are not in use. Tiles are LZ4-compressed (or kept
+// raw when that does not help) and held in memory. Trim spills the oldest
+// to a swap file from a background thread, keeping their data readable
+// until the write lands, and Prefetch reads swapped tiles back on the same
+// thread ahead of need. All methods are thread-safe.
+class TileStore {
+public:
+    // Without a swap path tiles are only compressed
+    explicit TileStore(const std::wstring& swapPath);
+    ~TileStore();
+
+    TileStore(const TileStore&) = delete;
+    TileStore& operator=(const TileStore&) = delete;
+
+    // Compresses tile and returns its handle
+    uint32_t Put(const PixelBuffer& tile);
+    // Restores a width x height tile and frees the handle
+    bool Take(uint32_t handle, int width, int height, PixelBuffer& tile);
+    void Release(uint32_t handle);
+
+    // Starts reading the swapped out ones among handles back into memory
+    void Prefetch(const std::vector<uint32_t>& handles);
+    // Queues the oldest tiles for the swap file until no more than
+    // memoryLimit bytes are left in memory. Waits only when too much is
+    // already queued.
+    void Trim(uint64_t memoryLimit);
+
+    uint64_t MemoryBytes() const;
+    TileStoreStats Stats() const;
+
+private:
+    struct Entry {
+        std::shared_ptr<const std::vector<uint8_t>> data;  // Null while only on disk
+        uint32_t generation = 0;    // Bumped when the handle is freed
+        uint32_t rawBytes = 0;
+        uint32_t storedBytes = 0;
+        uint64_t swapOffset = 0;
+        bool live = false;
+        bool compressed = false;
+        bool swapped = false;       // Has a copy in the swap file
+        bool writing = false;
+        bool reading = false;
+        bool prefetched = false;    // Read back by Prefetch and not taken yet
+    };
+
+    struct Job {
+        uint32_t handle;
+        uint32_t generation;
+    };
+
+    bool StartSwap();
+    void WorkerLoop();
+    void FreeEntry(uint32_t handle);
+    uint64_t AllocateSwap(uint32_t size);
+    void FreeSwap(uint64_t offset, uint32_t size);
+
+    const std::wstring m_swapPath;
+    ScratchFile m_swap;
+    bool m_swapFailed = false;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_changed;
+    std::vector<Entry> m_entries;
+    std::vector<uint32_t> m_freeHandles;
+    std::deque<Job> m_age;                      // Oldest stored first
+    std::deque<Job> m_reads;
+    std::deque<Job> m_writes;
+    uint64_t m_queuedWriteBytes = 0;
+    std::map<uint64_t, uint64_t> m_freeSwap;    // Offset to length
+    uint64_t m_swapEnd = 0;
+    TileStoreStats m_stats;
+
+    std::thread m_worker;
+    bool m_stopRequested = false;
+};
+
+} // namespace PixelForge
\ No newline at end of file
@@ -1,5 +1,8 @@
 #include "main_window.h"
 #include <commdlg.h>
+#include <algorithm>
+#include <atomic>
+#include <climits>
 #include <gdiplus.h>
 #ifdef DEBUG
 #include <stdio.h>
@@ -19,6 +22,157 @@ static const ResolutionPreset RESOLUTION_PRESETS[] = {
     { 1200, 1200, L"1200 × 1200 (Square)" }
 };
 
+// Extensions offered by the open dialog, used when listing a folder
+static const std::vector<std::wstring> IMAGE_EXTENSIONS = {
+    L".jpg", L".jpeg", L".png", L".bmp", L".gif"
+};
+
+// Baseline JPEGs are decoded natively at the smallest DCT scale that still
+// covers the display size, so a large photo never decodes in full just to
+// be shrunk. Returns false for anything the decoder does not handle.
+static bool LoadJpegImage(const std::wstring& path, int maxWidth, int maxHeight,
+                          const std::atomic<bool>& cancel, PrefetchedImage& image) {
+    std::wstring extension = GetFileExtension(path);
+    if (extension != L".jpg" && extension != L".jpeg") {
+        return false;
+    }
+    std::vector<uint8_t> data;
+    if (!ReadFileBytes(path, data) || cancel || !JpegDecoder::HasSignature(data.data(), data.size())) {
+        return false;
+    }
+    JpegDecoder decoder(data.data(), data.size());
+    if (!decoder.ReadHeader()) {
+        return false;
+    }
+
+    int sourceWidth = decoder.Width();
+    int sourceHeight = decoder.Height();
+    double scale = (std::min)({ 1.0, (double)maxWidth / sourceWidth, (double)maxHeight / sourceHeight });
+    int width = (std::max)(1, (int)(sourceWidth * scale + 0.5));
+    int height = (std::max)(1, (int)(sourceHeight * scale + 0.5));
+
+    PixelBuffer decoded;
+    int denominator = JpegDecoder::ScaleForTarget(sourceWidth, sourceHeight, width, height);
+    if (!decoder.Decode(denominator, decoded) || cancel) {
+        return false;
+    }
+
+    image.sourceWidth = sourceWidth;
+    image.sourceHeight = sourceHeight;
+    if (decoded.Width() == width && decoded.Height() == height) {
+        image.pixels = std::move(decoded);
+        return true;
+    }
+
+    // Finish the last step (less than 2x) with a bicubic resize
+    image.pixels.Resize(width, height);
+    Gdiplus::Bitmap source(decoded.Width(), decoded.Height(), decoded.Stride() * 4, PixelFormat32bppARGB,
+                           reinterpret_cast<BYTE*>(decoded.Data()));
+    Gdiplus::Bitmap target(width, height, width * 4, PixelFormat32bppARGB,
+                           reinterpret_cast<BYTE*>(image.pixels.Data()));
+    Gdiplus::Graphics graphics(&target);
+    graphics.SetInterpolationMode(Gdiplus::InterpolationModeHighQualityBicubic);
+    graphics.SetPixelOffsetMode(Gdiplus::PixelOffsetModeHalf);
+    Gdiplus::Status status = graphics.DrawImage(&source, Gdiplus::Rect(0, 0, width, height));
+    return status == Gdiplus::Ok && !cancel;
+}
+
+// Prefetch loader, run on a worker thread: decodes with GDI+ and scales
+// straight into a buffer that fits the display
+static bool LoadDisplayImage(const std::wstring& path, int maxWidth, int maxHeight,
+                             const std::atomic<bool>& cancel, PrefetchedImage& image) {
+    if (LoadJpegImage(path, maxWidth, maxHeight, cancel, image)) {
+        return true;
+    }
+    if (cancel) {
+        return false;
+    }
+
+    Gdiplus::Image source(path.c_str());
+    if (source.GetLastStatus() != Gdiplus::Ok || cancel) {
+        return false;
+    }
+    
+    int sourceWidth = (int)source.GetWidth();
+    int sourceHeight = (int)source.GetHeight();
+    if (sourceWidth <= 0 || sourceHeight <= 0) {
+        return false;
+    }
+    
+    // Never upscale; the canvas stretches the result as needed
+    double scale = (std::min)({ 1.0, (double)maxWidth / sourceWidth, (double)maxHeight / sourceHeight });
+    int width = (std::max)(1, (int)(sourceWidth * scale + 0.5));
+    int height = (std::max)(1, (int)(sourceHeight * scale + 0.5));
+    
+    image.sourceWidth = sourceWidth;
+    image.sourceHeight = sourceHeight;
+    image.pixels.Resize(width, height);
+    
+    Gdiplus::Bitmap target(width, height, width * 4, PixelFormat32bppARGB,
+                           reinterpret_cast<BYTE*>(image.pixels.Data()));
+    Gdiplus::Graphics graphics(&target);
+    graphics.SetInterpolationMode(Gdiplus::InterpolationModeHighQualityBicubic);
+    graphics.SetPixelOffsetMode(Gdiplus::PixelOffsetModeHalf);
+    Gdiplus::Status status = graphics.DrawImage(&source, Gdiplus::Rect(0, 0, width, height));
+    return status == Gdiplus::Ok && !cancel;
+}
+
+// Documents keep their tiles within a quarter of physical memory (at least
+// 256 MB), compressing the rest or swapping it to the cache folder. Each
+// document gets its own swap file, which is deleted when its store closes
+// it; documents are set up on the UI thread and on save tasks.
+static void LimitDocumentMemory(Document& document) {
+    static std::atomic<unsigned> swapFileCount(0);
+    uint64_t budget = 256ull * 1024 * 1024;
+    MEMORYSTATUSEX memory = {};
+    memory.dwLength = sizeof(memory);
+    if (GlobalMemoryStatusEx(&memory)) {
+        budget = (std::max)(budget, static_cast<uint64_t>(memory.ullTotalPhys / 4));
+    }
+    std::wstring directory = GetCacheDirectory();
+    std::wstring swapPath;
+    if (!directory.empty()) {
+        swapPath = directory + L"\\swap-" + std::to_wstring(GetCurrentProcessId()) + L"-" +
+                   std::to_wstring(++swapFileCount) + L".tmp";
+    }
+    document.SetMemoryBudget(budget, swapPath);
+}
+
+// Export source, read on the export task: the frame on screen for
+// animations, otherwise the full-resolution source, since the canvas may
+// show a display-sized copy
+static bool GetExportPixels(const PixelBuffer* frame, Document* document, const std::wstring& imagePath,
+                            int width, int height, const TaskControl& control, PixelBuffer& pixels) {
+    PixelBuffer decoded;
+    const PixelBuffer* source = &decoded;
+    if (frame) {
+        source = frame;
+    } else if (document) {
+        // Largest reduction that still covers the canvas
+        int shift = 0;
+        while (shift < document->GetPreviewLevel(0).shift &&
+               (document->Width() >> (shift + 1)) >= width &&
+               (document->Height() >> (shift + 1)) >= height) {
+            shift++;
+        }
+        document->Render(shift, decoded);
+    } else {
+        PrefetchedImage image;
+        if (!LoadDisplayImage(imagePath, INT_MAX, INT_MAX, *control.cancel, image)) {
+            return false;
+        }
+        decoded = std::move(image.pixels);
+    }
+    if (source->IsEmpty() || control.Cancelled()) {
+        return false;
+    }
+    
+    // Stretched to the canvas size, as the canvas shows it
+    width = width > 0 ? width : source->Width();
+    height = height > 0 ? height : source->Height();
+    return ResampleImage(*source, width, height, pixels);
+}
+
 MainWindow::MainWindow(HINSTANCE hInstance, const std::wstring& title, int width, int height)
     : m_hInstance(hInstance)
     , m_hwnd(nullptr)
@@ -36,6 +190,20 @@ MainWindow::MainWindow(HINSTANCE hInstance, const std::wstring& title, int width
     // Initialize GDI+
     Gdiplus::GdiplusStartupInput gdiplusStartupInput;
     Gdiplus::GdiplusStartup(&m_gdiplusToken, &gdiplusStartupInput, NULL);
+    
+    // Prefetched images never need to be larger than the screen
+    m_prefetcher = std::make_unique<ImagePrefetcher>(LoadDisplayImage);
+    m_prefetcher->SetDisplaySize(GetSystemMetrics(SM_CXSCREEN), GetSystemMetrics(SM_CYSCREEN));
+    
+    // Thumbnails persist between sessions in one pack file
+    m_thumbnailCache = std::make_unique<ThumbnailCache>();
+    std::wstring cacheDirectory = GetCacheDirectory();
+    if (!cacheDirectory.empty()) {
+        m_thumbnailCache->Open(cacheDirectory + L"\\thumbnails.pack");
+    }
+    m_thumbnailGenerator = std::make_unique<ThumbnailGenerator>(*m_thumbnailCache, LoadDisplayImage, THUMBNAIL_SIZE);
+    
+    CreatePaintResources();
 }
 
 MainWindow::~MainWindow() {
@@ -44,16 +212,47 @@ MainWindow::~MainWindow() {
         WindowMap::Unregister(m_hwnd);
     }
     
-    // Clean up image if loaded
-    if (m_pImage) {
-        delete m_pImage;
-        m_pImage = nullptr;
-    }
+    // The render thread posts to the window, so it goes first
+    m_renderThread.reset();
+    
+    // A save or export in progress uses the document and GDI+
+    CancelTask();
+    m_task.reset();
+    
+    // Stop the decoder thread and release the frame
+    StopAnimation();
+    
+    // Prefetch and thumbnail workers use GDI+, so they must finish before shutdown
+    m_thumbnailGenerator.reset();
+    m_thumbnailCache.reset();
+    m_prefetcher.reset();
+    
+    m_canvasImage.reset();
+    CloseDocument();
+    DestroyPaintResources();
     
     // Shutdown GDI+
     Gdiplus::GdiplusShutdown(m_gdiplusToken);
 }
 
+void MainWindow::CreatePaintResources() {
+    m_sidebarBrush = CreateSolidBrush(RGB(240, 240, 245));
+    m_placeholderBrush = CreateSolidBrush(RGB(235, 235, 235));
+    m_selectionBrush = CreateSolidBrush(RGB(204, 228, 247));
+    m_separatorPen = CreatePen(PS_SOLID, 1, RGB(200, 200, 200));
+}
+
+void MainWindow::DestroyPaintResources() {
+    HGDIOBJ objects[] = { m_sidebarBrush, m_placeholderBrush, m_selectionBrush, m_separatorPen };
+    for (HGDIOBJ object : objects) {
+        if (object) {
+            DeleteObject(object);
+        }
+    }
+    m_sidebarBrush = m_placeholderBrush = m_selectionBrush = nullptr;
+    m_separatorPen = nullptr;
+}
+
 bool MainWindow::Initialize() {
     #ifdef DEBUG
     printf("MainWindow::Initialize called\n");
@@ -146,6 +345,20 @@ bool MainWindow::Initialize() {
     // Register the window with our map
     WindowMap::Register(m_hwnd, this);
     
+    // Finished frames are picked up by the next WM_PAINT
+    HWND hwnd = m_hwnd;
+    m_renderThread = std::make_unique<RenderThread>([hwnd]() {
+        PostMessageW(hwnd, WM_CANVAS_FRAME_READY, 0, 0);
+    });
+    m_task = std::make_unique<BackgroundTask>(
+        [hwnd](int percent) { PostMessageW(hwnd, WM_TASK_PROGRESS, (WPARAM)percent, 0); },
+        [hwnd]() { PostMessageW(hwnd, WM_TASK_FINISHED, 0, 0); });
+    
+    // The image being opened may be among the decoded or failed files
+    m_prefetcher->SetReadyCallback([hwnd](const std::wstring&) {
+        PostMessageW(hwnd, WM_IMAGE_READY, 0, 0);
+    });
+    
     #ifdef DEBUG
     printf("Window created successfully: handle=%p\n", m_hwnd);
     printf("Registered window in WindowMap\n");
@@ -223,6 +436,13 @@ LRESULT MainWindow::HandleMessage(UINT msg, WPARAM wParam, LPARAM lParam) {
             PostQuitMessage(0);
             return 0;
         
+        case WM_TIMER:
+            if (wParam == ID_ANIMATION_TIMER) {
+                OnAnimationTimer();
+                return 0;
+            }
+            return DefWindowProcW(m_hwnd, msg, wParam, lParam);
+        
         case WM_SIZE: {
             // Update canvas rectangle when window size changes
             RECT clientRect;
@@ -233,9 +453,77 @@ LRESULT MainWindow::HandleMessage(UINT msg, WPARAM wParam, LPARAM lParam) {
                 clientRect.right, 
                 clientRect.bottom 
             };
+            if (m_showThumbnails) {
+                ScrollThumbnails(0);
+            }
             InvalidateRect(m_hwnd, NULL, TRUE);
             return 0;
         }
+        
+        case WM_CANVAS_FRAME_READY:
+            InvalidateRect(m_hwnd, &m_canvasRect, FALSE);
+            return 0;
+        
+        case WM_TASK_PROGRESS:
+            if (m_taskButton) {
+                std::wstring text = L"Cancel (" + std::to_wstring((int)wParam) + L"%)";
+                SetWindowTextW(m_taskButton, text.c_str());
+            }
+            return 0;
+        
+        case WM_TASK_FINISHED:
+            OnTaskFinished();
+            return 0;
+        
+        case WM_DOCUMENT_VIEW_READY: {
+            // Views of a document since closed are dropped
+            std::shared_ptr<const PixelBuffer> view;
+            {
+                std::lock_guard<std::mutex> lock(m_viewMutex);
+                if (m_renderedViewSerial == m_documentSerial) {
+                    view = std::move(m_renderedView);
+                }
+                m_renderedView.reset();
+            }
+            if (view && m_document) {
+                m_canvasImage = std::move(view);
+                ShowDocumentView();
+            }
+            return 0;
+        }
+            
+        case WM_IMAGE_READY:
+            OnImageReady();
+            return 0;
+            
+        case WM_THUMBNAIL_READY: {
+            // The cell picks the thumbnail up from the cache when repainted
+            int index = (int)wParam;
+            if (m_showThumbnails && index >= 0 && index < (int)m_thumbnails.size()) {
+                RECT cell = GetThumbnailCellRect(index);
+                InvalidateRect(m_hwnd, &cell, FALSE);
+            }
+            return 0;
+        }
+        
+        case WM_MOUSEWHEEL:
+            if (m_showThumbnails) {
+                int notches = GET_WHEEL_DELTA_WPARAM(wParam) / WHEEL_DELTA;
+                ScrollThumbnails(-notches * THUMBNAIL_CELL_HEIGHT / 2);
+                return 0;
+            }
+            return DefWindowProcW(m_hwnd, msg, wParam, lParam);
+        
+        case WM_LBUTTONDOWN:
+            if (m_showThumbnails) {
+                int index = HitTestThumbnail((short)LOWORD(lParam), (short)HIWORD(lParam));
+                if (index >= 0) {
+                    ShowThumbnails(false);
+                    GoToImage(index);
+                }
+                return 0;
+            }
+            return DefWindowProcW(m_hwnd, msg, wParam, lParam);
             
         case WM_PAINT: {
             PAINTSTRUCT ps;
@@ -246,17 +534,13 @@ LRESULT MainWindow::HandleMessage(UINT msg, WPARAM wParam, LPARAM lParam) {
             
             // Draw sidebar background
             RECT sidebarRect = { 0, 0, SIDEBAR_WIDTH, clientRect.bottom };
-            HBRUSH sidebarBrush = CreateSolidBrush(RGB(240, 240, 245));
-            FillRect(hdc, &sidebarRect, sidebarBrush);
-            DeleteObject(sidebarBrush);
+            FillRect(hdc, &sidebarRect, m_sidebarBrush);
             
             // Draw separator line
-            HPEN separatorPen = CreatePen(PS_SOLID, 1, RGB(200, 200, 200));
-            HPEN oldPen = (HPEN)SelectObject(hdc, separatorPen);
+            HPEN oldPen = (HPEN)SelectObject(hdc, m_separatorPen);
             MoveToEx(hdc, SIDEBAR_WIDTH, 0, NULL);
             LineTo(hdc, SIDEBAR_WIDTH, clientRect.bottom);
             SelectObject(hdc, oldPen);
-            DeleteObject(separatorPen);
             
             // Draw app title
             SetBkMode(hdc, TRANSPARENT);
@@ -373,6 +657,50 @@ void MainWindow::CreateControls() {
         BUTTON_WIDTH, BUTTON_HEIGHT,
         ID_OPEN_IMAGE
     );
+    y += BUTTON_HEIGHT + BUTTON_MARGIN;
+    
+    // Step through the other images in the same folder
+    int halfWidth = (BUTTON_WIDTH - BUTTON_MARGIN) / 2;
+    m_previousButton = CreateButton(
+        L"< Previous",
+        20, y,
+        halfWidth, BUTTON_HEIGHT,
+        ID_PREVIOUS_IMAGE
+    );
+    m_nextButton = CreateButton(
+        L"Next >",
+        20 + BUTTON_WIDTH - halfWidth, y,
+        halfWidth, BUTTON_HEIGHT,
+        ID_NEXT_IMAGE
+    );
+    y += BUTTON_HEIGHT + BUTTON_MARGIN;
+    
+    // Toggle the thumbnail grid for the current folder
+    m_thumbnailsButton = CreateButton(
+        L"Thumbnails",
+        20, y,
+        BUTTON_WIDTH, BUTTON_HEIGHT,
+        ID_THUMBNAILS
+    );
+    y += BUTTON_HEIGHT + BUTTON_MARGIN;
+    
+    // Save as (or update) a layered PixelForge project
+    m_saveProjectButton = CreateButton(
+        L"Save Project",
+        20, y,
+        BUTTON_WIDTH, BUTTON_HEIGHT,
+        ID_SAVE_PROJECT
+    );
+    y += BUTTON_HEIGHT + BUTTON_MARGIN;
+    
+    // 256-colour GIF at the canvas resolution
+    m_exportButton = CreateButton(
+        L"Export GIF",
+        20, y,
+        BUTTON_WIDTH, BUTTON_HEIGHT,
+        ID_EXPORT_GIF
+    );
+    UpdateNavigationButtons();
     
     #ifdef DEBUG
     printf("MainWindow::CreateControls completed\n");
@@ -449,6 +777,29 @@ void MainWindow::HandleCommand(WPARAM wParam, LPARAM lParam) {
     else if (controlId == ID_OPEN_IMAGE && notificationCode == BN_CLICKED) {
         OpenImage();
     }
+    else if (controlId == ID_PREVIOUS_IMAGE && notificationCode == BN_CLICKED) {
+        GoToImage(m_fileIndex - 1);
+    }
+    else if (controlId == ID_NEXT_IMAGE && notificationCode == BN_CLICKED) {
+        GoToImage(m_fileIndex + 1);
+    }
+    else if (controlId == ID_THUMBNAILS && notificationCode == BN_CLICKED) {
+        ShowThumbnails(!m_showThumbnails);
+    }
+    else if (controlId == ID_SAVE_PROJECT && notificationCode == BN_CLICKED) {
+        if (m_taskButton == m_saveProjectButton) {
+            m_task->Cancel();
+        } else {
+            SaveProject();
+        }
+    }
+    else if (controlId == ID_EXPORT_GIF && notificationCode == BN_CLICKED) {
+        if (m_taskButton == m_exportButton) {
+            m_task->Cancel();
+        } else {
+            ExportIndexedImage();
+        }
+    }
 }
 
 void MainWindow::ResizeWindow(int width, int height) {
@@ -488,64 +839,682 @@ void MainWindow::OpenImage() {
     OPENFILENAMEW ofn = {0};
     ofn.lStructSize = sizeof(ofn);
     ofn.hwndOwner = m_hwnd;
-    ofn.lpstrFilter = L"Image Files\0*.jpg;*.jpeg;*.png;*.bmp;*.gif\0All Files\0*.*\0";
+    ofn.lpstrFilter = L"Image Files\0*.jpg;*.jpeg;*.png;*.bmp;*.gif\0PixelForge Projects\0*.pfp\0All Files\0*.*\0";
     ofn.lpstrFile = fileName;
     ofn.nMaxFile = MAX_PATH;
     ofn.Flags = OFN_EXPLORER | OFN_FILEMUSTEXIST | OFN_HIDEREADONLY;
     
     if (GetOpenFileNameW(&ofn)) {
-        // Clean up previous image if any
-        if (m_pImage) {
-            delete m_pImage;
-            m_pImage = nullptr;
-        }
+        ShowThumbnails(false);
         
-        // Load the new image
-        m_pImage = new Gdiplus::Image(fileName);
+        if (GetFileExtension(fileName) == L".pfp") {
+            OpenProject(fileName);
+            return;
+        }
         
-        if (m_pImage && m_pImage->GetLastStatus() == Gdiplus::Ok) {
-            m_hasImage = true;
-            
-            // Get image dimensions
-            int imageWidth = m_pImage->GetWidth();
-            int imageHeight = m_pImage->GetHeight();
-            
-            // Update window to match image aspect ratio while maintaining canvas area
-            ResizeWindow(imageWidth, imageHeight);
-            
-            // Update window title
-            std::wstring fileNameOnly = fileName;
-            size_t lastSlash = fileNameOnly.find_last_of(L'\\');
-            if (lastSlash != std::wstring::npos) {
-                fileNameOnly = fileNameOnly.substr(lastSlash + 1);
+        // List the folder so its other images can be stepped through
+        std::vector<FileInfo> files;
+        ListDirectoryFiles(GetDirectoryPath(fileName), IMAGE_EXTENSIONS, files);
+        m_fileIndex = -1;
+        for (size_t i = 0; i < files.size(); i++) {
+            if (lstrcmpiW(files[i].path.c_str(), fileName) == 0) {
+                m_fileIndex = (int)i;
+                break;
             }
-            
-            std::wstring newTitle = m_title + L" - " + fileNameOnly + 
-                L" (" + std::to_wstring(imageWidth) + L" × " + std::to_wstring(imageHeight) + L")";
-            SetWindowTextW(m_hwnd, newTitle.c_str());
         }
-        else {
-            MessageBoxW(m_hwnd, L"Failed to load the image.", L"Error", MB_OK | MB_ICONERROR);
-            
-            if (m_pImage) {
-                delete m_pImage;
-                m_pImage = nullptr;
+        m_directoryFiles = m_fileIndex >= 0 ? files : std::vector<FileInfo>();
+        
+        std::vector<std::wstring> paths;
+        for (const auto& file : m_directoryFiles) {
+            paths.push_back(file.path);
+        }
+        m_prefetcher->SetFiles(paths);
+        
+        LoadImageFile(fileName);
+    }
+}
+
+bool MainWindow::LoadImageFile(const std::wstring& fileName) {
+    // Clean up previous image if any
+    StopAnimation();
+    m_canvasImage.reset();
+    CloseDocument();
+    m_imagePath = fileName;
+    m_hasImage = false;
+    
+    // A file opened outside a folder listing gets a listing of its own, so
+    // it is decoded by the prefetch workers like any other
+    if (m_fileIndex < 0) {
+        m_prefetcher->SetFiles({ fileName });
+        m_prefetcher->SetCurrent(0);
+    } else {
+        m_prefetcher->SetCurrent(m_fileIndex);
+    }
+    UpdateNavigationButtons();
+    
+    // A prefetched image is already decoded at display resolution; a miss
+    // is queued ahead of the neighbours and shown when it arrives, so the
+    // UI thread never decodes
+    std::shared_ptr<const PrefetchedImage> image = m_prefetcher->Find(fileName);
+    
+    #ifdef DEBUG
+    printf("Loading %ls (%s)\n", fileName.c_str(), image ? "prefetched" : "not prefetched");
+    #endif
+    
+    if (image) {
+        m_loadingPath.clear();
+        ShowLoadedImage(image);
+        return true;
+    }
+    if (m_prefetcher->HasFailed(fileName)) {
+        m_loadingPath.clear();
+        ShowLoadFailed();
+        return false;
+    }
+    
+    m_loadingPath = fileName;
+    std::wstring title = m_title + L" - Loading " + GetFileName(fileName) + L"...";
+    SetWindowTextW(m_hwnd, title.c_str());
+    InvalidateRect(m_hwnd, NULL, TRUE);
+    return true;
+}
+
+void MainWindow::OnImageReady() {
+    // Any image finishing may be the one being waited on
+    if (m_loadingPath.empty()) {
+        return;
+    }
+    std::shared_ptr<const PrefetchedImage> image = m_prefetcher->Find(m_loadingPath);
+    if (image) {
+        m_loadingPath.clear();
+        ShowLoadedImage(image);
+    } else if (m_prefetcher->HasFailed(m_loadingPath)) {
+        m_loadingPath.clear();
+        ShowLoadFailed();
+    }
+}
+
+void MainWindow::ShowLoadedImage(const std::shared_ptr<const PrefetchedImage>& image) {
+    // Shares ownership of the prefetched image
+    m_canvasImage = std::shared_ptr<const PixelBuffer>(image, &image->pixels);
+    int imageWidth = image->sourceWidth;
+    int imageHeight = image->sourceHeight;
+    m_hasImage = true;
+    
+    // Update window to match image aspect ratio while maintaining canvas area
+    ResizeWindow(imageWidth, imageHeight);
+    
+    // Update window title
+    std::wstring newTitle = m_title + L" - " + GetFileName(m_imagePath) + 
+        L" (" + std::to_wstring(imageWidth) + L" × " + std::to_wstring(imageHeight) + L")";
+    if (m_fileIndex >= 0) {
+        newTitle += L" [" + std::to_wstring(m_fileIndex + 1) + L"/" + std::to_wstring(m_directoryFiles.size()) + L"]";
+    }
+    SetWindowTextW(m_hwnd, newTitle.c_str());
+    
+    // GDI+ only ever shows the first frame; animated files play
+    // through the background decoder instead
+    std::wstring extension = GetFileExtension(m_imagePath);
+    if (extension == L".gif" || extension == L".png") {
+        std::vector<uint8_t> data;
+        if (ReadFileBytes(m_imagePath, data)) {
+            auto decoder = AnimationDecoder::Open(std::move(data));
+            if (decoder && decoder->FrameCount() > 1) {
+                StartAnimation(std::move(decoder));
             }
-            
-            m_hasImage = false;
+        }
+    }
+    
+    // Force redraw
+    InvalidateRect(m_hwnd, NULL, TRUE);
+}
+
+void MainWindow::ShowLoadFailed() {
+    m_hasImage = false;
+    SetWindowTextW(m_hwnd, m_title.c_str());
+    InvalidateRect(m_hwnd, NULL, TRUE);
+    MessageBoxW(m_hwnd, L"Failed to load the image.", L"Error", MB_OK | MB_ICONERROR);
+}
+
+void MainWindow::GoToImage(int index) {
+    if (index < 0 || index >= (int)m_directoryFiles.size() || index == m_fileIndex) {
+        return;
+    }
+    m_fileIndex = index;
+    LoadImageFile(m_directoryFiles[index].path);
+}
+
+void MainWindow::UpdateNavigationButtons() {
+    if (m_previousButton) {
+        EnableWindow(m_previousButton, m_fileIndex > 0);
+    }
+    if (m_nextButton) {
+        EnableWindow(m_nextButton, m_fileIndex >= 0 && m_fileIndex + 1 < (int)m_directoryFiles.size());
+    }
+}
+
+bool MainWindow::HandleNavigationKey(const MSG& msg) {
+    if (msg.message != WM_KEYDOWN || m_fileIndex < 0) {
+        return false;
+    }
+    
+    // Escape closes the thumbnail grid; the grid has no keyboard navigation
+    if (m_showThumbnails) {
+        if (msg.wParam == VK_ESCAPE) {
+            ShowThumbnails(false);
+            return true;
+        }
+        return false;
+    }
+    
+    // Leave the arrow keys to the size inputs, and ignore other windows
+    if (msg.hwnd == m_widthInput || msg.hwnd == m_heightInput) {
+        return false;
+    }
+    if (msg.hwnd != m_hwnd && GetParent(msg.hwnd) != m_hwnd) {
+        return false;
+    }
+    
+    switch (msg.wParam) {
+        case VK_RIGHT:
+        case VK_NEXT:
+            GoToImage(m_fileIndex + 1);
+            return true;
+        case VK_LEFT:
+        case VK_PRIOR:
+            GoToImage(m_fileIndex - 1);
+            return true;
+        case VK_HOME:
+            GoToImage(0);
+            return true;
+        case VK_END:
+            GoToImage((int)m_directoryFiles.size() - 1);
+            return true;
+        default:
+            return false;
+    }
+}
+
+void MainWindow::ShowThumbnails(bool show) {
+    if (!show) {
+        if (m_showThumbnails) {
+            m_thumbnailGenerator->Cancel();
+            m_showThumbnails = false;
+            m_thumbnails.clear();
+            m_thumbnailKeys.clear();
+            InvalidateRect(m_hwnd, NULL, TRUE);
+        }
+        return;
+    }
+    
+    if (m_directoryFiles.empty()) {
+        OpenImage();
+        if (m_directoryFiles.empty()) {
+            return;
+        }
+    }
+    
+    // Keys come from the folder listing, so nothing is opened until a
+    // thumbnail actually has to be generated
+    m_thumbnailKeys.clear();
+    for (const auto& file : m_directoryFiles) {
+        m_thumbnailKeys.push_back(ThumbnailCache::MakeKey(file.path, file.size, file.modifiedTime));
+    }
+    m_thumbnails.assign(m_directoryFiles.size(), PixelBuffer());
+    m_showThumbnails = true;
+    
+    // Start with the current image's row in view
+    int columns = GetThumbnailColumns();
+    m_thumbnailScroll = (std::max)(m_fileIndex, 0) / columns * THUMBNAIL_CELL_HEIGHT;
+    ScrollThumbnails(0);
+    RequestThumbnails();
+    InvalidateRect(m_hwnd, NULL, TRUE);
+}
+
+void MainWindow::RequestThumbnails() {
+    // Generate from the first visible cell onwards, wrapping round, so what
+    // is on screen fills in first
+    int count = (int)m_directoryFiles.size();
+    int first = (std::min)(m_thumbnailScroll / THUMBNAIL_CELL_HEIGHT * GetThumbnailColumns(), (std::max)(count - 1, 0));
+    
+    std::vector<ThumbnailSource> sources;
+    std::vector<int> fileIndices;
+    sources.reserve(count);
+    fileIndices.reserve(count);
+    for (int i = 0; i < count; i++) {
+        int index = (first + i) % count;
+        sources.push_back({ m_directoryFiles[index].path, m_thumbnailKeys[index] });
+        fileIndices.push_back(index);
+    }
+    
+    HWND hwnd = m_hwnd;
+    m_thumbnailGenerator->Generate(sources, [hwnd, fileIndices](int index) {
+        PostMessageW(hwnd, WM_THUMBNAIL_READY, (WPARAM)fileIndices[index], 0);
+    });
+}
+
+int MainWindow::GetThumbnailColumns() const {
+    int canvasWidth = m_canvasRect.right - m_canvasRect.left - THUMBNAIL_MARGIN * 2;
+    return (std::max)(1, canvasWidth / THUMBNAIL_CELL_WIDTH);
+}
+
+RECT MainWindow::GetThumbnailCellRect(int index) const {
+    int columns = GetThumbnailColumns();
+    int left = m_canvasRect.left + THUMBNAIL_MARGIN + (index % columns) * THUMBNAIL_CELL_WIDTH;
+    int top = m_canvasRect.top + THUMBNAIL_MARGIN + (index / columns) * THUMBNAIL_CELL_HEIGHT - m_thumbnailScroll;
+    RECT cell = { left, top, left + THUMBNAIL_CELL_WIDTH, top + THUMBNAIL_CELL_HEIGHT };
+    return cell;
+}
+
+int MainWindow::HitTestThumbnail(int x, int y) const {
+    if (x < m_canvasRect.left || x >= m_canvasRect.right || y < m_canvasRect.top || y >= m_canvasRect.bottom) {
+        return -1;
+    }
+    int column = (x - m_canvasRect.left - THUMBNAIL_MARGIN) / THUMBNAIL_CELL_WIDTH;
+    int row = (y - m_canvasRect.top - THUMBNAIL_MARGIN + m_thumbnailScroll) / THUMBNAIL_CELL_HEIGHT;
+    if (x < m_canvasRect.left + THUMBNAIL_MARGIN || column >= GetThumbnailColumns() ||
+        y < m_canvasRect.top + THUMBNAIL_MARGIN - m_thumbnailScroll) {
+        return -1;
+    }
+    int index = row * GetThumbnailColumns() + column;
+    return index < (int)m_thumbnails.size() ? index : -1;
+}
+
+void MainWindow::ScrollThumbnails(int delta) {
+    int columns = GetThumbnailColumns();
+    int rows = ((int)m_thumbnails.size() + columns - 1) / columns;
+    int canvasHeight = m_canvasRect.bottom - m_canvasRect.top;
+    int maxScroll = (std::max)(0, rows * THUMBNAIL_CELL_HEIGHT + THUMBNAIL_MARGIN * 2 - canvasHeight);
+    int scroll = (std::min)((std::max)(m_thumbnailScroll + delta, 0), maxScroll);
+    if (scroll == m_thumbnailScroll) {
+        return;
+    }
+    
+    // Jumping to a new row re-prioritises generation around it
+    bool rowChanged = scroll / THUMBNAIL_CELL_HEIGHT != m_thumbnailScroll / THUMBNAIL_CELL_HEIGHT;
+    m_thumbnailScroll = scroll;
+    if (rowChanged && delta != 0) {
+        RequestThumbnails();
+    }
+    InvalidateRect(m_hwnd, &m_canvasRect, FALSE);
+}
+
+void MainWindow::DrawThumbnailGrid(HDC hdc) {
+    int count = (int)m_thumbnails.size();
+    int columns = GetThumbnailColumns();
+    int canvasHeight = m_canvasRect.bottom - m_canvasRect.top;
+    int firstRow = (std::max)(0, (m_thumbnailScroll - THUMBNAIL_MARGIN) / THUMBNAIL_CELL_HEIGHT);
+    int lastRow = (m_thumbnailScroll + canvasHeight) / THUMBNAIL_CELL_HEIGHT;
+    int first = firstRow * columns;
+    int last = (std::min)(count, (lastRow + 1) * columns);
+    
+    // Keep a page either side of the view and let the rest go
+    int pageCells = (lastRow - firstRow + 1) * columns;
+    for (int i = 0; i < count; i++) {
+        if ((i < first - pageCells || i >= last + pageCells) && !m_thumbnails[i].IsEmpty()) {
+            m_thumbnails[i] = PixelBuffer();
+        }
+    }
+    
+    int savedDC = SaveDC(hdc);
+    IntersectClipRect(hdc, m_canvasRect.left, m_canvasRect.top, m_canvasRect.right, m_canvasRect.bottom);
+    
+    Gdiplus::Graphics graphics(hdc);
+    SetBkMode(hdc, TRANSPARENT);
+    SetTextColor(hdc, RGB(50, 50, 50));
+    
+    for (int i = first; i < last; i++) {
+        RECT cell = GetThumbnailCellRect(i);
+        if (i == m_fileIndex) {
+            FillRect(hdc, &cell, m_selectionBrush);
         }
         
-        // Force redraw
+        int boxLeft = cell.left + (THUMBNAIL_CELL_WIDTH - THUMBNAIL_SIZE) / 2;
+        int boxTop = cell.top + THUMBNAIL_MARGIN / 2;
+        PixelBuffer& thumbnail = m_thumbnails[i];
+        if (thumbnail.IsEmpty()) {
+            m_thumbnailCache->Lookup(m_thumbnailKeys[i], thumbnail);
+        }
+        
+        if (!thumbnail.IsEmpty()) {
+            // Drawn 1:1, centred in the thumbnail box
+            Gdiplus::Bitmap bitmap(thumbnail.Width(), thumbnail.Height(), thumbnail.Stride() * 4, PixelFormat32bppARGB,
+                                   reinterpret_cast<BYTE*>(thumbnail.Data()));
+            graphics.DrawImage(&bitmap, boxLeft + (THUMBNAIL_SIZE - thumbnail.Width()) / 2,
+                               boxTop + (THUMBNAIL_SIZE - thumbnail.Height()) / 2, thumbnail.Width(), thumbnail.Height());
+        } else {
+            RECT placeholder = { boxLeft, boxTop, boxLeft + THUMBNAIL_SIZE, boxTop + THUMBNAIL_SIZE };
+            FillRect(hdc, &placeholder, m_placeholderBrush);
+        }
+        
+        RECT nameRect = { cell.left + 4, boxTop + THUMBNAIL_SIZE + 4, cell.right - 4, cell.bottom - 4 };
+        // The name is drawn straight out of the path
+        const std::wstring& path = m_directoryFiles[i].path;
+        size_t slash = path.find_last_of(L"\\/");
+        const wchar_t* name = path.c_str() + (slash == std::wstring::npos ? 0 : slash + 1);
+        DrawTextW(hdc, name, -1, &nameRect, DT_CENTER | DT_SINGLELINE | DT_END_ELLIPSIS | DT_NOPREFIX);
+    }
+    
+    RestoreDC(hdc, savedDC);
+}
+
+void MainWindow::OpenProject(const std::wstring& fileName) {
+    StopAnimation();
+    m_canvasImage.reset();
+    CloseDocument();
+    m_imagePath.clear();
+    m_loadingPath.clear();
+    
+    // Projects are not part of folder navigation
+    m_directoryFiles.clear();
+    m_fileIndex = -1;
+    m_prefetcher->SetFiles(std::vector<std::wstring>());
+    UpdateNavigationButtons();
+    
+    auto project = std::make_unique<ProjectFile>();
+    std::unique_ptr<Document> document;
+    if (!project->Open(fileName, document)) {
+        m_hasImage = false;
         InvalidateRect(m_hwnd, NULL, TRUE);
+        MessageBoxW(m_hwnd, L"Failed to open the project.", L"Error", MB_OK | MB_ICONERROR);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_documentMutex);
+        m_project = std::move(project);
+        m_document = std::move(document);
+        m_documentSerial++;
     }
+    m_hasImage = true;
+    LimitDocumentMemory(*m_document);
+    
+    ResizeWindow(m_document->Width(), m_document->Height());
+    std::wstring newTitle = m_title + L" - " + GetFileName(fileName) +
+        L" (" + std::to_wstring(m_document->Width()) + L" × " + std::to_wstring(m_document->Height()) + L")";
+    SetWindowTextW(m_hwnd, newTitle.c_str());
+    
+    // Paint the stored preview straight away, then decode full-resolution
+    // tiles only if the canvas shows more detail than the preview has
+    m_canvasImage = std::make_shared<PixelBuffer>(m_document->GetPreviewLevel(0).pixels);
+    ShowDocumentView();
+    UpdateWindow(m_hwnd);
+    RefineDocumentView();
 }
 
-void MainWindow::DrawCanvas(HDC hdc) {
-    // Fill canvas background with white
-    HBRUSH canvasBrush = CreateSolidBrush(RGB(255, 255, 255));
-    FillRect(hdc, &m_canvasRect, canvasBrush);
-    DeleteObject(canvasBrush);
+void MainWindow::RefineDocumentView() {
+    RECT display = GetDisplayRect();
+    int displayWidth = display.right - display.left;
+    int displayHeight = display.bottom - display.top;
+    if (m_canvasImage && m_canvasImage->Width() >= displayWidth && m_canvasImage->Height() >= displayHeight) {
+        return;
+    }
+    
+    // Largest reduction that still covers the display
+    int shift = 0;
+    while (shift < m_document->GetPreviewLevel(0).shift &&
+           (m_document->Width() >> (shift + 1)) >= displayWidth &&
+           (m_document->Height() >> (shift + 1)) >= displayHeight) {
+        shift++;
+    }
+    if (shift >= m_document->GetPreviewLevel(0).shift) {
+        return;
+    }
+    
+    #ifdef DEBUG
+    printf("Rendering project at 1/%d for a %dx%d view\n", 1 << shift, displayWidth, displayHeight);
+    #endif
     
+    // Rendered between canvas frames. A newer view request, or a save or
+    // export holding the document, makes it give up; OnTaskFinished asks again.
+    if (!m_renderThread) {
+        return;
+    }
+    Document* document = m_document.get();
+    uint64_t serial = m_documentSerial;
+    HWND hwnd = m_hwnd;
+    m_renderThread->Post([this, document, serial, shift, hwnd](const std::atomic<bool>& superseded) {
+        auto view = std::make_shared<PixelBuffer>();
+        {
+            std::unique_lock<std::mutex> lock(m_documentMutex, std::try_to_lock);
+            if (!lock || m_documentSerial != serial || !document->Render(shift, *view, &superseded)) {
+                return;
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_viewMutex);
+            m_renderedView = std::move(view);
+            m_renderedViewSerial = serial;
+        }
+        PostMessageW(hwnd, WM_DOCUMENT_VIEW_READY, 0, 0);
+    });
+}
+
+void MainWindow::ShowDocumentView() {
+    // The next paint sees the new m_canvasImage and requests a frame
+    InvalidateRect(m_hwnd, &m_canvasRect, FALSE);
+}
+
+void MainWindow::CloseDocument() {
+    // Callers reset m_canvasImage when it shows the document
+    // Waits for a save, export or view render using the document
+    CancelTask();
+    {
+        std::lock_guard<std::mutex> lock(m_documentMutex);
+        m_document.reset();
+        m_project.reset();
+        m_documentSerial++;
+    }
+    
+    // A document's tiles would otherwise stay cached for reuse
+    BufferPool::Shared().Trim();
+}
+
+bool MainWindow::StartTask(HWND button, BackgroundTask::Job job, std::function<void(bool ok)> finished) {
+    if (!m_task || !m_task->Start(std::move(job))) {
+        return false;
+    }
+    m_taskFinished = std::move(finished);
+    m_taskButton = button;
+    wchar_t text[64] = {0};
+    GetWindowTextW(button, text, 64);
+    m_taskButtonText = text;
+    SetWindowTextW(button, L"Cancel");
+    for (HWND other : { m_saveProjectButton, m_exportButton }) {
+        if (other != button) {
+            EnableWindow(other, FALSE);
+        }
+    }
+    return true;
+}
+
+void MainWindow::CancelTask() {
+    // Waits for the job, so whatever it uses can be released afterwards;
+    // the finished message it may have posted finds nothing to do
+    if (!m_task || !m_task->IsBusy()) {
+        return;
+    }
+    m_task->Cancel();
+    m_task->Wait();
+    m_taskFinished = nullptr;
+    EndTask();
+}
+
+void MainWindow::OnTaskFinished() {
+    if (!m_task || !m_task->IsBusy()) {
+        return;
+    }
+    bool cancelled = m_task->IsCancelled();
+    bool ok = m_task->Wait();
+    std::function<void(bool)> finished = std::move(m_taskFinished);
+    m_taskFinished = nullptr;
+    EndTask();
+    if (finished && !cancelled) {
+        finished(ok);
+    }
+    
+    // An opened project's view may have been refused while the task held
+    // the document
+    if (m_document && m_imagePath.empty()) {
+        RefineDocumentView();
+    }
+}
+
+void MainWindow::EndTask() {
+    if (m_taskButton) {
+        SetWindowTextW(m_taskButton, m_taskButtonText.c_str());
+    }
+    m_taskButton = nullptr;
+    for (HWND button : { m_saveProjectButton, m_exportButton }) {
+        EnableWindow(button, TRUE);
+    }
+}
+
+void MainWindow::SaveProject() {
+    // An open project only rewrites what changed. The document is left to
+    // the task until it finishes; CloseDocument cancels it first.
+    if (m_document && m_project && m_project->IsOpen()) {
+        ProjectFile* project = m_project.get();
+        Document* document = m_document.get();
+        std::mutex* documentMutex = &m_documentMutex;
+        StartTask(m_saveProjectButton, [project, document, documentMutex](const TaskControl& control) {
+            std::lock_guard<std::mutex> lock(*documentMutex);
+            return project->Save(*document, &control);
+        }, [this](bool ok) {
+            if (!ok) {
+                MessageBoxW(m_hwnd, L"Failed to save the project.", L"Error", MB_OK | MB_ICONERROR);
+            }
+        });
+        return;
+    }
+    if (!m_hasImage || m_imagePath.empty()) {
+        MessageBoxW(m_hwnd, L"Open an image first.", L"Save Project", MB_OK | MB_ICONINFORMATION);
+        return;
+    }
+    
+    wchar_t fileName[MAX_PATH] = {0};
+    std::wstring suggested = GetFileName(m_imagePath);
+    suggested = suggested.substr(0, suggested.find_last_of(L'.')) + L".pfp";
+    lstrcpynW(fileName, suggested.c_str(), MAX_PATH);
+    
+    OPENFILENAMEW ofn = {0};
+    ofn.lStructSize = sizeof(ofn);
+    ofn.hwndOwner = m_hwnd;
+    ofn.lpstrFilter = L"PixelForge Projects\0*.pfp\0";
+    ofn.lpstrFile = fileName;
+    ofn.nMaxFile = MAX_PATH;
+    ofn.lpstrDefExt = L"pfp";
+    ofn.Flags = OFN_EXPLORER | OFN_OVERWRITEPROMPT | OFN_HIDEREADONLY;
+    if (!GetSaveFileNameW(&ofn)) {
+        return;
+    }
+    
+    // Built on the task, handed over when it finishes
+    struct SavedProject {
+        std::unique_ptr<ProjectFile> project;
+        std::unique_ptr<Document> document;
+        bool readFailed = false;
+    };
+    auto saved = std::make_shared<SavedProject>();
+    std::wstring imagePath = m_imagePath;
+    std::wstring path = fileName;
+    StartTask(m_saveProjectButton, [saved, imagePath, path](const TaskControl& control) {
+        // The shown image may be a display-sized prefetch, so decode the
+        // source again at full resolution
+        PrefetchedImage image;
+        if (!LoadDisplayImage(imagePath, INT_MAX, INT_MAX, *control.cancel, image)) {
+            saved->readFailed = !control.Cancelled();
+            return false;
+        }
+        
+        auto document = std::make_unique<Document>(image.pixels.Width(), image.pixels.Height());
+        document->SetPixels(document->AddLayer(L"Background"), image.pixels);
+        image.pixels = PixelBuffer();
+        LimitDocumentMemory(*document);
+        auto project = std::make_unique<ProjectFile>();
+        if (!project->SaveAs(*document, path, &control)) {
+            return false;
+        }
+        saved->project = std::move(project);
+        saved->document = std::move(document);
+        return true;
+    }, [this, saved](bool ok) {
+        if (!ok) {
+            MessageBoxW(m_hwnd, saved->readFailed ? L"Failed to read the image." : L"Failed to save the project.",
+                        L"Error", MB_OK | MB_ICONERROR);
+            return;
+        }
+        // Later saves of this image update the same file
+        std::lock_guard<std::mutex> lock(m_documentMutex);
+        m_project = std::move(saved->project);
+        m_document = std::move(saved->document);
+        m_documentSerial++;
+    });
+}
+
+void MainWindow::ExportIndexedImage() {
+    if (!m_hasImage || (m_imagePath.empty() && !m_document)) {
+        MessageBoxW(m_hwnd, L"Open an image first.", L"Export GIF", MB_OK | MB_ICONINFORMATION);
+        return;
+    }
+    
+    wchar_t fileName[MAX_PATH] = {0};
+    std::wstring suggested = m_imagePath.empty() ? L"export" : GetFileName(m_imagePath);
+    suggested = suggested.substr(0, suggested.find_last_of(L'.')) + L".gif";
+    lstrcpynW(fileName, suggested.c_str(), MAX_PATH);
+    
+    OPENFILENAMEW ofn = {0};
+    ofn.lStructSize = sizeof(ofn);
+    ofn.hwndOwner = m_hwnd;
+    ofn.lpstrFilter = L"GIF Images\0*.gif\0";
+    ofn.lpstrFile = fileName;
+    ofn.nMaxFile = MAX_PATH;
+    ofn.lpstrDefExt = L"gif";
+    ofn.Flags = OFN_EXPLORER | OFN_OVERWRITEPROMPT | OFN_HIDEREADONLY;
+    if (!GetSaveFileNameW(&ofn)) {
+        return;
+    }
+    
+    // The task works from copies of what the export depends on, except
+    // the document, which is left to it until it finishes
+    std::shared_ptr<const PixelBuffer> frame;
+    if (m_animationFrame) {
+        frame = std::make_shared<PixelBuffer>(*m_animationFrame);
+    }
+    Document* document = m_document.get();
+    std::wstring imagePath = m_imagePath;
+    std::wstring path = fileName;
+    int width = m_width;
+    int height = m_height;
+    std::mutex* documentMutex = &m_documentMutex;
+    StartTask(m_exportButton, [=](const TaskControl& control) {
+        PixelBuffer pixels;
+        {
+            std::lock_guard<std::mutex> lock(*documentMutex);
+            if (!GetExportPixels(frame.get(), document, imagePath, width, height, control, pixels)) {
+                return false;
+            }
+        }
+        control.Report(30);
+        
+        QuantizeOptions options;
+        options.cancel = control.cancel;
+        IndexedImage indexed;
+        if (!QuantizeImage(pixels, options, indexed)) {
+            return false;
+        }
+        pixels = PixelBuffer();
+        control.Report(90);
+        
+        std::vector<uint8_t> gif;
+        return EncodeGif(indexed, gif) && !control.Cancelled() && WriteFileBytes(path, gif.data(), gif.size());
+    }, [this](bool ok) {
+        if (!ok) {
+            MessageBoxW(m_hwnd, L"Failed to export the image.", L"Error", MB_OK | MB_ICONERROR);
+        }
+    });
+}
+
+RECT MainWindow::GetDisplayRect() const {
     // Calculate aspect ratio display area
     RECT aspectRect = m_canvasRect;
     
@@ -577,57 +1546,181 @@ void MainWindow::DrawCanvas(HDC hdc) {
         aspectRect.top = top;
         aspectRect.right = left + displayWidth;
         aspectRect.bottom = top + displayHeight;
+    }
+    
+    return aspectRect;
+}
+
+void MainWindow::StartAnimation(std::unique_ptr<AnimationDecoder> decoder) {
+    StopAnimation();
+    
+    m_animation = std::make_unique<AnimationPlayer>(std::move(decoder));
+    int width = m_animation->Width();
+    int height = m_animation->Height();
+    for (int i = 0; i < 2; i++) {
+        m_animationFrames[i] = std::make_shared<PixelBuffer>(width, height);
+        m_animationStale[i] = IntRect();
+    }
+    m_animationFrame = m_animationFrames[0];
+    
+    #ifdef DEBUG
+    printf("Starting animation playback: %dx%d\n", width, height);
+    #endif
+    
+    m_animation->Start();
+    SetTimer(m_hwnd, ID_ANIMATION_TIMER, USER_TIMER_MINIMUM, NULL);
+}
+
+void MainWindow::StopAnimation() {
+    if (m_hwnd) {
+        KillTimer(m_hwnd, ID_ANIMATION_TIMER);
+    }
+    
+    // Joins the decoder thread
+    m_animation.reset();
+    m_animationFrame.reset();
+    m_animationFrames[0].reset();
+    m_animationFrames[1].reset();
+}
+
+void MainWindow::OnAnimationTimer() {
+    if (!m_animation) {
+        KillTimer(m_hwnd, ID_ANIMATION_TIMER);
+        return;
+    }
+    
+    // The buffer in the last requested scene belongs to the render thread.
+    // The other may still be read by a render that was cut short; rather
+    // than wait on the UI thread, skip this tick and try again shortly.
+    // Once free, it catches up and takes the patches.
+    const int target = m_requestedScene.image == m_animationFrames[0] ? 1 : 0;
+    const int other = 1 - target;
+    PixelBuffer& frame = *m_animationFrames[target];
+    if (m_renderThread && m_renderThread->IsUsing(&frame)) {
+        SetTimer(m_hwnd, ID_ANIMATION_TIMER, USER_TIMER_MINIMUM, NULL);
+        return;
+    }
+    const IntRect stale = m_animationStale[target];
+    for (int y = stale.top; y < stale.bottom; y++) {
+        std::copy(m_animationFrames[other]->Row(y) + stale.left, m_animationFrames[other]->Row(y) + stale.right,
+                  frame.Row(y) + stale.left);
+    }
+    m_animationStale[target] = IntRect();
+    
+    IntRect dirty;
+    int nextDelay = 0;
+    bool running = m_animation->Advance(AnimationPlayer::Clock::now(), frame, dirty, nextDelay);
+    if (!dirty.IsEmpty()) {
+        m_animationFrame = m_animationFrames[target];
+        m_animationStale[other] = m_animationStale[other].Union(dirty);
+        m_canvasVersion++;
+    }
+    
+    // Repaint only the screen area covered by the changed frame rectangle
+    if (!dirty.IsEmpty() && m_width > 0 && m_height > 0) {
+        RECT display = GetDisplayRect();
+        int displayWidth = display.right - display.left;
+        int displayHeight = display.bottom - display.top;
+        int frameWidth = m_animationFrame->Width();
+        int frameHeight = m_animationFrame->Height();
         
-        // Draw checkerboard pattern for transparency
-        for (int y = aspectRect.top; y < aspectRect.bottom; y += 10) {
-            for (int x = aspectRect.left; x < aspectRect.right; x += 10) {
-                RECT checkerRect = { x, y, x + 10, y + 10 };
-                bool isLight = ((x / 10) + (y / 10)) % 2 == 0;
-                HBRUSH checkerBrush = CreateSolidBrush(isLight ? RGB(240, 240, 240) : RGB(220, 220, 220));
-                FillRect(hdc, &checkerRect, checkerBrush);
-                DeleteObject(checkerBrush);
-            }
-        }
-        
-        // If we have an image, draw it
-        if (m_hasImage && m_pImage) {
-            Gdiplus::Graphics graphics(hdc);
-            graphics.SetInterpolationMode(Gdiplus::InterpolationModeHighQualityBicubic);
-            graphics.DrawImage(m_pImage, 
-                Gdiplus::Rect(aspectRect.left, aspectRect.top, 
-                              aspectRect.right - aspectRect.left, 
-                              aspectRect.bottom - aspectRect.top));
-        }
-        
-        // Draw border around the aspect ratio rectangle
-        HPEN borderPen = CreatePen(PS_SOLID, 1, RGB(100, 100, 100));
-        HPEN oldPen = (HPEN)SelectObject(hdc, borderPen);
-        
-        Rectangle(hdc, 
-            aspectRect.left, 
-            aspectRect.top, 
-            aspectRect.right, 
-            aspectRect.bottom
-        );
-        
-        SelectObject(hdc, oldPen);
-        DeleteObject(borderPen);
+        RECT invalid = {
+            display.left + MulDiv(dirty.left, displayWidth, frameWidth) - 1,
+            display.top + MulDiv(dirty.top, displayHeight, frameHeight) - 1,
+            display.left + MulDiv(dirty.right, displayWidth, frameWidth) + 2,
+            display.top + MulDiv(dirty.bottom, displayHeight, frameHeight) + 2
+        };
+        InvalidateRect(m_hwnd, &invalid, FALSE);
+    }
+    
+    if (running) {
+        SetTimer(m_hwnd, ID_ANIMATION_TIMER, (UINT)(std::max)(nextDelay, (int)USER_TIMER_MINIMUM), NULL);
+    } else {
+        KillTimer(m_hwnd, ID_ANIMATION_TIMER);
+    }
+}
+
+CanvasScene MainWindow::CurrentScene() const {
+    CanvasScene scene;
+    scene.width = m_canvasRect.right - m_canvasRect.left;
+    scene.height = m_canvasRect.bottom - m_canvasRect.top;
+    if (m_width > 0 && m_height > 0) {
+        RECT display = GetDisplayRect();
+        scene.display = { display.left - m_canvasRect.left, display.top - m_canvasRect.top,
+                          display.right - m_canvasRect.left, display.bottom - m_canvasRect.top };
+    }
+    if (m_hasImage) {
+        scene.image = m_animationFrame ? m_animationFrame : m_canvasImage;
+        scene.version = m_canvasVersion;
+    }
+    return scene;
+}
+
+void MainWindow::PresentCanvas(HDC hdc) {
+    // Ask for a new frame only when something it depends on changed;
+    // requests made faster than frames finish replace each other
+    if (!m_renderThread) {
+        return;
+    }
+    CanvasScene scene = CurrentScene();
+    if (!SameScene(scene, m_requestedScene)) {
+        m_requestedScene = scene;
+        m_renderThread->Request(std::move(scene));
+    }
+    
+    // Meanwhile the latest finished frame is shown, which may be from
+    // before a resize; whatever it does not cover stays white
+    int frameWidth = 0;
+    int frameHeight = 0;
+    m_renderThread->Present([&](const PixelBuffer& frame, uint64_t) {
+        BITMAPINFO info = {};
+        info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        info.bmiHeader.biWidth = frame.Width();
+        info.bmiHeader.biHeight = -frame.Height();     // Top-down rows
+        info.bmiHeader.biPlanes = 1;
+        info.bmiHeader.biBitCount = 32;
+        info.bmiHeader.biCompression = BI_RGB;
+        SetDIBitsToDevice(hdc, m_canvasRect.left, m_canvasRect.top, frame.Width(), frame.Height(),
+                          0, 0, 0, frame.Height(), frame.Data(), &info, DIB_RGB_COLORS);
+        frameWidth = frame.Width();
+        frameHeight = frame.Height();
+    });
+    
+    HBRUSH whiteBrush = (HBRUSH)GetStockObject(WHITE_BRUSH);
+    RECT right = { m_canvasRect.left + frameWidth, m_canvasRect.top, m_canvasRect.right, m_canvasRect.bottom };
+    RECT bottom = { m_canvasRect.left, m_canvasRect.top + frameHeight, m_canvasRect.right, m_canvasRect.bottom };
+    FillRect(hdc, &right, whiteBrush);
+    FillRect(hdc, &bottom, whiteBrush);
+}
+
+void MainWindow::DrawCanvas(HDC hdc) {
+    if (m_showThumbnails) {
+        // Fill canvas background with white
+        FillRect(hdc, &m_canvasRect, (HBRUSH)GetStockObject(WHITE_BRUSH));
+        DrawThumbnailGrid(hdc);
+        return;
+    }
+    
+    // Background, checkerboard, image and border come from the render thread
+    PresentCanvas(hdc);
+    
+    if (m_width > 0 && m_height > 0) {
+        RECT aspectRect = GetDisplayRect();
         
         // Display resolution in the corner
         SetBkMode(hdc, TRANSPARENT);
         SetTextColor(hdc, RGB(50, 50, 50));
         
-        std::wstring sizeText = std::to_wstring(m_width) + L" × " + std::to_wstring(m_height);
+        wchar_t sizeText[32];
+        swprintf(sizeText, 32, L"%d × %d", m_width, m_height);
         RECT textRect = { aspectRect.left + 5, aspectRect.top + 5, aspectRect.right - 5, aspectRect.top + 25 };
         
         // Draw semi-transparent background for text
         RECT textBgRect = textRect;
         textBgRect.bottom = textBgRect.top + 20;
-        HBRUSH textBgBrush = CreateSolidBrush(RGB(255, 255, 255));
-        FillRect(hdc, &textBgRect, textBgBrush);
-        DeleteObject(textBgBrush);
+        FillRect(hdc, &textBgRect, (HBRUSH)GetStockObject(WHITE_BRUSH));
         
-        DrawTextW(hdc, sizeText.c_str(), -1, &textRect, DT_LEFT | DT_SINGLELINE);
+        DrawTextW(hdc, sizeText, -1, &textRect, DT_LEFT | DT_SINGLELINE);
     } 
     else {
         // If no canvas size set, display a message
@@ -5,7 +5,22 @@
 #include <vector>
 #include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <gdiplus.h>
+#include "../core/animation_player.h"
+#include "../core/background_task.h"
+#include "../core/buffer_pool.h"
+#include "../core/document.h"
+#include "../core/gif_encoder.h"
+#include "../core/image_prefetcher.h"
+#include "../core/jpeg_decoder.h"
+#include "../core/project_file.h"
+#include "../core/render_thread.h"
+#include "../core/thumbnail_cache.h"
+#include "../core/thumbnail_generator.h"
+#include "../utils/file_utils.h"
+#include "../core/pixel_buffer.h"
 
 namespace PixelForge {
 
@@ -47,6 +62,10 @@ public:
     void Show();
     
     HWND GetHandle() const { return m_hwnd; }
+    
+    // Next/previous image keys, handled before dispatch so they work
+    // whichever control has focus. Returns true if the message was used.
+    bool HandleNavigationKey(const MSG& msg);
 
 private:
     static LRESULT CALLBACK WindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
@@ -56,10 +75,56 @@ private:
     void HandleCommand(WPARAM wParam, LPARAM lParam);
     void ResizeWindow(int width, int height);
     void DrawCanvas(HDC hdc);
+    CanvasScene CurrentScene() const;
+    void PresentCanvas(HDC hdc);
+    RECT GetDisplayRect() const;
     void OpenImage();
+    // Shows fileName at once when it is prefetched; otherwise the prefetcher
+    // decodes it and OnImageReady shows it. False if it is known not to load.
+    bool LoadImageFile(const std::wstring& fileName);
+    void OnImageReady();
+    void ShowLoadedImage(const std::shared_ptr<const PrefetchedImage>& image);
+    void ShowLoadFailed();
+    void GoToImage(int index);
+    void UpdateNavigationButtons();
+    
+    // Folder thumbnail grid
+    void ShowThumbnails(bool show);
+    void RequestThumbnails();
+    void DrawThumbnailGrid(HDC hdc);
+    RECT GetThumbnailCellRect(int index) const;
+    int GetThumbnailColumns() const;
+    int HitTestThumbnail(int x, int y) const;
+    void ScrollThumbnails(int delta);
+    
+    // Long saves and exports run on m_task; the button that started one
+    // cancels it and shows its progress
+    bool StartTask(HWND button, BackgroundTask::Job job, std::function<void(bool ok)> finished);
+    void CancelTask();
+    void OnTaskFinished();
+    void EndTask();
+    
+    // Native project files
+    void OpenProject(const std::wstring& fileName);
+    void SaveProject();
+    void CloseDocument();
+    void ShowDocumentView();
+    void RefineDocumentView();
+    
+    // Palette-reduced export at the canvas resolution
+    void ExportIndexedImage();
+    
+    // Animated GIF/APNG playback
+    void StartAnimation(std::unique_ptr<AnimationDecoder> decoder);
+    void StopAnimation();
+    void OnAnimationTimer();
     
     HWND CreateButton(const wchar_t* text, int x, int y, int width, int height, int id);
     
+    // GDI objects used on every paint
+    void CreatePaintResources();
+    void DestroyPaintResources();
+    
     HINSTANCE m_hInstance;
     HWND m_hwnd;
     std::wstring m_title;
@@ -76,21 +141,103 @@ private:
     HWND m_heightInput;
     HWND m_applyButton;
     HWND m_openButton;
+    HWND m_previousButton = nullptr;
+    HWND m_nextButton = nullptr;
+    HWND m_thumbnailsButton = nullptr;
+    HWND m_saveProjectButton = nullptr;
+    HWND m_exportButton = nullptr;
+    
+    // Created once so painting does not allocate
+    HBRUSH m_sidebarBrush = nullptr;
+    HBRUSH m_placeholderBrush = nullptr;
+    HBRUSH m_selectionBrush = nullptr;
+    HPEN m_separatorPen = nullptr;
     
     // Custom resolution storage
     int m_customWidth;
     int m_customHeight;
     
-    // Image handling
+    // Image handling; m_canvasImage is what the canvas shows, shared with
+    // the render thread, so it is replaced rather than changed in place
     bool m_hasImage;
-    Gdiplus::Image* m_pImage = nullptr;
+    std::shared_ptr<const PixelBuffer> m_canvasImage;
     ULONG_PTR m_gdiplusToken;
     
+    // Canvas frames are drawn by m_renderThread; WM_PAINT requests a new
+    // one when the scene changed and presents the latest finished frame
+    std::unique_ptr<RenderThread> m_renderThread;
+    CanvasScene m_requestedScene;
+    uint64_t m_canvasVersion = 0;       // Bumped when the animation frame changes
+    
+    // Animation state. Patches go into one of two frame buffers: the other
+    // one, last handed to the render thread, is left alone, and the one
+    // written is first given the patches it missed (m_animationStale).
+    // m_animationFrame is whichever holds the latest frame.
+    std::unique_ptr<AnimationPlayer> m_animation;
+    std::shared_ptr<PixelBuffer> m_animationFrames[2];
+    IntRect m_animationStale[2];
+    std::shared_ptr<PixelBuffer> m_animationFrame;
+    
+    std::wstring m_imagePath;
+    
+    // Open project; m_canvasImage holds the stored preview until the
+    // canvas needs more detail. The document reads its tiles from
+    // m_project, so it is declared after it and destroyed first.
+    std::unique_ptr<ProjectFile> m_project;
+    std::unique_ptr<Document> m_document;
+    
+    // Threads other than the UI lock m_documentMutex while they use
+    // m_document; m_documentSerial changes whenever it is replaced, also
+    // under the lock. Views rendered on the render thread wait in
+    // m_renderedView for the UI to pick them up.
+    std::mutex m_documentMutex;
+    uint64_t m_documentSerial = 0;
+    std::mutex m_viewMutex;
+    std::shared_ptr<const PixelBuffer> m_renderedView;
+    uint64_t m_renderedViewSerial = 0;
+    
+    // Background save or export; while it runs the document belongs to it
+    std::unique_ptr<BackgroundTask> m_task;
+    std::function<void(bool ok)> m_taskFinished;
+    HWND m_taskButton = nullptr;
+    std::wstring m_taskButtonText;
+    
+    // Images in the open file's folder; neighbours are decoded ahead
+    std::vector<FileInfo> m_directoryFiles;
+    int m_fileIndex = -1;
+    std::unique_ptr<ImagePrefetcher> m_prefetcher;
+    std::wstring m_loadingPath;     // Waiting on the prefetcher, or empty
+    
+    // Thumbnail grid; m_thumbnails holds the visible cells' pixels, loaded
+    // from the persistent cache as they scroll into view
+    std::unique_ptr<ThumbnailCache> m_thumbnailCache;
+    std::unique_ptr<ThumbnailGenerator> m_thumbnailGenerator;
+    bool m_showThumbnails = false;
+    int m_thumbnailScroll = 0;
+    std::vector<uint64_t> m_thumbnailKeys;
+    std::vector<PixelBuffer> m_thumbnails;
+    
     // Constants
     static constexpr int BUTTON_HEIGHT = 30;
     static constexpr int BUTTON_WIDTH = 150;
     static constexpr int BUTTON_MARGIN = 10;
     static constexpr int SIDEBAR_WIDTH = 190;
+    static constexpr int THUMBNAIL_SIZE = 160;
+    static constexpr int THUMBNAIL_CELL_WIDTH = 180;
+    static constexpr int THUMBNAIL_CELL_HEIGHT = 200;
+    static constexpr int THUMBNAIL_MARGIN = 10;
+    
+    // Posted by thumbnail workers; wParam is the file index
+    static constexpr UINT WM_THUMBNAIL_READY = WM_APP + 1;
+    // Posted by the render thread when a canvas frame is finished
+    static constexpr UINT WM_CANVAS_FRAME_READY = WM_APP + 2;
+    // Posted by m_task; wParam is the progress in percent
+    static constexpr UINT WM_TASK_PROGRESS = WM_APP + 3;
+    static constexpr UINT WM_TASK_FINISHED = WM_APP + 4;
+    // Posted by the render thread when a document view is in m_renderedView
+    static constexpr UINT WM_DOCUMENT_VIEW_READY = WM_APP + 5;
+    // Posted by prefetch workers when an image has been decoded or failed
+    static constexpr UINT WM_IMAGE_READY = WM_APP + 6;
     
     // Control IDs
     enum ControlIDs {
@@ -98,7 +245,13 @@ private:
         ID_CUSTOM_WIDTH = 200,
         ID_CUSTOM_HEIGHT = 201,
         ID_APPLY_CUSTOM = 202,
-        ID_OPEN_IMAGE = 203
+        ID_OPEN_IMAGE = 203,
+        ID_PREVIOUS_IMAGE = 204,
+        ID_NEXT_IMAGE = 205,
+        ID_THUMBNAILS = 206,
+        ID_SAVE_PROJECT = 207,
+        ID_EXPORT_GIF = 208,
+        ID_ANIMATION_TIMER = 300
     };
 };
 
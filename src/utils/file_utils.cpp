@@ -0,0 +1,284 @@
+#include "file_utils.h"
+#include <algorithm>
+#include <cwctype>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+namespace PixelForge {
+
+std::string NarrowPath(const std::wstring& path) {
+    std::string out;
+    for (wchar_t wc : path) {
+        uint32_t c = static_cast<uint32_t>(wc);
+        if (c < 0x80) {
+            out += static_cast<char>(c);
+        } else if (c < 0x800) {
+            out += static_cast<char>(0xC0 | (c >> 6));
+            out += static_cast<char>(0x80 | (c & 0x3F));
+        } else if (c < 0x10000) {
+            out += static_cast<char>(0xE0 | (c >> 12));
+            out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (c & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (c >> 18));
+            out += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (c & 0x3F));
+        }
+    }
+    return out;
+}
+
+std::wstring WidenPath(const std::string& path) {
+    std::wstring out;
+    for (size_t i = 0; i < path.size();) {
+        uint8_t c = static_cast<uint8_t>(path[i]);
+        int extra = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : 0;
+        uint32_t code = extra == 0 ? c : (c & (0x3F >> extra));
+        i++;
+        for (int k = 0; k < extra && i < path.size(); k++, i++) {
+            code = (code << 6) | (static_cast<uint8_t>(path[i]) & 0x3F);
+        }
+        out += static_cast<wchar_t>(code);
+    }
+    return out;
+}
+
+bool ReadFileBytes(const std::wstring& path, std::vector<uint8_t>& data) {
+    data.clear();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart > 0x7FFFFFFF) {
+        CloseHandle(file);
+        return false;
+    }
+
+    data.resize(static_cast<size_t>(size.QuadPart));
+    DWORD read = 0;
+    bool ok = data.empty() ||
+        (ReadFile(file, data.data(), static_cast<DWORD>(data.size()), &read, NULL) && read == data.size());
+    CloseHandle(file);
+#else
+    FILE* file = fopen(NarrowPath(path).c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    bool ok = fseek(file, 0, SEEK_END) == 0;
+    long size = ok ? ftell(file) : -1;
+    ok = ok && size >= 0 && fseek(file, 0, SEEK_SET) == 0;
+    if (ok) {
+        data.resize(static_cast<size_t>(size));
+        ok = data.empty() || fread(data.data(), 1, data.size(), file) == data.size();
+    }
+    fclose(file);
+#endif
+
+    if (!ok) {
+        data.clear();
+    }
+    return ok;
+}
+
+bool WriteFileBytes(const std::wstring& path, const void* data, size_t size) {
+#ifdef _WIN32
+    if (size > 0xFFFFFFFF) {
+        return false;
+    }
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    DWORD written = 0;
+    bool ok = size == 0 ||
+        (WriteFile(file, data, static_cast<DWORD>(size), &written, NULL) && written == size);
+    ok = CloseHandle(file) && ok;
+#else
+    FILE* file = fopen(NarrowPath(path).c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+
+    bool ok = size == 0 || fwrite(data, 1, size, file) == size;
+    ok = fclose(file) == 0 && ok;
+#endif
+
+    // Leave no truncated file behind
+    if (!ok) {
+        DeleteFileAt(path);
+    }
+    return ok;
+}
+
+std::wstring GetFileExtension(const std::wstring& path) {
+    size_t dot = path.find_last_of(L'.');
+    size_t slash = path.find_last_of(L"\\/");
+    if (dot == std::wstring::npos || (slash != std::wstring::npos && dot < slash)) {
+        return std::wstring();
+    }
+    std::wstring ext = path.substr(dot);
+    for (auto& c : ext) {
+        c = static_cast<wchar_t>(std::towlower(c));
+    }
+    return ext;
+}
+
+std::wstring GetDirectoryPath(const std::wstring& path) {
+    size_t slash = path.find_last_of(L"\\/");
+    return slash == std::wstring::npos ? std::wstring() : path.substr(0, slash);
+}
+
+std::wstring GetFileName(const std::wstring& path) {
+    size_t slash = path.find_last_of(L"\\/");
+    return slash == std::wstring::npos ? path : path.substr(slash + 1);
+}
+
+bool ListDirectoryFiles(const std::wstring& directory, const std::vector<std::wstring>& extensions,
+                        std::vector<FileInfo>& files) {
+    files.clear();
+    auto wanted = [&extensions](const std::wstring& name) {
+        return std::find(extensions.begin(), extensions.end(), GetFileExtension(name)) != extensions.end();
+    };
+
+#ifdef _WIN32
+    WIN32_FIND_DATAW findData;
+    HANDLE find = FindFirstFileW((directory + L"\\*").c_str(), &findData);
+    if (find == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    do {
+        if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && wanted(findData.cFileName)) {
+            FileInfo file;
+            file.path = directory + L"\\" + findData.cFileName;
+            file.size = (static_cast<uint64_t>(findData.nFileSizeHigh) << 32) | findData.nFileSizeLow;
+            file.modifiedTime = (static_cast<uint64_t>(findData.ftLastWriteTime.dwHighDateTime) << 32) |
+                                findData.ftLastWriteTime.dwLowDateTime;
+            files.push_back(file);
+        }
+    } while (FindNextFileW(find, &findData));
+    FindClose(find);
+#else
+    std::string narrow = NarrowPath(directory);
+    DIR* dir = opendir(narrow.c_str());
+    if (!dir) {
+        return false;
+    }
+    while (dirent* entry = readdir(dir)) {
+        std::string full = narrow + "/" + entry->d_name;
+        struct stat info;
+        std::wstring name = WidenPath(entry->d_name);
+        if (stat(full.c_str(), &info) == 0 && S_ISREG(info.st_mode) && wanted(name)) {
+            FileInfo file;
+            file.path = directory + L"/" + name;
+            file.size = static_cast<uint64_t>(info.st_size);
+            file.modifiedTime = static_cast<uint64_t>(info.st_mtime);
+            files.push_back(file);
+        }
+    }
+    closedir(dir);
+#endif
+
+    std::sort(files.begin(), files.end(), [](const FileInfo& a, const FileInfo& b) {
+        return NaturalLess(a.path, b.path);
+    });
+    return true;
+}
+
+bool NaturalLess(const std::wstring& a, const std::wstring& b) {
+    size_t i = 0, j = 0;
+    while (i < a.size() && j < b.size()) {
+        if (std::iswdigit(a[i]) && std::iswdigit(b[j])) {
+            // Compare digit runs by value: skip leading zeros, then length, then digits
+            size_t startA = i, startB = j;
+            while (startA < a.size() && a[startA] == L'0') startA++;
+            while (startB < b.size() && b[startB] == L'0') startB++;
+            size_t endA = startA, endB = startB;
+            while (endA < a.size() && std::iswdigit(a[endA])) endA++;
+            while (endB < b.size() && std::iswdigit(b[endB])) endB++;
+            if (endA - startA != endB - startB) {
+                return endA - startA < endB - startB;
+            }
+            int order = a.compare(startA, endA - startA, b, startB, endB - startB);
+            if (order != 0) {
+                return order < 0;
+            }
+            i = endA;
+            j = endB;
+            continue;
+        }
+        wchar_t ca = static_cast<wchar_t>(std::towlower(a[i]));
+        wchar_t cb = static_cast<wchar_t>(std::towlower(b[j]));
+        if (ca != cb) {
+            return ca < cb;
+        }
+        i++;
+        j++;
+    }
+    if (a.size() - i != b.size() - j) {
+        return a.size() - i < b.size() - j;
+    }
+    return a < b;
+}
+
+bool RenameFile(const std::wstring& from, const std::wstring& to) {
+#ifdef _WIN32
+    return MoveFileExW(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(NarrowPath(from).c_str(), NarrowPath(to).c_str()) == 0;
+#endif
+}
+
+bool DeleteFileAt(const std::wstring& path) {
+#ifdef _WIN32
+    return DeleteFileW(path.c_str()) != 0;
+#else
+    return remove(NarrowPath(path).c_str()) == 0;
+#endif
+}
+
+std::wstring GetCacheDirectory() {
+#ifdef _WIN32
+    wchar_t base[MAX_PATH];
+    DWORD length = GetEnvironmentVariableW(L"LOCALAPPDATA", base, MAX_PATH);
+    if (length == 0 || length >= MAX_PATH) {
+        return std::wstring();
+    }
+    std::wstring directory = std::wstring(base) + L"\\PixelForge";
+    if (!CreateDirectoryW(directory.c_str(), NULL) && GetLastError() != ERROR_ALREADY_EXISTS) {
+        return std::wstring();
+    }
+#else
+    const char* xdg = getenv("XDG_CACHE_HOME");
+    const char* home = getenv("HOME");
+    if ((!xdg || !*xdg) && !home) {
+        return std::wstring();
+    }
+    std::string base = (xdg && *xdg) ? xdg : std::string(home) + "/.cache";
+    mkdir(base.c_str(), 0755);
+    std::string narrow = base + "/pixelforge";
+    if (mkdir(narrow.c_str(), 0755) != 0) {
+        struct stat info;
+        if (stat(narrow.c_str(), &info) != 0 || !S_ISDIR(info.st_mode)) {
+            return std::wstring();
+        }
+    }
+    std::wstring directory = WidenPath(narrow);
+#endif
+    return directory;
+}
+
+} // namespace PixelForge
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace PixelForge {
+
+struct FileInfo {
+    std::wstring path;
+    uint64_t size = 0;
+    uint64_t modifiedTime = 0;  // Platform file time; only compared for equality
+};
+
+// UTF-8 forms of paths, as used by the POSIX file APIs
+std::string NarrowPath(const std::wstring& path);
+std::wstring WidenPath(const std::string& path);
+
+// Reads a whole file into memory. Returns false if it cannot be opened or read.
+bool ReadFileBytes(const std::wstring& path, std::vector<uint8_t>& data);
+
+// Creates or replaces path with size bytes of data
+bool WriteFileBytes(const std::wstring& path, const void* data, size_t size);
+
+// Lower-case extension including the dot (L".gif"), or empty
+std::wstring GetFileExtension(const std::wstring& path);
+
+// Path up to (not including) the last separator, or empty
+std::wstring GetDirectoryPath(const std::wstring& path);
+
+// Path after the last separator
+std::wstring GetFileName(const std::wstring& path);
+
+// Regular files in directory whose extension is one of extensions
+// (lower-case, with the dot), in natural order. Sizes and times come from
+// the listing itself, so no file is opened.
+bool ListDirectoryFiles(const std::wstring& directory, const std::vector<std::wstring>& extensions,
+                        std::vector<FileInfo>& files);
+
+// Moves from onto to, replacing any existing file
+bool RenameFile(const std::wstring& from, const std::wstring& to);
+bool DeleteFileAt(const std::wstring& path);
+
+// Per-user cache folder (created if needed), or empty
+std::wstring GetCacheDirectory();
+
+// Case-insensitive comparison that orders digit runs by value ("2" < "10")
+bool NaturalLess(const std::wstring& a, const std::wstring& b);
+
+} // namespace PixelForge
\ No newline at end of file
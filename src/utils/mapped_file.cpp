@@ -0,0 +1,169 @@
+#include "mapped_file.h"
+#include "file_utils.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef DEBUG
+#include <stdio.h>
+#endif
+
+namespace PixelForge {
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+bool MappedFile::Open(const std::wstring& path, size_t minimumSize) {
+    Close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                              OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        #ifdef DEBUG
+        printf("ERROR: Could not open %ls (error %lu)\n", path.c_str(), GetLastError());
+        #endif
+        return false;
+    }
+    m_file = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        Close();
+        return false;
+    }
+    size_t current = static_cast<size_t>(size.QuadPart);
+#else
+    m_fd = open(NarrowPath(path).c_str(), O_RDWR | O_CREAT, 0644);
+    if (m_fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(m_fd, &info) != 0) {
+        Close();
+        return false;
+    }
+    size_t current = static_cast<size_t>(info.st_size);
+#endif
+
+    if (!Map(current > minimumSize ? current : minimumSize)) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool MappedFile::Map(size_t size) {
+    if (size == 0) {
+        return false;
+    }
+
+#ifdef _WIN32
+    // Creating the mapping extends the file to size
+    HANDLE mapping = CreateFileMappingW(static_cast<HANDLE>(m_file), NULL, PAGE_READWRITE,
+                                        static_cast<DWORD>(static_cast<uint64_t>(size) >> 32),
+                                        static_cast<DWORD>(size & 0xFFFFFFFF), NULL);
+    if (mapping == NULL) {
+        return false;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (view == NULL) {
+        CloseHandle(mapping);
+        return false;
+    }
+    m_mapping = mapping;
+    m_data = static_cast<uint8_t*>(view);
+#else
+    struct stat info;
+    if (fstat(m_fd, &info) != 0) {
+        return false;
+    }
+    if (static_cast<size_t>(info.st_size) < size && ftruncate(m_fd, static_cast<off_t>(size)) != 0) {
+        return false;
+    }
+    void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (view == MAP_FAILED) {
+        return false;
+    }
+    m_data = static_cast<uint8_t*>(view);
+#endif
+
+    m_size = size;
+    return true;
+}
+
+void MappedFile::Unmap() {
+#ifdef _WIN32
+    if (m_data) {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping) {
+        CloseHandle(static_cast<HANDLE>(m_mapping));
+        m_mapping = nullptr;
+    }
+#else
+    if (m_data) {
+        munmap(m_data, m_size);
+    }
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
+
+bool MappedFile::Resize(size_t size) {
+    if (!IsOpen()) {
+        return false;
+    }
+    size_t previous = m_size;
+    Unmap();
+
+#ifdef _WIN32
+    LARGE_INTEGER end;
+    end.QuadPart = static_cast<LONGLONG>(size);
+    bool truncated = SetFilePointerEx(static_cast<HANDLE>(m_file), end, NULL, FILE_BEGIN) &&
+                     SetEndOfFile(static_cast<HANDLE>(m_file));
+#else
+    bool truncated = ftruncate(m_fd, static_cast<off_t>(size)) == 0;
+#endif
+
+    // Keep the old mapping usable if the file could not be resized
+    if (!truncated || !Map(size)) {
+        Map(previous);
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::Flush() {
+    if (!m_data) {
+        return;
+    }
+#ifdef _WIN32
+    FlushViewOfFile(m_data, m_size);
+#else
+    msync(m_data, m_size, MS_ASYNC);
+#endif
+}
+
+void MappedFile::Close() {
+    Unmap();
+#ifdef _WIN32
+    if (m_file) {
+        CloseHandle(static_cast<HANDLE>(m_file));
+        m_file = nullptr;
+    }
+#else
+    if (m_fd >= 0) {
+        close(m_fd);
+        m_fd = -1;
+    }
+#endif
+}
+
+} // namespace PixelForge
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace PixelForge {
+
+// Read/write shared mapping of a whole file. Resizing remaps, so pointers
+// from Data() are invalidated by Resize and Close.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Opens or creates path and maps at least minimumSize bytes; new space
+    // reads as zero
+    bool Open(const std::wstring& path, size_t minimumSize);
+    bool Resize(size_t size);
+    void Flush();
+    void Close();
+
+    bool IsOpen() const { return m_data != nullptr; }
+    uint8_t* Data() { return m_data; }
+    const uint8_t* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+
+private:
+    bool Map(size_t size);
+    void Unmap();
+
+#ifdef _WIN32
+    void* m_file = nullptr;     // HANDLE
+    void* m_mapping = nullptr;  // HANDLE
+#else
+    int m_fd = -1;
+#endif
+    uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+};
+
+} // namespace PixelForge
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include "scratch_file.h"
+#include "file_utils.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef DEBUG
+#include <stdio.h>
+#endif
+
+namespace PixelForge {
+
+ScratchFile::~ScratchFile() {
+    Close();
+}
+
+bool ScratchFile::Create(const std::wstring& path) {
+    Close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        #ifdef DEBUG
+        printf("ERROR: Could not create %ls (error %lu)\n", path.c_str(), GetLastError());
+        #endif
+        return false;
+    }
+    m_file = file;
+#else
+    std::string narrow = NarrowPath(path);
+    m_fd = open(narrow.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (m_fd < 0) {
+        return false;
+    }
+    // Open descriptors keep the data; nothing is left behind on exit
+    unlink(narrow.c_str());
+#endif
+    return true;
+}
+
+void ScratchFile::Close() {
+#ifdef _WIN32
+    if (m_file) {
+        CloseHandle(static_cast<HANDLE>(m_file));
+        m_file = nullptr;
+    }
+#else
+    if (m_fd >= 0) {
+        close(m_fd);
+        m_fd = -1;
+    }
+#endif
+}
+
+bool ScratchFile::IsOpen() const {
+#ifdef _WIN32
+    return m_file != nullptr;
+#else
+    return m_fd >= 0;
+#endif
+}
+
+bool ScratchFile::Write(uint64_t offset, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    while (size > 0) {
+#ifdef _WIN32
+        // An explicit offset leaves the shared file pointer alone
+        OVERLAPPED position = {};
+        position.Offset = static_cast<DWORD>(offset & 0xFFFFFFFF);
+        position.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD written = 0;
+        DWORD chunk = static_cast<DWORD>(size < 0x40000000 ? size : 0x40000000);
+        if (!WriteFile(static_cast<HANDLE>(m_file), bytes, chunk, &written, &position) || written == 0) {
+            return false;
+        }
+#else
+        ssize_t written = pwrite(m_fd, bytes, size, static_cast<off_t>(offset));
+        if (written <= 0) {
+            return false;
+        }
+#endif
+        bytes += written;
+        offset += written;
+        size -= written;
+    }
+    return true;
+}
+
+bool ScratchFile::Read(uint64_t offset, void* data, size_t size) {
+    uint8_t* bytes = static_cast<uint8_t*>(data);
+    while (size > 0) {
+#ifdef _WIN32
+        OVERLAPPED position = {};
+        position.Offset = static_cast<DWORD>(offset & 0xFFFFFFFF);
+        position.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD read = 0;
+        DWORD chunk = static_cast<DWORD>(size < 0x40000000 ? size : 0x40000000);
+        if (!ReadFile(static_cast<HANDLE>(m_file), bytes, chunk, &read, &position) || read == 0) {
+            return false;
+        }
+#else
+        ssize_t read = pread(m_fd, bytes, size, static_cast<off_t>(offset));
+        if (read <= 0) {
+            return false;
+        }
+#endif
+        bytes += read;
+        offset += read;
+        size -= read;
+    }
+    return true;
+}
+
+} // namespace PixelForge
\ No newline at end of file
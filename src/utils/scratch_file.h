@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace PixelForge {
+
+// Temporary file for positioned reads and writes, which may come from
+// several threads at once. It is deleted when closed, or by the system if
+// the process exits first.
+class ScratchFile {
+public:
+    ScratchFile() = default;
+    ~ScratchFile();
+
+    ScratchFile(const ScratchFile&) = delete;
+    ScratchFile& operator=(const ScratchFile&) = delete;
+
+    // Creates path, replacing any existing file
+    bool Create(const std::wstring& path);
+    void Close();
+
+    bool Write(uint64_t offset, const void* data, size_t size);
+    bool Read(uint64_t offset, void* data, size_t size);
+
+    bool IsOpen() const;
+
+private:
+#ifdef _WIN32
+    void* m_file = nullptr;     // HANDLE
+#else
+    int m_fd = -1;
+#endif
+};
+
+} // namespace PixelForge
\ No newline at end of file
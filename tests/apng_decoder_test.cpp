@@ -0,0 +1,186 @@
+#include "test.h"
+#include "core/apng_decoder.h"
+
+using namespace PixelForge;
+
+namespace {
+
+void AppendU16(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+void AppendU32(std::vector<uint8_t>& out, uint32_t value) {
+    AppendU16(out, value >> 16);
+    AppendU16(out, value & 0xFFFF);
+}
+
+uint32_t Crc32(const uint8_t* data, size_t size) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < size; i++) {
+        crc ^= data[i];
+        for (int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+void AppendChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& body) {
+    AppendU32(out, static_cast<uint32_t>(body.size()));
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), body.begin(), body.end());
+    AppendU32(out, Crc32(out.data() + start, out.size() - start));
+}
+
+// zlib stream holding raw in one stored (uncompressed) block
+std::vector<uint8_t> StoredZlib(const std::vector<uint8_t>& raw) {
+    std::vector<uint8_t> out = { 0x78, 0x01, 0x01 };
+    out.push_back(static_cast<uint8_t>(raw.size()));
+    out.push_back(static_cast<uint8_t>(raw.size() >> 8));
+    out.push_back(static_cast<uint8_t>(~raw.size()));
+    out.push_back(static_cast<uint8_t>(~raw.size() >> 8));
+    out.insert(out.end(), raw.begin(), raw.end());
+    uint32_t a = 1, b = 0;
+    for (uint8_t value : raw) {
+        a = (a + value) % 65521;
+        b = (b + a) % 65521;
+    }
+    AppendU32(out, (b << 16) | a);
+    return out;
+}
+
+std::vector<uint8_t> FrameControl(uint32_t sequence, int width, int height, int x, int y,
+                                  int delayNum, int delayDen, uint8_t dispose, uint8_t blend) {
+    std::vector<uint8_t> body;
+    AppendU32(body, sequence);
+    AppendU32(body, width);
+    AppendU32(body, height);
+    AppendU32(body, x);
+    AppendU32(body, y);
+    AppendU16(body, delayNum);
+    AppendU16(body, delayDen);
+    body.push_back(dispose);
+    body.push_back(blend);
+    return body;
+}
+
+// Unfiltered RGBA rows of one colour
+std::vector<uint8_t> SolidRows(int width, int height, uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+    std::vector<uint8_t> rows;
+    for (int y = 0; y < height; y++) {
+        rows.push_back(0);
+        for (int x = 0; x < width; x++) {
+            rows.insert(rows.end(), { r, g, b, a });
+        }
+    }
+    return rows;
+}
+
+// 4x2 RGBA, played twice: a red frame for 100 ms, then a half transparent
+// blue 2x1 frame at (1, 1) for 200 ms blended over it
+std::vector<uint8_t> BuildApng(int canvasWidth = 4) {
+    static const uint8_t SIGNATURE[] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+    std::vector<uint8_t> out(SIGNATURE, SIGNATURE + sizeof(SIGNATURE));
+
+    std::vector<uint8_t> header;
+    AppendU32(header, canvasWidth);
+    AppendU32(header, 2);
+    header.insert(header.end(), { 8, 6, 0, 0, 0 });
+    AppendChunk(out, "IHDR", header);
+
+    std::vector<uint8_t> animation;
+    AppendU32(animation, 2);
+    AppendU32(animation, 2);
+    AppendChunk(out, "acTL", animation);
+
+    AppendChunk(out, "fcTL", FrameControl(0, 4, 2, 0, 0, 1, 10, 0, 0));
+    AppendChunk(out, "IDAT", StoredZlib(SolidRows(4, 2, 255, 0, 0, 255)));
+
+    AppendChunk(out, "fcTL", FrameControl(1, 2, 1, 1, 1, 20, 100, 1, 1));
+    std::vector<uint8_t> frameData;
+    AppendU32(frameData, 2);
+    std::vector<uint8_t> compressed = StoredZlib(SolidRows(2, 1, 0, 0, 255, 128));
+    frameData.insert(frameData.end(), compressed.begin(), compressed.end());
+    AppendChunk(out, "fdAT", frameData);
+
+    AppendChunk(out, "IEND", std::vector<uint8_t>());
+    return out;
+}
+
+} // namespace
+
+TEST(ApngDecodesFramesAndLoopCount) {
+    std::unique_ptr<AnimationDecoder> decoder = AnimationDecoder::Open(BuildApng());
+    CHECK(decoder != nullptr);
+    if (!decoder) {
+        return;
+    }
+    CHECK(decoder->Width() == 4);
+    CHECK(decoder->Height() == 2);
+    CHECK(decoder->FrameCount() == 2);
+    CHECK(decoder->LoopCount() == 2);
+
+    AnimationFrame frame;
+    CHECK(decoder->DecodeFrame(0, frame));
+    CHECK(frame.rect.Width() == 4 && frame.rect.Height() == 2);
+    CHECK(frame.delayMs == 100);
+    CHECK(frame.blend == FrameBlend::Source);
+    CHECK(frame.pixels.GetPixel(0, 0) == 0xFFFF0000);
+    CHECK(frame.pixels.GetPixel(3, 1) == 0xFFFF0000);
+
+    CHECK(decoder->DecodeFrame(1, frame));
+    CHECK(frame.rect.left == 1 && frame.rect.top == 1 && frame.rect.right == 3 && frame.rect.bottom == 2);
+    CHECK(frame.delayMs == 200);
+    CHECK(frame.disposal == FrameDisposal::Background);
+    CHECK(frame.blend == FrameBlend::Over);
+    CHECK(frame.pixels.GetPixel(0, 0) == 0x800000FF);
+    CHECK(frame.pixels.GetPixel(1, 0) == 0x800000FF);
+}
+
+TEST(ApngRejectsForgedCanvasSize) {
+    CHECK(AnimationDecoder::Open(BuildApng(100000)) == nullptr);
+
+    // Frames have to fit the canvas
+    std::vector<uint8_t> data = BuildApng();
+    data[8 + 25 + 20 + 8 + 4] = 0x10;   // fcTL 0 width high byte
+    CHECK(AnimationDecoder::Open(data) == nullptr);
+}
+
+TEST(ApngSurvivesTruncation) {
+    const std::vector<uint8_t> data = BuildApng();
+    for (size_t length = 0; length < data.size(); length++) {
+        std::vector<uint8_t> prefix(data.begin(), data.begin() + length);
+        std::unique_ptr<AnimationDecoder> decoder = AnimationDecoder::Open(prefix);
+        if (!decoder) {
+            continue;
+        }
+        // Frames whose data was cut off are dropped rather than decoded
+        CHECK(decoder->FrameCount() >= 1);
+        AnimationFrame frame;
+        for (int i = 0; i < decoder->FrameCount(); i++) {
+            CHECK(decoder->DecodeFrame(i, frame));
+        }
+    }
+}
+
+TEST(ApngFailsOnCorruptFrameData) {
+    const std::vector<uint8_t> clean = BuildApng();
+
+    // Break the stored block length of frame 0, then its filter byte
+    const size_t storedLength = 8 + 25 + 20 + 38 + 8 + 3;
+    std::vector<uint8_t> data = clean;
+    data[storedLength] ^= 0x01;
+    ApngDecoder badLength(data);
+    AnimationFrame frame;
+    CHECK(badLength.Parse());
+    CHECK(!badLength.DecodeFrame(0, frame));
+    CHECK(badLength.DecodeFrame(1, frame));
+
+    data = clean;
+    data[storedLength + 4] = 9;
+    ApngDecoder badFilter(data);
+    CHECK(badFilter.Parse());
+    CHECK(!badFilter.DecodeFrame(0, frame));
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "test.h"
+#include "core/buffer_pool.h"
+#include <cstdint>
+
+using namespace PixelForge;
+
+TEST(BufferPoolSizeClasses) {
+    // 256 bytes, then four classes per power of two
+    CHECK(BufferPool::RoundUp(1) == 256);
+    CHECK(BufferPool::RoundUp(256) == 256);
+    CHECK(BufferPool::RoundUp(257) == 320);
+    CHECK(BufferPool::RoundUp(320) == 320);
+    CHECK(BufferPool::RoundUp(321) == 384);
+    CHECK(BufferPool::RoundUp(512) == 512);
+    CHECK(BufferPool::RoundUp(513) == 640);
+    CHECK(BufferPool::RoundUp(900) == 1024);
+
+    // Past the largest class, requests are only rounded to the alignment
+    const size_t largest = size_t(64) * 1024 * 1024;
+    CHECK(BufferPool::RoundUp(largest) == largest);
+    CHECK(BufferPool::RoundUp(largest + 1) == largest + BufferPool::ALIGNMENT);
+
+    // Never short, never more than a quarter over, always whole cache lines
+    bool fits = true;
+    for (size_t bytes = 1; bytes < 300000; bytes += bytes / 64 + 1) {
+        size_t size = BufferPool::RoundUp(bytes);
+        fits &= size >= bytes && size % BufferPool::ALIGNMENT == 0;
+        fits &= bytes <= 256 || size <= bytes + bytes / 4;
+    }
+    CHECK(fits);
+}
+
+TEST(BufferPoolReusesBuffers) {
+    BufferPool pool(4096);
+    CHECK(pool.Acquire(0).IsEmpty());
+
+    PooledBuffer first = pool.Acquire(1000);
+    CHECK(first.Size() == 1024);
+    CHECK(reinterpret_cast<uintptr_t>(first.Data()) % BufferPool::ALIGNMENT == 0);
+    uint8_t* data = first.Data();
+    first.Reset();
+    CHECK(first.IsEmpty());
+
+    // Any request in the same class gets the freed buffer back
+    PooledBuffer second = pool.Acquire(900);
+    CHECK(second.Data() == data);
+    BufferPoolStats stats = pool.Stats();
+    CHECK(stats.acquires == 2 && stats.reuses == 1 && stats.heapAllocations == 1);
+    CHECK(stats.bytesInUse == 1024 && stats.cachedBytes == 0);
+
+    // Moving hands over ownership; the buffer is returned once
+    PooledBuffer moved = std::move(second);
+    CHECK(second.IsEmpty() && moved.Data() == data);
+    moved = PooledBuffer();
+    CHECK(pool.Stats().bytesInUse == 0 && pool.Stats().cachedBytes == 1024);
+
+    // A different class goes to the heap
+    PooledBuffer other = pool.Acquire(2000);
+    CHECK(other.Size() == 2048 && other.Data() != data);
+    CHECK(pool.Stats().heapAllocations == 2);
+}
+
+TEST(BufferPoolCapsCachedBytes) {
+    BufferPool pool(4096);
+    {
+        PooledBuffer a = pool.Acquire(2048);
+        PooledBuffer b = pool.Acquire(2048);
+        PooledBuffer c = pool.Acquire(2048);
+        CHECK(pool.Stats().bytesInUse == 3 * 2048);
+        CHECK(pool.Stats().peakBytesInUse == 3 * 2048);
+    }
+
+    // Two fit under the cap; the third goes back to the heap
+    BufferPoolStats stats = pool.Stats();
+    CHECK(stats.cachedBytes == 4096);
+    CHECK(stats.heapFrees == 1);
+    CHECK(stats.bytesInUse == 0);
+
+    pool.Trim();
+    stats = pool.Stats();
+    CHECK(stats.cachedBytes == 0 && stats.heapFrees == 3);
+    PooledBuffer again = pool.Acquire(2048);
+    CHECK(pool.Stats().reuses == 0);
+
+    // Buffers too large to pool are never cached
+    BufferPool big(size_t(1) << 30);
+    {
+        PooledBuffer huge = big.Acquire(size_t(64) * 1024 * 1024 + 1);
+        CHECK(!huge.IsEmpty());
+    }
+    CHECK(big.Stats().cachedBytes == 0 && big.Stats().heapFrees == 1);
+}
\ No newline at end of file
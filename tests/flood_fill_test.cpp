@@ -0,0 +1,207 @@
+#include "test.h"
+#include "core/flood_fill.h"
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+using namespace PixelForge;
+
+namespace {
+
+bool WithinTolerance(uint32_t a, uint32_t b, int tolerance) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        if (std::abs(static_cast<int>((a >> shift) & 0xFF) - static_cast<int>((b >> shift) & 0xFF)) > tolerance) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Pixel-at-a-time 4-connected fill to check the span fill against
+std::vector<uint8_t> ReferenceFill(const PixelBuffer& image, int seedX, int seedY, int tolerance, bool contiguous) {
+    const int width = image.Width();
+    const int height = image.Height();
+    const uint32_t seed = image.GetPixel(seedX, seedY);
+    std::vector<uint8_t> mask(static_cast<size_t>(width) * height, 0);
+    if (!contiguous) {
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                mask[static_cast<size_t>(y) * width + x] = WithinTolerance(image.GetPixel(x, y), seed, tolerance);
+            }
+        }
+        return mask;
+    }
+    std::vector<std::pair<int, int>> stack = { { seedX, seedY } };
+    while (!stack.empty()) {
+        auto [x, y] = stack.back();
+        stack.pop_back();
+        if (x < 0 || y < 0 || x >= width || y >= height || mask[static_cast<size_t>(y) * width + x] ||
+            !WithinTolerance(image.GetPixel(x, y), seed, tolerance)) {
+            continue;
+        }
+        mask[static_cast<size_t>(y) * width + x] = 1;
+        stack.push_back({ x - 1, y });
+        stack.push_back({ x + 1, y });
+        stack.push_back({ x, y - 1 });
+        stack.push_back({ x, y + 1 });
+    }
+    return mask;
+}
+
+bool SameMask(const Selection& selection, const std::vector<uint8_t>& mask) {
+    for (int y = 0; y < selection.Height(); y++) {
+        for (int x = 0; x < selection.Width(); x++) {
+            if ((selection.CoverageAt(x, y) == 255) != (mask[static_cast<size_t>(y) * selection.Width() + x] == 1)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Few distinct values, so regions are ragged and tolerance decides a lot
+PixelBuffer Blotches(int width, int height, uint32_t seed) {
+    std::mt19937 random(seed);
+    PixelBuffer image(width, height);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint8_t value = static_cast<uint8_t>(100 + (random() % 5) * 10);
+            image.SetPixel(x, y, MakeColor(value, 100, static_cast<uint8_t>(200 - value / 2)));
+        }
+    }
+    return image;
+}
+
+} // namespace
+
+TEST(MagicWandToleranceEdges) {
+    // Every channel, alpha included, is compared on its own; the widths put
+    // pixels in every position of the four-pixel compare and in the tail
+    const uint32_t seed = 0x80808080;
+    for (int width : { 1, 3, 4, 7, 13 }) {
+        for (int shift = 0; shift < 32; shift += 8) {
+            PixelBuffer image(width, 3);
+            image.Clear(seed);
+            for (int x = 0; x < width; x++) {
+                image.SetPixel(x, 1, seed + (static_cast<uint32_t>(x % 2 == 0 ? 20 : 21) << shift));
+                image.SetPixel(x, 2, seed - (static_cast<uint32_t>(x % 2 == 0 ? 20 : 21) << shift));
+            }
+            FillOptions options;
+            options.tolerance = 20;
+            options.contiguous = false;
+            Selection selection = MagicWand(image, 0, 0, options);
+            bool exact = true;
+            for (int x = 0; x < width; x++) {
+                exact &= selection.CoverageAt(x, 0) == 255;
+                exact &= (selection.CoverageAt(x, 1) == 255) == (x % 2 == 0);
+                exact &= (selection.CoverageAt(x, 2) == 255) == (x % 2 == 0);
+            }
+            CHECK(exact);
+        }
+    }
+
+    // Tolerance 0 takes only the exact color; 255 takes everything
+    PixelBuffer image = Blotches(37, 21, 1);
+    FillOptions options;
+    options.tolerance = 0;
+    CHECK(SameMask(MagicWand(image, 5, 5, options), ReferenceFill(image, 5, 5, 0, true)));
+    options.tolerance = 255;
+    Selection everything = MagicWand(image, 5, 5, options);
+    CHECK(everything.Bounds().right == 37 && everything.Bounds().bottom == 21);
+    CHECK(SameMask(everything, std::vector<uint8_t>(37 * 21, 1)));
+
+    // Seeds outside the image select nothing
+    CHECK(MagicWand(image, -1, 0, options).IsEmpty());
+    CHECK(MagicWand(image, 0, 21, options).IsEmpty());
+}
+
+TEST(MagicWandContiguousAndGlobal) {
+    // Two squares of the same color; only one touches the seed
+    PixelBuffer image(40, 20);
+    image.Clear(0xFFFFFFFF);
+    for (int y = 2; y < 10; y++) {
+        for (int x = 2; x < 10; x++) {
+            image.SetPixel(x, y, 0xFF0000FF);
+            image.SetPixel(x + 25, y + 8, 0xFF0000FF);
+        }
+    }
+    FillOptions options;
+    options.tolerance = 0;
+    Selection contiguous = MagicWand(image, 4, 4, options);
+    CHECK(contiguous.IsHardEdged());
+    CHECK(contiguous.Bounds().left == 2 && contiguous.Bounds().right == 10);
+    CHECK(contiguous.Bounds().top == 2 && contiguous.Bounds().bottom == 10);
+    CHECK(contiguous.CoverageAt(30, 12) == 0);
+
+    options.contiguous = false;
+    Selection global = MagicWand(image, 4, 4, options);
+    CHECK(global.CoverageAt(4, 4) == 255 && global.CoverageAt(30, 12) == 255);
+    CHECK(global.Bounds().right == 35 && global.Bounds().bottom == 18);
+
+    // Diagonal neighbours are not connected
+    PixelBuffer checker(8, 8);
+    for (int y = 0; y < 8; y++) {
+        for (int x = 0; x < 8; x++) {
+            checker.SetPixel(x, y, (x + y) % 2 ? 0xFF000000 : 0xFFFFFFFF);
+        }
+    }
+    options.contiguous = true;
+    Selection single = MagicWand(checker, 3, 3, options);
+    CHECK(single.Bounds().Width() == 1 && single.Bounds().Height() == 1);
+
+    // Ragged regions match a pixel-at-a-time fill, both ways, at several tolerances
+    const PixelBuffer blotches = Blotches(203, 67, 2);
+    for (int tolerance : { 0, 9, 10, 25 }) {
+        for (bool connected : { true, false }) {
+            options.tolerance = tolerance;
+            options.contiguous = connected;
+            CHECK(SameMask(MagicWand(blotches, 101, 33, options),
+                           ReferenceFill(blotches, 101, 33, tolerance, connected)));
+        }
+    }
+}
+
+TEST(BucketFillStaysInsideSelection) {
+    PixelBuffer image(100, 60);
+    image.Clear(0xFFFFFFFF);
+    const uint32_t paint = 0xFF2040C0;
+    FillOptions options;
+
+    // The whole white image matches, but only the selected rectangle is painted
+    const IntRect rect = { 30, 10, 70, 50 };
+    const Selection selection = Selection::Rectangle(100, 60, rect);
+    CHECK(BucketFill(image, 50, 30, paint, options, &selection));
+    bool inside = true;
+    for (int y = 0; y < 60; y++) {
+        for (int x = 0; x < 100; x++) {
+            inside &= image.GetPixel(x, y) == (rect.Contains(x, y) ? paint : 0xFFFFFFFF);
+        }
+    }
+    CHECK(inside);
+
+    // A selection of another size is refused rather than ignored
+    PixelBuffer before = image;
+    const Selection wrongSize = Selection::Rectangle(100, 61, rect);
+    CHECK(!BucketFill(image, 5, 5, paint, options, &wrongSize));
+    CHECK(std::memcmp(image.Data(), before.Data(), 100 * 60 * 4) == 0);
+    CHECK(!BucketFill(image, 100, 5, paint, options));
+
+    // Soft selection edges blend the paint
+    const Selection soft = Selection::Ellipse(100, 60, { 0, 0, 30, 30 }, true);
+    CHECK(BucketFill(image, 5, 5, 0xFF000000, options, &soft));
+    CHECK(image.GetPixel(15, 15) == 0xFF000000);
+    CHECK(image.GetPixel(40, 40) == paint);
+    bool blended = false;
+    for (int y = 0; y < 30; y++) {
+        for (int x = 0; x < 30; x++) {
+            uint32_t pixel = image.GetPixel(x, y);
+            blended |= pixel != 0xFF000000 && pixel != 0xFFFFFFFF;
+        }
+    }
+    CHECK(blended);
+
+    // Without a selection the region is everything connected to the seed
+    CHECK(BucketFill(image, 50, 30, 0xFF00FF00, options));
+    CHECK(image.GetPixel(30, 10) == 0xFF00FF00 && image.GetPixel(69, 49) == 0xFF00FF00);
+    CHECK(image.GetPixel(29, 10) != 0xFF00FF00);
+}
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include "test.h"
+#include "core/frame_arena.h"
+#include <cstdint>
+#include <thread>
+
+using namespace PixelForge;
+
+TEST(FrameArenaBumpsAndRewinds) {
+    FrameArena arena;
+    uint8_t* a = static_cast<uint8_t*>(arena.Allocate(100));
+    uint8_t* b = static_cast<uint8_t*>(arena.Allocate(100, 64));
+    CHECK(a && b);
+    CHECK(reinterpret_cast<uintptr_t>(b) % 64 == 0);
+    CHECK(b > a && b - a < 200);
+    CHECK(arena.Stats().blockAcquires == 1);
+
+    // Rewinding hands the same memory out again
+    FrameArena::Mark mark = arena.GetMark();
+    size_t inUse = arena.Stats().bytesInUse;
+    void* c = arena.Allocate(1000);
+    CHECK(arena.Stats().bytesInUse > inUse);
+    arena.Rewind(mark);
+    CHECK(arena.Stats().bytesInUse == inUse);
+    CHECK(arena.Allocate(1000) == c);
+
+    uint32_t* values = arena.AllocateArray<uint32_t>(16);
+    CHECK(values && reinterpret_cast<uintptr_t>(values) % 16 == 0);
+    CHECK(arena.Stats().allocations == 5);
+}
+
+TEST(FrameArenaMergesOnReset) {
+    // A frame that spills over three blocks...
+    FrameArena arena;
+    auto frame = [&arena]() {
+        bool ok = arena.Allocate(60 * 1024) != nullptr;
+        ok &= arena.Allocate(100 * 1024) != nullptr;
+        ok &= arena.Allocate(300 * 1024) != nullptr;
+        return ok;
+    };
+    CHECK(frame());
+    FrameArenaStats stats = arena.Stats();
+    CHECK(stats.blockAcquires == 3);
+    CHECK(stats.peakBytes >= 460 * 1024);
+    const size_t spilled = stats.capacity;
+
+    // ...is merged into one block big enough for all of it
+    arena.Reset();
+    stats = arena.Stats();
+    CHECK(stats.resets == 1 && stats.bytesInUse == 0);
+    CHECK(stats.blockAcquires == 4);
+    CHECK(stats.capacity >= spilled);
+
+    // so the same frame again needs nothing new
+    for (int i = 0; i < 3; i++) {
+        CHECK(frame());
+        arena.Reset();
+    }
+    CHECK(arena.Stats().blockAcquires == 4);
+
+    // More than the arena keeps is handed back on reset
+    CHECK(arena.Allocate(20 * 1024 * 1024) != nullptr);
+    arena.Reset();
+    CHECK(arena.Stats().capacity == 0);
+}
+
+TEST(FrameArenaScopes) {
+    FrameArena arena;
+    {
+        ArenaScope outer(arena);
+        outer.Arena().Allocate(500);
+        size_t inUse = arena.Stats().bytesInUse;
+        {
+            // An inner scope only rewinds to where it began
+            ArenaScope inner(arena);
+            inner.Arena().Allocate(5000);
+        }
+        CHECK(arena.Stats().bytesInUse == inUse);
+        CHECK(arena.Stats().resets == 0);
+    }
+    // The outermost scope resets the arena
+    CHECK(arena.Stats().resets == 1);
+    CHECK(arena.Stats().bytesInUse == 0);
+
+    // Each thread gets its own arena
+    FrameArena* other = nullptr;
+    std::thread([&other]() { other = &FrameArena::ForThread(); }).join();
+    CHECK(other != &FrameArena::ForThread());
+}
\ No newline at end of file
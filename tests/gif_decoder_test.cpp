@@ -0,0 +1,112 @@
+#include "test.h"
+#include "core/gif_decoder.h"
+
+using namespace PixelForge;
+
+namespace {
+
+// 6x4, two frames (50 and 120 ms), NETSCAPE loop value 2. Frame 0 cycles
+// red, green, blue and white along the diagonals; frame 1 paints the left
+// 3x4 white through a local colour table, leaving the pixels that already
+// were white transparent.
+const uint8_t ANIMATED_GIF[] = {
+    0x47, 0x49, 0x46, 0x38, 0x39, 0x61, 0x06, 0x00, 0x04, 0x00, 0x81, 0x00, 0x00, 0xFF, 0x00, 0x00,
+    0x00, 0xFF, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0x21, 0xFF, 0x0B, 0x4E, 0x45, 0x54, 0x53,
+    0x43, 0x41, 0x50, 0x45, 0x32, 0x2E, 0x30, 0x03, 0x01, 0x02, 0x00, 0x00, 0x21, 0xF9, 0x04, 0x04,
+    0x05, 0x00, 0x00, 0x00, 0x2C, 0x00, 0x00, 0x00, 0x00, 0x06, 0x00, 0x04, 0x00, 0x00, 0x08, 0x11,
+    0x00, 0x01, 0x04, 0x10, 0x30, 0x40, 0xE0, 0xC0, 0x82, 0x03, 0x09, 0x0A, 0x24, 0x88, 0x50, 0x61,
+    0x40, 0x00, 0x21, 0xF9, 0x04, 0x05, 0x0C, 0x00, 0x04, 0x00, 0x2C, 0x00, 0x00, 0x00, 0x00, 0x03,
+    0x00, 0x04, 0x00, 0x81, 0xFF, 0x00, 0x00, 0x00, 0xFF, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF,
+    0x08, 0x0C, 0x00, 0x07, 0x08, 0x14, 0x48, 0x60, 0x40, 0xC1, 0x82, 0x03, 0x02, 0x02, 0x00, 0x3B,
+};
+
+const size_t FRAME0_DATA = 63;          // Just past frame 0's minimum code size byte
+const size_t FRAME0_LZW_START = 64;     // First byte of frame 0's LZW data
+const size_t FRAME0_LZW_END = 82;       // Just past its block terminator
+
+std::vector<uint8_t> Fixture() {
+    return std::vector<uint8_t>(ANIMATED_GIF, ANIMATED_GIF + sizeof(ANIMATED_GIF));
+}
+
+} // namespace
+
+TEST(GifDecodesFramesAndLoopCount) {
+    std::unique_ptr<AnimationDecoder> decoder = AnimationDecoder::Open(Fixture());
+    CHECK(decoder != nullptr);
+    if (!decoder) {
+        return;
+    }
+    CHECK(decoder->Width() == 6);
+    CHECK(decoder->Height() == 4);
+    CHECK(decoder->FrameCount() == 2);
+    CHECK(decoder->LoopCount() == 3);   // Played once, then repeated twice
+
+    const uint32_t colors[] = { 0xFFFF0000, 0xFF00FF00, 0xFF0000FF, 0xFFFFFFFF };
+    AnimationFrame frame;
+    CHECK(decoder->DecodeFrame(0, frame));
+    CHECK(frame.rect.left == 0 && frame.rect.top == 0 && frame.rect.right == 6 && frame.rect.bottom == 4);
+    CHECK(frame.delayMs == 50);
+    bool matches = frame.pixels.Width() == 6 && frame.pixels.Height() == 4;
+    for (int y = 0; matches && y < 4; y++) {
+        for (int x = 0; x < 6; x++) {
+            matches &= frame.pixels.GetPixel(x, y) == colors[(x + y) % 4];
+        }
+    }
+    CHECK(matches);
+
+    CHECK(decoder->DecodeFrame(1, frame));
+    CHECK(frame.rect.left == 0 && frame.rect.top == 0 && frame.rect.right == 3 && frame.rect.bottom == 4);
+    CHECK(frame.delayMs == 120);
+    CHECK(frame.disposal == FrameDisposal::None);
+    matches = frame.pixels.Width() == 3 && frame.pixels.Height() == 4;
+    for (int y = 0; matches && y < 4; y++) {
+        for (int x = 0; x < 3; x++) {
+            matches &= frame.pixels.GetPixel(x, y) == ((x + y) % 4 == 3 ? 0 : 0xFFFFFFFF);
+        }
+    }
+    CHECK(matches);
+    CHECK(!decoder->DecodeFrame(2, frame));
+}
+
+TEST(GifRejectsForgedScreenSize) {
+    std::vector<uint8_t> data = Fixture();
+    data[6] = data[7] = data[8] = data[9] = 0xFF;   // 65535 x 65535
+    CHECK(AnimationDecoder::Open(data) == nullptr);
+}
+
+TEST(GifSurvivesTruncation) {
+    const std::vector<uint8_t> data = Fixture();
+    for (size_t length = 0; length < data.size(); length++) {
+        std::vector<uint8_t> prefix(data.begin(), data.begin() + length);
+        std::unique_ptr<AnimationDecoder> decoder = AnimationDecoder::Open(prefix);
+        // A cut off frame shows what arrived, but without any image data
+        // there is nothing to show
+        if (length < FRAME0_DATA) {
+            CHECK(decoder == nullptr);
+        }
+        if (!decoder) {
+            continue;
+        }
+        AnimationFrame frame;
+        for (int i = 0; i < decoder->FrameCount(); i++) {
+            decoder->DecodeFrame(i, frame);
+        }
+    }
+}
+
+TEST(GifSurvivesCorruptImageData) {
+    for (size_t pos = FRAME0_LZW_START; pos < FRAME0_LZW_END; pos++) {
+        for (uint8_t value : { 0x00, 0xFF }) {
+            std::vector<uint8_t> data = Fixture();
+            data[pos] = value;
+            std::unique_ptr<AnimationDecoder> decoder = AnimationDecoder::Open(data);
+            if (!decoder) {
+                continue;
+            }
+            AnimationFrame frame;
+            if (decoder->DecodeFrame(0, frame)) {
+                CHECK(frame.pixels.Width() == 6 && frame.pixels.Height() == 4);
+            }
+        }
+    }
+}
\ No newline at end of file
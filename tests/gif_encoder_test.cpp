@@ -0,0 +1,155 @@
+#include "test.h"
+#include "core/gif_decoder.h"
+#include "core/gif_encoder.h"
+#include <algorithm>
+#include <atomic>
+#include <random>
+
+using namespace PixelForge;
+
+namespace {
+
+IndexedImage RandomImage(int width, int height, int colors, uint32_t seed) {
+    std::mt19937 random(seed);
+    IndexedImage image;
+    image.width = width;
+    image.height = height;
+    for (int i = 0; i < colors; i++) {
+        image.palette.push_back(0xFF000000 | (random() & 0xFFFFFF));
+    }
+    image.indices.resize(static_cast<size_t>(width) * height);
+    for (auto& index : image.indices) {
+        index = static_cast<uint8_t>(random() % colors);
+    }
+    return image;
+}
+
+// Encodes image, decodes it again and compares every pixel with its
+// palette entry; the transparent entry comes back fully transparent
+bool RoundTrips(const IndexedImage& image) {
+    std::vector<uint8_t> encoded;
+    if (!EncodeGif(image, encoded)) {
+        return false;
+    }
+    GifDecoder decoder(encoded);
+    AnimationFrame frame;
+    if (!decoder.Parse() || decoder.FrameCount() != 1 || !decoder.DecodeFrame(0, frame) ||
+        frame.pixels.Width() != image.width || frame.pixels.Height() != image.height) {
+        return false;
+    }
+    for (int y = 0; y < image.height; y++) {
+        for (int x = 0; x < image.width; x++) {
+            int index = image.indices[static_cast<size_t>(y) * image.width + x];
+            uint32_t expected = index == image.transparentIndex ? 0 : image.palette[index];
+            if (frame.pixels.GetPixel(x, y) != expected) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+PixelBuffer Gradient(int width, int height) {
+    PixelBuffer image(width, height);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            image.SetPixel(x, y, MakeColor(static_cast<uint8_t>(x * 255 / width), static_cast<uint8_t>(y * 255 / height),
+                                           static_cast<uint8_t>((x + y) & 0xFF)));
+        }
+    }
+    return image;
+}
+
+} // namespace
+
+TEST(GifEncoderRoundTrip) {
+    CHECK(RoundTrips(RandomImage(1, 1, 1, 1)));
+    CHECK(RoundTrips(RandomImage(37, 23, 2, 2)));
+    CHECK(RoundTrips(RandomImage(37, 23, 5, 3)));       // Table padded to 8 entries
+    // Noise fills the 4096-entry code table many times over
+    CHECK(RoundTrips(RandomImage(300, 200, 256, 4)));
+
+    // Long runs walk the code size up to 12 bits
+    IndexedImage flat = RandomImage(500, 400, 4, 5);
+    std::fill(flat.indices.begin(), flat.indices.end(), 3);
+    CHECK(RoundTrips(flat));
+
+    IndexedImage transparent = RandomImage(64, 64, 16, 6);
+    transparent.transparentIndex = 7;
+    CHECK(RoundTrips(transparent));
+}
+
+TEST(GifEncoderRejectsInvalidImages) {
+    std::vector<uint8_t> encoded;
+    IndexedImage image = RandomImage(8, 8, 4, 7);
+    CHECK(EncodeGif(image, encoded));
+
+    IndexedImage noPalette = image;
+    noPalette.palette.clear();
+    CHECK(!EncodeGif(noPalette, encoded));
+
+    IndexedImage tooManyColors = image;
+    tooManyColors.palette.resize(257, 0xFF000000);
+    CHECK(!EncodeGif(tooManyColors, encoded));
+
+    IndexedImage wrongSize = image;
+    wrongSize.indices.pop_back();
+    CHECK(!EncodeGif(wrongSize, encoded));
+
+    IndexedImage tooWide = RandomImage(70000, 1, 4, 8);
+    CHECK(!EncodeGif(tooWide, encoded));
+    CHECK(encoded.empty());
+}
+
+TEST(QuantizerKeepsFewColorsExact) {
+    // 80 distinct colours, so the palette can hold them all
+    PixelBuffer image(40, 30);
+    for (int y = 0; y < 30; y++) {
+        for (int x = 0; x < 40; x++) {
+            image.SetPixel(x, y, MakeColor(static_cast<uint8_t>(x / 5 * 30), static_cast<uint8_t>(y / 6 * 50),
+                                           static_cast<uint8_t>((x + y) % 2 * 200)));
+        }
+    }
+    image.SetPixel(0, 0, 0x10FFFFFF);   // Under half alpha
+
+    QuantizeOptions options;
+    options.dither = DitherMode::None;
+    IndexedImage indexed;
+    CHECK(QuantizeImage(image, options, indexed));
+    CHECK(indexed.width == 40 && indexed.height == 30);
+    CHECK(indexed.palette.size() <= 256);
+    CHECK(indexed.transparentIndex >= 0);
+    bool exact = indexed.indices[0] == indexed.transparentIndex;
+    for (int i = 1; i < 40 * 30; i++) {
+        exact &= indexed.palette[indexed.indices[i]] == image.GetPixel(i % 40, i / 40);
+    }
+    CHECK(exact);
+    CHECK(RoundTrips(indexed));
+}
+
+TEST(QuantizerDitheredImageRoundTrips) {
+    // Large enough for the cache to be filled up front
+    const PixelBuffer image = Gradient(512, 300);
+    for (DitherMode dither : { DitherMode::Ordered, DitherMode::FloydSteinberg }) {
+        QuantizeOptions options;
+        options.maxColors = 64;
+        options.dither = dither;
+        IndexedImage indexed;
+        CHECK(QuantizeImage(image, options, indexed));
+        CHECK(indexed.palette.size() <= 64);
+        CHECK(RoundTrips(indexed));
+
+        // The same input quantizes the same way every time
+        IndexedImage again;
+        CHECK(QuantizeImage(image, options, again));
+        CHECK(again.palette == indexed.palette && again.indices == indexed.indices);
+    }
+}
+
+TEST(QuantizerStopsWhenCancelled) {
+    std::atomic<bool> cancel(true);
+    QuantizeOptions options;
+    options.cancel = &cancel;
+    IndexedImage indexed;
+    CHECK(!QuantizeImage(Gradient(256, 256), options, indexed));
+}
\ No newline at end of file
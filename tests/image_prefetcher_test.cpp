@@ -0,0 +1,205 @@
+#include "test.h"
+#include "core/image_prefetcher.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+using namespace PixelForge;
+
+namespace {
+
+// Every file is a 100x50 source, decoded to fit the display bounds
+const int SOURCE_WIDTH = 100;
+const int SOURCE_HEIGHT = 50;
+
+// Records the order files were decoded in; "bad" files fail and "slow"
+// files hold their worker until they are cancelled
+class FakeLoader {
+public:
+    ImageLoader Loader() {
+        return [this](const std::wstring& path, int maxWidth, int maxHeight,
+                      const std::atomic<bool>& cancel, PrefetchedImage& image) {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_order.push_back(path);
+            }
+            if (path.find(L"slow") != std::wstring::npos) {
+                auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+                while (!cancel && std::chrono::steady_clock::now() < deadline) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+                return false;
+            }
+            if (path.find(L"bad") != std::wstring::npos) {
+                return false;
+            }
+            double scale = (std::min)({ 1.0, (double)maxWidth / SOURCE_WIDTH, (double)maxHeight / SOURCE_HEIGHT });
+            image.sourceWidth = SOURCE_WIDTH;
+            image.sourceHeight = SOURCE_HEIGHT;
+            image.pixels.Resize(static_cast<int>(SOURCE_WIDTH * scale), static_cast<int>(SOURCE_HEIGHT * scale));
+            return true;
+        };
+    }
+
+    std::vector<std::wstring> Order() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_order;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::vector<std::wstring> m_order;
+};
+
+std::vector<std::wstring> Files(int count) {
+    std::vector<std::wstring> files;
+    for (int i = 0; i < count; i++) {
+        files.push_back(std::to_wstring(i));
+    }
+    return files;
+}
+
+template <typename Condition>
+bool WaitFor(Condition condition) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+} // namespace
+
+TEST(ImagePrefetcherFollowsDirection) {
+    FakeLoader fake;
+    ImagePrefetcher prefetcher(fake.Loader(), 3, 1 << 30, 1);
+    prefetcher.SetFiles(Files(10));
+    prefetcher.SetCurrent(5);
+    // Nothing decodes until the bounds are known
+    CHECK(fake.Order().empty());
+
+    // Current first, then the radius ahead nearest first, then one behind
+    prefetcher.SetDisplaySize(200, 200);
+    CHECK(WaitFor([&]() { return prefetcher.Stats().decoded == 5; }));
+    CHECK(fake.Order() == std::vector<std::wstring>({ L"5", L"6", L"7", L"8", L"4" }));
+    CHECK(prefetcher.Find(L"5") && prefetcher.Find(L"8") && prefetcher.Find(L"4"));
+    CHECK(!prefetcher.Find(L"3"));
+
+    // Turning round looks the other way; 4 and 5 are already cached
+    prefetcher.SetCurrent(4);
+    CHECK(WaitFor([&]() { return prefetcher.Stats().decoded == 8; }));
+    std::vector<std::wstring> order = fake.Order();
+    CHECK(std::vector<std::wstring>(order.begin() + 5, order.end()) ==
+          std::vector<std::wstring>({ L"3", L"2", L"1" }));
+
+    // The ends of the listing clip the window
+    prefetcher.SetCurrent(0);
+    CHECK(WaitFor([&]() { return prefetcher.Stats().decoded == 9; }));
+    CHECK(fake.Order().back() == L"0");
+    PrefetchStats stats = prefetcher.Stats();
+    CHECK(stats.cachedImages == 9);
+    CHECK(stats.cacheBytes == 9ull * SOURCE_WIDTH * SOURCE_HEIGHT * 4);
+}
+
+TEST(ImagePrefetcherEvictsFurthestFirst) {
+    // Room for two images
+    const size_t imageBytes = static_cast<size_t>(SOURCE_WIDTH) * SOURCE_HEIGHT * 4;
+    FakeLoader fake;
+    ImagePrefetcher prefetcher(fake.Loader(), 3, imageBytes * 2, 1);
+    prefetcher.SetFiles(Files(10));
+    prefetcher.SetCurrent(5);
+    prefetcher.SetDisplaySize(200, 200);
+    CHECK(WaitFor([&]() { return prefetcher.Stats().decoded == 5; }));
+
+    // Every later neighbour ranked below the two already cached
+    PrefetchStats stats = prefetcher.Stats();
+    CHECK(stats.cachedImages == 2);
+    CHECK(stats.cacheBytes == imageBytes * 2);
+    CHECK(prefetcher.Find(L"5") && prefetcher.Find(L"6"));
+    CHECK(!prefetcher.Find(L"7") && !prefetcher.Find(L"4"));
+
+    // Moving on makes 5 the furthest of the wanted window; 8 and 9 rank
+    // below 6 and 7 and are dropped as soon as they arrive
+    prefetcher.SetCurrent(6);
+    CHECK(WaitFor([&]() { return prefetcher.Stats().decoded == 8; }));
+    CHECK(prefetcher.Find(L"6") && prefetcher.Find(L"7"));
+    CHECK(!prefetcher.Find(L"5"));
+    CHECK(prefetcher.Stats().cacheBytes <= imageBytes * 2);
+
+    // A held image outlives its eviction
+    std::shared_ptr<const PrefetchedImage> held = prefetcher.Find(L"7");
+    prefetcher.SetCurrent(9);
+    CHECK(WaitFor([&]() { return !prefetcher.Find(L"7"); }));
+    CHECK(held && held->pixels.Width() == SOURCE_WIDTH);
+}
+
+TEST(ImagePrefetcherCancelsUnwantedDecodes) {
+    FakeLoader fake;
+    ImagePrefetcher prefetcher(fake.Loader(), 2, 1 << 30, 1);
+    std::vector<std::wstring> files = Files(10);
+    files[1] = L"slow";
+    prefetcher.SetFiles(files);
+    prefetcher.SetCurrent(0);
+    prefetcher.SetDisplaySize(200, 200);
+    CHECK(WaitFor([&]() { return fake.Order().size() == 2; }));
+
+    // Jumping away abandons the slow neighbour and decodes the new window
+    prefetcher.SetCurrent(8);
+    CHECK(WaitFor([&]() { return prefetcher.Find(L"8") && prefetcher.Find(L"9") && prefetcher.Find(L"7"); }));
+    PrefetchStats stats = prefetcher.Stats();
+    CHECK(stats.cancelled == 1);
+    CHECK(!prefetcher.HasFailed(L"slow"));
+    CHECK(!prefetcher.Find(L"slow"));
+}
+
+TEST(ImagePrefetcherReportsReadyAndFailed) {
+    FakeLoader fake;
+    ImagePrefetcher prefetcher(fake.Loader(), 1, 1 << 30, 1);
+    std::mutex mutex;
+    std::vector<std::wstring> ready;
+    prefetcher.SetReadyCallback([&](const std::wstring& path) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.push_back(path);
+    });
+    auto readyCount = [&]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return ready.size();
+    };
+
+    // The current image is decoded by the workers, not left to the caller
+    prefetcher.SetDisplaySize(80, 80);
+    prefetcher.SetFiles({ L"a", L"bad" });
+    prefetcher.SetCurrent(0);
+    CHECK(WaitFor([&]() { return readyCount() == 2; }));
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        CHECK(ready == std::vector<std::wstring>({ L"a", L"bad" }));
+    }
+    std::shared_ptr<const PrefetchedImage> image = prefetcher.Find(L"a");
+    CHECK(image && image->pixels.Width() == 80 && image->pixels.Height() == 40);
+    CHECK(image && image->sourceWidth == SOURCE_WIDTH);
+    CHECK(prefetcher.HasFailed(L"bad") && !prefetcher.Find(L"bad"));
+
+    // A failed file is not retried until the listing changes
+    prefetcher.SetCurrent(1);
+    prefetcher.SetCurrent(0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK(fake.Order().size() == 2);
+    prefetcher.SetFiles({ L"a", L"bad" });
+    CHECK(!prefetcher.HasFailed(L"bad"));
+    prefetcher.SetCurrent(1);
+    CHECK(WaitFor([&]() { return readyCount() == 3; }));
+    CHECK(prefetcher.HasFailed(L"bad"));
+
+    // Smaller bounds keep the cached image; larger ones decode it again
+    prefetcher.SetDisplaySize(60, 60);
+    CHECK(prefetcher.Find(L"a") == image);
+    prefetcher.SetDisplaySize(200, 200);
+    CHECK(WaitFor([&]() {
+        auto again = prefetcher.Find(L"a");
+        return again && again->pixels.Width() == SOURCE_WIDTH;
+    }));
+}
\ No newline at end of file
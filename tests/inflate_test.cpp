@@ -0,0 +1,111 @@
+#include "test.h"
+#include "core/inflate.h"
+#include <algorithm>
+
+using namespace PixelForge;
+
+namespace {
+
+// zlib level 9 output for DynamicText(2000), which uses a dynamic Huffman block
+const uint8_t DYNAMIC_ZLIB[] = {
+    0x78, 0xDA, 0xED, 0xCC, 0xC1, 0x01, 0x00, 0x41, 0x04, 0x03, 0xC0, 0x5A, 0x11, 0x96, 0xA0, 0xFF,
+    0xEF, 0x75, 0x71, 0x2F, 0x53, 0xC0, 0x88, 0x3A, 0xB1, 0x3D, 0xE2, 0x1D, 0xA6, 0x78, 0x13, 0xBA,
+    0x6B, 0x6F, 0xD3, 0xE1, 0x25, 0x09, 0x55, 0x94, 0xF2, 0xC5, 0xA3, 0x31, 0x80, 0x20, 0xA6, 0xB2,
+    0x06, 0x93, 0x11, 0x39, 0x2E, 0xCD, 0x96, 0x58, 0x66, 0x52, 0x9E, 0xEE, 0xAC, 0xA5, 0x36, 0x39,
+    0x56, 0x10, 0xB9, 0xFA, 0xEA, 0xAB, 0xAF, 0xBE, 0xFA, 0xEA, 0xAB, 0xFF, 0xA9, 0x3F, 0x40, 0xB7,
+    0x24, 0xE7,
+};
+
+// zlib level 9 output for "PixelForge PixelForge PixelForge", a fixed Huffman block
+const uint8_t FIXED_ZLIB[] = {
+    0x78, 0xDA, 0x0B, 0xC8, 0xAC, 0x48, 0xCD, 0x71, 0xCB, 0x2F, 0x4A, 0x4F, 0x55, 0x08, 0xC0, 0xC6,
+    0x04, 0x00, 0xC7, 0x52, 0x0C, 0x20,
+};
+
+const size_t ZLIB_HEADER = 2;
+const size_t ZLIB_TRAILER = 4;
+
+std::vector<uint8_t> DynamicText(int length) {
+    std::vector<uint8_t> text;
+    for (int i = 0; i < length; i++) {
+        text.push_back(static_cast<uint8_t>('a' + (i * i + i / 7) % 13));
+    }
+    return text;
+}
+
+std::vector<uint8_t> FixedText() {
+    const char* text = "PixelForge PixelForge PixelForge";
+    return std::vector<uint8_t>(text, text + 32);
+}
+
+} // namespace
+
+TEST(InflateDecodesFixedAndDynamicBlocks) {
+    std::vector<uint8_t> out;
+    CHECK(ZlibDecompress(DYNAMIC_ZLIB, sizeof(DYNAMIC_ZLIB), out));
+    CHECK(out == DynamicText(2000));
+
+    out.clear();
+    CHECK(ZlibDecompress(FIXED_ZLIB, sizeof(FIXED_ZLIB), out));
+    CHECK(out == FixedText());
+
+    // Output is appended
+    CHECK(Inflate(FIXED_ZLIB + ZLIB_HEADER, sizeof(FIXED_ZLIB) - ZLIB_HEADER - ZLIB_TRAILER, out));
+    CHECK(out.size() == 64);
+}
+
+TEST(InflateDecodesStoredBlocks) {
+    const uint8_t stored[] = { 0x00, 0x03, 0x00, 0xFC, 0xFF, 'a', 'b', 'c',
+                               0x01, 0x02, 0x00, 0xFD, 0xFF, 'd', 'e' };
+    std::vector<uint8_t> out;
+    CHECK(Inflate(stored, sizeof(stored), out));
+    CHECK(out == std::vector<uint8_t>({ 'a', 'b', 'c', 'd', 'e' }));
+
+    // Length and its complement disagree
+    uint8_t broken[sizeof(stored)];
+    std::copy(stored, stored + sizeof(stored), broken);
+    broken[3] = 0xFD;
+    out.clear();
+    CHECK(!Inflate(broken, sizeof(broken), out));
+}
+
+TEST(InflateFailsOnTruncatedStreams) {
+    const uint8_t* deflate = DYNAMIC_ZLIB + ZLIB_HEADER;
+    const size_t size = sizeof(DYNAMIC_ZLIB) - ZLIB_HEADER - ZLIB_TRAILER;
+    std::vector<uint8_t> out;
+    for (size_t length = 0; length < size; length++) {
+        out.clear();
+        CHECK(!Inflate(deflate, length, out));
+    }
+
+    out.clear();
+    CHECK(!ZlibDecompress(FIXED_ZLIB, 1, out));
+}
+
+TEST(InflateFailsOnCorruptStreams) {
+    // Block type 3 is reserved
+    const uint8_t reserved[] = { 0x07, 0x00 };
+    std::vector<uint8_t> out;
+    CHECK(!Inflate(reserved, sizeof(reserved), out));
+
+    // Damaged code tables and distances must fail or stop, never read or
+    // write out of bounds
+    for (size_t pos = ZLIB_HEADER; pos < sizeof(DYNAMIC_ZLIB) - ZLIB_TRAILER; pos++) {
+        for (uint8_t mask : { 0x01, 0x10, 0xFF }) {
+            std::vector<uint8_t> data(DYNAMIC_ZLIB, DYNAMIC_ZLIB + sizeof(DYNAMIC_ZLIB));
+            data[pos] ^= mask;
+            out.clear();
+            if (ZlibDecompress(data.data(), data.size(), out, 4000)) {
+                CHECK(out.size() <= 4000);
+            }
+        }
+    }
+}
+
+TEST(InflateHonoursMaxSize) {
+    std::vector<uint8_t> out;
+    CHECK(!ZlibDecompress(DYNAMIC_ZLIB, sizeof(DYNAMIC_ZLIB), out, 1999));
+    out.clear();
+    CHECK(ZlibDecompress(DYNAMIC_ZLIB, sizeof(DYNAMIC_ZLIB), out, 2000));
+    CHECK(out.size() == 2000);
+}
\ No newline at end of file
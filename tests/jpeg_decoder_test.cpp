@@ -0,0 +1,235 @@
+#include "test.h"
+#include "core/jpeg_decoder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace PixelForge;
+
+namespace {
+
+// 32x32 baseline, 4:2:0, a restart marker after every MCU. Red rises by 7
+// per column and green by 7 per row over a blue of 128.
+const uint8_t COLOR_JPEG[] = {
+    0xFF, 0xD8, 0xFF, 0xE0, 0x00, 0x10, 0x4A, 0x46, 0x49, 0x46, 0x00, 0x01, 0x01, 0x00, 0x00, 0x01,
+    0x00, 0x01, 0x00, 0x00, 0xFF, 0xDB, 0x00, 0x43, 0x00, 0x05, 0x03, 0x04, 0x04, 0x04, 0x03, 0x05,
+    0x04, 0x04, 0x04, 0x05, 0x05, 0x05, 0x06, 0x07, 0x0C, 0x08, 0x07, 0x07, 0x07, 0x07, 0x0F, 0x0B,
+    0x0B, 0x09, 0x0C, 0x11, 0x0F, 0x12, 0x12, 0x11, 0x0F, 0x11, 0x11, 0x13, 0x16, 0x1C, 0x17, 0x13,
+    0x14, 0x1A, 0x15, 0x11, 0x11, 0x18, 0x21, 0x18, 0x1A, 0x1D, 0x1D, 0x1F, 0x1F, 0x1F, 0x13, 0x17,
+    0x22, 0x24, 0x22, 0x1E, 0x24, 0x1C, 0x1E, 0x1F, 0x1E, 0xFF, 0xDB, 0x00, 0x43, 0x01, 0x05, 0x05,
+    0x05, 0x07, 0x06, 0x07, 0x0E, 0x08, 0x08, 0x0E, 0x1E, 0x14, 0x11, 0x14, 0x1E, 0x1E, 0x1E, 0x1E,
+    0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E,
+    0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E,
+    0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0xFF, 0xC0,
+    0x00, 0x11, 0x08, 0x00, 0x20, 0x00, 0x20, 0x03, 0x01, 0x22, 0x00, 0x02, 0x11, 0x01, 0x03, 0x11,
+    0x01, 0xFF, 0xC4, 0x00, 0x1F, 0x00, 0x00, 0x01, 0x05, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09,
+    0x0A, 0x0B, 0xFF, 0xC4, 0x00, 0xB5, 0x10, 0x00, 0x02, 0x01, 0x03, 0x03, 0x02, 0x04, 0x03, 0x05,
+    0x05, 0x04, 0x04, 0x00, 0x00, 0x01, 0x7D, 0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21,
+    0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07, 0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xA1, 0x08, 0x23,
+    0x42, 0xB1, 0xC1, 0x15, 0x52, 0xD1, 0xF0, 0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0A, 0x16, 0x17,
+    0x18, 0x19, 0x1A, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A,
+    0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A,
+    0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A,
+    0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99,
+    0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7,
+    0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5,
+    0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE1, 0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF1,
+    0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA, 0xFF, 0xC4, 0x00, 0x1F, 0x01, 0x00, 0x03,
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+    0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0xFF, 0xC4, 0x00, 0xB5, 0x11, 0x00,
+    0x02, 0x01, 0x02, 0x04, 0x04, 0x03, 0x04, 0x07, 0x05, 0x04, 0x04, 0x00, 0x01, 0x02, 0x77, 0x00,
+    0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71, 0x13,
+    0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xA1, 0xB1, 0xC1, 0x09, 0x23, 0x33, 0x52, 0xF0, 0x15,
+    0x62, 0x72, 0xD1, 0x0A, 0x16, 0x24, 0x34, 0xE1, 0x25, 0xF1, 0x17, 0x18, 0x19, 0x1A, 0x26, 0x27,
+    0x28, 0x29, 0x2A, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88,
+    0x89, 0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6,
+    0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4,
+    0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE2,
+    0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9,
+    0xFA, 0xFF, 0xDD, 0x00, 0x04, 0x00, 0x01, 0xFF, 0xDA, 0x00, 0x0C, 0x03, 0x01, 0x00, 0x02, 0x11,
+    0x03, 0x11, 0x00, 0x3F, 0x00, 0xF9, 0xB2, 0xCB, 0x4C, 0xE9, 0xF2, 0xD6, 0xDD, 0x96, 0x99, 0xD3,
+    0xE5, 0xAD, 0xAB, 0x2D, 0x33, 0xA7, 0xCB, 0x5B, 0x76, 0x5A, 0x67, 0x4F, 0x96, 0xBE, 0xF3, 0x13,
+    0x98, 0xF9, 0x9C, 0xB9, 0x2E, 0x6B, 0xB6, 0xA7, 0xFF, 0xD0, 0xF2, 0x2B, 0x2D, 0x33, 0xA7, 0xCB,
+    0x5B, 0x76, 0x5A, 0x67, 0x4F, 0x96, 0xB6, 0x6C, 0xB4, 0xCE, 0x9F, 0x2D, 0x6D, 0xD9, 0x69, 0x9D,
+    0x3E, 0x5A, 0xF7, 0xB1, 0x39, 0x8F, 0x99, 0xFA, 0x86, 0x4B, 0x9A, 0xED, 0xA9, 0xFF, 0xD1, 0xE5,
+    0x6C, 0xB4, 0xCE, 0x9F, 0x2D, 0x6D, 0xD9, 0x69, 0x9D, 0x3E, 0x5A, 0xDA, 0xB2, 0xD3, 0x3A, 0x7C,
+    0xB5, 0xB7, 0x65, 0xA6, 0x74, 0xF9, 0x69, 0xE2, 0x73, 0x1F, 0x33, 0xF2, 0xAC, 0x97, 0x35, 0xDB,
+    0x53, 0xFF, 0xD2, 0xB9, 0x65, 0xA6, 0x74, 0xF9, 0x6B, 0x6E, 0xCB, 0x4C, 0xE9, 0xF2, 0xD6, 0xD5,
+    0x96, 0x99, 0xD3, 0xE5, 0xAD, 0xAB, 0x2D, 0x33, 0xA7, 0xCB, 0x5E, 0x16, 0x27, 0x31, 0xF3, 0x35,
+    0xC9, 0x73, 0x5D, 0xB5, 0x3F, 0xFF, 0xD9,
+};
+
+const size_t COLOR_SCAN_DATA = 629;     // First entropy-coded byte
+
+// 17x9 baseline grayscale, 12 levels per column plus 4 per row
+const uint8_t GRAY_JPEG[] = {
+    0xFF, 0xD8, 0xFF, 0xE0, 0x00, 0x10, 0x4A, 0x46, 0x49, 0x46, 0x00, 0x01, 0x01, 0x00, 0x00, 0x01,
+    0x00, 0x01, 0x00, 0x00, 0xFF, 0xDB, 0x00, 0x43, 0x00, 0x03, 0x02, 0x02, 0x03, 0x02, 0x02, 0x03,
+    0x03, 0x03, 0x03, 0x04, 0x03, 0x03, 0x04, 0x05, 0x08, 0x05, 0x05, 0x04, 0x04, 0x05, 0x0A, 0x07,
+    0x07, 0x06, 0x08, 0x0C, 0x0A, 0x0C, 0x0C, 0x0B, 0x0A, 0x0B, 0x0B, 0x0D, 0x0E, 0x12, 0x10, 0x0D,
+    0x0E, 0x11, 0x0E, 0x0B, 0x0B, 0x10, 0x16, 0x10, 0x11, 0x13, 0x14, 0x15, 0x15, 0x15, 0x0C, 0x0F,
+    0x17, 0x18, 0x16, 0x14, 0x18, 0x12, 0x14, 0x15, 0x14, 0xFF, 0xC0, 0x00, 0x0B, 0x08, 0x00, 0x09,
+    0x00, 0x11, 0x01, 0x01, 0x11, 0x00, 0xFF, 0xC4, 0x00, 0x1F, 0x00, 0x00, 0x01, 0x05, 0x01, 0x01,
+    0x01, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x03, 0x04,
+    0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0xFF, 0xC4, 0x00, 0xB5, 0x10, 0x00, 0x02, 0x01, 0x03,
+    0x03, 0x02, 0x04, 0x03, 0x05, 0x05, 0x04, 0x04, 0x00, 0x00, 0x01, 0x7D, 0x01, 0x02, 0x03, 0x00,
+    0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07, 0x22, 0x71, 0x14, 0x32,
+    0x81, 0x91, 0xA1, 0x08, 0x23, 0x42, 0xB1, 0xC1, 0x15, 0x52, 0xD1, 0xF0, 0x24, 0x33, 0x62, 0x72,
+    0x82, 0x09, 0x0A, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x34, 0x35,
+    0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A, 0x53, 0x54, 0x55,
+    0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x73, 0x74, 0x75,
+    0x76, 0x77, 0x78, 0x79, 0x7A, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8A, 0x92, 0x93, 0x94,
+    0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2,
+    0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9,
+    0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE1, 0xE2, 0xE3, 0xE4, 0xE5, 0xE6,
+    0xE7, 0xE8, 0xE9, 0xEA, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA, 0xFF, 0xDA,
+    0x00, 0x08, 0x01, 0x01, 0x00, 0x00, 0x3F, 0x00, 0xF8, 0xFF, 0x00, 0xE0, 0x97, 0x86, 0xFF, 0x00,
+    0xE3, 0xDF, 0xE4, 0xF4, 0xAF, 0xD0, 0x0F, 0x82, 0x5E, 0x1B, 0xFF, 0x00, 0x8F, 0x7F, 0x93, 0xD2,
+    0xBE, 0x90, 0xFF, 0x00, 0x84, 0x6F, 0xFD, 0x8A, 0xFC, 0x9F, 0xF8, 0x25, 0xFF, 0x00, 0x2E, 0xFF,
+    0x00, 0x85, 0x7E, 0x80, 0x7C, 0x12, 0xFF, 0x00, 0x97, 0x7F, 0xC2, 0xBE, 0x90, 0xAF, 0xFF, 0xD9,
+};
+
+const size_t GRAY_SCAN_DATA = 328;
+
+// Largest channel difference from the expected gradient. A scaled pixel
+// is compared with the centre of the source pixels it covers.
+int GradientError(const PixelBuffer& image, int scale, bool color) {
+    int worst = 0;
+    for (int y = 0; y < image.Height(); y++) {
+        for (int x = 0; x < image.Width(); x++) {
+            double sx = (x + 0.5) * scale - 0.5;
+            double sy = (y + 0.5) * scale - 0.5;
+            uint32_t p = image.GetPixel(x, y);
+            double expected[3] = { sx * 7, sy * 7, 128 };
+            if (!color) {
+                expected[0] = expected[1] = expected[2] = sx * 12 + sy * 4;
+            }
+            for (int c = 0; c < 3; c++) {
+                int value = (p >> (16 - c * 8)) & 0xFF;
+                worst = (std::max)(worst, static_cast<int>(std::lround(std::fabs(value - expected[c]))));
+            }
+        }
+    }
+    return worst;
+}
+
+// Decodes at every scale without checking the result; damaged input must
+// only ever fail
+void DecodeAnyway(const uint8_t* data, size_t size) {
+    JpegDecoder decoder(data, size);
+    if (!decoder.ReadHeader()) {
+        return;
+    }
+    for (int scale : { 1, 8 }) {
+        PixelBuffer image;
+        if (decoder.Decode(scale, image)) {
+            CHECK(image.Width() == (decoder.Width() + scale - 1) / scale);
+            CHECK(image.Height() == (decoder.Height() + scale - 1) / scale);
+        }
+    }
+}
+
+} // namespace
+
+TEST(JpegDecodesColorWithRestartMarkers) {
+    JpegDecoder decoder(COLOR_JPEG, sizeof(COLOR_JPEG));
+    CHECK(decoder.ReadHeader());
+    CHECK(decoder.Width() == 32 && decoder.Height() == 32);
+
+    PixelBuffer image;
+    CHECK(decoder.Decode(1, image));
+    CHECK(image.Width() == 32 && image.Height() == 32);
+    CHECK(GradientError(image, 1, true) <= 12);
+    CHECK((image.GetPixel(0, 0) >> 24) == 0xFF);
+
+    // Restart segments decode in parallel; one thread must agree
+    JpegDecoder serial(COLOR_JPEG, sizeof(COLOR_JPEG));
+    serial.SetThreadCount(1);
+    PixelBuffer serialImage;
+    CHECK(serial.ReadHeader() && serial.Decode(1, serialImage));
+    CHECK(serialImage.Width() == 32 &&
+          std::memcmp(serialImage.Data(), image.Data(), 32 * 32 * 4) == 0);
+
+    for (int scale : { 2, 4, 8 }) {
+        CHECK(decoder.Decode(scale, image));
+        CHECK(image.Width() == 32 / scale && image.Height() == 32 / scale);
+    }
+    CHECK(decoder.Decode(2, image));
+    CHECK(GradientError(image, 2, true) <= 20);
+    CHECK(!decoder.Decode(3, image));
+}
+
+TEST(JpegDecodesGrayscale) {
+    JpegDecoder decoder(GRAY_JPEG, sizeof(GRAY_JPEG));
+    CHECK(decoder.ReadHeader());
+    CHECK(decoder.Width() == 17 && decoder.Height() == 9);
+
+    PixelBuffer image;
+    CHECK(decoder.Decode(1, image));
+    CHECK(image.Width() == 17 && image.Height() == 9);
+    CHECK(GradientError(image, 1, false) <= 8);
+
+    // Partial blocks round up
+    CHECK(decoder.Decode(8, image));
+    CHECK(image.Width() == 3 && image.Height() == 2);
+}
+
+TEST(JpegFailsOnTruncatedInput) {
+    for (size_t length = 0; length < sizeof(COLOR_JPEG); length++) {
+        JpegDecoder decoder(COLOR_JPEG, length);
+        bool header = decoder.ReadHeader();
+        if (length < COLOR_SCAN_DATA) {
+            CHECK(!header);
+        }
+        DecodeAnyway(COLOR_JPEG, length);
+    }
+    for (size_t length = 0; length < sizeof(GRAY_JPEG); length++) {
+        JpegDecoder decoder(GRAY_JPEG, length);
+        if (length < GRAY_SCAN_DATA) {
+            CHECK(!decoder.ReadHeader());
+        }
+        DecodeAnyway(GRAY_JPEG, length);
+    }
+}
+
+TEST(JpegSurvivesCorruptInput) {
+    // Every header byte, then the entropy-coded data and restart markers
+    for (size_t pos = 2; pos < sizeof(COLOR_JPEG); pos++) {
+        for (uint8_t mask : { 0x01, 0x10, 0x80, 0xFF }) {
+            std::vector<uint8_t> data(COLOR_JPEG, COLOR_JPEG + sizeof(COLOR_JPEG));
+            data[pos] ^= mask;
+            DecodeAnyway(data.data(), data.size());
+        }
+    }
+    for (size_t pos = GRAY_SCAN_DATA; pos < sizeof(GRAY_JPEG); pos++) {
+        std::vector<uint8_t> data(GRAY_JPEG, GRAY_JPEG + sizeof(GRAY_JPEG));
+        data[pos] ^= 0xFF;
+        DecodeAnyway(data.data(), data.size());
+    }
+}
+
+TEST(JpegRejectsOversizedFrames) {
+    std::vector<uint8_t> data(GRAY_JPEG, GRAY_JPEG + sizeof(GRAY_JPEG));
+    size_t frame = 0;
+    while (frame + 1 < data.size() && !(data[frame] == 0xFF && data[frame + 1] == 0xC0)) {
+        frame++;
+    }
+    auto readsHeader = [&](int width, int height) {
+        data[frame + 5] = static_cast<uint8_t>(height >> 8);
+        data[frame + 6] = static_cast<uint8_t>(height);
+        data[frame + 7] = static_cast<uint8_t>(width >> 8);
+        data[frame + 8] = static_cast<uint8_t>(width);
+        JpegDecoder decoder(data.data(), data.size());
+        return decoder.ReadHeader();
+    };
+
+    // 32 megapixels is the most; the header alone is enough to refuse
+    CHECK(readsHeader(17, 9));
+    CHECK(readsHeader(8192, 4096));
+    CHECK(!readsHeader(8193, 4096));
+    CHECK(!readsHeader(65535, 65535));
+    CHECK(!readsHeader(0, 9));
+}
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "test.h"
+#include "core/lz4.h"
+#include <random>
+
+using namespace PixelForge;
+
+namespace {
+
+bool RoundTrips(const std::vector<uint8_t>& data) {
+    std::vector<uint8_t> compressed;
+    Lz4Compress(data.data(), data.size(), compressed);
+    if (compressed.size() > Lz4CompressBound(data.size())) {
+        return false;
+    }
+    std::vector<uint8_t> restored(data.size());
+    return Lz4Decompress(compressed.data(), compressed.size(), restored.data(), restored.size()) &&
+           restored == data;
+}
+
+// Repetitive but not uniform, like a row of tile pixels
+std::vector<uint8_t> Text(size_t size) {
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; i++) {
+        data[i] = static_cast<uint8_t>("pixel forge tile "[i % 17] + (i / 1000) % 3);
+    }
+    return data;
+}
+
+} // namespace
+
+TEST(Lz4RoundTrip) {
+    std::mt19937 random(7);
+    for (size_t size = 1; size <= 40; size++) {
+        std::vector<uint8_t> data(size);
+        for (auto& value : data) {
+            value = static_cast<uint8_t>(random() % 3);
+        }
+        CHECK(RoundTrips(data));
+    }
+
+    std::vector<uint8_t> noise(70000);
+    for (auto& value : noise) {
+        value = static_cast<uint8_t>(random());
+    }
+    CHECK(RoundTrips(noise));
+    CHECK(RoundTrips(std::vector<uint8_t>(256 * 256 * 4, 0)));
+    CHECK(RoundTrips(Text(200000)));
+
+    // Matches further back than the 64 KB window cannot be used
+    std::vector<uint8_t> far = noise;
+    far.insert(far.end(), noise.begin(), noise.begin() + 1000);
+    CHECK(RoundTrips(far));
+
+    uint8_t none = 0;
+    std::vector<uint8_t> compressed;
+    Lz4Compress(&none, 0, compressed);
+    CHECK(Lz4Decompress(compressed.data(), compressed.size(), &none, 0));
+}
+
+TEST(Lz4FailsOnTruncatedInput) {
+    const std::vector<uint8_t> data = Text(5000);
+    std::vector<uint8_t> compressed;
+    Lz4Compress(data.data(), data.size(), compressed);
+    CHECK(compressed.size() < data.size());
+
+    std::vector<uint8_t> restored(data.size());
+    for (size_t length = 0; length < compressed.size(); length++) {
+        CHECK(!Lz4Decompress(compressed.data(), length, restored.data(), restored.size()));
+    }
+    // The block has to fill the output exactly
+    CHECK(!Lz4Decompress(compressed.data(), compressed.size(), restored.data(), restored.size() - 1));
+    restored.resize(data.size() + 1);
+    CHECK(!Lz4Decompress(compressed.data(), compressed.size(), restored.data(), restored.size()));
+}
+
+TEST(Lz4FailsOnCorruptInput) {
+    uint8_t out[64];
+
+    // One literal, then a match reaching two bytes back
+    const uint8_t tooFar[] = { 0x10, 'a', 0x02, 0x00 };
+    CHECK(!Lz4Decompress(tooFar, sizeof(tooFar), out, 5));
+    const uint8_t zeroOffset[] = { 0x10, 'a', 0x00, 0x00 };
+    CHECK(!Lz4Decompress(zeroOffset, sizeof(zeroOffset), out, 5));
+    const uint8_t valid[] = { 0x10, 'a', 0x01, 0x00 };
+    CHECK(Lz4Decompress(valid, sizeof(valid), out, 5));
+    CHECK(out[0] == 'a' && out[4] == 'a');
+
+    // Literal length extension running off the end
+    const uint8_t longLiterals[] = { 0xF0, 0xFF, 0xFF };
+    CHECK(!Lz4Decompress(longLiterals, sizeof(longLiterals), out, sizeof(out)));
+
+    // Damaged bytes anywhere may decode to garbage, but never outside the
+    // input and output buffers
+    const std::vector<uint8_t> data = Text(3000);
+    std::vector<uint8_t> compressed;
+    Lz4Compress(data.data(), data.size(), compressed);
+    std::vector<uint8_t> restored(data.size());
+    for (size_t pos = 0; pos < compressed.size(); pos++) {
+        for (uint8_t mask : { 0x01, 0x80, 0xFF }) {
+            std::vector<uint8_t> damaged = compressed;
+            damaged[pos] ^= mask;
+            Lz4Decompress(damaged.data(), damaged.size(), restored.data(), restored.size());
+        }
+    }
+}
\ No newline at end of file
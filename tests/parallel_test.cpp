@@ -0,0 +1,91 @@
+#include "test.h"
+#include "core/parallel.h"
+#include <set>
+#include <stdexcept>
+
+using namespace PixelForge;
+
+TEST(ParallelForCoversRange) {
+    // Every index exactly once, in contiguous chunks, for awkward splits too
+    for (int count : { 0, 1, 7, 9, 64, 1000, 1001 }) {
+        for (int minChunk : { 1, 3, 100 }) {
+            std::vector<std::atomic<int>> hits(count + 5);
+            std::atomic<bool> ordered(true);
+            ParallelFor(5, 5 + count, minChunk, [&](int first, int last) {
+                if (first >= last) {
+                    ordered = false;
+                }
+                for (int i = first; i < last; i++) {
+                    hits[i]++;
+                }
+            });
+            bool once = ordered;
+            for (int i = 0; i < count + 5; i++) {
+                once &= hits[i] == (i >= 5 ? 1 : 0);
+            }
+            CHECK(once);
+        }
+    }
+}
+
+TEST(WorkerPoolNestsAndShares) {
+    // Jobs whose tasks run jobs of their own, from several threads at once,
+    // all finish even though every worker may be busy
+    WorkerPool pool(3);
+    std::atomic<long long> total(0);
+    std::vector<std::thread> callers;
+    for (int t = 0; t < 4; t++) {
+        callers.emplace_back([&pool, &total]() {
+            for (int round = 0; round < 20; round++) {
+                pool.Run(16, [&pool, &total](int) {
+                    pool.Run(10, [&total](int chunk) {
+                        for (int j = chunk * 10; j < chunk * 10 + 10; j++) {
+                            total += j;
+                        }
+                    });
+                });
+            }
+        });
+    }
+    for (auto& caller : callers) {
+        caller.join();
+    }
+    CHECK(total == 4LL * 20 * 16 * 4950);
+}
+
+TEST(WorkerPoolReusesThreads) {
+    WorkerPool pool(2);
+    CHECK(pool.ThreadCount() == 2);
+    std::mutex mutex;
+    std::set<std::thread::id> seen;
+    for (int round = 0; round < 50; round++) {
+        pool.Run(8, [&](int) {
+            std::lock_guard<std::mutex> lock(mutex);
+            seen.insert(std::this_thread::get_id());
+        });
+    }
+    // The two workers and the caller, however many jobs ran
+    CHECK(seen.size() <= 3);
+    CHECK(seen.count(std::this_thread::get_id()) == 1);
+
+    // A throwing task fails the job once the others are done
+    std::atomic<int> ran(0);
+    bool caught = false;
+    try {
+        pool.Run(16, [&ran](int index) {
+            if (index == 5) {
+                throw std::runtime_error("task failed");
+            }
+            ran++;
+        });
+    } catch (const std::runtime_error&) {
+        caught = true;
+    }
+    CHECK(caught);
+    CHECK(ran == 15);
+
+    // and the pool keeps working afterwards
+    std::atomic<int> after(0);
+    pool.Run(4, [&after](int) { after++; });
+    CHECK(after == 4);
+}
\ No newline at end of file
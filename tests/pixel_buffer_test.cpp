@@ -0,0 +1,41 @@
+#include "test.h"
+#include "core/pixel_buffer.h"
+
+using namespace PixelForge;
+
+TEST(BlendOverOpaqueDestination) {
+    const uint32_t dst = MakeColor(200, 100, 0);
+    const uint32_t color = MakeColor(0, 100, 255);
+    CHECK(BlendOver(dst, color, 0) == dst);
+    CHECK(BlendOver(dst, color, 255) == color);
+    CHECK(BlendOver(dst, color, 128) == MakeColor(100, 100, 128));
+    CHECK(BlendOver(dst, color, 64) == MakeColor(150, 100, 64));
+
+    // Out-of-range alpha is clamped
+    CHECK(BlendOver(dst, color, -5) == dst);
+    CHECK(BlendOver(dst, color, 300) == color);
+}
+
+TEST(BlendOverIgnoresColorAlpha) {
+    // Only the alpha argument counts, so full alpha is always opaque; the
+    // rasterizer's copy used to pass a translucent color straight through
+    const uint32_t translucent = MakeColor(10, 20, 30, 40);
+    CHECK(BlendOver(MakeColor(255, 255, 255), translucent, 255) == MakeColor(10, 20, 30));
+    CHECK(BlendOver(0, translucent, 255) == MakeColor(10, 20, 30));
+    CHECK(BlendOver(MakeColor(0, 0, 0), translucent, 128) == BlendOver(MakeColor(0, 0, 0), MakeColor(10, 20, 30), 128));
+}
+
+TEST(BlendOverTranslucentDestination) {
+    // Zero alpha keeps even a fully transparent pixel's color bits
+    CHECK(BlendOver(0x00123456, 0xFFFFFFFF, 0) == 0x00123456);
+
+    // Onto nothing the color comes through at the given alpha
+    CHECK(BlendOver(0, MakeColor(90, 180, 30), 100) == MakeColor(90, 180, 30, 100));
+
+    // Half over half: alpha 128 + 64, colors weighted 2:1 towards the source
+    uint32_t result = BlendOver(MakeColor(0, 0, 255, 128), MakeColor(255, 0, 0), 128);
+    CHECK((result >> 24) == 192);
+    CHECK(((result >> 16) & 0xFF) == 170);
+    CHECK(((result >> 8) & 0xFF) == 0);
+    CHECK((result & 0xFF) == 85);
+}
\ No newline at end of file
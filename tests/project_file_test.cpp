@@ -0,0 +1,239 @@
+#include "test.h"
+#include "core/project_file.h"
+#include "utils/file_utils.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+using namespace PixelForge;
+
+namespace {
+
+// On-disk layout, as written by ProjectFile
+const size_t HEADER_TABLE_OFFSET = 24;
+const size_t HEADER_BYTES = 64;
+const size_t ENTRY_BYTES = 32;
+const uint8_t CHUNK_TILE = 2;
+const uint8_t CODEC_LZ4 = 1;
+
+// 8x8 blocks of colour, so tiles compress without being uniform
+PixelBuffer Pattern(int width, int height, uint8_t blue) {
+    PixelBuffer image(width, height);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            image.SetPixel(x, y, MakeColor(static_cast<uint8_t>(x / 8 * 8), static_cast<uint8_t>(y / 8 * 8), blue));
+        }
+    }
+    return image;
+}
+
+// Two layers over 3x2 tiles: a pattern, and a solid tile and a patterned
+// tile on top. The other top tiles stay empty.
+std::unique_ptr<Document> BuildDocument() {
+    auto document = std::make_unique<Document>(600, 300);
+    document->AddLayer(L"Background");
+    document->SetPixels(0, Pattern(600, 300, 64));
+    document->AddLayer(L"Top");
+    document->SetLayerOpacity(1, 128);
+    document->SetLayerVisible(1, false);
+    document->WriteTile(1, 0, 0).Clear(0xFF336699);
+    document->WriteTile(1, 2, 1) = Pattern(88, 44, 200);
+    return document;
+}
+
+bool SameTiles(Document& a, Document& b) {
+    if (a.Width() != b.Width() || a.Height() != b.Height() || a.LayerCount() != b.LayerCount()) {
+        return false;
+    }
+    for (int layer = 0; layer < a.LayerCount(); layer++) {
+        for (int ty = 0; ty < a.TilesY(); ty++) {
+            for (int tx = 0; tx < a.TilesX(); tx++) {
+                const PixelBuffer* pa;
+                const PixelBuffer* pb;
+                if (!a.ReadTile(layer, tx, ty, pa) || !b.ReadTile(layer, tx, ty, pb) || !pa != !pb) {
+                    return false;
+                }
+                if (pa && (pa->Width() != pb->Width() || pa->Height() != pb->Height() ||
+                           std::memcmp(pa->Data(), pb->Data(), static_cast<size_t>(pa->Width()) * pa->Height() * 4))) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+uint64_t ReadU64(const std::vector<uint8_t>& data, size_t pos) {
+    uint64_t value;
+    std::memcpy(&value, data.data() + pos, 8);
+    return value;
+}
+
+} // namespace
+
+TEST(ProjectFileRoundTrip) {
+    const std::wstring path = Test::TempPath(L"round-trip.pfp");
+    std::unique_ptr<Document> original = BuildDocument();
+    ProjectFile saver;
+    CHECK(saver.SaveAs(*original, path));
+    CHECK(!original->IsModified());
+    saver.Close();
+
+    ProjectFile file;
+    std::unique_ptr<Document> opened;
+    CHECK(file.Open(path, opened));
+    if (!opened) {
+        return;
+    }
+    CHECK(opened->GetLayer(0).Name() == L"Background");
+    CHECK(opened->GetLayer(1).Name() == L"Top");
+    CHECK(opened->GetLayer(1).Opacity() == 128);
+    CHECK(!opened->GetLayer(1).IsVisible());
+    CHECK(opened->GetLayer(1).Tile(1).state == TileState::Empty);
+    CHECK(SameTiles(*original, *opened));
+
+    // An in-place save only appends what changed
+    opened->WriteTile(0, 1, 1).Clear(0xFFFFFFFF);
+    CHECK(file.Save(*opened));
+    CHECK(file.LastSaveStats().chunksReused > 0);
+    CHECK(!file.LastSaveStats().rewritten);
+
+    ProjectFile saved;
+    std::unique_ptr<Document> reopened;
+    CHECK(saved.Open(path, reopened));
+    CHECK(reopened && SameTiles(*opened, *reopened));
+
+    saved.Close();
+    file.Close();
+    DeleteFileAt(path);
+}
+
+TEST(ProjectFileCancelledSaveKeepsPreviousVersion) {
+    const std::wstring path = Test::TempPath(L"cancelled.pfp");
+    std::unique_ptr<Document> original = BuildDocument();
+    ProjectFile file;
+    CHECK(file.SaveAs(*original, path));
+
+    std::unique_ptr<Document> opened;
+    CHECK(file.Open(path, opened));
+    if (!opened) {
+        return;
+    }
+    opened->WriteTile(0, 0, 0).Clear(0xFF000000);
+
+    std::atomic<bool> cancel(true);
+    TaskControl control;
+    control.cancel = &cancel;
+    CHECK(!file.Save(*opened, &control));
+    CHECK(opened->IsModified());
+
+    ProjectFile previous;
+    std::unique_ptr<Document> reopened;
+    CHECK(previous.Open(path, reopened));
+    CHECK(reopened && SameTiles(*original, *reopened));
+
+    previous.Close();
+    file.Close();
+    DeleteFileAt(path);
+}
+
+TEST(ProjectFileRejectsTruncatedFiles) {
+    const std::wstring path = Test::TempPath(L"truncated.pfp");
+    const std::wstring cut = Test::TempPath(L"truncated-cut.pfp");
+    std::unique_ptr<Document> original = BuildDocument();
+    ProjectFile saver;
+    CHECK(saver.SaveAs(*original, path));
+    saver.Close();
+    std::vector<uint8_t> data;
+    CHECK(ReadFileBytes(path, data));
+
+    // The chunk table is written last, so every prefix loses part of it
+    const size_t step = (std::max)(data.size() / 97, static_cast<size_t>(1));
+    for (size_t length = 0; length < data.size(); length += length < HEADER_BYTES ? 1 : step) {
+        CHECK(WriteFileBytes(cut, data.data(), length));
+        ProjectFile file;
+        std::unique_ptr<Document> opened;
+        CHECK(!file.Open(cut, opened));
+    }
+
+    DeleteFileAt(cut);
+    DeleteFileAt(path);
+}
+
+TEST(ProjectFileRejectsDamagedTable) {
+    const std::wstring path = Test::TempPath(L"damaged-table.pfp");
+    std::unique_ptr<Document> original = BuildDocument();
+    ProjectFile saver;
+    CHECK(saver.SaveAs(*original, path));
+    saver.Close();
+    std::vector<uint8_t> data;
+    CHECK(ReadFileBytes(path, data));
+
+    const size_t table = static_cast<size_t>(ReadU64(data, HEADER_TABLE_OFFSET));
+    CHECK(table > HEADER_BYTES && table < data.size());
+    for (size_t pos = table; pos < data.size(); pos += 7) {
+        std::vector<uint8_t> damaged = data;
+        damaged[pos] ^= 0x40;
+        CHECK(WriteFileBytes(path, damaged.data(), damaged.size()));
+        ProjectFile file;
+        std::unique_ptr<Document> opened;
+        CHECK(!file.Open(path, opened));
+    }
+
+    DeleteFileAt(path);
+}
+
+TEST(ProjectFileReportsDamagedTiles) {
+    const std::wstring path = Test::TempPath(L"damaged-tile.pfp");
+    const std::wstring copy = Test::TempPath(L"damaged-tile-copy.pfp");
+    std::unique_ptr<Document> original = BuildDocument();
+    ProjectFile saver;
+    CHECK(saver.SaveAs(*original, path));
+    saver.Close();
+    std::vector<uint8_t> data;
+    CHECK(ReadFileBytes(path, data));
+
+    // Overwrite the compressed pixels of the first LZ4 tile; the table and
+    // its checksum stay intact
+    const size_t table = static_cast<size_t>(ReadU64(data, HEADER_TABLE_OFFSET));
+    int damagedX = -1;
+    int damagedY = -1;
+    uint32_t damagedOwner = 0;
+    for (size_t pos = table; pos + ENTRY_BYTES <= data.size(); pos += ENTRY_BYTES) {
+        if (data[pos] == CHUNK_TILE && data[pos + 1] == CODEC_LZ4) {
+            uint32_t stored;
+            std::memcpy(&damagedOwner, &data[pos + 4], 4);
+            damagedX = data[pos + 8] | (data[pos + 9] << 8);
+            damagedY = data[pos + 10] | (data[pos + 11] << 8);
+            std::memcpy(&stored, &data[pos + 12], 4);
+            size_t offset = static_cast<size_t>(ReadU64(data, pos + 16));
+            std::memset(&data[offset], 0xFF, stored);
+            break;
+        }
+    }
+    CHECK(damagedX >= 0);
+    CHECK(WriteFileBytes(path, data.data(), data.size()));
+
+    ProjectFile file;
+    std::unique_ptr<Document> opened;
+    CHECK(file.Open(path, opened));
+    if (!opened || damagedX < 0) {
+        return;
+    }
+    const int layer = opened->FindLayer(damagedOwner);
+    CHECK(layer >= 0);
+    const PixelBuffer* pixels;
+    CHECK(!opened->ReadTile(layer, damagedX, damagedY, pixels));
+    // Still stored, so it is retried rather than taken for empty
+    CHECK(opened->GetLayer(layer).Tile(damagedY * opened->TilesX() + damagedX).state == TileState::Stored);
+    CHECK(!opened->ReadTile(layer, damagedX, damagedY, pixels));
+
+    // Saving elsewhere must not silently drop the unreadable tile
+    ProjectFile other;
+    CHECK(!other.SaveAs(*opened, copy));
+
+    other.Close();
+    file.Close();
+    DeleteFileAt(copy);
+    DeleteFileAt(path);
+}
\ No newline at end of file
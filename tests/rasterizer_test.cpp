@@ -0,0 +1,202 @@
+#include "test.h"
+#include "core/rasterizer.h"
+#include <cmath>
+
+using namespace PixelForge;
+
+namespace {
+
+const uint32_t BLACK = 0xFF000000;
+const uint32_t WHITE = 0xFFFFFFFF;
+
+// White over opaque black leaves the coverage in every color channel
+int CoverageAt(const PixelBuffer& target, int x, int y) {
+    return target.GetPixel(x, y) & 0xFF;
+}
+
+// Covered area in pixels
+double CoveredArea(const PixelBuffer& target) {
+    double total = 0.0;
+    for (int y = 0; y < target.Height(); y++) {
+        for (int x = 0; x < target.Width(); x++) {
+            total += CoverageAt(target, x, y) / 255.0;
+        }
+    }
+    return total;
+}
+
+PixelBuffer FillPath(const Path& path, FillRule rule) {
+    PixelBuffer target(100, 100, BLACK);
+    Rasterizer rasterizer;
+    rasterizer.Fill(target, path, WHITE, rule);
+    return target;
+}
+
+PixelBuffer StrokePath(const Path& path, const StrokeStyle& style) {
+    PixelBuffer target(100, 100, BLACK);
+    Rasterizer rasterizer;
+    rasterizer.Stroke(target, path, WHITE, style);
+    return target;
+}
+
+bool Near(double value, double expected, double tolerance) {
+    return std::fabs(value - expected) <= tolerance;
+}
+
+// Curves are flattened to chords at most 0.1 pixels inside the true curve
+bool FlattenedArea(double value, double exact, double curveLength) {
+    return value <= exact + 0.5 && value >= exact - 0.1 * curveLength;
+}
+
+} // namespace
+
+TEST(RasterizerCoverageSums) {
+    // Fractional edges: corners and sides get partial coverage, the inside is solid
+    Path rect;
+    rect.AddRectangle(10.25f, 5.5f, 20.5f, 7.25f);
+    PixelBuffer target = FillPath(rect, FillRule::NonZero);
+    CHECK(Near(CoveredArea(target), 20.5 * 7.25, 0.05));
+    CHECK(CoverageAt(target, 20, 8) == 255);
+    CHECK(Near(CoverageAt(target, 10, 5), 255 * 0.75 * 0.5, 1));
+    CHECK(Near(CoverageAt(target, 30, 12), 255 * 0.75 * 0.75, 1));
+    CHECK(CoverageAt(target, 9, 8) == 0 && CoverageAt(target, 31, 8) == 0);
+
+    // Sloped edges crossing many pixels per row
+    Path triangle;
+    triangle.AddPolyline({ { 5.0f, 90.0f }, { 95.0f, 80.0f }, { 40.0f, 10.5f } }, true);
+    CHECK(Near(CoveredArea(FillPath(triangle, FillRule::NonZero)), 0.5 * std::fabs(90.0 * -79.5 - 35.0 * -10.0), 0.5));
+
+    Path ellipse;
+    ellipse.AddEllipse(50.0f, 50.0f, 30.0f, 20.0f);
+    CHECK(FlattenedArea(CoveredArea(FillPath(ellipse, FillRule::NonZero)), 3.14159265 * 30.0 * 20.0, 160.0));
+
+    // Shapes hanging off the target keep only the part inside
+    Path offEdge;
+    offEdge.AddRectangle(-20.0f, 90.0f, 50.0f, 30.0f);
+    CHECK(Near(CoveredArea(FillPath(offEdge, FillRule::NonZero)), 30.0 * 10.0, 0.05));
+
+    // A translucent color scales the coverage
+    PixelBuffer faint(100, 100, BLACK);
+    Rasterizer rasterizer;
+    rasterizer.Fill(faint, rect, 0x80FFFFFF);
+    CHECK(Near(CoverageAt(faint, 20, 8), 128, 1));
+
+    // The scratch buffers are reused; a small shape after a big one is unaffected
+    rasterizer.Fill(faint, ellipse, WHITE);
+    PixelBuffer again(100, 100, BLACK);
+    rasterizer.Fill(again, rect, WHITE);
+    CHECK(Near(CoveredArea(again), 20.5 * 7.25, 0.05));
+}
+
+TEST(RasterizerFillRules) {
+    // Nested squares wound the same way: NonZero fills the middle, EvenOdd cuts it out
+    Path nested;
+    nested.AddRectangle(10.0f, 10.0f, 80.0f, 80.0f);
+    nested.AddRectangle(30.0f, 30.0f, 40.0f, 40.0f);
+    PixelBuffer nonZero = FillPath(nested, FillRule::NonZero);
+    PixelBuffer evenOdd = FillPath(nested, FillRule::EvenOdd);
+    CHECK(CoverageAt(nonZero, 50, 50) == 255 && CoverageAt(evenOdd, 50, 50) == 0);
+    CHECK(CoverageAt(nonZero, 20, 50) == 255 && CoverageAt(evenOdd, 20, 50) == 255);
+    CHECK(Near(CoveredArea(nonZero), 80.0 * 80.0, 0.5));
+    CHECK(Near(CoveredArea(evenOdd), 80.0 * 80.0 - 40.0 * 40.0, 0.5));
+
+    // Wound the other way the inner square cancels under both rules
+    Path opposite;
+    opposite.AddRectangle(10.0f, 10.0f, 80.0f, 80.0f);
+    opposite.AddPolyline({ { 30.0f, 30.0f }, { 30.0f, 70.0f }, { 70.0f, 70.0f }, { 70.0f, 30.0f } }, true);
+    CHECK(CoverageAt(FillPath(opposite, FillRule::NonZero), 50, 50) == 0);
+    CHECK(CoverageAt(FillPath(opposite, FillRule::EvenOdd), 50, 50) == 0);
+
+    // A pentagram winds twice around its centre
+    Path star;
+    std::vector<PointF> points;
+    for (int i = 0; i < 5; i++) {
+        float angle = -1.5707963f + i * 2.0f * 2.0f * 3.14159265f / 5.0f;
+        points.push_back({ 50.0f + 40.0f * std::cos(angle), 50.0f + 40.0f * std::sin(angle) });
+    }
+    star.AddPolyline(points, true);
+    PixelBuffer starNonZero = FillPath(star, FillRule::NonZero);
+    PixelBuffer starEvenOdd = FillPath(star, FillRule::EvenOdd);
+    CHECK(CoverageAt(starNonZero, 50, 50) == 255 && CoverageAt(starEvenOdd, 50, 50) == 0);
+    CHECK(CoverageAt(starNonZero, 50, 15) == 255 && CoverageAt(starEvenOdd, 50, 15) == 255);
+}
+
+TEST(RasterizerStrokeJoins) {
+    // A right-angle turn whose outer corner is at the top right of (50, 10)
+    Path corner;
+    corner.MoveTo(10.0f, 10.0f);
+    corner.LineTo(50.0f, 10.0f);
+    corner.LineTo(50.0f, 50.0f);
+    StrokeStyle style;
+    style.width = 10.0f;
+
+    style.join = LineJoin::Miter;
+    PixelBuffer miter = StrokePath(corner, style);
+    style.join = LineJoin::Round;
+    PixelBuffer round = StrokePath(corner, style);
+    style.join = LineJoin::Bevel;
+    PixelBuffer bevel = StrokePath(corner, style);
+
+    // The miter fills the square corner, the round join part of it, the bevel none
+    CHECK(CoverageAt(miter, 54, 5) == 255);
+    CHECK(CoverageAt(round, 54, 5) == 0);
+    CHECK(CoverageAt(bevel, 54, 5) == 0);
+    CHECK(CoverageAt(round, 53, 6) > 0);
+    CHECK(CoverageAt(bevel, 53, 6) == 0);
+
+    // Pieces are unioned without seams or double counting; the joins add
+    // the corner square, a quarter disc and a half square
+    const double straight = 40.0 * 10.0 + 40.0 * 10.0 - 25.0;
+    CHECK(Near(CoveredArea(miter), straight + 25.0, 1.0));
+    CHECK(FlattenedArea(CoveredArea(round), straight + 3.14159265 * 25.0 / 4.0, 3.14159265 * 10.0 / 4.0));
+    CHECK(Near(CoveredArea(bevel), straight + 12.5, 1.0));
+    CHECK(CoverageAt(miter, 30, 10) == 255 && CoverageAt(miter, 50, 30) == 255);
+
+    // Past the miter limit the join falls back to a bevel
+    style.join = LineJoin::Miter;
+    style.miterLimit = 1.2f;
+    CHECK(CoverageAt(StrokePath(corner, style), 54, 5) == 0);
+}
+
+TEST(RasterizerStrokeCaps) {
+    Path line;
+    line.MoveTo(20.0f, 20.0f);
+    line.LineTo(40.0f, 20.0f);
+    StrokeStyle style;
+    style.width = 10.0f;
+
+    style.cap = LineCap::Butt;
+    PixelBuffer butt = StrokePath(line, style);
+    style.cap = LineCap::Square;
+    PixelBuffer square = StrokePath(line, style);
+    style.cap = LineCap::Round;
+    PixelBuffer round = StrokePath(line, style);
+
+    CHECK(Near(CoveredArea(butt), 20.0 * 10.0, 0.5));
+    CHECK(Near(CoveredArea(square), 30.0 * 10.0, 0.5));
+    CHECK(FlattenedArea(CoveredArea(round), 20.0 * 10.0 + 3.14159265 * 25.0, 3.14159265 * 10.0));
+
+    CHECK(CoverageAt(butt, 40, 20) == 0 && CoverageAt(butt, 39, 20) == 255);
+    CHECK(CoverageAt(square, 44, 16) == 255 && CoverageAt(square, 45, 16) == 0);
+    CHECK(CoverageAt(round, 43, 20) == 255 && CoverageAt(round, 44, 16) < 8);
+    CHECK(CoverageAt(round, 15, 20) > 0 && CoverageAt(butt, 19, 20) == 0);
+
+    // A single point only shows with caps that have extent
+    Path dot;
+    dot.MoveTo(50.0f, 50.0f);
+    style.cap = LineCap::Butt;
+    CHECK(CoveredArea(StrokePath(dot, style)) == 0.0);
+    style.cap = LineCap::Square;
+    CHECK(Near(CoveredArea(StrokePath(dot, style)), 100.0, 0.5));
+
+    // Closed contours have joins all round and no caps
+    PixelBuffer framed(100, 100, BLACK);
+    Rasterizer rasterizer;
+    StrokeStyle frame;
+    frame.width = 4.0f;
+    rasterizer.DrawRectangle(framed, { 10, 10, 60, 40 }, WHITE, frame);
+    CHECK(Near(CoveredArea(framed), 50.0 * 30.0 - 42.0 * 22.0, 0.5));
+    CHECK(CoverageAt(framed, 10, 10) == 255 && CoverageAt(framed, 59, 39) == 255);
+    CHECK(CoverageAt(framed, 9, 10) == 0 && CoverageAt(framed, 60, 39) == 0);
+    CHECK(CoverageAt(framed, 35, 25) == 0);
+}
\ No newline at end of file
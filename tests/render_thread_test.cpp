@@ -0,0 +1,100 @@
+#include "test.h"
+#include "core/render_thread.h"
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace PixelForge;
+
+namespace {
+
+template <typename Condition>
+bool WaitFor(Condition condition) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+CanvasScene Scene(std::shared_ptr<const PixelBuffer> image) {
+    CanvasScene scene;
+    scene.width = 64;
+    scene.height = 48;
+    scene.display = { 8, 8, 56, 40 };
+    scene.image = std::move(image);
+    return scene;
+}
+
+} // namespace
+
+TEST(RenderThreadSupersedesJobs) {
+    RenderThread thread(nullptr);
+    std::mutex mutex;
+    std::vector<int> ran;
+    auto record = [&](int id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ran.push_back(id);
+    };
+
+    // The first job holds the thread until it is told to stop
+    std::atomic<bool> started(false);
+    std::atomic<bool> gaveUp(false);
+    thread.Post([&](const std::atomic<bool>& superseded) {
+        started = true;
+        gaveUp = WaitFor([&]() { return superseded.load(); });
+        record(1);
+    });
+    CHECK(WaitFor([&]() { return started.load(); }));
+
+    // The second is replaced before it starts; only the newest runs
+    thread.Post([&](const std::atomic<bool>&) { record(2); });
+    thread.Post([&](const std::atomic<bool>&) { record(3); });
+    CHECK(WaitFor([&]() { return thread.Stats().jobsRun == 2; }));
+    CHECK(gaveUp);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        CHECK(ran == std::vector<int>({ 1, 3 }));
+    }
+    CHECK(thread.Stats().jobsSuperseded == 2);
+}
+
+TEST(RenderThreadDrawsFramesBeforeJobs) {
+    RenderThread thread(nullptr);
+    std::atomic<bool> release(false);
+    std::atomic<bool> started(false);
+    thread.Post([&](const std::atomic<bool>&) {
+        started = true;
+        WaitFor([&]() { return release.load(); });
+    });
+    CHECK(WaitFor([&]() { return started.load(); }));
+
+    // A job and a frame queue up behind the running job
+    auto image = std::make_shared<PixelBuffer>(32, 32);
+    std::atomic<uint64_t> framesBeforeJob(0);
+    std::atomic<bool> jobRan(false);
+    thread.Post([&](const std::atomic<bool>&) {
+        framesBeforeJob = thread.Stats().framesRendered;
+        jobRan = true;
+    });
+    uint64_t serial = thread.Request(Scene(image));
+
+    // The frame's image is in use until the frame is drawn
+    CHECK(thread.IsUsing(image.get()));
+    CHECK(!thread.IsUsing(nullptr));
+    release = true;
+    CHECK(thread.WaitForFrame(serial, 10000));
+    CHECK(WaitFor([&]() { return jobRan.load(); }));
+    CHECK(framesBeforeJob == 1);
+    CHECK(!thread.IsUsing(image.get()));
+
+    bool presented = thread.Present([&](const PixelBuffer& frame, uint64_t frameSerial) {
+        CHECK(frame.Width() == 64 && frame.Height() == 48);
+        CHECK(frameSerial == serial);
+    });
+    CHECK(presented);
+}
\ No newline at end of file
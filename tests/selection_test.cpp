@@ -0,0 +1,191 @@
+#include "test.h"
+#include "core/selection.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+
+using namespace PixelForge;
+
+namespace {
+
+const int WIDTH = 200;
+const int HEIGHT = 130;
+
+// True when every pixel's coverage matches expected(x, y)
+bool CoverageMatches(const Selection& selection, const std::function<int(int, int)>& expected) {
+    for (int y = 0; y < selection.Height(); y++) {
+        for (int x = 0; x < selection.Width(); x++) {
+            if (selection.CoverageAt(x, y) != expected(x, y)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int Inside(const IntRect& rect, int x, int y) {
+    return rect.Contains(x, y) ? 255 : 0;
+}
+
+std::vector<TileKind> TileKinds(const Selection& selection) {
+    std::vector<TileKind> kinds;
+    selection.ForEachTile([&](const SelectionTileView& tile) { kinds.push_back(tile.kind); });
+    return kinds;
+}
+
+} // namespace
+
+TEST(SelectionRunsCombine) {
+    const IntRect a = { 10, 5, 90, 60 };
+    const IntRect b = { 50, 30, 150, 100 };
+
+    Selection selection = Selection::Rectangle(WIDTH, HEIGHT, a);
+    CHECK(selection.Union(Selection::Rectangle(WIDTH, HEIGHT, b)));
+    CHECK(selection.IsHardEdged());
+    CHECK(CoverageMatches(selection, [&](int x, int y) { return Inside(a, x, y) | Inside(b, x, y); }));
+    CHECK(selection.Bounds().left == 10 && selection.Bounds().top == 5);
+    CHECK(selection.Bounds().right == 150 && selection.Bounds().bottom == 100);
+
+    selection = Selection::Rectangle(WIDTH, HEIGHT, a);
+    CHECK(selection.Intersect(Selection::Rectangle(WIDTH, HEIGHT, b)));
+    CHECK(CoverageMatches(selection, [&](int x, int y) { return Inside(a, x, y) & Inside(b, x, y); }));
+
+    selection = Selection::Rectangle(WIDTH, HEIGHT, a);
+    CHECK(selection.Subtract(Selection::Rectangle(WIDTH, HEIGHT, b)));
+    CHECK(CoverageMatches(selection, [&](int x, int y) { return Inside(a, x, y) & ~Inside(b, x, y) & 0xFF; }));
+
+    // Row 40 keeps [10, 50), which inverts into the spans either side
+    selection.Invert();
+    CHECK(CoverageMatches(selection, [&](int x, int y) { return (Inside(a, x, y) & ~Inside(b, x, y) & 0xFF) ^ 0xFF; }));
+    CHECK(selection.Runs().Row(40).size() == 2);
+
+    Selection all = Selection::All(WIDTH, HEIGHT);
+    all.Invert();
+    CHECK(all.IsEmpty());
+    CHECK(all.Bounds().IsEmpty());
+}
+
+TEST(SelectionRejectsSizeMismatch) {
+    const IntRect rect = { 20, 20, 80, 80 };
+    Selection selection = Selection::Rectangle(WIDTH, HEIGHT, rect);
+    const Selection other = Selection::All(WIDTH, HEIGHT + 1);
+    auto unchanged = [&]() { return CoverageMatches(selection, [&](int x, int y) { return Inside(rect, x, y); }); };
+
+    CHECK(!selection.Union(other));
+    CHECK(unchanged());
+    CHECK(!selection.Intersect(other));
+    CHECK(unchanged());
+    CHECK(!selection.Subtract(other));
+    CHECK(unchanged());
+    CHECK(!selection.Combine(other, SelectionOp::Add));
+    CHECK(unchanged());
+    CHECK(selection.Combine(other, SelectionOp::Replace));
+    CHECK(selection.Height() == HEIGHT + 1);
+
+    // A soft operand takes the tile path, which must check sizes too
+    Selection soft = Selection::Ellipse(WIDTH, HEIGHT, rect, true);
+    CHECK(!soft.IsHardEdged());
+    const uint8_t middle = soft.CoverageAt(50, 50);
+    CHECK(!soft.Intersect(Selection::Ellipse(WIDTH + 1, HEIGHT, rect, true)));
+    CHECK(soft.CoverageAt(50, 50) == middle);
+
+    RunMask runs(WIDTH, HEIGHT);
+    runs.Row(0).push_back({ 0, 10 });
+    CHECK(!runs.Intersect(RunMask(WIDTH - 1, HEIGHT)));
+    CHECK(runs.Contains(5, 0));
+
+    PixelBuffer pixels(WIDTH, HEIGHT - 1);
+    CHECK(!FillSelection(pixels, Selection::All(WIDTH, HEIGHT), 0xFFFFFFFF));
+    CHECK(!ApplySelection(pixels, PixelBuffer(WIDTH, HEIGHT - 1), Selection::All(WIDTH, HEIGHT)));
+}
+
+TEST(SelectionClassifiesTiles) {
+    // 200x130 is 4x3 tiles, the last column 8 pixels wide, the last row 2 high
+    CHECK(Selection(WIDTH, HEIGHT).TilesX() == 4 && Selection(WIDTH, HEIGHT).TilesY() == 3);
+
+    // Tile (0, 0) exactly, part of tile (1, 1), and all of the small corner tile
+    Selection selection = Selection::Rectangle(WIDTH, HEIGHT, { 0, 0, 64, 64 });
+    CHECK(selection.Union(Selection::Rectangle(WIDTH, HEIGHT, { 70, 70, 100, 90 })));
+    CHECK(selection.Union(Selection::Rectangle(WIDTH, HEIGHT, { 192, 128, 200, 130 })));
+
+    const std::vector<TileKind> expected = {
+        TileKind::Full,  TileKind::Empty,   TileKind::Empty, TileKind::Empty,
+        TileKind::Empty, TileKind::Partial, TileKind::Empty, TileKind::Empty,
+        TileKind::Empty, TileKind::Empty,   TileKind::Empty, TileKind::Full,
+    };
+    CHECK(TileKinds(selection) == expected);
+
+    // Converting to tiles classifies the same way and keeps every pixel
+    Selection tiled = selection;
+    tiled.ConvertToTiles();
+    CHECK(!tiled.IsHardEdged());
+    CHECK(TileKinds(tiled) == expected);
+    CHECK(CoverageMatches(tiled, [&](int x, int y) { return selection.CoverageAt(x, y); }));
+
+    SelectionTileView partial = tiled.GetTileView(1, 1);
+    CHECK(partial.coverage != nullptr);
+    CHECK(partial.coverage[(70 - 64) * partial.pitch + (70 - 64)] == 255);
+    CHECK(partial.coverage[(69 - 64) * partial.pitch + (70 - 64)] == 0);
+
+    // Combining a hard selection with a soft one goes through the tiles
+    Selection soft = Selection::Ellipse(WIDTH, HEIGHT, { 100, 10, 180, 120 }, true);
+    Selection combined = selection;
+    CHECK(combined.Union(soft));
+    CHECK(CoverageMatches(combined, [&](int x, int y) {
+        return (std::max)(selection.CoverageAt(x, y), soft.CoverageAt(x, y));
+    }));
+
+    // Painting through either form writes the same pixels
+    PixelBuffer viaRuns(WIDTH, HEIGHT);
+    PixelBuffer viaTiles(WIDTH, HEIGHT);
+    CHECK(FillSelection(viaRuns, selection, 0xFF102030));
+    CHECK(FillSelection(viaTiles, tiled, 0xFF102030));
+    CHECK(std::memcmp(viaRuns.Data(), viaTiles.Data(), static_cast<size_t>(WIDTH) * HEIGHT * 4) == 0);
+    CHECK(viaRuns.GetPixel(10, 10) == 0xFF102030 && viaRuns.GetPixel(100, 10) == 0);
+}
+
+TEST(SelectionFeather) {
+    const int size = 384;
+    const IntRect rect = { 128, 128, 256, 256 };
+    const int radius = 4;
+    Selection selection = Selection::Rectangle(size, size, rect);
+    CHECK(selection.Feather(radius));
+    CHECK(!selection.IsHardEdged());
+
+    // Deep inside and far outside stay hard; the edge ramps through half
+    CHECK(selection.CoverageAt(192, 192) == 255);
+    CHECK(selection.CoverageAt(128 + radius, 192) == 255);
+    CHECK(selection.CoverageAt(128 - radius - 1, 192) == 0);
+    CHECK(std::abs(selection.CoverageAt(128, 192) - 142) <= 1);     // 5 of 9 pixels
+    CHECK(std::abs(selection.CoverageAt(127, 192) - 113) <= 1);     // 4 of 9 pixels
+    bool ramps = true;
+    for (int x = 128 - radius - 1; x < 128 + radius; x++) {
+        ramps &= selection.CoverageAt(x, 192) < selection.CoverageAt(x + 1, 192);
+    }
+    CHECK(ramps);
+
+    // The blur keeps the selected area
+    long long total = 0;
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            total += selection.CoverageAt(x, y);
+        }
+    }
+    const long long area = 255LL * rect.Width() * rect.Height();
+    CHECK(std::llabs(total - area) < area / 100);
+
+    // Tiles well away from the edge keep their kind, not coverage bytes
+    SelectionTileView corner = selection.GetTileView(0, 0);
+    SelectionTileView edge = selection.GetTileView(2, 2);
+    CHECK(corner.kind == TileKind::Empty);
+    CHECK(edge.kind == TileKind::Partial);
+
+    // Feathering nothing or by zero changes nothing
+    Selection none(size, size);
+    CHECK(none.Feather(radius));
+    CHECK(none.IsEmpty());
+    Selection hard = Selection::Rectangle(size, size, rect);
+    CHECK(hard.Feather(0));
+    CHECK(hard.IsHardEdged());
+}
\ No newline at end of file
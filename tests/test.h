@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Defines a test case; it runs when the test binary starts
+#define TEST(name) \
+    static void name(); \
+    static PixelForge::Test::Registration name##Registration(#name, name); \
+    static void name()
+
+// Reports a failure without stopping the test
+#define CHECK(expression) \
+    do { \
+        if (!(expression)) { \
+            PixelForge::Test::Fail(__FILE__, __LINE__, #expression); \
+        } \
+    } while (0)
+
+namespace PixelForge {
+namespace Test {
+
+struct TestCase {
+    const char* name;
+    void (*run)();
+};
+
+std::vector<TestCase>& Registry();
+
+// Records a failed check; the test keeps running so one run reports them all
+void Fail(const char* file, int line, const char* expression);
+
+struct Registration {
+    Registration(const char* name, void (*run)()) { Registry().push_back({ name, run }); }
+};
+
+// Path for name in the system temporary directory; the file is not created
+std::wstring TempPath(const std::wstring& name);
+
+} // namespace Test
+} // namespace PixelForge
\ No newline at end of file
@@ -0,0 +1,54 @@
+#include "test.h"
+#include <filesystem>
+#include <stdio.h>
+
+namespace PixelForge {
+namespace Test {
+
+namespace {
+
+int g_failures = 0;
+
+} // namespace
+
+std::vector<TestCase>& Registry() {
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+void Fail(const char* file, int line, const char* expression) {
+    printf("  %s:%d: CHECK(%s) failed\n", file, line, expression);
+    g_failures++;
+}
+
+std::wstring TempPath(const std::wstring& name) {
+    std::error_code error;
+    std::filesystem::path directory = std::filesystem::temp_directory_path(error);
+    return (directory / (L"pixelforge-test-" + name)).wstring();
+}
+
+} // namespace Test
+} // namespace PixelForge
+
+int main(int argc, char** argv) {
+    using namespace PixelForge::Test;
+
+    // An argument runs only the tests whose names contain it
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+    int run = 0;
+    int failed = 0;
+    for (const TestCase& test : Registry()) {
+        if (filter && std::string(test.name).find(filter) == std::string::npos) {
+            continue;
+        }
+        int before = g_failures;
+        test.run();
+        run++;
+        if (g_failures != before) {
+            printf("FAILED %s\n", test.name);
+            failed++;
+        }
+    }
+    printf("%d of %d tests passed\n", run - failed, run);
+    return failed == 0 ? 0 : 1;
+}
\ No newline at end of file
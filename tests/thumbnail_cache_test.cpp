@@ -0,0 +1,275 @@
+#include "test.h"
+#include "core/thumbnail_cache.h"
+#include "utils/file_utils.h"
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+using namespace PixelForge;
+
+namespace {
+
+// On-disk layout, as written by ThumbnailCache
+const uint64_t SLOT_COUNT = 16384;
+const size_t HEADER_BYTES = 64;
+const size_t SLOT_BYTES = 32;
+const size_t HEADER_LIVE_BYTES = 32;
+const size_t SLOT_OFFSET = 8;
+const size_t SLOT_WIDTH = 20;
+
+// Fills with a color derived from key and marks the corners, so moved or
+// mixed-up pixels show
+PixelBuffer Thumbnail(uint64_t key, int width, int height) {
+    PixelBuffer thumbnail(width, height);
+    thumbnail.Clear(0xFF000000 | static_cast<uint32_t>(key * 0x9E3779B1u));
+    thumbnail.SetPixel(0, 0, static_cast<uint32_t>(key));
+    thumbnail.SetPixel(width - 1, height - 1, static_cast<uint32_t>(key >> 32) ^ 0x5A5A5A5A);
+    return thumbnail;
+}
+
+bool Matches(ThumbnailCache& cache, uint64_t key, int width, int height) {
+    PixelBuffer found;
+    if (!cache.Lookup(key, found) || found.Width() != width || found.Height() != height) {
+        return false;
+    }
+    PixelBuffer expected = Thumbnail(key, width, height);
+    return std::memcmp(found.Data(), expected.Data(), static_cast<size_t>(width) * height * 4) == 0;
+}
+
+size_t SlotPos(uint64_t key) {
+    return HEADER_BYTES + static_cast<size_t>(key % SLOT_COUNT) * SLOT_BYTES;
+}
+
+template <typename T>
+void Put(std::vector<uint8_t>& data, size_t pos, T value) {
+    std::memcpy(data.data() + pos, &value, sizeof(value));
+}
+
+template <typename T>
+T Get(const std::vector<uint8_t>& data, size_t pos) {
+    T value;
+    std::memcpy(&value, data.data() + pos, sizeof(value));
+    return value;
+}
+
+} // namespace
+
+TEST(ThumbnailCacheRoundTrip) {
+    const std::wstring path = Test::TempPath(L"round-trip.pftc");
+    DeleteFileAt(path);
+    {
+        ThumbnailCache cache;
+        CHECK(cache.Open(path));
+        for (uint64_t key = 1; key <= 20; key++) {
+            CHECK(cache.Insert(key, Thumbnail(key, 10 + static_cast<int>(key), 30)));
+        }
+        CHECK(cache.Contains(7) && !cache.Contains(21));
+        CHECK(Matches(cache, 7, 17, 30));
+        PixelBuffer missing;
+        CHECK(!cache.Lookup(99, missing));
+
+        // Replacing an entry leaves the old pixels as garbage, not as a second entry
+        CHECK(cache.Insert(7, Thumbnail(7, 40, 5)));
+        CHECK(Matches(cache, 7, 40, 5));
+
+        ThumbnailCacheStats stats = cache.Stats();
+        CHECK(stats.entries == 20);
+        CHECK(stats.hits == 2 && stats.misses == 1);
+        size_t live = 0;
+        for (int key = 1; key <= 20; key++) {
+            live += key == 7 ? 40 * 5 * 4 : (10 + key) * 30 * 4;
+        }
+        CHECK(stats.dataBytes == live);
+
+        // Unusable thumbnails are refused
+        CHECK(!cache.Insert(0, Thumbnail(1, 4, 4)));
+        CHECK(!cache.Insert(30, PixelBuffer()));
+        CHECK(!cache.Insert(31, PixelBuffer(0x10000, 1)));
+    }
+
+    // Everything is still there after reopening
+    ThumbnailCache reopened;
+    CHECK(reopened.Open(path));
+    CHECK(reopened.Stats().entries == 20);
+    CHECK(Matches(reopened, 7, 40, 5));
+    CHECK(Matches(reopened, 20, 30, 30));
+    reopened.Close();
+    DeleteFileAt(path);
+}
+
+TEST(ThumbnailCacheKeepsProbeChains) {
+    // Room for eight 16x16 thumbnails; overflowing evicts to three quarters
+    const std::wstring path = Test::TempPath(L"probe-chains.pftc");
+    DeleteFileAt(path);
+    ThumbnailCache cache(8 * 1024);
+    CHECK(cache.Open(path));
+
+    // Three keys homed on the last slot wrap round to slots 0 and 1, then
+    // keys homed on 0 and 1 are pushed to 2 and 3
+    const uint64_t last = SLOT_COUNT - 1;
+    const uint64_t chain[] = { last, last + SLOT_COUNT, last + 2 * SLOT_COUNT, 5 * SLOT_COUNT, 1 + 7 * SLOT_COUNT };
+    for (uint64_t key : chain) {
+        CHECK(cache.Insert(key, Thumbnail(key, 16, 16)));
+    }
+
+    // Replacing the head deletes it first; the rest shift back over the wrap
+    CHECK(cache.Insert(chain[0], Thumbnail(chain[0], 16, 16)));
+    bool found = true;
+    for (uint64_t key : chain) {
+        found &= Matches(cache, key, 16, 16);
+    }
+    CHECK(found);
+
+    // Fill up, touch all of the chain but its head, and overflow: the head
+    // and the older filler are evicted and the rest compacted
+    CHECK(cache.Insert(100, Thumbnail(100, 16, 16)));
+    CHECK(cache.Insert(200, Thumbnail(200, 16, 16)));
+    for (int i = 1; i < 5; i++) {
+        CHECK(Matches(cache, chain[i], 16, 16));
+    }
+    CHECK(cache.Insert(400, Thumbnail(400, 16, 16)));
+
+    ThumbnailCacheStats stats = cache.Stats();
+    CHECK(stats.evictions == 2);
+    CHECK(stats.entries == 6);
+    CHECK(!cache.Contains(chain[0]) && !cache.Contains(100));
+    found = Matches(cache, 200, 16, 16) && Matches(cache, 400, 16, 16);
+    for (int i = 1; i < 5; i++) {
+        found &= Matches(cache, chain[i], 16, 16);
+    }
+    CHECK(found);
+
+    // Keys that share a home still miss correctly
+    CHECK(!cache.Contains(last + 3 * SLOT_COUNT));
+    cache.Close();
+    DeleteFileAt(path);
+}
+
+TEST(ThumbnailCacheCompacts) {
+    // 256 KB thumbnails in an 8 MB budget; overflowing keeps 5.75 MB, more
+    // than several compaction steps' worth
+    const std::wstring path = Test::TempPath(L"compaction.pftc");
+    DeleteFileAt(path);
+    const size_t budget = 8 * 1024 * 1024;
+    const size_t thumbnailBytes = 256 * 256 * 4;
+    ThumbnailCache cache(budget);
+    CHECK(cache.Open(path));
+    for (uint64_t key = 1; key <= 32; key++) {
+        CHECK(cache.Insert(key, Thumbnail(key, 256, 256)));
+    }
+    CHECK(cache.Stats().evictions == 0);
+
+    // Touch the even keys so the odd ones are evicted, leaving holes all
+    // through the data for the survivors to slide into
+    for (uint64_t key = 2; key <= 32; key += 2) {
+        CHECK(Matches(cache, key, 256, 256));
+    }
+
+    // Lookups run between compaction steps and always see whole thumbnails
+    std::atomic<bool> done(false);
+    std::atomic<int> torn(0);
+    std::thread reader([&]() {
+        while (!done) {
+            for (uint64_t key = 2; key <= 32; key += 2) {
+                PixelBuffer found;
+                if (cache.Lookup(key, found)) {
+                    PixelBuffer expected = Thumbnail(key, 256, 256);
+                    if (std::memcmp(found.Data(), expected.Data(), thumbnailBytes) != 0) {
+                        torn++;
+                    }
+                }
+            }
+        }
+    });
+    for (uint64_t key = 33; key <= 40; key++) {
+        CHECK(cache.Insert(key, Thumbnail(key, 256, 256)));
+    }
+    done = true;
+    reader.join();
+    CHECK(torn == 0);
+
+    ThumbnailCacheStats stats = cache.Stats();
+    CHECK(stats.evictions > 0);
+    CHECK(stats.dataBytes == static_cast<size_t>(stats.entries) * thumbnailBytes);
+    CHECK(stats.dataBytes <= budget);
+    CHECK(stats.fileBytes <= HEADER_BYTES + SLOT_COUNT * SLOT_BYTES + budget);
+    bool intact = true;
+    for (uint64_t key = 33; key <= 40; key++) {
+        intact &= Matches(cache, key, 256, 256);
+    }
+    for (uint64_t key = 1; key <= 32; key++) {
+        intact &= !cache.Contains(key) || Matches(cache, key, 256, 256);
+    }
+    CHECK(intact);
+    cache.Close();
+
+    // The compacted pack reopens as it was left
+    ThumbnailCache reopened(budget);
+    CHECK(reopened.Open(path));
+    CHECK(reopened.Stats().entries == stats.entries);
+    CHECK(Matches(reopened, 40, 256, 256));
+    reopened.Close();
+    DeleteFileAt(path);
+}
+
+TEST(ThumbnailCacheRejectsDamagedPack) {
+    const std::wstring path = Test::TempPath(L"damaged.pftc");
+    const std::wstring copy = Test::TempPath(L"damaged-copy.pftc");
+    DeleteFileAt(path);
+    {
+        ThumbnailCache cache;
+        CHECK(cache.Open(path));
+        for (uint64_t key = 1; key <= 8; key++) {
+            CHECK(cache.Insert(key, Thumbnail(key, 16, 16)));
+        }
+    }
+    std::vector<uint8_t> data;
+    CHECK(ReadFileBytes(path, data));
+    const size_t slot = SlotPos(5);
+    CHECK(Get<uint64_t>(data, slot) == 5);
+
+    // Each damaged copy keeps the header totals consistent, so only the
+    // slot checks can catch it
+    auto opensEmpty = [&](const std::vector<uint8_t>& damaged) {
+        WriteFileBytes(copy, damaged.data(), damaged.size());
+        ThumbnailCache cache;
+        bool empty = cache.Open(copy) && cache.Stats().entries == 0 && !cache.Contains(5);
+        cache.Close();
+        return empty;
+    };
+
+    // An offset whose end wraps past zero
+    std::vector<uint8_t> damaged = data;
+    Put<uint64_t>(damaged, slot + SLOT_OFFSET, ~0ull - 100);
+    CHECK(opensEmpty(damaged));
+
+    // An offset past the data
+    damaged = data;
+    Put<uint64_t>(damaged, slot + SLOT_OFFSET, Get<uint64_t>(data, 24) - 100);
+    CHECK(opensEmpty(damaged));
+
+    // No pixels at all
+    damaged = data;
+    Put<uint16_t>(damaged, slot + SLOT_WIDTH, 0);
+    Put<uint32_t>(damaged, slot + SLOT_WIDTH - 4, 0);
+    Put<uint64_t>(damaged, HEADER_LIVE_BYTES, Get<uint64_t>(data, HEADER_LIVE_BYTES) - 16 * 16 * 4);
+    CHECK(opensEmpty(damaged));
+
+    // A size that disagrees with the dimensions
+    damaged = data;
+    Put<uint16_t>(damaged, slot + SLOT_WIDTH, 17);
+    CHECK(opensEmpty(damaged));
+
+    // A broken header
+    damaged = data;
+    damaged[0] ^= 1;
+    CHECK(opensEmpty(damaged));
+
+    // The undamaged pack still opens with everything in it
+    ThumbnailCache cache;
+    CHECK(cache.Open(path));
+    CHECK(cache.Stats().entries == 8 && Matches(cache, 5, 16, 16));
+    cache.Close();
+    DeleteFileAt(copy);
+    DeleteFileAt(path);
+}
\ No newline at end of file
@@ -0,0 +1,178 @@
+#include "test.h"
+#include "core/tile_store.h"
+#include "utils/file_utils.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#ifdef __linux__
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+using namespace PixelForge;
+
+namespace {
+
+const int TILE = 64;
+
+PixelBuffer MakeTile(int seed, bool noisy) {
+    PixelBuffer tile(TILE, TILE);
+    std::mt19937 random(seed);
+    for (int y = 0; y < TILE; y++) {
+        for (int x = 0; x < TILE; x++) {
+            tile.SetPixel(x, y, noisy ? static_cast<uint32_t>(random())
+                                      : MakeColor(static_cast<uint8_t>(seed), static_cast<uint8_t>(x / 4 * 4),
+                                                  static_cast<uint8_t>(y)));
+        }
+    }
+    return tile;
+}
+
+bool SamePixels(const PixelBuffer& a, const PixelBuffer& b) {
+    return a.Width() == b.Width() && a.Height() == b.Height() &&
+           std::memcmp(a.Data(), b.Data(), static_cast<size_t>(a.Width()) * a.Height() * 4) == 0;
+}
+
+// Trim only queues the writes; the worker lands them shortly after
+bool WaitForSwappedTiles(TileStore& store, int count) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (store.Stats().swappedTiles < count) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+#ifdef __linux__
+// The swap file is unlinked as soon as it is open, so reach it through the
+// process's descriptor table
+int FindSwapDescriptor(const std::wstring& path) {
+    const std::string target = NarrowPath(path) + " (deleted)";
+    DIR* dir = opendir("/proc/self/fd");
+    if (!dir) {
+        return -1;
+    }
+    int found = -1;
+    while (dirent* entry = readdir(dir)) {
+        char link[4096];
+        std::string name = std::string("/proc/self/fd/") + entry->d_name;
+        ssize_t length = readlink(name.c_str(), link, sizeof(link));
+        if (length > 0 && std::string(link, length) == target) {
+            found = atoi(entry->d_name);
+            break;
+        }
+    }
+    closedir(dir);
+    return found;
+}
+#endif
+
+} // namespace
+
+TEST(TileStoreRoundTripInMemory) {
+    TileStore store(L"");
+    std::vector<uint32_t> handles;
+    for (int i = 0; i < 8; i++) {
+        handles.push_back(store.Put(MakeTile(i, i % 2 == 1)));
+    }
+    TileStoreStats stats = store.Stats();
+    CHECK(stats.tiles == 8);
+    CHECK(stats.rawBytes == 8ull * TILE * TILE * 4);
+    CHECK(stats.memoryBytes < stats.rawBytes);
+
+    // Without a swap path Trim has nowhere to put tiles
+    store.Trim(0);
+    CHECK(store.Stats().swappedTiles == 0);
+
+    PixelBuffer tile;
+    for (int i = 0; i < 8; i++) {
+        CHECK(store.Take(handles[i], TILE, TILE, tile));
+        CHECK(SamePixels(tile, MakeTile(i, i % 2 == 1)));
+        // Taking frees the handle
+        CHECK(!store.Take(handles[i], TILE, TILE, tile));
+    }
+    CHECK(store.Stats().tiles == 0);
+    CHECK(store.MemoryBytes() == 0);
+}
+
+TEST(TileStoreRejectsWrongSize) {
+    TileStore store(L"");
+    uint32_t handle = store.Put(MakeTile(1, false));
+    PixelBuffer tile;
+    CHECK(!store.Take(handle, TILE, TILE - 1, tile));
+    CHECK(!store.Take(12345, TILE, TILE, tile));
+}
+
+TEST(TileStoreRoundTripThroughSwap) {
+    const int count = 40;
+    TileStore store(Test::TempPath(L"round-trip.swap"));
+    std::vector<uint32_t> handles;
+    for (int i = 0; i < count; i++) {
+        handles.push_back(store.Put(MakeTile(i, i % 3 == 0)));
+    }
+    store.Trim(0);
+    CHECK(WaitForSwappedTiles(store, count));
+    CHECK(store.MemoryBytes() == 0);
+    CHECK(store.Stats().swapWrites == static_cast<uint64_t>(count));
+
+    // Half are read ahead, the rest straight from the file
+    store.Prefetch(std::vector<uint32_t>(handles.begin(), handles.begin() + count / 2));
+    PixelBuffer tile;
+    for (int i = 0; i < count; i++) {
+        CHECK(store.Take(handles[i], TILE, TILE, tile));
+        CHECK(SamePixels(tile, MakeTile(i, i % 3 == 0)));
+    }
+    TileStoreStats stats = store.Stats();
+    CHECK(stats.tiles == 0);
+    CHECK(stats.swapReads == static_cast<uint64_t>(count));
+}
+
+TEST(TileStoreKeepsTilesWithoutSwapFile) {
+    TileStore store(Test::TempPath(L"no-such-directory/tiles.swap"));
+    uint32_t handle = store.Put(MakeTile(3, false));
+    store.Trim(0);
+    PixelBuffer tile;
+    CHECK(store.Take(handle, TILE, TILE, tile));
+    CHECK(SamePixels(tile, MakeTile(3, false)));
+}
+
+#ifdef __linux__
+TEST(TileStoreFailsOnDamagedSwapFile) {
+    const std::wstring path = Test::TempPath(L"damaged.swap");
+    const int count = 8;
+    TileStore store(path);
+    std::vector<uint32_t> handles;
+    for (int i = 0; i < count; i++) {
+        handles.push_back(store.Put(MakeTile(i, false)));
+    }
+    store.Trim(0);
+    CHECK(WaitForSwappedTiles(store, count));
+    const int fd = FindSwapDescriptor(path);
+    CHECK(fd >= 0);
+    if (fd < 0) {
+        return;
+    }
+
+    // Garbage where the compressed tiles were
+    const uint64_t swapBytes = store.Stats().swapFileBytes;
+    std::vector<uint8_t> garbage(static_cast<size_t>(swapBytes), 0xFF);
+    CHECK(pwrite(fd, garbage.data(), garbage.size(), 0) == static_cast<ssize_t>(garbage.size()));
+    PixelBuffer tile;
+    for (int i = 0; i < count / 2; i++) {
+        CHECK(!store.Take(handles[i], TILE, TILE, tile));
+    }
+
+    // Then cut the file short
+    CHECK(ftruncate(fd, 0) == 0);
+    for (int i = count / 2; i < count; i++) {
+        CHECK(!store.Take(handles[i], TILE, TILE, tile));
+    }
+    TileStoreStats stats = store.Stats();
+    CHECK(stats.tiles == 0);
+    CHECK(stats.swappedTiles == 0);
+}
+#endif
\ No newline at end of file